@@ -41,8 +41,8 @@ using namespace ShaderToggler;
 using namespace Shim::Constants;
 using namespace std;
 
-AddonUIData::AddonUIData(ShaderManager* pixelShaderManager, ShaderManager* vertexShaderManager, ShaderManager* computeShaderManager, ConstantHandlerBase* cHandler, atomic_uint32_t* activeCollectorFrameCounter):
-    _pixelShaderManager(pixelShaderManager), _vertexShaderManager(vertexShaderManager), _computeShaderManager(computeShaderManager), _activeCollectorFrameCounter(activeCollectorFrameCounter),
+AddonUIData::AddonUIData(ShaderManager* pixelShaderManager, ShaderManager* vertexShaderManager, ShaderManager* computeShaderManager, PipelineLookupTable* pipelineLookupTable, ConstantHandlerBase* cHandler, atomic_uint32_t* activeCollectorFrameCounter):
+    _pixelShaderManager(pixelShaderManager), _vertexShaderManager(vertexShaderManager), _computeShaderManager(computeShaderManager), _pipelineLookupTable(pipelineLookupTable), _activeCollectorFrameCounter(activeCollectorFrameCounter),
     _constantHandler(cHandler)
 {
     _toggleGroupIdShaderEditing = -1;
@@ -65,6 +65,46 @@ AddonUIData::AddonUIData(ShaderManager* pixelShaderManager, ShaderManager* verte
 }
 
 
+AddonUIData::~AddonUIData()
+{
+    delete _pixelShaderHashFilter.load();
+    delete _vertexShaderHashFilter.load();
+    delete _computeShaderHashFilter.load();
+}
+
+
+// Binds don't reach this, they read the groups the PipelineLookupTable stored per pipeline. The filter speeds up the callers that resolve
+// groups by hash: pipeline creation (one lookup per shader stage) and PipelineLookupTable::updateToggleGroups, which re-resolves every
+// known pipeline whenever groups or hunting change. Both see almost only hashes outside any group.
+static bool mayContainShaderHash(const atomic<const ShaderHashFilter*>& filter, uint32_t hash)
+{
+    EpochDomain::ReadGuard guard;
+    const ShaderHashFilter* hashFilter = filter.load(memory_order_acquire);
+
+    return hashFilter != nullptr && hashFilter->mayContain(hash);
+}
+
+
+static void publishShaderHashFilter(atomic<const ShaderHashFilter*>& filter, const unordered_map<uint32_t, GroupMask>& hashToToggleGroups)
+{
+    ShaderHashFilter* newFilter = nullptr;
+    if (hashToToggleGroups.size() > 0)
+    {
+        newFilter = new ShaderHashFilter(hashToToggleGroups.size());
+        for (const auto& [hash, _] : hashToToggleGroups)
+        {
+            newFilter->add(hash);
+        }
+    }
+
+    const ShaderHashFilter* oldFilter = filter.exchange(newFilter, memory_order_acq_rel);
+    if (oldFilter != nullptr)
+    {
+        EpochDomain::Retire([oldFilter]() { delete oldFilter; });
+    }
+}
+
+
 unordered_map<int, ToggleGroup>& AddonUIData::GetToggleGroups()
 {
     return _toggleGroups;
@@ -81,6 +121,56 @@ void AddonUIData::SignalToggleGroupRemoved(reshade::api::effect_runtime* runtime
     {
         func(runtime, group);
     }
+
+    ReleaseToggleGroupSlot(*group);
+}
+
+bool AddonUIData::AssignToggleGroupSlot(ToggleGroup& group)
+{
+    for (uint32_t slot = 0; slot < MAX_TOGGLE_GROUPS; slot++)
+    {
+        if (_toggleGroupsBySlot[slot] == nullptr)
+        {
+            _toggleGroupsBySlot[slot] = &group;
+            group.setSlot(slot);
+
+            if (group.isActive())
+            {
+                _activeToggleGroups.set(slot);
+            }
+
+            return true;
+        }
+    }
+
+    reshade::log::message(reshade::log::level::warning, std::format("Maximum of {} toggle groups reached, group \"{}\" will not be applied", MAX_TOGGLE_GROUPS, group.getName()).c_str());
+    return false;
+}
+
+void AddonUIData::ReleaseToggleGroupSlot(ToggleGroup& group)
+{
+    const uint32_t slot = group.getSlot();
+    if (slot < MAX_TOGGLE_GROUPS && _toggleGroupsBySlot[slot] == &group)
+    {
+        _toggleGroupsBySlot[slot] = nullptr;
+        _activeToggleGroups.reset(slot);
+    }
+
+    group.setSlot(INVALID_GROUP_SLOT);
+}
+
+void AddonUIData::ToggleGroupActive(ToggleGroup& group)
+{
+    group.toggleActive();
+
+    if (group.isActive())
+    {
+        _activeToggleGroups.set(group.getSlot());
+    }
+    else
+    {
+        _activeToggleGroups.reset(group.getSlot());
+    }
 }
 
 void AddonUIData::AssignPreferredGroupTechniques(std::unordered_map<std::string, EffectData>& allTechniques)
@@ -91,40 +181,81 @@ void AddonUIData::AssignPreferredGroupTechniques(std::unordered_map<std::string,
     }
 }
 
-const vector<ToggleGroup*>* AddonUIData::GetToggleGroupsForPixelShaderHash(uint32_t hash)
+GroupMask AddonUIData::GetToggleGroupsForPixelShaderHash(uint32_t hash)
 {
+    if (!mayContainShaderHash(_pixelShaderHashFilter, hash))
+    {
+        return GroupMask();
+    }
+
     const auto& it = _pixelShaderHashToToggleGroups.find(hash);
 
     if (it != _pixelShaderHashToToggleGroups.end())
     {
-        return &it->second;
+        return it->second;
     }
 
-    return nullptr;
+    return GroupMask();
 }
 
-const vector<ToggleGroup*>* AddonUIData::GetToggleGroupsForVertexShaderHash(uint32_t hash)
+GroupMask AddonUIData::GetToggleGroupsForVertexShaderHash(uint32_t hash)
 {
+    if (!mayContainShaderHash(_vertexShaderHashFilter, hash))
+    {
+        return GroupMask();
+    }
+
     const auto& it = _vertexShaderHashToToggleGroups.find(hash);
 
     if (it != _vertexShaderHashToToggleGroups.end())
     {
-        return &it->second;
+        return it->second;
     }
 
-    return nullptr;
+    return GroupMask();
 }
 
-const vector<ToggleGroup*>* AddonUIData::GetToggleGroupsForComputeShaderHash(uint32_t hash)
+GroupMask AddonUIData::GetToggleGroupsForComputeShaderHash(uint32_t hash)
 {
+    if (!mayContainShaderHash(_computeShaderHashFilter, hash))
+    {
+        return GroupMask();
+    }
+
     const auto& it = _computeShaderHashToToggleGroups.find(hash);
 
     if (it != _computeShaderHashToToggleGroups.end())
     {
-        return &it->second;
+        return it->second;
     }
 
-    return nullptr;
+    return GroupMask();
+}
+
+GroupMask AddonUIData::GetToggleGroupsForShaderHash(uint32_t stageIndex, uint32_t hash)
+{
+    switch (stageIndex)
+    {
+    case STAGE_INDEX_PIXEL:
+        return GetToggleGroupsForPixelShaderHash(hash);
+    case STAGE_INDEX_VERTEX:
+        return GetToggleGroupsForVertexShaderHash(hash);
+    case STAGE_INDEX_COMPUTE:
+        return GetToggleGroupsForComputeShaderHash(hash);
+    default:
+        return GroupMask();
+    }
+}
+
+/// <summary>
+/// Returns true if there's anything the render hooks could act on: an active group, hunting, collecting or editing.
+/// </summary>
+bool AddonUIData::IsWorkPossible() const
+{
+    return _activeToggleGroups.any() ||
+        _pixelShaderManager->isInHuntingMode() || _vertexShaderManager->isInHuntingMode() || _computeShaderManager->isInHuntingMode() ||
+        *_activeCollectorFrameCounter > 0 ||
+        _toggleGroupIdShaderEditing >= 0 || _toggleGroupIdEffectEditing >= 0 || _toggleGroupIdConstantEditing >= 0;
 }
 
 void AddonUIData::UpdateToggleGroupsForShaderHashes()
@@ -135,22 +266,28 @@ void AddonUIData::UpdateToggleGroupsForShaderHashes()
 
     for (auto& [_,group] : _toggleGroups)
     {
+        const uint32_t slot = group.getSlot();
+        if (slot == INVALID_GROUP_SLOT)
+        {
+            continue;
+        }
+
         // Only consider the currently hunted hash for the group being edited
         if (group.getId() == _toggleGroupIdShaderEditing && (_pixelShaderManager->isInHuntingMode() || _vertexShaderManager->isInHuntingMode() || _computeShaderManager->isInHuntingMode()))
         {
             if (_pixelShaderManager->isInHuntingMode())
             {
-                _pixelShaderHashToToggleGroups[_pixelShaderManager->getActiveHuntedShaderHash()].push_back(&group);
+                _pixelShaderHashToToggleGroups[_pixelShaderManager->getActiveHuntedShaderHash()].set(slot);
             }
 
             if (_vertexShaderManager->isInHuntingMode())
             {
-                _vertexShaderHashToToggleGroups[_vertexShaderManager->getActiveHuntedShaderHash()].push_back(&group);
+                _vertexShaderHashToToggleGroups[_vertexShaderManager->getActiveHuntedShaderHash()].set(slot);
             }
 
             if (_computeShaderManager->isInHuntingMode())
             {
-                _computeShaderHashToToggleGroups[_computeShaderManager->getActiveHuntedShaderHash()].push_back(&group);
+                _computeShaderHashToToggleGroups[_computeShaderManager->getActiveHuntedShaderHash()].set(slot);
             }
 
             continue;
@@ -158,19 +295,25 @@ void AddonUIData::UpdateToggleGroupsForShaderHashes()
 
         for (const auto& h : group.getPixelShaderHashes())
         {
-            _pixelShaderHashToToggleGroups[h].push_back(&group);
+            _pixelShaderHashToToggleGroups[h].set(slot);
         }
 
         for (const auto& h : group.getVertexShaderHashes())
         {
-            _vertexShaderHashToToggleGroups[h].push_back(&group);
+            _vertexShaderHashToToggleGroups[h].set(slot);
         }
 
         for (const auto& h : group.getComputeShaderHashes())
         {
-            _computeShaderHashToToggleGroups[h].push_back(&group);
+            _computeShaderHashToToggleGroups[h].set(slot);
         }
     }
+
+    publishShaderHashFilter(_pixelShaderHashFilter, _pixelShaderHashToToggleGroups);
+    publishShaderHashFilter(_vertexShaderHashFilter, _vertexShaderHashToToggleGroups);
+    publishShaderHashFilter(_computeShaderHashFilter, _computeShaderHashToToggleGroups);
+
+    _pipelineLookupTable->updateToggleGroups([this](uint32_t stageIndex, uint32_t hash) { return GetToggleGroupsForShaderHash(stageIndex, hash); });
 }
 
 const atomic_int& AddonUIData::GetToggleGroupIdShaderEditing() const
@@ -193,7 +336,12 @@ void AddonUIData::AddDefaultGroup()
 {
     ToggleGroup toAdd("Default", ToggleGroup::getNewGroupId());
     toAdd.setToggleKey(0);
-    _toggleGroups.emplace(toAdd.getId(), toAdd);
+    const auto& [it, _] = _toggleGroups.emplace(toAdd.getId(), toAdd);
+
+    if (!AssignToggleGroupSlot(it->second))
+    {
+        _toggleGroups.erase(it);
+    }
 }
 
 
@@ -234,7 +382,16 @@ void AddonUIData::LoadShaderTogglerIniFile(const string& fileName)
         _constHookCopyType = "gpu_readback";
     }
 
+    // Frames between copying constants into a readback buffer and reading them, only used by the gpu_readback copy type. Has to cover the
+    // frames a game keeps in flight, so it's at least 3.
+    _constReadbackLatency = iniFile.GetUInt("ConstantBufferReadbackLatency", "General");
+    if (_constReadbackLatency == UINT_MAX)
+    {
+        _constReadbackLatency = 3;
+    }
+
     _preventRuntimeReload = iniFile.GetBoolOrDefault("PreventRuntimeReload", "General", false);
+    _recordEventTrace = iniFile.GetBoolOrDefault("RecordEventTrace", "General", false);
 
     for (uint32_t i = 0; i < ARRAYSIZE(KeybindNames); i++)
     {
@@ -266,21 +423,18 @@ void AddonUIData::LoadShaderTogglerIniFile(const string& fileName)
         group.loadState(iniFile, groupCounter);		// groupCounter is normally 0 or greater. For when the old format is detected, it's -1 (and there's 1 group).
         groupCounter++;
 
-        for (const auto& h : group.getPixelShaderHashes())
+        // Groups beyond the slot limit are kept so they survive a save, but never match.
+        if (group.getSlot() == INVALID_GROUP_SLOT)
         {
-            _pixelShaderHashToToggleGroups[h].push_back(&group);
+            AssignToggleGroupSlot(group);
         }
-
-        for (const auto& h : group.getVertexShaderHashes())
+        else if (group.isActive())
         {
-            _vertexShaderHashToToggleGroups[h].push_back(&group);
-        }
-
-        for (const auto& h : group.getComputeShaderHashes())
-        {
-            _computeShaderHashToToggleGroups[h].push_back(&group);
+            _activeToggleGroups.set(group.getSlot());
         }
     }
+
+    UpdateToggleGroupsForShaderHashes();
 }
 
 
@@ -297,8 +451,10 @@ void AddonUIData::SaveShaderTogglerIniFile(const string& fileName)
 
     iniFile.SetValue("ConstantBufferHookType", _constHookType, "", "General");
     iniFile.SetValue("ConstantBufferHookCopyType", _constHookCopyType, "", "General");
+    iniFile.SetUInt("ConstantBufferReadbackLatency", _constReadbackLatency, "Frames before read back constants are used (3-4). Has to be at least the number of frames the game keeps in flight.", "General");
     iniFile.SetBool("TrackDescriptors", _trackDescriptors, "", "General");
     iniFile.SetBool("PreventRuntimeReload", _preventRuntimeReload, "", "General");
+    iniFile.SetBool("RecordEventTrace", _recordEventTrace, "", "General");
 
     for (uint32_t i = 0; i < ARRAYSIZE(KeybindNames); i++)
     {
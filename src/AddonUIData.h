@@ -32,11 +32,15 @@
 #pragma once
 
 #include <unordered_map>
+#include <array>
 #include <filesystem>
 #include <reshade.hpp>
 #include "ShaderManager.h"
+#include "PipelineLookupTable.h"
+#include "ShaderHashFilter.h"
 #include "CDataFile.h"
 #include "ToggleGroup.h"
+#include "GroupMask.h"
 #include "ConstantHandlerBase.h"
 #include "EffectData.h"
 
@@ -94,6 +98,7 @@ namespace AddonImGui
         ShaderToggler::ShaderManager* _pixelShaderManager;
         ShaderToggler::ShaderManager* _vertexShaderManager;
         ShaderToggler::ShaderManager* _computeShaderManager;
+        ShaderToggler::PipelineLookupTable* _pipelineLookupTable;
         Shim::Constants::ConstantHandlerBase* _constantHandler;
         std::atomic_uint32_t* _activeCollectorFrameCounter;
         std::atomic_uint _invocationLocation = 0;
@@ -102,27 +107,43 @@ namespace AddonImGui
         std::atomic_int _toggleGroupIdEffectEditing = -1;
         std::atomic_int _toggleGroupIdConstantEditing = -1;
         std::unordered_map<int, ShaderToggler::ToggleGroup> _toggleGroups;
-        std::unordered_map<uint32_t, std::vector<ShaderToggler::ToggleGroup*>> _pixelShaderHashToToggleGroups;
-        std::unordered_map<uint32_t, std::vector<ShaderToggler::ToggleGroup*>> _vertexShaderHashToToggleGroups;
-        std::unordered_map<uint32_t, std::vector<ShaderToggler::ToggleGroup*>> _computeShaderHashToToggleGroups;
+        std::array<ShaderToggler::ToggleGroup*, ShaderToggler::MAX_TOGGLE_GROUPS> _toggleGroupsBySlot = { };
+        ShaderToggler::GroupMask _activeToggleGroups;
+        std::unordered_map<uint32_t, ShaderToggler::GroupMask> _pixelShaderHashToToggleGroups;
+        std::unordered_map<uint32_t, ShaderToggler::GroupMask> _vertexShaderHashToToggleGroups;
+        std::unordered_map<uint32_t, ShaderToggler::GroupMask> _computeShaderHashToToggleGroups;
+        std::atomic<const ShaderToggler::ShaderHashFilter*> _pixelShaderHashFilter = nullptr;
+        std::atomic<const ShaderToggler::ShaderHashFilter*> _vertexShaderHashFilter = nullptr;
+        std::atomic<const ShaderToggler::ShaderHashFilter*> _computeShaderHashFilter = nullptr;
         int _startValueFramecountCollectionPhase = FRAMECOUNT_COLLECTION_PHASE_DEFAULT;
         float _overlayOpacity = 0.2f;
         uint32_t _keyBindings[ARRAYSIZE(KeybindNames)];
         std::string _constHookType = "default";
         std::string _constHookCopyType = "gpu_readback";
+        uint32_t _constReadbackLatency = 3;
         std::string _resourceShim = "none";
         bool _trackDescriptors = true;
         bool _preventRuntimeReload = false;
+        bool _recordEventTrace = false;
         std::filesystem::path _basePath;
         TabType _currentTab = TabType::TAB_NONE;
 
         std::vector<std::function<void(reshade::api::effect_runtime*, ShaderToggler::ToggleGroup*)>> _removalCallbacks;
+
+        bool AssignToggleGroupSlot(ShaderToggler::ToggleGroup& group);
+        void ReleaseToggleGroupSlot(ShaderToggler::ToggleGroup& group);
     public:
-        AddonUIData(ShaderToggler::ShaderManager* pixelShaderManager, ShaderToggler::ShaderManager* vertexShaderManager, ShaderToggler::ShaderManager* computeShaderManager, Shim::Constants::ConstantHandlerBase* constants, std::atomic_uint32_t* activeCollectorFrameCounter);
+        AddonUIData(ShaderToggler::ShaderManager* pixelShaderManager, ShaderToggler::ShaderManager* vertexShaderManager, ShaderToggler::ShaderManager* computeShaderManager, ShaderToggler::PipelineLookupTable* pipelineLookupTable, Shim::Constants::ConstantHandlerBase* constants, std::atomic_uint32_t* activeCollectorFrameCounter);
+        ~AddonUIData();
         std::unordered_map<int, ShaderToggler::ToggleGroup>& GetToggleGroups();
-        const std::vector<ShaderToggler::ToggleGroup*>* GetToggleGroupsForPixelShaderHash(uint32_t hash);
-        const std::vector<ShaderToggler::ToggleGroup*>* GetToggleGroupsForVertexShaderHash(uint32_t hash);
-        const std::vector<ShaderToggler::ToggleGroup*>* GetToggleGroupsForComputeShaderHash(uint32_t hash);
+        ShaderToggler::GroupMask GetToggleGroupsForPixelShaderHash(uint32_t hash);
+        ShaderToggler::GroupMask GetToggleGroupsForVertexShaderHash(uint32_t hash);
+        ShaderToggler::GroupMask GetToggleGroupsForComputeShaderHash(uint32_t hash);
+        ShaderToggler::GroupMask GetToggleGroupsForShaderHash(uint32_t stageIndex, uint32_t hash);
+        ShaderToggler::ToggleGroup* GetToggleGroupBySlot(uint32_t slot) const { return slot < ShaderToggler::MAX_TOGGLE_GROUPS ? _toggleGroupsBySlot[slot] : nullptr; }
+        const ShaderToggler::GroupMask& GetActiveToggleGroups() const { return _activeToggleGroups; }
+        void ToggleGroupActive(ShaderToggler::ToggleGroup& group);
+        bool IsWorkPossible() const;
         void UpdateToggleGroupsForShaderHashes();
         void AddDefaultGroup();
         const std::atomic_int& GetToggleGroupIdShaderEditing() const;
@@ -155,6 +176,7 @@ namespace AddonImGui
         uint32_t GetKeybinding(Keybind keybind) const;
         const std::string& GetConstHookType() { return _constHookType; }
         const std::string& GetConstHookCopyType()  { return _constHookCopyType; }
+        uint32_t GetConstReadbackLatency() const { return _constReadbackLatency; }
         const std::string& GetResourceShim() { return _resourceShim; }
         void SetConstHookCopyType(std::string& copyType) { _constHookCopyType = copyType; }
         void SetResourceShim(std::string& shim) { _resourceShim = shim; }
@@ -166,6 +188,8 @@ namespace AddonImGui
         void SignalToggleGroupRemoved(reshade::api::effect_runtime*, ShaderToggler::ToggleGroup*);
         bool GetPreventRuntimeReload() const { return _preventRuntimeReload; }
         void SetPreventRuntimeReload(bool reload) { _preventRuntimeReload = reload; }
+        bool GetRecordEventTrace() const { return _recordEventTrace; }
+        void SetRecordEventTrace(bool record) { _recordEventTrace = record; }
 
         void AssignPreferredGroupTechniques(std::unordered_map<std::string, EffectData>& allTechniques);
     };
@@ -40,6 +40,7 @@
 #include "KeyData.h"
 #include "ResourceManager.h"
 #include "ConstantManager.h"
+#include "StateTracking.h"
 
 #define MAX_DESCRIPTOR_INDEX 10
 
@@ -1199,10 +1200,21 @@ static void DisplaySettings(AddonImGui::AddonUIData& instance, reshade::api::eff
         bool trackDescriptors = instance.GetTrackDescriptors();
         ImGui::Checkbox("Track descriptors", &trackDescriptors);
         instance.SetTrackDescriptors(trackDescriptors);
+        if (state_tracking::is_tracking_descriptors())
+        {
+            ImGui::SameLine();
+            ImGui::Text(std::format(" Heap offset lookups cached last frame: {}", runtime->get_device()->get_private_data<descriptor_tracking>().get_translations_saved_last_frame()).c_str());
+        }
 
         bool runtimeReload = instance.GetPreventRuntimeReload();
         ImGui::Checkbox("Prevent runtime reload", &runtimeReload);
         instance.SetPreventRuntimeReload(runtimeReload);
+
+        bool recordEventTrace = instance.GetRecordEventTrace();
+        ImGui::Checkbox("Record event trace", &recordEventTrace);
+        ImGui::SameLine();
+        ShowHelpMarker("Records the draw, bind and descriptor events the addon sees to ShaderToggler.trace next to the addon, for offline profiling. Takes effect after a restart of the game.");
+        instance.SetRecordEventTrace(recordEventTrace);
     }
 
     if (ImGui::CollapsingHeader("Keybindings", ImGuiTreeNodeFlags_None))
@@ -1245,7 +1257,7 @@ static void DisplaySettings(AddonImGui::AddonUIData& instance, reshade::api::eff
             ImGui::Checkbox("Active", &groupActive);
             if (groupActive != group.isActive())
             {
-                group.toggleActive();
+                instance.ToggleGroupActive(group);
 
                 if (!groupActive && instance.GetConstantHandler() != nullptr)
                 {
@@ -0,0 +1,365 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <bit>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <cstring>
+#include <type_traits>
+#include "EpochDomain.h"
+
+namespace ShaderToggler
+{
+    /// <summary>
+    /// Open addressing map from non-zero 64 bit handles to small trivially copyable values, for data that is read on every bind and written
+    /// rarely. Lookups never take a lock: each slot is guarded by a seqlock and grown tables are released through the EpochDomain. Writers
+    /// are serialized by an internal mutex.
+    /// </summary>
+    template<typename T>
+    class ConcurrentHandleMap
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "ConcurrentHandleMap values have to be trivially copyable");
+
+    public:
+        ConcurrentHandleMap() : _table(new Table(MIN_CAPACITY))
+        {
+        }
+
+        ~ConcurrentHandleMap()
+        {
+            delete _table.load(std::memory_order_relaxed);
+        }
+
+        ConcurrentHandleMap(const ConcurrentHandleMap&) = delete;
+        ConcurrentHandleMap& operator=(const ConcurrentHandleMap&) = delete;
+
+        bool find(uint64_t key, T& value) const
+        {
+            EpochDomain::ReadGuard guard;
+            const Table* table = _table.load(std::memory_order_acquire);
+
+            size_t index = table->indexOf(key);
+            for (size_t probe = 0; probe <= table->mask; probe++, index = (index + 1) & table->mask)
+            {
+                const Slot& slot = table->slots[index];
+                const uint64_t slotKey = slot.key.load(std::memory_order_acquire);
+
+                if (slotKey == EMPTY_KEY)
+                {
+                    return false;
+                }
+
+                if (slotKey == key && readSlot(slot, key, value))
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool contains(uint64_t key) const
+        {
+            T value;
+            return find(key, value);
+        }
+
+        size_t size() const
+        {
+            return _size.load(std::memory_order_relaxed);
+        }
+
+        void insert_or_assign(uint64_t key, const T& value)
+        {
+            update(key, [&value](T& v) { v = value; });
+        }
+
+        /// <summary>
+        /// Calls func with the current value for key, or a value initialized T if key isn't present yet, and stores the result.
+        /// </summary>
+        template<typename F>
+        void update(uint64_t key, F&& func)
+        {
+            if (key == EMPTY_KEY || key == TOMBSTONE_KEY)
+            {
+                return;
+            }
+
+            std::unique_lock lock(_writeMutex);
+
+            Table* table = _table.load(std::memory_order_relaxed);
+            Slot* slot = findSlotLocked(table, key);
+            if (slot != nullptr)
+            {
+                T value = loadSlotLocked(*slot);
+                func(value);
+                writeSlot(*slot, key, value);
+                return;
+            }
+
+            if ((_used + 1) * 2 > table->mask + 1)
+            {
+                table = rehashLocked(table);
+            }
+
+            Slot* target = nullptr;
+            size_t index = table->indexOf(key);
+            for (;; index = (index + 1) & table->mask)
+            {
+                const uint64_t slotKey = table->slots[index].key.load(std::memory_order_relaxed);
+                if (slotKey == TOMBSTONE_KEY || slotKey == EMPTY_KEY)
+                {
+                    target = &table->slots[index];
+                    if (slotKey == EMPTY_KEY)
+                    {
+                        _used++;
+                    }
+                    break;
+                }
+            }
+
+            T value{};
+            func(value);
+            writeSlot(*target, key, value);
+            _size.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bool erase(uint64_t key, T* removed = nullptr)
+        {
+            if (key == EMPTY_KEY || key == TOMBSTONE_KEY)
+            {
+                return false;
+            }
+
+            std::unique_lock lock(_writeMutex);
+
+            Slot* slot = findSlotLocked(_table.load(std::memory_order_relaxed), key);
+            if (slot == nullptr)
+            {
+                return false;
+            }
+
+            if (removed != nullptr)
+            {
+                *removed = loadSlotLocked(*slot);
+            }
+
+            writeSlot(*slot, TOMBSTONE_KEY, T{});
+            _size.fetch_sub(1, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        /// <summary>
+        /// Calls func(key, value) for every entry and stores the value it leaves behind.
+        /// </summary>
+        template<typename F>
+        void update_all(F&& func)
+        {
+            std::unique_lock lock(_writeMutex);
+
+            Table* table = _table.load(std::memory_order_relaxed);
+            for (size_t i = 0; i <= table->mask; i++)
+            {
+                Slot& slot = table->slots[i];
+                const uint64_t slotKey = slot.key.load(std::memory_order_relaxed);
+                if (slotKey != EMPTY_KEY && slotKey != TOMBSTONE_KEY)
+                {
+                    T value = loadSlotLocked(slot);
+                    func(slotKey, value);
+                    writeSlot(slot, slotKey, value);
+                }
+            }
+        }
+
+    private:
+        static constexpr uint64_t EMPTY_KEY = 0;
+        static constexpr uint64_t TOMBSTONE_KEY = UINT64_MAX;
+        static constexpr size_t MIN_CAPACITY = 64;
+        static constexpr size_t VALUE_WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        struct Slot
+        {
+            std::atomic<uint32_t> sequence;
+            std::atomic<uint64_t> key;
+            std::atomic<uint64_t> value[VALUE_WORDS];
+        };
+
+        struct Table
+        {
+            Table(size_t capacity) : mask(capacity - 1), shift(64 - std::countr_zero(capacity)), slots(std::make_unique<Slot[]>(capacity))
+            {
+            }
+
+            size_t indexOf(uint64_t key) const
+            {
+                // fibonacci hashing, pipeline handles are pointers with their low bits mostly zero
+                return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift);
+            }
+
+            const size_t mask;
+            const uint32_t shift;
+            std::unique_ptr<Slot[]> slots;
+        };
+
+        static bool readSlot(const Slot& slot, uint64_t key, T& value)
+        {
+            uint64_t words[VALUE_WORDS];
+
+            for (;;)
+            {
+                const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+                if (sequence & 1)
+                {
+                    // writer is busy with this slot, it only holds it for a couple of stores
+                    continue;
+                }
+
+                const uint64_t slotKey = slot.key.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < VALUE_WORDS; i++)
+                {
+                    words[i] = slot.value[i].load(std::memory_order_relaxed);
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+                {
+                    continue;
+                }
+
+                if (slotKey != key)
+                {
+                    // removed in the meantime
+                    return false;
+                }
+
+                memcpy(&value, words, sizeof(T));
+                return true;
+            }
+        }
+
+        static T loadSlotLocked(const Slot& slot)
+        {
+            uint64_t words[VALUE_WORDS];
+            for (size_t i = 0; i < VALUE_WORDS; i++)
+            {
+                words[i] = slot.value[i].load(std::memory_order_relaxed);
+            }
+
+            T value;
+            memcpy(&value, words, sizeof(T));
+            return value;
+        }
+
+        static void writeSlot(Slot& slot, uint64_t key, const T& value)
+        {
+            uint64_t words[VALUE_WORDS] = {};
+            memcpy(words, &value, sizeof(T));
+
+            const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for (size_t i = 0; i < VALUE_WORDS; i++)
+            {
+                slot.value[i].store(words[i], std::memory_order_relaxed);
+            }
+            slot.key.store(key, std::memory_order_relaxed);
+
+            slot.sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        static Slot* findSlotLocked(Table* table, uint64_t key)
+        {
+            size_t index = table->indexOf(key);
+            for (size_t probe = 0; probe <= table->mask; probe++, index = (index + 1) & table->mask)
+            {
+                const uint64_t slotKey = table->slots[index].key.load(std::memory_order_relaxed);
+                if (slotKey == EMPTY_KEY)
+                {
+                    return nullptr;
+                }
+
+                if (slotKey == key)
+                {
+                    return &table->slots[index];
+                }
+            }
+
+            return nullptr;
+        }
+
+        Table* rehashLocked(Table* table)
+        {
+            const size_t size = _size.load(std::memory_order_relaxed);
+            size_t capacity = MIN_CAPACITY;
+            while (capacity < (size + 1) * 4)
+            {
+                capacity *= 2;
+            }
+
+            Table* newTable = new Table(capacity);
+            for (size_t i = 0; i <= table->mask; i++)
+            {
+                const Slot& slot = table->slots[i];
+                const uint64_t slotKey = slot.key.load(std::memory_order_relaxed);
+                if (slotKey == EMPTY_KEY || slotKey == TOMBSTONE_KEY)
+                {
+                    continue;
+                }
+
+                size_t index = newTable->indexOf(slotKey);
+                while (newTable->slots[index].key.load(std::memory_order_relaxed) != EMPTY_KEY)
+                {
+                    index = (index + 1) & newTable->mask;
+                }
+
+                writeSlot(newTable->slots[index], slotKey, loadSlotLocked(slot));
+            }
+
+            _table.store(newTable, std::memory_order_release);
+            _used = size;
+
+            EpochDomain::Retire([table]() { delete table; });
+
+            return newTable;
+        }
+
+        std::atomic<Table*> _table;
+        std::atomic<size_t> _size = 0;
+        size_t _used = 0;
+        std::mutex _writeMutex;
+    };
+}
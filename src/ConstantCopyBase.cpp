@@ -4,8 +4,7 @@ using namespace Shim::Constants;
 using namespace reshade::api;
 using namespace std;
 
-unordered_map<uint64_t, vector<uint8_t>> ConstantCopyBase::deviceToHostConstantBuffer;
-shared_mutex ConstantCopyBase::deviceHostMutex;
+HostBufferMirrors ConstantCopyBase::hostBuffers;
 
 ConstantCopyBase::ConstantCopyBase()
 {
@@ -17,49 +16,37 @@ ConstantCopyBase::~ConstantCopyBase()
 
 }
 
-void ConstantCopyBase::GetHostConstantBuffer(reshade::api::command_list* cmd_list, ShaderToggler::ToggleGroup* group, vector<uint8_t>& dest, size_t size, uint64_t resourceHandle)
+bool ConstantCopyBase::IsHostConstantBufferMirrored(uint64_t handle)
 {
-    shared_lock<shared_mutex> lock(deviceHostMutex);
-    const auto& it = deviceToHostConstantBuffer.find(resourceHandle);
-    if (it != deviceToHostConstantBuffer.end())
-    {
-        auto& [_, buffer] = *it;
-        std::memcpy(dest.data(), buffer.data(), size);
-    }
+    return hostBuffers.mirrored(handle);
+}
+
+void ConstantCopyBase::GetHostConstantBuffer(reshade::api::command_list* cmd_list, ShaderToggler::ToggleGroup* group, vector<uint8_t>& dest, size_t size, uint64_t resourceHandle, const vector<ConstantRange>& ranges)
+{
+    hostBuffers.read(resourceHandle, dest, size, ranges);
 }
 
 void ConstantCopyBase::CreateHostConstantBuffer(device* dev, resource resource, size_t size)
 {
-    unique_lock<shared_mutex> lock(deviceHostMutex);
-    deviceToHostConstantBuffer.emplace(resource.handle, vector<uint8_t>(size, 0));
+    hostBuffers.add(resource.handle, size);
 }
 
 void ConstantCopyBase::DeleteHostConstantBuffer(resource resource)
 {
-    unique_lock<shared_mutex> lock(deviceHostMutex);
-    deviceToHostConstantBuffer.erase(resource.handle);
+    hostBuffers.remove(resource.handle);
 }
 
 inline void ConstantCopyBase::SetHostConstantBuffer(const uint64_t handle, const void* buffer, size_t size, uintptr_t offset, uint64_t bufferSize)
 {
-    unique_lock<shared_mutex> lock(deviceHostMutex);
-    const auto& it = deviceToHostConstantBuffer.find(handle);
-    if (it != deviceToHostConstantBuffer.end())
-    {
-        auto& [_, cBuffer] = *it;
-        memcpy(&cBuffer[offset], buffer, size);
-    }
+    hostBuffers.write(handle, buffer, size, offset);
 }
 
 void ConstantCopyBase::OnInitResource(device* device, const resource_desc& desc, const subresource_data* initData, resource_usage usage, reshade::api::resource handle)
 {
     if (desc.heap == memory_heap::cpu_to_gpu && static_cast<uint32_t>(desc.usage & resource_usage::constant_buffer))
     {
+        // Initial data isn't kept, a mirror only exists once a group extracts from the buffer and fills with the game's next write
         CreateHostConstantBuffer(device, handle, static_cast<size_t>(desc.buffer.size));
-        if (initData != nullptr && initData->data != nullptr)
-        {
-            SetHostConstantBuffer(handle.handle, initData->data, static_cast<size_t>(desc.buffer.size), 0, desc.buffer.size);
-        }
     }
 }
 
@@ -70,4 +57,17 @@ void ConstantCopyBase::OnDestroyResource(device* device, resource res)
     {
         DeleteHostConstantBuffer(res);
     }
-}
\ No newline at end of file
+}
+
+void ConstantCopyBase::OnReshadePresent(effect_runtime* runtime)
+{
+    hostBuffers.advance_frame();
+}
+
+void ConstantCopyBase::OnDestroyDevice(device* device)
+{
+}
+
+void ConstantCopyBase::RemoveGroup(const ShaderToggler::ToggleGroup* group, device* device)
+{
+}
@@ -4,8 +4,9 @@
 #include <reshade_api_device.hpp>
 #include <reshade_api_pipeline.hpp>
 #include <unordered_map>
-#include <shared_mutex>
+#include <vector>
 #include "ToggleGroup.h"
+#include "HostBufferMirrors.h"
 
 namespace Shim
 {
@@ -19,7 +20,7 @@ namespace Shim
             virtual bool Init() = 0;
             virtual bool UnInit() = 0;
 
-            virtual void GetHostConstantBuffer(reshade::api::command_list* cmd_list, ShaderToggler::ToggleGroup* group, std::vector<uint8_t>& dest, size_t size, uint64_t resourceHandle);
+            virtual void GetHostConstantBuffer(reshade::api::command_list* cmd_list, ShaderToggler::ToggleGroup* group, std::vector<uint8_t>& dest, size_t size, uint64_t resourceHandle, const std::vector<ConstantRange>& ranges);
             virtual void CreateHostConstantBuffer(reshade::api::device* dev, reshade::api::resource resource, size_t size);
             virtual void DeleteHostConstantBuffer(reshade::api::resource resource);
             virtual inline void SetHostConstantBuffer(const uint64_t handle, const void* buffer, size_t size, uintptr_t offset, uint64_t bufferSize);
@@ -30,9 +31,15 @@ namespace Shim
             virtual void OnUpdateBufferRegion(reshade::api::device* device, const void* data, reshade::api::resource resource, uint64_t offset, uint64_t size) = 0;
             virtual void OnMapBufferRegion(reshade::api::device* device, reshade::api::resource resource, uint64_t offset, uint64_t size, reshade::api::map_access access, void** data) = 0;
             virtual void OnUnmapBufferRegion(reshade::api::device* device, reshade::api::resource resource) = 0;
+
+            virtual void OnReshadePresent(reshade::api::effect_runtime* runtime);
+            virtual void OnDestroyDevice(reshade::api::device* device);
+            virtual void RemoveGroup(const ShaderToggler::ToggleGroup* group, reshade::api::device* device);
         protected:
-            static std::unordered_map<uint64_t, std::vector<uint8_t>> deviceToHostConstantBuffer;
-            static std::shared_mutex deviceHostMutex;
+            bool IsHostConstantBufferMirrored(uint64_t handle);
+
+        private:
+            static HostBufferMirrors hostBuffers;
         };
     }
 }
@@ -33,14 +33,20 @@ bool ConstantCopyFFXIV::UnInit()
     return MH_Uninitialize() == MH_OK;
 }
 
-void ConstantCopyFFXIV::GetHostConstantBuffer(command_list* cmd_list, ShaderToggler::ToggleGroup* group, vector<uint8_t>& dest, size_t size, uint64_t resourceHandle)
+void ConstantCopyFFXIV::GetHostConstantBuffer(command_list* cmd_list, ShaderToggler::ToggleGroup* group, vector<uint8_t>& dest, size_t size, uint64_t resourceHandle, const vector<ConstantRange>& ranges)
 {
     const auto& ff = _hostResourceBufferMap.find(resourceHandle);
     if (ff != _hostResourceBufferMap.end())
     {
         auto& [buffer, bufHandle, bufSize, mapped] = _hostResourceBuffer[ff->second];
         size_t minSize = std::min(size, bufSize);
-        memcpy(dest.data(), buffer, minSize);
+        for (const auto& range : ranges)
+        {
+            if (range.offset < minSize)
+            {
+                memcpy(dest.data() + range.offset, static_cast<const uint8_t*>(buffer) + range.offset, std::min(range.size, minSize - range.offset));
+            }
+        }
     }
 }
 
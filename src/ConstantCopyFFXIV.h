@@ -43,7 +43,7 @@ namespace Shim
             void OnUpdateBufferRegion(reshade::api::device* device, const void* data, reshade::api::resource resource, uint64_t offset, uint64_t size) override final {};
             void OnMapBufferRegion(reshade::api::device* device, reshade::api::resource resource, uint64_t offset, uint64_t size, reshade::api::map_access access, void** data) override final {};
             void OnUnmapBufferRegion(reshade::api::device* device, reshade::api::resource resource) override final {};
-            void GetHostConstantBuffer(reshade::api::command_list* cmd_list, ShaderToggler::ToggleGroup* group, std::vector<uint8_t>& dest, size_t size, uint64_t resourceHandle) override final;
+            void GetHostConstantBuffer(reshade::api::command_list* cmd_list, ShaderToggler::ToggleGroup* group, std::vector<uint8_t>& dest, size_t size, uint64_t resourceHandle, const std::vector<ConstantRange>& ranges) override final;
         private:
             static std::vector<std::tuple<const void*, uint64_t, size_t, bool>> _hostResourceBuffer;
             static std::unordered_map<uint64_t, uint64_t> _hostResourceBufferMap;
@@ -1,4 +1,5 @@
 #include <cstring>
+#include <algorithm>
 #include "ConstantCopyGPUReadback.h"
 #include "PipelinePrivateData.h"
 
@@ -7,24 +8,228 @@ using namespace reshade::api;
 using namespace ShaderToggler;
 using namespace std;
 
+ConstantCopyGPUReadback::ConstantCopyGPUReadback(uint32_t latency) : latency(std::clamp(latency, MIN_LATENCY, MAX_LATENCY))
+{
+}
+
+void ConstantCopyGPUReadback::CreateRing(device* device, ReadbackRing& ring, uint64_t size)
+{
+    ring.device = device;
+    ring.size = size;
+    ring.next = 0;
+    ring.latest.assign(static_cast<size_t>(size), 0);
+
+    // One buffer per frame in flight plus the one copied into this frame
+    ring.slots.resize(latency + 1);
+    for (auto& slot : ring.slots)
+    {
+        slot = ReadbackSlot{};
+        if (!device->create_resource(resource_desc(size, memory_heap::gpu_to_cpu, resource_usage::copy_dest), nullptr, resource_usage::copy_dest, &slot.res))
+        {
+            reshade::log::message(reshade::log::level::error, "Failed to create group constant copy buffer!");
+            // Keep the size so a failing buffer isn't recreated on every extraction
+            RetireRing(ring);
+            ring.size = size;
+            return;
+        }
+    }
+}
+
+void ConstantCopyGPUReadback::RetireRing(ReadbackRing& ring)
+{
+    // Copies into these buffers may still be in flight, destroy them once they have retired
+    for (const auto& slot : ring.slots)
+    {
+        if (slot.res != 0)
+        {
+            retiredBuffers.push_back(RetiredBuffer{ ring.device, slot.res, slot.copyFrame == NO_COPY ? 0 : slot.copyFrame });
+        }
+    }
+
+    ring.slots.clear();
+    ring.size = 0;
+}
+
+void ConstantCopyGPUReadback::ReadRetiredSlots(ReadbackRing& ring)
+{
+    ReadbackSlot* newest = nullptr;
+
+    for (auto& slot : ring.slots)
+    {
+        if (slot.pending && IsRetired(slot.copyFrame))
+        {
+            if (newest == nullptr || slot.copyFrame > newest->copyFrame)
+            {
+                newest = &slot;
+            }
 
-void ConstantCopyGPUReadback::GetHostConstantBuffer(reshade::api::command_list* cmd_list, ShaderToggler::ToggleGroup* group, vector<uint8_t>& dest, size_t size, uint64_t resourceHandle)
+            // Values of older copies are superseded by the newest one
+            slot.pending = false;
+        }
+    }
+
+    void* data = nullptr;
+    if (newest != nullptr && ring.device->map_buffer_region(newest->res, 0, ring.size, map_access::read_only, &data))
+    {
+        // Only the ranges copied into the buffer hold values
+        for (const auto& range : newest->ranges)
+        {
+            memcpy(ring.latest.data() + range.offset, static_cast<const uint8_t*>(data) + range.offset, range.size);
+        }
+        ring.device->unmap_buffer_region(newest->res);
+    }
+}
+
+void ConstantCopyGPUReadback::GetHostConstantBuffer(reshade::api::command_list* cmd_list, ShaderToggler::ToggleGroup* group, vector<uint8_t>& dest, size_t size, uint64_t resourceHandle, const vector<ConstantRange>& ranges)
 {
     resource src = resource{ resourceHandle };
-    ShaderToggler::GroupResource& dst = group->GetGroupResource(ShaderToggler::GroupResourceType::RESOURCE_CONSTANTS_COPY);
-    if (groupResourceManager.IsCompatibleWithGroupFormat(cmd_list->get_device(), ShaderToggler::GroupResourceType::RESOURCE_CONSTANTS_COPY, src, group))
+    device* device = cmd_list->get_device();
+    const uint64_t srcSize = device->get_resource_desc(src).buffer.size;
+
+    unique_lock<mutex> lock(ringMutex);
+
+    ReadbackRing& ring = rings[group];
+    if (ring.size != srcSize || ring.device != device)
+    {
+        RetireRing(ring);
+        CreateRing(device, ring, srcSize);
+    }
+
+    if (ring.slots.empty())
+    {
+        return;
+    }
+
+    ReadRetiredSlots(ring);
+
+    // A group extracting more than once in the same frame keeps overwriting that frame's copy
+    const uint32_t count = static_cast<uint32_t>(ring.slots.size());
+    const uint32_t previous = (ring.next + count - 1) % count;
+    ReadbackSlot& slot = ring.slots[previous].copyFrame == frame ? ring.slots[previous] : ring.slots[ring.next];
+    if (&slot == &ring.slots[ring.next])
+    {
+        ring.next = (ring.next + 1) % count;
+    }
+
+    slot.ranges.clear();
+    for (const auto& range : ranges)
     {
-        void* data = nullptr;
-        cmd_list->copy_resource(src, dst.res);
-        if (cmd_list->get_device()->map_buffer_region(dst.res, 0, size, map_access::read_only, &data))
+        if (range.offset < ring.size)
         {
-            memcpy(dest.data(), data, size);
-            cmd_list->get_device()->unmap_buffer_region(dst.res);
+            const ConstantRange clamped = { range.offset, static_cast<size_t>(std::min<uint64_t>(range.size, ring.size - range.offset)) };
+            cmd_list->copy_buffer_region(src, clamped.offset, slot.res, clamped.offset, clamped.size);
+            slot.ranges.push_back(clamped);
         }
     }
-    else
+    slot.copyFrame = frame;
+    slot.pending = true;
+
+    size = std::min(size, ring.latest.size());
+    for (const auto& range : ranges)
+    {
+        if (range.offset < size)
+        {
+            memcpy(dest.data() + range.offset, ring.latest.data() + range.offset, std::min(range.size, size - range.offset));
+        }
+    }
+}
+
+void ConstantCopyGPUReadback::OnReshadePresent(effect_runtime* runtime)
+{
+    unique_lock<mutex> lock(ringMutex);
+
+    // The frame advances on presents of the runtime presenting least often, once every other one presented too. A game presenting several
+    // swapchains doesn't age copies faster than the slowest of them, and changes in the order they present in don't advance it twice in
+    // one frame.
+    RuntimePresents& presents = runtimePresents[runtime];
+    presents.presented = true;
+    presents.othersPresented = 0;
+
+    const effect_runtime* slower = nullptr;
+    for (auto it = runtimePresents.begin(); it != runtimePresents.end();)
+    {
+        // A runtime which stopped presenting, e.g. because it was destroyed, doesn't hold back the others
+        if (it->first != runtime && ++it->second.othersPresented > RUNTIME_IDLE_FRAMES)
+        {
+            clockRuntime = clockRuntime == it->first ? nullptr : clockRuntime;
+            it = runtimePresents.erase(it);
+            continue;
+        }
+
+        slower = it->second.presented ? slower : it->first;
+        it++;
+    }
+
+    if (clockRuntime == nullptr)
+    {
+        clockRuntime = runtime;
+        clockArmed = true;
+    }
+
+    if (runtime == clockRuntime)
+    {
+        if (slower != nullptr)
+        {
+            // The frame isn't over before that one presented, it only counts frames from its next present on so the frame doesn't
+            // advance twice in this one
+            clockRuntime = slower;
+            clockArmed = false;
+        }
+        else
+        {
+            frame += clockArmed ? 1 : 0;
+            clockArmed = true;
+            for (auto& [_, p] : runtimePresents)
+            {
+                p.presented = false;
+            }
+        }
+    }
+
+    retiredBuffers.erase(std::remove_if(retiredBuffers.begin(), retiredBuffers.end(), [this](const RetiredBuffer& buffer) {
+        if (frame > buffer.lastUse + latency)
+        {
+            buffer.device->destroy_resource(buffer.res);
+            return true;
+        }
+        return false;
+        }), retiredBuffers.end());
+}
+
+void ConstantCopyGPUReadback::OnDestroyDevice(device* device)
+{
+    unique_lock<mutex> lock(ringMutex);
+
+    for (auto it = rings.begin(); it != rings.end();)
+    {
+        if (it->second.device == device)
+        {
+            RetireRing(it->second);
+            it = rings.erase(it);
+            continue;
+        }
+        it++;
+    }
+
+    // The device is idle by now, nothing it owns can be in flight anymore
+    retiredBuffers.erase(std::remove_if(retiredBuffers.begin(), retiredBuffers.end(), [device](const RetiredBuffer& buffer) {
+        if (buffer.device == device)
+        {
+            device->destroy_resource(buffer.res);
+            return true;
+        }
+        return false;
+        }), retiredBuffers.end());
+}
+
+void ConstantCopyGPUReadback::RemoveGroup(const ToggleGroup* group, device* device)
+{
+    unique_lock<mutex> lock(ringMutex);
+
+    const auto it = rings.find(group);
+    if (it != rings.end())
     {
-        dst.state = ShaderToggler::GroupResourceState::RESOURCE_INVALID;
-        dst.target_description = cmd_list->get_device()->get_resource_desc(src);
+        RetireRing(it->second);
+        rings.erase(it);
     }
-}
\ No newline at end of file
+}
@@ -5,22 +5,31 @@
 #include <reshade_api_pipeline.hpp>
 #include <unordered_map>
 #include <vector>
-#include <shared_mutex>
+#include <mutex>
 #include "ConstantCopyBase.h"
-#include "ToggleGroupResourceManager.h"
 
 namespace Shim
 {
     namespace Constants
     {
+        /// <summary>
+        /// Copies the ranges of a group's constant buffer it reads values from into one of a ring of readback buffers and reads back the
+        /// newest copy the GPU is done with, instead of mapping a buffer right after copying into it. Extracted values arrive with a
+        /// latency of a few frames, but the game's draw stream never waits on the GPU.
+        /// </summary>
         class ConstantCopyGPUReadback final : public virtual ConstantCopyBase {
         public:
-            ConstantCopyGPUReadback(Rendering::ToggleGroupResourceManager& gResourceManager) : groupResourceManager(gResourceManager) { }
+            // The targeted ReShade API has no queue fences, so a copy is only considered done once the maximum number of frames a game can
+            // have in flight have been presented after it
+            static constexpr uint32_t MIN_LATENCY = 3;
+            static constexpr uint32_t MAX_LATENCY = 4;
+
+            ConstantCopyGPUReadback(uint32_t latency);
 
             bool Init() override final { return true; };
             bool UnInit() override final { return true; };
 
-            virtual void GetHostConstantBuffer(reshade::api::command_list* cmd_list, ShaderToggler::ToggleGroup* group, std::vector<uint8_t>& dest, size_t size, uint64_t resourceHandle) override final;
+            virtual void GetHostConstantBuffer(reshade::api::command_list* cmd_list, ShaderToggler::ToggleGroup* group, std::vector<uint8_t>& dest, size_t size, uint64_t resourceHandle, const std::vector<ConstantRange>& ranges) override final;
             virtual void CreateHostConstantBuffer(reshade::api::device* dev, reshade::api::resource resource, size_t size) override final {};
             virtual void DeleteHostConstantBuffer(reshade::api::resource resource) override final {};
             virtual void SetHostConstantBuffer(const uint64_t handle, const void* buffer, size_t size, uintptr_t offset, uint64_t bufferSize) override final {};
@@ -32,9 +41,56 @@ namespace Shim
             virtual void OnMapBufferRegion(reshade::api::device* device, reshade::api::resource resource, uint64_t offset, uint64_t size, reshade::api::map_access access, void** data) override final {};
             virtual void OnUnmapBufferRegion(reshade::api::device* device, reshade::api::resource resource) override final {};
 
+            virtual void OnReshadePresent(reshade::api::effect_runtime* runtime) override final;
+            virtual void OnDestroyDevice(reshade::api::device* device) override final;
+            virtual void RemoveGroup(const ShaderToggler::ToggleGroup* group, reshade::api::device* device) override final;
         private:
-            std::unordered_map<uint64_t, reshade::api::resource> resToCopyBuffer;
-            Rendering::ToggleGroupResourceManager& groupResourceManager;
+            static constexpr uint64_t NO_COPY = UINT64_MAX;
+            static constexpr uint64_t RUNTIME_IDLE_FRAMES = 60;
+
+            struct ReadbackSlot
+            {
+                reshade::api::resource res = { 0 };
+                uint64_t copyFrame = NO_COPY;		// frame the last copy into this buffer was recorded in
+                bool pending = false;				// copy recorded but not read back yet
+                std::vector<ConstantRange> ranges;	// ranges the last copy wrote
+            };
+
+            struct ReadbackRing
+            {
+                reshade::api::device* device = nullptr;
+                uint64_t size = 0;
+                uint32_t next = 0;
+                std::vector<ReadbackSlot> slots;
+                std::vector<uint8_t> latest;		// newest values read back, handed out until a newer copy has retired
+            };
+
+            struct RuntimePresents
+            {
+                bool presented = false;				// presented since the frame last advanced
+                uint64_t othersPresented = 0;		// presents of other runtimes since its last one
+            };
+
+            struct RetiredBuffer
+            {
+                reshade::api::device* device;
+                reshade::api::resource res;
+                uint64_t lastUse;
+            };
+
+            bool IsRetired(uint64_t copyFrame) const { return copyFrame != NO_COPY && frame >= copyFrame + latency; }
+            void CreateRing(reshade::api::device* device, ReadbackRing& ring, uint64_t size);
+            void RetireRing(ReadbackRing& ring);
+            void ReadRetiredSlots(ReadbackRing& ring);
+
+            const uint32_t latency;
+            uint64_t frame = 0;
+            std::unordered_map<const reshade::api::effect_runtime*, RuntimePresents> runtimePresents;
+            const reshade::api::effect_runtime* clockRuntime = nullptr;
+            bool clockArmed = false;
+            std::mutex ringMutex;
+            std::unordered_map<const ShaderToggler::ToggleGroup*, ReadbackRing> rings;
+            std::vector<RetiredBuffer> retiredBuffers;
         };
     }
-}
\ No newline at end of file
+}
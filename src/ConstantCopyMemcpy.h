@@ -8,6 +8,7 @@
 #include <shared_mutex>
 #include "ConstantCopyBase.h"
 #include "GameHookT.h"
+#include "MappedRangeIndex.h"
 
 using namespace sigmatch_literals;
 
@@ -53,17 +54,6 @@ namespace Shim
 {
     namespace Constants
     {
-        struct BufferCopy
-        {
-            uint64_t resource = 0;
-            void* destination = nullptr;
-            uint8_t* hostDestination = nullptr;
-            uint64_t offset = 0;
-            uint64_t size = 0;
-            uint64_t bufferSize = 0;
-        };
-
-
         class ConstantCopyMemcpy: public virtual ConstantCopyBase {
         public:
             ConstantCopyMemcpy();
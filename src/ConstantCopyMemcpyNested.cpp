@@ -19,10 +19,10 @@ void ConstantCopyMemcpyNested::OnMapBufferRegion(device* device, resource resour
     if (access == map_access::write_discard || access == map_access::write_only)
     {
         resource_desc desc = device->get_resource_desc(resource);
-        if (desc.heap == memory_heap::cpu_to_gpu && static_cast<uint32_t>(desc.usage & resource_usage::constant_buffer))
+        // Only buffers groups extract from are mirrored, the others don't need to be found by OnMemcpy
+        if (desc.heap == memory_heap::cpu_to_gpu && static_cast<uint32_t>(desc.usage & resource_usage::constant_buffer) && desc.buffer.size > offset && IsHostConstantBufferMirrored(resource.handle))
         {
-            unique_lock<shared_mutex> lock(_map_mutex);
-            _resourceMemoryMapping[resource.handle] = BufferCopy{ resource.handle, *data, nullptr, offset, size, desc.buffer.size };
+            _mappedRanges.insert(BufferCopy{ resource.handle, *data, offset, size, desc.buffer.size });
         }
     }
 }
@@ -33,23 +33,13 @@ void ConstantCopyMemcpyNested::OnUnmapBufferRegion(device* device, resource reso
     resource_desc desc = device->get_resource_desc(resource);
     if (desc.heap == memory_heap::cpu_to_gpu && static_cast<uint32_t>(desc.usage & resource_usage::constant_buffer))
     {
-        unique_lock<shared_mutex> lock(_map_mutex);
-        _resourceMemoryMapping.erase(resource.handle);
+        _mappedRanges.erase(resource.handle);
     }
 }
 
 void ConstantCopyMemcpyNested::OnMemcpy(void* volatile dest, void* src, size_t size)
 {
-    shared_lock<shared_mutex> lock(_map_mutex);
-    if (_resourceMemoryMapping.size() > 0)
-    {
-        for (auto& [_,buffer] : _resourceMemoryMapping)
-        {
-            if (dest >= buffer.destination && static_cast<uintptr_t>(reinterpret_cast<intptr_t>(dest)) <= reinterpret_cast<intptr_t>(buffer.destination) + buffer.bufferSize - buffer.offset)
-            {
-                SetHostConstantBuffer(buffer.resource, src, size, reinterpret_cast<intptr_t>(dest) - reinterpret_cast<intptr_t>(buffer.destination), buffer.bufferSize);
-                break;
-            }
-        }
-    }
-}
\ No newline at end of file
+    _mappedRanges.find(reinterpret_cast<uintptr_t>(dest), [&](const BufferCopy& buffer, uintptr_t offset) {
+        SetHostConstantBuffer(buffer.resource, src, std::min(size, static_cast<size_t>(buffer.bufferSize - offset)), offset, buffer.bufferSize);
+        });
+}
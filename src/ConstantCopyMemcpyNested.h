@@ -1,5 +1,6 @@
 #pragma once
 #include "ConstantCopyMemcpy.h"
+#include "MappedRangeIndex.h"
 
 namespace Shim
 {
@@ -14,8 +15,7 @@ namespace Shim
             void OnMapBufferRegion(reshade::api::device * device, reshade::api::resource resource, uint64_t offset, uint64_t size, reshade::api::map_access access, void** data) override final;
             void OnUnmapBufferRegion(reshade::api::device* device, reshade::api::resource resource) override final;
         private:
-            std::unordered_map<uint64_t, BufferCopy> _resourceMemoryMapping;
-            std::shared_mutex _map_mutex;
+            MappedRangeIndex _mappedRanges;
         };
     }
 }
\ No newline at end of file
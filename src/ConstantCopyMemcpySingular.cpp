@@ -18,17 +18,14 @@ void ConstantCopyMemcpySingular::OnMapBufferRegion(device* device, resource reso
     if (access == map_access::write_discard || access == map_access::write_only)
     {
         resource_desc desc = device->get_resource_desc(resource);
-        const auto& it = deviceToHostConstantBuffer.find(resource.handle);
 
-        if (it != deviceToHostConstantBuffer.end())
+        if (IsHostConstantBufferMirrored(resource.handle))
         {
-            auto& [_, buf] = *it;
             _bufferCopy.resource = resource.handle;
             _bufferCopy.destination = *data;
             _bufferCopy.size = size;
             _bufferCopy.offset = offset;
             _bufferCopy.bufferSize = desc.buffer.size;
-            _bufferCopy.hostDestination = buf.data();
         }
     }
 }
@@ -48,6 +45,6 @@ void ConstantCopyMemcpySingular::OnMemcpy(void* dest, void* src, size_t size)
         destPtr >= destinationPtr &&
         destPtr <= destinationPtr + _bufferCopy.bufferSize - _bufferCopy.offset)
     {
-        memcpy(_bufferCopy.hostDestination, src, size);
+        SetHostConstantBuffer(_bufferCopy.resource, src, size, 0, _bufferCopy.bufferSize);
     }
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <cstring>
+#include <algorithm>
 #include "ConstantHandlerBase.h"
 #include "PipelinePrivateData.h"
 #include "StateTracking.h"
@@ -9,6 +10,7 @@ using namespace ShaderToggler;
 using namespace std;
 
 unordered_map<string, tuple<constant_type, vector<effect_uniform_variable>>> ConstantHandlerBase::restVariables;
+atomic<uint32_t> ConstantHandlerBase::restVariablesVersion = 0;
 char ConstantHandlerBase::charBuffer[CHAR_BUFFER_SIZE];
 ConstantCopyBase* ConstantHandlerBase::_constCopy;
 std::shared_mutex ConstantHandlerBase::groupBufferMutex;
@@ -27,6 +29,11 @@ void ConstantHandlerBase::SetConstantCopy(ConstantCopyBase* constantCopy)
     _constCopy = constantCopy;
 }
 
+void ConstantHandlerBase::SetViewedGroupId(const std::atomic_int* groupId)
+{
+    _viewedGroupId = groupId;
+}
+
 size_t ConstantHandlerBase::GetConstantBufferSize(const ToggleGroup* group)
 {
     if (groupBufferSize.contains(group))
@@ -128,11 +135,14 @@ void ConstantHandlerBase::ReloadConstantVariables(effect_runtime* runtime)
             }
         }
         });
+
+    restVariablesVersion++;
 }
 
 void ConstantHandlerBase::ClearConstantVariables()
 {
     restVariables.clear();
+    restVariablesVersion++;
 }
 
 void ConstantHandlerBase::OnEffectsReloading(effect_runtime* runtime)
@@ -200,7 +210,7 @@ bool ConstantHandlerBase::UpdateConstantBufferEntries(command_list* cmd_list, Co
 
         SetBufferRange(group, buf->constant, cmd_list->get_device(), cmd_list);
         ApplyConstantValues(devData.current_runtime, group, restVariables);
-        devData.constantsUpdated.insert(group);
+        devData.constantsUpdated.set(group->getSlot());
 
         return true;
     }
@@ -226,15 +236,15 @@ bool ConstantHandlerBase::UpdateConstantEntries(command_list* cmd_list, CommandL
     if (const_buffer_size == 0)
         return false;
     
-    const vector<uint32_t>* buf = state.get_constants_at(index, slot);//current_constants.at(slot);
+    const StateTracking::arena_span<uint32_t>* buf = state.get_constants_at(index, slot);//current_constants.at(slot);
 
     if (buf != nullptr)
     {
         unique_lock<shared_mutex> lock(groupBufferMutex);
 
-        SetConstants(group, *buf, cmd_list->get_device(), cmd_list);
+        SetConstants(group, buf->data, buf->size, cmd_list->get_device(), cmd_list);
         ApplyConstantValues(devData.current_runtime, group, restVariables);
-        devData.constantsUpdated.insert(group);
+        devData.constantsUpdated.set(group->getSlot());
     }
 
     return true;
@@ -262,7 +272,7 @@ void ConstantHandlerBase::UpdateConstants(command_list* cmd_list)
 
     for (const auto& cb : commandListData.ps.constantBuffersToUpdate)
     {
-        if (!deviceData.constantsUpdated.contains(cb))
+        if (!deviceData.constantsUpdated.test(cb->getSlot()))
         {
             if (!cb->getCBIsPushMode() && UpdateConstantBufferEntries(cmd_list, commandListData, deviceData, cb, cb->getCBShaderStage()) ||
                 cb->getCBIsPushMode() && UpdateConstantEntries(cmd_list, commandListData, deviceData, cb, cb->getCBShaderStage()))
@@ -274,7 +284,7 @@ void ConstantHandlerBase::UpdateConstants(command_list* cmd_list)
 
     for (const auto& cb : commandListData.vs.constantBuffersToUpdate)
     {
-        if (!deviceData.constantsUpdated.contains(cb))
+        if (!deviceData.constantsUpdated.test(cb->getSlot()))
         {
             if (!cb->getCBIsPushMode() && UpdateConstantBufferEntries(cmd_list, commandListData, deviceData, cb, cb->getCBShaderStage()) ||
                 cb->getCBIsPushMode() && UpdateConstantEntries(cmd_list, commandListData, deviceData, cb, cb->getCBShaderStage()))
@@ -286,7 +296,7 @@ void ConstantHandlerBase::UpdateConstants(command_list* cmd_list)
 
     for (const auto& cb : commandListData.cs.constantBuffersToUpdate)
     {
-        if (!deviceData.constantsUpdated.contains(cb))
+        if (!deviceData.constantsUpdated.test(cb->getSlot()))
         {
             if (!cb->getCBIsPushMode() && UpdateConstantBufferEntries(cmd_list, commandListData, deviceData, cb, cb->getCBShaderStage()) ||
                 cb->getCBIsPushMode() && UpdateConstantEntries(cmd_list, commandListData, deviceData, cb, cb->getCBShaderStage()))
@@ -365,20 +375,21 @@ void ConstantHandlerBase::ApplyConstantValues(effect_runtime* runtime, const Tog
 }
 
 
-void ConstantHandlerBase::SetConstants(const ToggleGroup* group, const vector<uint32_t>& buf, device* dev, command_list* cmd_list)
+void ConstantHandlerBase::SetConstants(const ToggleGroup* group, const uint32_t* values, size_t count, device* dev, command_list* cmd_list)
 {
-    if (dev == nullptr || cmd_list == nullptr || buf.size() == 0)
+    if (dev == nullptr || cmd_list == nullptr || count == 0)
     {
         return;
     }
 
-    InitBuffers(group, buf.size());
+    const size_t size = count * sizeof(uint32_t);
+    InitBuffers(group, size);
 
     vector<uint8_t>& bufferContent = groupBufferContent.at(group);
     vector<uint8_t>& prevBufferContent = groupPrevBufferContent.at(group);
 
-    std::memcpy(prevBufferContent.data(), bufferContent.data(), buf.size());
-    std::memcpy(bufferContent.data(), reinterpret_cast<const uint8_t*>(buf.data()), buf.size() * 4);
+    std::memcpy(prevBufferContent.data(), bufferContent.data(), size);
+    std::memcpy(bufferContent.data(), reinterpret_cast<const uint8_t*>(values), size);
 }
 
 void ConstantHandlerBase::SetBufferRange(ToggleGroup* group, buffer_range range, device* dev, command_list* cmd_list)
@@ -395,9 +406,80 @@ void ConstantHandlerBase::SetBufferRange(ToggleGroup* group, buffer_range range,
 
     vector<uint8_t>& bufferContent = groupBufferContent.at(group);
     vector<uint8_t>& prevBufferContent = groupPrevBufferContent.at(group);
+    const vector<ConstantRange>& copyRanges = UpdateCopyRanges(group, size);
 
-    std::memcpy(prevBufferContent.data(), bufferContent.data(), size);
-    _constCopy->GetHostConstantBuffer(cmd_list, group, bufferContent, size, range.buffer.handle);
+    for (const auto& copyRange : copyRanges)
+    {
+        std::memcpy(prevBufferContent.data() + copyRange.offset, bufferContent.data() + copyRange.offset, copyRange.size);
+    }
+    _constCopy->GetHostConstantBuffer(cmd_list, group, bufferContent, size, range.buffer.handle, copyRanges);
+}
+
+const vector<ConstantRange>& ConstantHandlerBase::UpdateCopyRanges(const ToggleGroup* group, size_t size)
+{
+    // The constant buffer viewer shows the whole buffer of the group being edited
+    const bool viewed = _viewedGroupId != nullptr && group->getId() == _viewedGroupId->load();
+    const uint32_t restVersion = restVariablesVersion.load(memory_order_relaxed);
+
+    GroupCopyRanges& cached = groupCopyRanges[group];
+    if (cached.valid && cached.varMappingVersion == group->getVarMappingVersion() && cached.restVariablesVersion == restVersion &&
+        cached.size == size && cached.viewed == viewed)
+    {
+        return cached.ranges;
+    }
+
+    cached.varMappingVersion = group->getVarMappingVersion();
+    cached.restVariablesVersion = restVersion;
+    cached.size = size;
+    cached.viewed = viewed;
+    cached.valid = true;
+
+    vector<ConstantRange>& ranges = cached.ranges;
+    ranges.clear();
+
+    if (viewed)
+    {
+        ranges.push_back(ConstantRange{ 0, size });
+        return ranges;
+    }
+
+    for (const auto& [varName, varData] : group->GetVarOffsetMapping())
+    {
+        const auto& [offset, _] = varData;
+        const auto& var = restVariables.find(varName);
+
+        if (var == restVariables.end() || offset >= size)
+        {
+            continue;
+        }
+
+        const uint32_t typeIndex = static_cast<uint32_t>(get<0>(var->second));
+        ranges.push_back(ConstantRange{ offset, std::min(type_size[typeIndex] * type_length[typeIndex], size - offset) });
+    }
+
+    // Merge overlapping and adjacent ranges
+    sort(ranges.begin(), ranges.end(), [](const ConstantRange& lhs, const ConstantRange& rhs) { return lhs.offset < rhs.offset; });
+
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); i++)
+    {
+        ConstantRange& last = ranges[merged];
+        if (ranges[i].offset <= last.offset + last.size)
+        {
+            last.size = std::max(last.size, ranges[i].offset + ranges[i].size - last.offset);
+        }
+        else
+        {
+            ranges[++merged] = ranges[i];
+        }
+    }
+
+    if (ranges.size() > 0)
+    {
+        ranges.resize(merged + 1);
+    }
+
+    return ranges;
 }
 
 void ConstantHandlerBase::InitBuffers(const ToggleGroup* group, size_t size)
@@ -420,6 +502,11 @@ void ConstantHandlerBase::InitBuffers(const ToggleGroup* group, size_t size)
 
 void ConstantHandlerBase::RemoveGroup(const ToggleGroup* group, device* dev)
 {
+    if (_constCopy != nullptr)
+    {
+        _constCopy->RemoveGroup(group, dev);
+    }
+
     if (!groupBufferContent.contains(group))
     {
         return;
@@ -428,4 +515,5 @@ void ConstantHandlerBase::RemoveGroup(const ToggleGroup* group, device* dev)
     groupBufferContent.erase(group);
     groupPrevBufferContent.erase(group);
     groupBufferSize.erase(group);
+    groupCopyRanges.erase(group);
 }
\ No newline at end of file
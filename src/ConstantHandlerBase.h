@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <functional>
 #include <shared_mutex>
+#include <atomic>
 #include "ToggleGroup.h"
 #include "ShaderManager.h"
 #include "ConstantCopyBase.h"
@@ -81,7 +82,7 @@ namespace Shim
             ~ConstantHandlerBase();
 
             void SetBufferRange(ShaderToggler::ToggleGroup* group, reshade::api::buffer_range range, reshade::api::device * dev, reshade::api::command_list* cmd_list);
-            void SetConstants(const ShaderToggler::ToggleGroup* group, const std::vector<uint32_t>& buf, reshade::api::device* dev, reshade::api::command_list* cmd_list);
+            void SetConstants(const ShaderToggler::ToggleGroup* group, const uint32_t* values, size_t count, reshade::api::device* dev, reshade::api::command_list* cmd_list);
             std::shared_mutex& GetBufferMutex() { return groupBufferMutex; }
             void RemoveGroup(const ShaderToggler::ToggleGroup*, reshade::api::device* dev);
             const uint8_t* GetConstantBuffer(const ShaderToggler::ToggleGroup* group);
@@ -97,20 +98,38 @@ namespace Shim
             std::unordered_map<std::string, std::tuple<constant_type, std::vector<reshade::api::effect_uniform_variable>>>* GetRESTVariables();
 
             static void SetConstantCopy(ConstantCopyBase* constantHandler);
+            void SetViewedGroupId(const std::atomic_int* groupId);
         private:
             std::unordered_map<const ShaderToggler::ToggleGroup*, std::vector<uint8_t>> groupBufferContent;
             std::unordered_map<const ShaderToggler::ToggleGroup*, std::vector<uint8_t>> groupPrevBufferContent;
             std::unordered_map<const ShaderToggler::ToggleGroup*, size_t> groupBufferSize;
+            /// <summary>
+            /// Ranges of the buffer a group reads values from, rebuilt only when what they were derived from changes.
+            /// </summary>
+            struct GroupCopyRanges
+            {
+                std::vector<ConstantRange> ranges;
+                uint32_t varMappingVersion = 0;
+                uint32_t restVariablesVersion = 0;
+                size_t size = 0;
+                bool viewed = false;
+                bool valid = false;
+            };
+
+            std::unordered_map<const ShaderToggler::ToggleGroup*, GroupCopyRanges> groupCopyRanges;
+            const std::atomic_int* _viewedGroupId = nullptr;
             int32_t previousEnableCount = std::numeric_limits<int32_t>::max();
             std::shared_mutex varMutex;
             static std::shared_mutex groupBufferMutex;
 
             static std::unordered_map<std::string, std::tuple<constant_type, std::vector<reshade::api::effect_uniform_variable>>> restVariables;
+            static std::atomic<uint32_t> restVariablesVersion;		// bumped whenever restVariables changes
             static char charBuffer[CHAR_BUFFER_SIZE];
 
             static ConstantCopyBase* _constCopy;
 
             void InitBuffers(const ShaderToggler::ToggleGroup* group, size_t size);
+            const std::vector<ConstantRange>& UpdateCopyRanges(const ShaderToggler::ToggleGroup* group, size_t size);
             bool UpdateConstantEntries(reshade::api::command_list* cmd_list, CommandListDataContainer& cmdData, DeviceDataContainer& devData, ShaderToggler::ToggleGroup* group, uint32_t index);
             bool UpdateConstantBufferEntries(reshade::api::command_list* cmd_list, CommandListDataContainer& cmdData, DeviceDataContainer& devData, ShaderToggler::ToggleGroup* group, uint32_t index);
         };
@@ -9,92 +9,245 @@
 
 using namespace reshade::api;
 
-sampler descriptor_tracking::get_sampler(descriptor_heap heap, uint32_t offset) const
+descriptor_tracking::~descriptor_tracking()
 {
-    const descriptor_heap_data& heap_data = heaps.at(heap);
+    heaps.update_all([](uint64_t, descriptor_heap_data*& heap_data) {
+        delete heap_data;
+        heap_data = nullptr;
+        });
+    layouts.update_all([](uint64_t, pipeline_layout_data*& layout_data) {
+        delete layout_data;
+        layout_data = nullptr;
+        });
+}
+
+const descriptor_tracking::descriptor_heap_data* descriptor_tracking::find_heap(descriptor_heap heap) const
+{
+    descriptor_heap_data* heap_data = nullptr;
+    heaps.find(heap.handle, heap_data);
+
+    return heap_data;
+}
 
-    if (offset < heap_data.descriptors.size())
+descriptor_tracking::descriptor_heap_data* descriptor_tracking::acquire_heap(descriptor_heap heap)
+{
+    descriptor_heap_data* heap_data = nullptr;
+    if (heaps.find(heap.handle, heap_data))
     {
-        const descriptor_data& descriptor = heap_data.descriptors[offset];
+        return heap_data;
+    }
 
-        if (descriptor.type == descriptor_type::sampler)
-            return descriptor.sampler;
-        else if (descriptor.type == descriptor_type::sampler_with_resource_view)
-            return descriptor.sampler_and_view.sampler;
+    // Writers to the map are serialized, so only one thread creates the mirror of a new heap
+    heaps.update(heap.handle, [&heap_data](descriptor_heap_data*& current) {
+        if (current == nullptr)
+        {
+            current = new descriptor_heap_data();
+        }
+        heap_data = current;
+        });
+
+    return heap_data;
+}
+
+sampler descriptor_tracking::get_sampler(descriptor_heap heap, uint32_t offset) const
+{
+    const descriptor_heap_data* heap_data = find_heap(heap);
+    const descriptor_data* descriptor = heap_data != nullptr ? heap_data->descriptors.find(offset) : nullptr;
+
+    if (descriptor != nullptr)
+    {
+        if (descriptor->type == descriptor_type::sampler)
+            return descriptor->sampler;
+        else if (descriptor->type == descriptor_type::sampler_with_resource_view)
+            return descriptor->sampler_and_view.sampler;
     }
 
     return { 0 };
 }
 resource_view descriptor_tracking::get_shader_resource_view(descriptor_heap heap, uint32_t offset) const
 {
-    const descriptor_heap_data& heap_data = heaps.at(heap);
+    const descriptor_heap_data* heap_data = find_heap(heap);
+    const descriptor_data* descriptor = heap_data != nullptr ? heap_data->descriptors.find(offset) : nullptr;
 
-    if (offset < heap_data.descriptors.size())
+    if (descriptor != nullptr)
     {
-        const descriptor_data& descriptor = heap_data.descriptors[offset];
-
-        if (descriptor.type == descriptor_type::shader_resource_view)
-            return descriptor.view;
-        else if (descriptor.type == descriptor_type::sampler_with_resource_view)
-            return descriptor.sampler_and_view.view;
+        if (descriptor->type == descriptor_type::shader_resource_view)
+            return descriptor->view;
+        else if (descriptor->type == descriptor_type::sampler_with_resource_view)
+            return descriptor->sampler_and_view.view;
     }
 
     return { 0 };
 }
 buffer_range descriptor_tracking::get_buffer_range(descriptor_heap heap, uint32_t offset) const
 {
-    const descriptor_heap_data& heap_data = heaps.at(heap);
+    const descriptor_heap_data* heap_data = find_heap(heap);
+    const descriptor_data* descriptor = heap_data != nullptr ? heap_data->descriptors.find(offset) : nullptr;
 
-    if (offset < heap_data.descriptors.size())
+    if (descriptor != nullptr)
     {
-        const descriptor_data& descriptor = heap_data.descriptors[offset];
-
-        if (descriptor.type == descriptor_type::constant_buffer)
-            return descriptor.constant;
+        if (descriptor->type == descriptor_type::constant_buffer)
+            return descriptor->constant;
     }
 
     return { 0 };
 }
 
-void descriptor_tracking::set_all_descriptors(reshade::api::descriptor_heap heap, uint32_t offset, uint32_t count, std::vector<descriptor_tracking::descriptor_data>& descriptor_list, uint32_t list_offset) const
+void descriptor_tracking::set_all_descriptors(reshade::api::descriptor_heap heap, uint32_t offset, uint32_t count, descriptor_tracking::descriptor_data* descriptor_list, uint32_t list_offset) const
 {
-    const descriptor_heap_data& heap_data = heaps.at(heap);
+    const descriptor_heap_data* heap_data = find_heap(heap);
 
-    size_t mcount = std::min(static_cast<size_t>(offset) + count, heap_data.descriptors.size());
+    if (heap_data != nullptr)
+    {
+        heap_data->descriptors.read(offset, count, descriptor_list + list_offset);
+    }
+}
+
+void descriptor_tracking::get_descriptor_heap_offset(device* device, descriptor_table table, uint32_t binding, uint32_t array_offset, descriptor_heap* heap, uint32_t* offset) const
+{
+    // Vulkan descriptor pools can be reset and their sets reallocated with the same handles within a frame, without an event to drop entries on
+    if (device->get_api() == device_api::vulkan)
+    {
+        device->get_descriptor_heap_offset(table, binding, array_offset, heap, offset);
+        return;
+    }
+
+    const uint32_t epoch = heap_offset_epoch.load(std::memory_order_relaxed);
+    const size_t index = static_cast<size_t>(((table.handle ^ (static_cast<uint64_t>(binding) << 32)) * 0x9E3779B97F4A7C15ull) >> 52) & (HEAP_OFFSET_CACHE_SIZE - 1);
+    heap_offset_entry& entry = heap_offset_cache[index];
+
+    uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+    if ((sequence & 1) == 0)
+    {
+        const uint32_t entry_epoch = entry.epoch.load(std::memory_order_relaxed);
+        const uint64_t entry_table = entry.table.load(std::memory_order_relaxed);
+        const uint32_t entry_binding = entry.binding.load(std::memory_order_relaxed);
+        const uint64_t entry_heap = entry.heap.load(std::memory_order_relaxed);
+        const uint32_t entry_base_offset = entry.base_offset.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) == sequence && entry_epoch == epoch && entry_table == table.handle && entry_binding == binding)
+        {
+            *heap = { entry_heap };
+            *offset = entry_base_offset + array_offset;
+            translations_saved.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    uint32_t base_offset = 0;
+    device->get_descriptor_heap_offset(table, binding, 0, heap, &base_offset);
+    *offset = base_offset + array_offset;
 
-    for (uint32_t i = offset; i < mcount; i++)
+    // Skip caching if another thread is writing the entry right now, the next translation will store it
+    if ((sequence & 1) != 0 || !entry.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed))
     {
-        descriptor_list[list_offset + i - offset] = heap_data.descriptors[i];
+        return;
     }
+
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.epoch.store(epoch, std::memory_order_relaxed);
+    entry.table.store(table.handle, std::memory_order_relaxed);
+    entry.binding.store(binding, std::memory_order_relaxed);
+    entry.heap.store(heap->handle, std::memory_order_relaxed);
+    entry.base_offset.store(base_offset, std::memory_order_relaxed);
+    entry.sequence.store(sequence + 2, std::memory_order_release);
 }
 
 pipeline_layout_param descriptor_tracking::get_pipeline_layout_param(pipeline_layout layout, uint32_t param) const
 {
-    const pipeline_layout_data& layout_data = layouts.at(layout);
+    ShaderToggler::EpochDomain::ReadGuard guard;
+
+    pipeline_layout_data* layout_data = nullptr;
+    if (!layouts.find(layout.handle, layout_data) || param >= layout_data->params.size())
+    {
+        return {};
+    }
 
-    return layout_data.params[param];
+    return layout_data->params[param];
+}
+
+uint32_t descriptor_tracking::get_pipeline_layout_index(pipeline_layout layout) const
+{
+    ShaderToggler::EpochDomain::ReadGuard guard;
+
+    pipeline_layout_data* layout_data = nullptr;
+    if (!layouts.find(layout.handle, layout_data))
+    {
+        return INVALID_LAYOUT_INDEX;
+    }
+
+    return layout_data->metadata_index;
 }
 
 void descriptor_tracking::register_pipeline_layout(pipeline_layout layout, uint32_t count, const pipeline_layout_param* params)
 {
-    pipeline_layout_data& layout_data = layouts[layout];
-    layout_data.params.assign(params, params + count);
-    layout_data.ranges.resize(count);
+    // A handle registered again without being destroyed first replaces the old layout
+    unregister_pipeline_layout(layout);
+
+    pipeline_layout_data* layout_data = new pipeline_layout_data();
+    layout_data->params.assign(params, params + count);
+    layout_data->ranges.resize(count);
+
+    {
+        std::unique_lock<std::mutex> lock(layout_metadata_slots->mutex);
+        if (!layout_metadata_slots->free.empty())
+        {
+            layout_data->metadata_index = layout_metadata_slots->free.back();
+            layout_metadata_slots->free.pop_back();
+        }
+        else
+        {
+            layout_data->metadata_index = layout_metadata_slots->count++;
+        }
+    }
+
+    pipeline_layout_metadata& metadata = *layout_metadata.acquire(layout_data->metadata_index);
+    metadata.params.assign(count, layout_param_metadata());
+    metadata.tracked_ranges.clear();
 
     for (uint32_t i = 0; i < count; ++i)
     {
         if (params[i].type == pipeline_layout_param_type::descriptor_table)
         {
-            layout_data.ranges[i].assign(params[i].descriptor_table.ranges, params[i].descriptor_table.ranges + params[i].descriptor_table.count);
-            layout_data.params[i].descriptor_table.ranges = layout_data.ranges[i].data();
+            layout_data->ranges[i].assign(params[i].descriptor_table.ranges, params[i].descriptor_table.ranges + params[i].descriptor_table.count);
+            layout_data->params[i].descriptor_table.ranges = layout_data->ranges[i].data();
+
+            layout_param_metadata& param = metadata.params[i];
+            param.is_descriptor_table = true;
+            param.first_range = static_cast<uint32_t>(metadata.tracked_ranges.size());
+
+            for (const descriptor_range& range : layout_data->ranges[i])
+            {
+                if (range.count == UINT32_MAX || range.type == descriptor_type::sampler)
+                    continue; // Skip unbounded ranges
+
+                metadata.tracked_ranges.push_back(range);
+                param.binding_extent = std::max(param.binding_extent, range.binding + range.count);
+            }
+
+            param.range_count = static_cast<uint32_t>(metadata.tracked_ranges.size()) - param.first_range;
         }
     }
+
+    layouts.insert_or_assign(layout.handle, layout_data);
 }
 void descriptor_tracking::unregister_pipeline_layout(pipeline_layout layout)
 {
-    pipeline_layout_data& layout_data = layouts[layout];
-    layout_data.params.clear();
-    layout_data.ranges.clear();
+    pipeline_layout_data* layout_data = nullptr;
+    if (!layouts.erase(layout.handle, &layout_data))
+    {
+        return;
+    }
+
+    // Readers that resolved the layout can still walk its metadata, it's rewritten only after they left
+    ShaderToggler::EpochDomain::Retire([layout_data, slots = layout_metadata_slots]() {
+        {
+            std::unique_lock<std::mutex> lock(slots->mutex);
+            slots->free.push_back(layout_data->metadata_index);
+        }
+        delete layout_data;
+        });
 }
 
 static void on_init_device(device* device)
@@ -127,22 +280,19 @@ bool descriptor_tracking::on_copy_descriptor_tables(device* device, uint32_t cou
 
         uint32_t src_offset;
         descriptor_heap src_heap;
-        device->get_descriptor_heap_offset(copy.source_table, copy.source_binding, copy.source_array_offset, &src_heap, &src_offset);
+        ctx.get_descriptor_heap_offset(device, copy.source_table, copy.source_binding, copy.source_array_offset, &src_heap, &src_offset);
 
         uint32_t dst_offset;
         descriptor_heap dst_heap;
-        device->get_descriptor_heap_offset(copy.dest_table, copy.dest_binding, copy.dest_array_offset, &dst_heap, &dst_offset);
+        ctx.get_descriptor_heap_offset(device, copy.dest_table, copy.dest_binding, copy.dest_array_offset, &dst_heap, &dst_offset);
 
-        descriptor_heap_data& src_pool_data = ctx.heaps[src_heap];
-        descriptor_heap_data& dst_pool_data = ctx.heaps[dst_heap];
+        const descriptor_heap_data* src_pool_data = ctx.acquire_heap(src_heap);
+        descriptor_heap_data* dst_pool_data = ctx.acquire_heap(dst_heap);
 
-        if (dst_offset + copy.count > dst_pool_data.descriptors.size())
-            dst_pool_data.descriptors.grow_to_at_least(dst_offset + copy.count);
+        if (src_pool_data == nullptr || dst_pool_data == nullptr)
+            continue;
 
-        for (uint32_t k = 0; k < copy.count; ++k)
-        {
-            dst_pool_data.descriptors[dst_offset + k] = src_pool_data.descriptors[src_offset + k];
-        }
+        dst_pool_data->descriptors.copy(src_pool_data->descriptors, src_offset, dst_offset, copy.count);
     }
 
     return false;
@@ -158,36 +308,43 @@ bool descriptor_tracking::on_update_descriptor_tables(device* device, uint32_t c
 
         uint32_t offset;
         descriptor_heap heap;
-        device->get_descriptor_heap_offset(update.table, update.binding, update.array_offset, &heap, &offset);
+        ctx.get_descriptor_heap_offset(device, update.table, update.binding, update.array_offset, &heap, &offset);
 
-        descriptor_heap_data& heap_data = ctx.heaps[heap];
+        descriptor_heap_data* heap_data = ctx.acquire_heap(heap);
+        if (heap_data == nullptr)
+            continue;
 
-        if (offset + update.count > heap_data.descriptors.size())
-            heap_data.descriptors.grow_to_at_least(offset + update.count);
-
-        for (uint32_t k = 0; k < update.count; ++k)
+        for (uint32_t k = 0; k < update.count;)
         {
-            descriptor_data& descriptor = heap_data.descriptors[offset + k];
-
-            descriptor.type = update.type;
+            size_t available = 0;
+            descriptor_data* descriptors = heap_data->descriptors.acquire_span(offset + k, update.count - k, available);
+            if (descriptors == nullptr)
+                break; // Past the largest heap size that is mirrored
 
-            switch (update.type)
+            for (size_t j = 0; j < available; ++j, ++k)
             {
-            case descriptor_type::sampler:
-                descriptor.sampler = static_cast<const sampler*>(update.descriptors)[k];
-                break;
-            case descriptor_type::sampler_with_resource_view:
-                descriptor.sampler_and_view = static_cast<const sampler_with_resource_view*>(update.descriptors)[k];
-                descriptor.view = descriptor.sampler_and_view.view;
-                descriptor.sampler = descriptor.sampler_and_view.sampler;
-                break;
-            case descriptor_type::shader_resource_view:
-            case descriptor_type::unordered_access_view:
-                descriptor.view = static_cast<const resource_view*>(update.descriptors)[k];
-                break;
-            case descriptor_type::constant_buffer:
-            case descriptor_type::shader_storage_buffer:
-                descriptor.constant = static_cast<const buffer_range*>(update.descriptors)[k];
+                descriptor_data& descriptor = descriptors[j];
+
+                descriptor.type = update.type;
+
+                switch (update.type)
+                {
+                case descriptor_type::sampler:
+                    descriptor.sampler = static_cast<const sampler*>(update.descriptors)[k];
+                    break;
+                case descriptor_type::sampler_with_resource_view:
+                    descriptor.sampler_and_view = static_cast<const sampler_with_resource_view*>(update.descriptors)[k];
+                    descriptor.view = descriptor.sampler_and_view.view;
+                    descriptor.sampler = descriptor.sampler_and_view.sampler;
+                    break;
+                case descriptor_type::shader_resource_view:
+                case descriptor_type::unordered_access_view:
+                    descriptor.view = static_cast<const resource_view*>(update.descriptors)[k];
+                    break;
+                case descriptor_type::constant_buffer:
+                case descriptor_type::shader_storage_buffer:
+                    descriptor.constant = static_cast<const buffer_range*>(update.descriptors)[k];
+                }
             }
         }
     }
@@ -195,6 +352,14 @@ bool descriptor_tracking::on_update_descriptor_tables(device* device, uint32_t c
     return false;
 }
 
+void descriptor_tracking::on_reshade_present(effect_runtime* runtime)
+{
+    descriptor_tracking& ctx = runtime->get_device()->get_private_data<descriptor_tracking>();
+
+    ctx.translations_saved_last_frame.store(ctx.translations_saved.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    ctx.heap_offset_epoch.fetch_add(1, std::memory_order_relaxed);
+}
+
 void descriptor_tracking::register_events(bool track_descriptors)
 {
     reshade::register_event<reshade::addon_event::init_device>(on_init_device);
@@ -206,6 +371,7 @@ void descriptor_tracking::register_events(bool track_descriptors)
     {
         reshade::register_event<reshade::addon_event::copy_descriptor_tables>(on_copy_descriptor_tables);
         reshade::register_event<reshade::addon_event::update_descriptor_tables>(on_update_descriptor_tables);
+        reshade::register_event<reshade::addon_event::reshade_present>(on_reshade_present);
     }
 }
 void descriptor_tracking::unregister_events(bool track_descriptors)
@@ -219,5 +385,6 @@ void descriptor_tracking::unregister_events(bool track_descriptors)
     {
         reshade::unregister_event<reshade::addon_event::copy_descriptor_tables>(on_copy_descriptor_tables);
         reshade::unregister_event<reshade::addon_event::update_descriptor_tables>(on_update_descriptor_tables);
+        reshade::unregister_event<reshade::addon_event::reshade_present>(on_reshade_present);
     }
 }
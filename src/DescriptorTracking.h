@@ -6,9 +6,12 @@
 #pragma once
 
 #include <vector>
-#include <concurrent_vector.h>
-#include <concurrent_unordered_map.h>
+#include <mutex>
+#include <memory>
+#include <atomic>
 #include "reshade.hpp"
+#include "ConcurrentHandleMap.h"
+#include "PagedArray.h"
 
  /// <summary>
  /// An instance of this is automatically created for all devices and can be queried with <c>device->get_private_data&lt;descriptor_tracking&gt;()</c> (assuming descriptor tracking was registered via <see cref="descriptor_tracking::register_events"/>).
@@ -36,6 +39,25 @@ public:
         reshade::api::buffer_range constant;
     };
 
+    /// <summary>
+    /// Binding layout of a pipeline layout parameter, computed once when the layout is created.
+    /// </summary>
+    struct layout_param_metadata
+    {
+        bool is_descriptor_table = false;
+        uint32_t binding_extent = 0;	// one past the last binding covered by the table's tracked ranges
+        uint32_t first_range = 0;		// into pipeline_layout_metadata::tracked_ranges
+        uint32_t range_count = 0;
+    };
+
+    struct pipeline_layout_metadata
+    {
+        std::vector<layout_param_metadata> params;
+        std::vector<reshade::api::descriptor_range> tracked_ranges;	// descriptor table ranges without samplers and unbounded ranges
+    };
+
+    static constexpr uint32_t INVALID_LAYOUT_INDEX = UINT32_MAX;
+
     /// <summary>
     /// Registers all the necessary add-on events for descriptor tracking to work.
     /// </summary>
@@ -45,6 +67,9 @@ public:
     /// </summary>
     static void unregister_events(bool track_descriptors = true);
 
+    descriptor_tracking() = default;
+    ~descriptor_tracking();
+
     /// <summary>
     /// Gets the sampler in a descriptor set at the specified offset.
     /// </summary>
@@ -58,13 +83,30 @@ public:
     /// </summary>
     reshade::api::buffer_range get_buffer_range(reshade::api::descriptor_heap heap, uint32_t offset) const;
 
-    void set_all_descriptors(reshade::api::descriptor_heap heap, uint32_t offset, uint32_t count, std::vector<descriptor_tracking::descriptor_data>& descriptor_list, uint32_t list_offset) const;
+    void set_all_descriptors(reshade::api::descriptor_heap heap, uint32_t offset, uint32_t count, descriptor_tracking::descriptor_data* descriptor_list, uint32_t list_offset) const;
+
+    /// <summary>
+    /// Same as device::get_descriptor_heap_offset, but remembers the heap and base offset of each table binding so repeated translations
+    /// don't have to call into the runtime. Entries are dropped every frame, as tables can be freed and reallocated without an event. Not
+    /// used for Vulkan, where that happens within a frame as well.
+    /// </summary>
+    void get_descriptor_heap_offset(reshade::api::device* device, reshade::api::descriptor_table table, uint32_t binding, uint32_t array_offset, reshade::api::descriptor_heap* heap, uint32_t* offset) const;
+    /// <summary>
+    /// Gets the number of translations answered from the cache during the last frame.
+    /// </summary>
+    uint64_t get_translations_saved_last_frame() const { return translations_saved_last_frame.load(std::memory_order_relaxed); }
 
     /// <summary>
     /// Gets the description that was used to create the specified pipeline layout parameter.
     /// </summary>
     reshade::api::pipeline_layout_param get_pipeline_layout_param(reshade::api::pipeline_layout layout, uint32_t param) const;
 
+    /// <summary>
+    /// Gets the index of the precomputed metadata of a pipeline layout, or INVALID_LAYOUT_INDEX if the layout isn't known. Indices of
+    /// destroyed layouts are reused, so only hold on to one while the layout is bound.
+    /// </summary>
+    uint32_t get_pipeline_layout_index(reshade::api::pipeline_layout layout) const;
+    const pipeline_layout_metadata& get_pipeline_layout_metadata(uint32_t index) const { return *layout_metadata.find(index); }
 
 private:
     void register_pipeline_layout(reshade::api::pipeline_layout layout, uint32_t count, const reshade::api::pipeline_layout_param* params);
@@ -75,41 +117,54 @@ private:
 
     static bool on_copy_descriptor_tables(reshade::api::device* device, uint32_t count, const reshade::api::descriptor_table_copy* copies);
     static bool on_update_descriptor_tables(reshade::api::device* device, uint32_t count, const reshade::api::descriptor_table_update* updates);
+    static void on_reshade_present(reshade::api::effect_runtime* runtime);
 
     struct descriptor_heap_data
     {
-        concurrency::concurrent_vector<descriptor_data> descriptors;
-    };
-    struct descriptor_heap_hash : std::hash<uint64_t>
-    {
-        size_t operator()(reshade::api::descriptor_heap handle) const
-        {
-            return std::hash<uint64_t>::operator()(handle.handle);
-        }
+        ShaderToggler::PagedArray<descriptor_data> descriptors;
     };
 
     struct pipeline_layout_data
     {
         std::vector<reshade::api::pipeline_layout_param> params;
         std::vector<std::vector<reshade::api::descriptor_range>> ranges;
+        uint32_t metadata_index = INVALID_LAYOUT_INDEX;
     };
-    struct pipeline_layout_hash : std::hash<uint64_t>
+
+    const descriptor_heap_data* find_heap(reshade::api::descriptor_heap heap) const;
+    descriptor_heap_data* acquire_heap(reshade::api::descriptor_heap heap);
+
+    // Heaps are never destroyed while the device lives, layouts are retired through the EpochDomain when they are
+    ShaderToggler::ConcurrentHandleMap<descriptor_heap_data*> heaps;
+    ShaderToggler::ConcurrentHandleMap<pipeline_layout_data*> layouts;
+
+    // Direct mapped, a colliding translation replaces the entry. Each entry is guarded by a seqlock and belongs to the frame in epoch.
+    struct heap_offset_entry
     {
-        size_t operator()(reshade::api::pipeline_layout handle) const
-        {
-            return std::hash<uint64_t>::operator()(handle.handle);
-        }
+        std::atomic<uint32_t> sequence = 0;
+        std::atomic<uint32_t> epoch = 0;
+        std::atomic<uint64_t> table = 0;
+        std::atomic<uint64_t> heap = 0;
+        std::atomic<uint32_t> binding = 0;
+        std::atomic<uint32_t> base_offset = 0;
     };
 
-    struct pipeline_hash : std::hash<uint64_t>
+    static constexpr size_t HEAP_OFFSET_CACHE_SIZE = 4096;
+    std::unique_ptr<heap_offset_entry[]> heap_offset_cache = std::make_unique<heap_offset_entry[]>(HEAP_OFFSET_CACHE_SIZE);
+    std::atomic<uint32_t> heap_offset_epoch = 1;
+    mutable std::atomic<uint64_t> translations_saved = 0;
+    std::atomic<uint64_t> translations_saved_last_frame = 0;
+
+    // Indices into layout_metadata. An index is only freed once the layout it belonged to is reclaimed, as state blocks keep using
+    // it until then. Shared with the retire callbacks, which can run after the device is gone.
+    struct layout_metadata_indices
     {
-        size_t operator()(reshade::api::pipeline handle) const
-        {
-            return std::hash<uint64_t>::operator()(handle.handle);
-        }
+        std::mutex mutex;
+        uint32_t count = 0;
+        std::vector<uint32_t> free;
     };
 
-    concurrency::concurrent_unordered_map<reshade::api::descriptor_heap, descriptor_heap_data, descriptor_heap_hash> heaps;
-    concurrency::concurrent_unordered_map<reshade::api::pipeline_layout, pipeline_layout_data, pipeline_layout_hash> layouts;
-    concurrency::concurrent_unordered_map<reshade::api::pipeline, reshade::api::pipeline_layout, pipeline_hash> pipelines;
+    // Indexed by pipeline_layout_data::metadata_index, elements never move
+    ShaderToggler::PagedArray<pipeline_layout_metadata> layout_metadata;
+    std::shared_ptr<layout_metadata_indices> layout_metadata_slots = std::make_shared<layout_metadata_indices>();
 };
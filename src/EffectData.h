@@ -5,8 +5,8 @@
 struct __declspec(novtable) EffectData final {
     constexpr EffectData() : rendered(false), enabled_in_screenshot(true), technique({}), timeout(-1) {}
     constexpr EffectData(reshade::api::effect_technique tech) : rendered(false), enabled_in_screenshot(true), technique(tech), timeout(-1) {}
-    constexpr EffectData(reshade::api::effect_technique tech, reshade::api::effect_runtime* runtime) : EffectData(tech, runtime, false) {}
-    constexpr EffectData(reshade::api::effect_technique tech, reshade::api::effect_runtime* runtime, bool active)
+    EffectData(reshade::api::effect_technique tech, reshade::api::effect_runtime* runtime) : EffectData(tech, runtime, false) {}
+    EffectData(reshade::api::effect_technique tech, reshade::api::effect_runtime* runtime, bool active)
     {
         if (!runtime->get_annotation_bool_from_technique(tech, "enabled_in_screenshot", &enabled_in_screenshot, 1))
         {
@@ -32,5 +32,6 @@ struct __declspec(novtable) EffectData final {
     bool enabled = false;
     reshade::api::effect_technique technique = {};
     int32_t timeout = -1;
+    uint32_t index = 0;		// position in RuntimeDataContainer::allSortedTechniques, dense key for effect queues
     std::chrono::steady_clock::time_point timeout_start;
 };
\ No newline at end of file
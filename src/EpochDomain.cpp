@@ -0,0 +1,173 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#include "EpochDomain.h"
+
+using namespace std;
+
+namespace ShaderToggler
+{
+    EpochDomain::ReaderSlot EpochDomain::_readerSlots[MAX_READER_SLOTS];
+    atomic<uint64_t> EpochDomain::_globalEpoch = 1;
+    atomic<uint32_t> EpochDomain::_overflowReaders = 0;
+    mutex EpochDomain::_retiredMutex;
+    vector<pair<uint64_t, function<void()>>> EpochDomain::_retired;
+    thread_local EpochDomain::ThreadState EpochDomain::_threadState;
+
+
+    EpochDomain::ThreadState::~ThreadState()
+    {
+        if (slot != nullptr)
+        {
+            slot->epoch.store(0, memory_order_release);
+            slot->inUse.store(false, memory_order_release);
+        }
+    }
+
+
+    EpochDomain::ReaderSlot* EpochDomain::AcquireSlot()
+    {
+        for (uint32_t i = 0; i < MAX_READER_SLOTS; i++)
+        {
+            bool expected = false;
+            if (!_readerSlots[i].inUse.load(memory_order_relaxed) && _readerSlots[i].inUse.compare_exchange_strong(expected, true, memory_order_acquire))
+            {
+                return &_readerSlots[i];
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    void EpochDomain::Enter()
+    {
+        ThreadState& state = _threadState;
+        if (state.depth++ > 0)
+        {
+            return;
+        }
+
+        if (state.slot == nullptr)
+        {
+            state.slot = AcquireSlot();
+        }
+
+        if (state.slot != nullptr)
+        {
+            state.slot->epoch.store(_globalEpoch.load(memory_order_acquire), memory_order_relaxed);
+            // the announcement has to be visible before any protected pointer is loaded
+            atomic_thread_fence(memory_order_seq_cst);
+        }
+        else
+        {
+            // more reader threads than slots, these block reclamation altogether while reading
+            state.overflow = true;
+            _overflowReaders.fetch_add(1, memory_order_seq_cst);
+        }
+    }
+
+
+    void EpochDomain::Leave()
+    {
+        ThreadState& state = _threadState;
+        if (--state.depth > 0)
+        {
+            return;
+        }
+
+        if (state.overflow)
+        {
+            state.overflow = false;
+            _overflowReaders.fetch_sub(1, memory_order_release);
+        }
+        else
+        {
+            state.slot->epoch.store(0, memory_order_release);
+        }
+    }
+
+
+    void EpochDomain::Retire(function<void()> deleter)
+    {
+        unique_lock lock(_retiredMutex);
+
+        // readers that announced an epoch after this one can't see the retired memory anymore
+        const uint64_t retireEpoch = _globalEpoch.fetch_add(1, memory_order_seq_cst);
+        _retired.emplace_back(retireEpoch, std::move(deleter));
+
+        ReclaimLocked();
+    }
+
+
+    void EpochDomain::Reclaim()
+    {
+        unique_lock lock(_retiredMutex);
+        ReclaimLocked();
+    }
+
+
+    void EpochDomain::ReclaimLocked()
+    {
+        if (_retired.size() == 0)
+        {
+            return;
+        }
+
+        atomic_thread_fence(memory_order_seq_cst);
+
+        if (_overflowReaders.load(memory_order_acquire) > 0)
+        {
+            return;
+        }
+
+        uint64_t oldestActive = UINT64_MAX;
+        for (uint32_t i = 0; i < MAX_READER_SLOTS; i++)
+        {
+            const uint64_t epoch = _readerSlots[i].epoch.load(memory_order_acquire);
+            if (epoch != 0 && epoch < oldestActive)
+            {
+                oldestActive = epoch;
+            }
+        }
+
+        erase_if(_retired, [oldestActive](auto& entry) {
+            if (entry.first < oldestActive)
+            {
+                entry.second();
+                return true;
+            }
+
+            return false;
+            });
+    }
+}
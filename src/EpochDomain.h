@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <functional>
+
+namespace ShaderToggler
+{
+    /// <summary>
+    /// Epoch based memory reclamation for the lock-free containers. Readers announce the epoch they entered in a per-thread slot, writers
+    /// hand memory that readers may still see to Retire() and it is freed once every reader that could have observed it has left.
+    /// </summary>
+    class EpochDomain
+    {
+    public:
+        static constexpr uint32_t MAX_READER_SLOTS = 128;
+
+        /// <summary>
+        /// Marks the calling thread as reading shared data for the lifetime of the guard. Guards nest.
+        /// </summary>
+        class ReadGuard
+        {
+        public:
+            ReadGuard() { EpochDomain::Enter(); }
+            ~ReadGuard() { EpochDomain::Leave(); }
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+        };
+
+        /// <summary>
+        /// Schedules deleter to run once no reader can hold a reference to the retired memory anymore. The memory has to be unreachable
+        /// for new readers (unpublished) before it is retired.
+        /// </summary>
+        /// <param name="deleter"></param>
+        static void Retire(std::function<void()> deleter);
+        static void Reclaim();
+
+    private:
+        struct alignas(64) ReaderSlot
+        {
+            std::atomic<uint64_t> epoch = 0;
+            std::atomic<bool> inUse = false;
+        };
+
+        struct ThreadState
+        {
+            ReaderSlot* slot = nullptr;
+            uint32_t depth = 0;
+            bool overflow = false;
+
+            ~ThreadState();
+        };
+
+        static void Enter();
+        static void Leave();
+        static ReaderSlot* AcquireSlot();
+        static void ReclaimLocked();
+
+        static ReaderSlot _readerSlots[MAX_READER_SLOTS];
+        static std::atomic<uint64_t> _globalEpoch;
+        static std::atomic<uint32_t> _overflowReaders;
+        static std::mutex _retiredMutex;
+        static std::vector<std::pair<uint64_t, std::function<void()>>> _retired;
+        static thread_local ThreadState _threadState;
+    };
+}
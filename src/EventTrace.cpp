@@ -0,0 +1,688 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#include <format>
+#include <chrono>
+#include <cstring>
+#include "crc32_hash.hpp"
+#include "EventTrace.h"
+
+using namespace reshade::api;
+using namespace std;
+
+namespace ShaderToggler
+{
+    atomic<bool> EventTrace::_recording = false;
+    bool EventTrace::_fileCreated = false;
+    bool EventTrace::_startFailed = false;
+    mutex EventTrace::_controlMutex;
+    mutex EventTrace::_ringsMutex;
+    vector<unique_ptr<EventTrace::Ring>> EventTrace::_rings;
+    jthread EventTrace::_writer;
+    ofstream EventTrace::_file;
+    thread_local EventTrace::RingLease EventTrace::_threadRing;
+
+
+    static inline uint64_t timestamp()
+    {
+        return static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+
+    /// <summary>
+    /// Builds a record payload on the stack. Trailing arrays which don't fit MAX_PAYLOAD_SIZE are cut off and the record gets flagged truncated.
+    /// </summary>
+    class PayloadBuilder
+    {
+    public:
+        template<typename T>
+        void Put(const T& value)
+        {
+            memcpy(_data + _size, &value, sizeof(T));
+            _size += sizeof(T);
+        }
+
+        bool Fits(uint32_t size)
+        {
+            if (_size + size > EventTrace::MAX_PAYLOAD_SIZE)
+            {
+                _flags |= EventTrace::FLAG_TRUNCATED;
+                return false;
+            }
+
+            return true;
+        }
+
+        bool Truncated() const { return (_flags & EventTrace::FLAG_TRUNCATED) != 0; }
+        uint32_t Position() const { return _size; }
+        void Patch(uint32_t position, uint32_t value) { memcpy(_data + position, &value, sizeof(value)); }
+
+        void Write(EventTrace::RecordType type) const
+        {
+            EventTrace::Write(type, _data, _size, _flags);
+        }
+
+    private:
+        uint8_t _data[EventTrace::MAX_PAYLOAD_SIZE];
+        uint32_t _size = 0;
+        uint8_t _flags = 0;
+    };
+
+
+    static inline uint64_t handleOf(const void* object)
+    {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(object));
+    }
+
+
+    static uint32_t shaderHash(const void* shaderData)
+    {
+        if (nullptr == shaderData)
+        {
+            return 0;
+        }
+
+        const auto& shaderDesc = *static_cast<const shader_desc*>(shaderData);
+        return compute_crc32(static_cast<const uint8_t*>(shaderDesc.code), shaderDesc.code_size);
+    }
+
+
+    /// <summary>
+    /// Appends a DescriptorUpdate. Returns false if not even its header fit, descriptors which don't fit are cut off.
+    /// </summary>
+    static bool putDescriptorUpdate(PayloadBuilder& payload, const descriptor_table_update& update)
+    {
+        if (!payload.Fits(sizeof(uint64_t) + 4 * sizeof(uint32_t)))
+        {
+            return false;
+        }
+
+        payload.Put(update.table.handle);
+        payload.Put(update.binding);
+        payload.Put(update.array_offset);
+        const uint32_t countPosition = payload.Position();
+        payload.Put(update.count);
+        payload.Put(static_cast<uint32_t>(update.type));
+
+        uint32_t written = 0;
+        for (; written < update.count; written++)
+        {
+            switch (update.type)
+            {
+            case descriptor_type::constant_buffer:
+            case descriptor_type::shader_storage_buffer:
+            {
+                if (!payload.Fits(3 * sizeof(uint64_t)))
+                {
+                    break;
+                }
+                const buffer_range& range = static_cast<const buffer_range*>(update.descriptors)[written];
+                payload.Put(range.buffer.handle);
+                payload.Put(range.offset);
+                payload.Put(range.size);
+                continue;
+            }
+            case descriptor_type::sampler_with_resource_view:
+            {
+                if (!payload.Fits(2 * sizeof(uint64_t)))
+                {
+                    break;
+                }
+                const sampler_with_resource_view& samplerAndView = static_cast<const sampler_with_resource_view*>(update.descriptors)[written];
+                payload.Put(samplerAndView.sampler.handle);
+                payload.Put(samplerAndView.view.handle);
+                continue;
+            }
+            default:
+                if (!payload.Fits(sizeof(uint64_t)))
+                {
+                    break;
+                }
+                // samplers, views and acceleration structures are all a single 64 bit handle
+                payload.Put(static_cast<const uint64_t*>(update.descriptors)[written]);
+                continue;
+            }
+
+            break;
+        }
+
+        payload.Patch(countPosition, written);
+        return true;
+    }
+
+
+    static void onInitPipeline(device* device, pipeline_layout, uint32_t subobjectCount, const pipeline_subobject* subobjects, pipeline pipelineHandle)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return;
+        }
+
+        uint32_t hashes[3] = { 0, 0, 0 };
+        for (uint32_t i = 0; i < subobjectCount; ++i)
+        {
+            switch (subobjects[i].type)
+            {
+            case pipeline_subobject_type::vertex_shader:
+                hashes[0] = shaderHash(subobjects[i].data);
+                break;
+            case pipeline_subobject_type::pixel_shader:
+                hashes[1] = shaderHash(subobjects[i].data);
+                break;
+            case pipeline_subobject_type::compute_shader:
+                hashes[2] = shaderHash(subobjects[i].data);
+                break;
+            }
+        }
+
+        PayloadBuilder payload;
+        payload.Put(pipelineHandle.handle);
+        payload.Put(hashes);
+        payload.Write(EventTrace::RecordType::InitPipeline);
+    }
+
+
+    static void onDestroyPipeline(device* device, pipeline pipelineHandle)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(pipelineHandle.handle);
+        payload.Write(EventTrace::RecordType::DestroyPipeline);
+    }
+
+
+    static void onBindPipeline(command_list* cmd_list, pipeline_stage stages, pipeline pipelineHandle)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(handleOf(cmd_list));
+        payload.Put(pipelineHandle.handle);
+        payload.Put(static_cast<uint32_t>(stages));
+        payload.Write(EventTrace::RecordType::BindPipeline);
+    }
+
+
+    static bool onDraw(command_list* cmd_list, uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return false;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(handleOf(cmd_list));
+        payload.Put(vertex_count);
+        payload.Put(instance_count);
+        payload.Put(first_vertex);
+        payload.Put(first_instance);
+        payload.Write(EventTrace::RecordType::Draw);
+        return false;
+    }
+
+
+    static bool onDrawIndexed(command_list* cmd_list, uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return false;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(handleOf(cmd_list));
+        payload.Put(index_count);
+        payload.Put(instance_count);
+        payload.Put(first_index);
+        payload.Put(vertex_offset);
+        payload.Put(first_instance);
+        payload.Write(EventTrace::RecordType::DrawIndexed);
+        return false;
+    }
+
+
+    static bool onDispatch(command_list* cmd_list, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return false;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(handleOf(cmd_list));
+        payload.Put(group_count_x);
+        payload.Put(group_count_y);
+        payload.Put(group_count_z);
+        payload.Write(EventTrace::RecordType::Dispatch);
+        return false;
+    }
+
+
+    static bool onDrawOrDispatchIndirect(command_list* cmd_list, indirect_command type, resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return false;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(handleOf(cmd_list));
+        payload.Put(static_cast<uint32_t>(type));
+        payload.Put(buffer.handle);
+        payload.Put(offset);
+        payload.Put(draw_count);
+        payload.Put(stride);
+        payload.Write(EventTrace::RecordType::DrawOrDispatchIndirect);
+        return false;
+    }
+
+
+    static void onBindRenderTargetsAndDepthStencil(command_list* cmd_list, uint32_t count, const resource_view* rtvs, resource_view dsv)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(handleOf(cmd_list));
+        payload.Put(dsv.handle);
+        const uint32_t countPosition = payload.Position();
+        payload.Put(count);
+
+        uint32_t written = 0;
+        for (; written < count && payload.Fits(sizeof(uint64_t)); written++)
+        {
+            payload.Put(rtvs[written].handle);
+        }
+
+        payload.Patch(countPosition, written);
+        payload.Write(EventTrace::RecordType::BindRenderTargets);
+    }
+
+
+    static void onBeginRenderPass(command_list* cmd_list, uint32_t count, const render_pass_render_target_desc* rts, const render_pass_depth_stencil_desc* ds)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(handleOf(cmd_list));
+        payload.Put(ds != nullptr ? ds->view.handle : static_cast<uint64_t>(0));
+        const uint32_t countPosition = payload.Position();
+        payload.Put(count);
+
+        uint32_t written = 0;
+        for (; written < count && payload.Fits(sizeof(uint64_t)); written++)
+        {
+            payload.Put(rts[written].view.handle);
+        }
+
+        payload.Patch(countPosition, written);
+        payload.Write(EventTrace::RecordType::BeginRenderPass);
+    }
+
+
+    static void onBindDescriptorTables(command_list* cmd_list, shader_stage stages, pipeline_layout layout, uint32_t first, uint32_t count, const descriptor_table* tables)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(handleOf(cmd_list));
+        payload.Put(static_cast<uint32_t>(stages));
+        payload.Put(layout.handle);
+        payload.Put(first);
+        const uint32_t countPosition = payload.Position();
+        payload.Put(count);
+
+        uint32_t written = 0;
+        for (; written < count && payload.Fits(sizeof(uint64_t)); written++)
+        {
+            payload.Put(tables[written].handle);
+        }
+
+        payload.Patch(countPosition, written);
+        payload.Write(EventTrace::RecordType::BindDescriptorTables);
+    }
+
+
+    static bool onUpdateDescriptorTables(device* device, uint32_t count, const descriptor_table_update* updates)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return false;
+        }
+
+        PayloadBuilder payload;
+        const uint32_t countPosition = payload.Position();
+        payload.Put(count);
+
+        uint32_t written = 0;
+        for (; written < count && !payload.Truncated(); written++)
+        {
+            if (!putDescriptorUpdate(payload, updates[written]))
+            {
+                break;
+            }
+        }
+
+        payload.Patch(countPosition, written);
+        payload.Write(EventTrace::RecordType::UpdateDescriptorTables);
+        return false;
+    }
+
+
+    static void onPushDescriptors(command_list* cmd_list, shader_stage stages, pipeline_layout layout, uint32_t layout_param, const descriptor_table_update& update)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(handleOf(cmd_list));
+        payload.Put(static_cast<uint32_t>(stages));
+        payload.Put(layout.handle);
+        payload.Put(layout_param);
+        putDescriptorUpdate(payload, update);
+        payload.Write(EventTrace::RecordType::PushDescriptors);
+    }
+
+
+    static void onMapBufferRegion(device* device, resource resource, uint64_t offset, uint64_t size, map_access access, void** data)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(resource.handle);
+        payload.Put(offset);
+        payload.Put(size);
+        payload.Put(static_cast<uint32_t>(access));
+        payload.Write(EventTrace::RecordType::MapBufferRegion);
+    }
+
+
+    static void onPresent(command_queue* queue, swapchain* swapchain, const rect* source_rect, const rect* dest_rect, uint32_t dirty_rect_count, const rect* dirty_rects)
+    {
+        if (!EventTrace::IsRecording())
+        {
+            return;
+        }
+
+        PayloadBuilder payload;
+        payload.Put(handleOf(queue));
+        payload.Put(handleOf(swapchain));
+        payload.Write(EventTrace::RecordType::Present);
+    }
+
+
+    void EventTrace::RegisterEvents()
+    {
+        reshade::register_event<reshade::addon_event::init_pipeline>(onInitPipeline);
+        reshade::register_event<reshade::addon_event::destroy_pipeline>(onDestroyPipeline);
+        reshade::register_event<reshade::addon_event::bind_pipeline>(onBindPipeline);
+        reshade::register_event<reshade::addon_event::draw>(onDraw);
+        reshade::register_event<reshade::addon_event::draw_indexed>(onDrawIndexed);
+        reshade::register_event<reshade::addon_event::dispatch>(onDispatch);
+        reshade::register_event<reshade::addon_event::draw_or_dispatch_indirect>(onDrawOrDispatchIndirect);
+        reshade::register_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(onBindRenderTargetsAndDepthStencil);
+        reshade::register_event<reshade::addon_event::begin_render_pass>(onBeginRenderPass);
+        reshade::register_event<reshade::addon_event::bind_descriptor_tables>(onBindDescriptorTables);
+        reshade::register_event<reshade::addon_event::update_descriptor_tables>(onUpdateDescriptorTables);
+        reshade::register_event<reshade::addon_event::push_descriptors>(onPushDescriptors);
+        reshade::register_event<reshade::addon_event::map_buffer_region>(onMapBufferRegion);
+        reshade::register_event<reshade::addon_event::present>(onPresent);
+    }
+
+
+    void EventTrace::UnregisterEvents()
+    {
+        reshade::unregister_event<reshade::addon_event::init_pipeline>(onInitPipeline);
+        reshade::unregister_event<reshade::addon_event::destroy_pipeline>(onDestroyPipeline);
+        reshade::unregister_event<reshade::addon_event::bind_pipeline>(onBindPipeline);
+        reshade::unregister_event<reshade::addon_event::draw>(onDraw);
+        reshade::unregister_event<reshade::addon_event::draw_indexed>(onDrawIndexed);
+        reshade::unregister_event<reshade::addon_event::dispatch>(onDispatch);
+        reshade::unregister_event<reshade::addon_event::draw_or_dispatch_indirect>(onDrawOrDispatchIndirect);
+        reshade::unregister_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(onBindRenderTargetsAndDepthStencil);
+        reshade::unregister_event<reshade::addon_event::begin_render_pass>(onBeginRenderPass);
+        reshade::unregister_event<reshade::addon_event::bind_descriptor_tables>(onBindDescriptorTables);
+        reshade::unregister_event<reshade::addon_event::update_descriptor_tables>(onUpdateDescriptorTables);
+        reshade::unregister_event<reshade::addon_event::push_descriptors>(onPushDescriptors);
+        reshade::unregister_event<reshade::addon_event::map_buffer_region>(onMapBufferRegion);
+        reshade::unregister_event<reshade::addon_event::present>(onPresent);
+    }
+
+
+    EventTrace::RingLease::~RingLease()
+    {
+        if (ring != nullptr)
+        {
+            // The writer thread keeps draining what's left, the next thread which needs a ring continues the stream
+            ring->leased.store(false, memory_order_release);
+        }
+    }
+
+
+    EventTrace::Ring* EventTrace::AcquireRing()
+    {
+        unique_lock<mutex> lock(_ringsMutex);
+
+        for (auto& ring : _rings)
+        {
+            if (!ring->leased.exchange(true, memory_order_acquire))
+            {
+                _threadRing.ring = ring.get();
+                return _threadRing.ring;
+            }
+        }
+
+        _rings.push_back(make_unique<Ring>(static_cast<uint32_t>(_rings.size())));
+        _threadRing.ring = _rings.back().get();
+
+        return _threadRing.ring;
+    }
+
+
+    void EventTrace::Write(RecordType type, const void* payload, uint32_t payloadSize, uint8_t flags)
+    {
+        Ring* ring = _threadRing.ring != nullptr ? _threadRing.ring : AcquireRing();
+
+        const uint64_t recordSize = sizeof(RecordHeader) + payloadSize;
+        const uint64_t head = ring->head.load(memory_order_relaxed);
+
+        if (head + recordSize - ring->tail.load(memory_order_acquire) > RING_SIZE)
+        {
+            ring->dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+
+        const RecordHeader header{ type, flags, static_cast<uint16_t>(payloadSize), ring->stream, timestamp() };
+
+        const auto copy = [ring](uint64_t position, const void* source, size_t size) {
+            const size_t offset = static_cast<size_t>(position & (RING_SIZE - 1));
+            const size_t first = min(size, RING_SIZE - offset);
+            memcpy(ring->data.get() + offset, source, first);
+            memcpy(ring->data.get(), static_cast<const uint8_t*>(source) + first, size - first);
+            };
+
+        copy(head, &header, sizeof(header));
+        copy(head + sizeof(header), payload, payloadSize);
+
+        ring->head.store(head + recordSize, memory_order_release);
+    }
+
+
+    bool EventTrace::Drain(Ring& ring)
+    {
+        const uint64_t tail = ring.tail.load(memory_order_relaxed);
+        const uint64_t head = ring.head.load(memory_order_acquire);
+
+        if (head != tail)
+        {
+            const size_t offset = static_cast<size_t>(tail & (RING_SIZE - 1));
+            const size_t size = static_cast<size_t>(head - tail);
+            const size_t first = min(size, RING_SIZE - offset);
+
+            _file.write(reinterpret_cast<const char*>(ring.data.get() + offset), first);
+            _file.write(reinterpret_cast<const char*>(ring.data.get()), size - first);
+
+            ring.tail.store(head, memory_order_release);
+        }
+
+        const uint32_t dropped = ring.dropped.exchange(0, memory_order_relaxed);
+        if (dropped > 0)
+        {
+            const RecordHeader header{ RecordType::Dropped, 0, sizeof(dropped), ring.stream, timestamp() };
+            _file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            _file.write(reinterpret_cast<const char*>(&dropped), sizeof(dropped));
+        }
+
+        return head != tail || dropped > 0;
+    }
+
+
+    void EventTrace::WriterLoop(stop_token stopToken)
+    {
+        vector<Ring*> rings;
+
+        while (!stopToken.stop_requested())
+        {
+            {
+                unique_lock<mutex> lock(_ringsMutex);
+                rings.clear();
+                for (const auto& ring : _rings)
+                {
+                    rings.push_back(ring.get());
+                }
+            }
+
+            bool wroteRecords = false;
+            for (Ring* ring : rings)
+            {
+                wroteRecords |= Drain(*ring);
+            }
+
+            if (wroteRecords)
+            {
+                _file.flush();
+            }
+            else
+            {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+        }
+    }
+
+
+    bool EventTrace::Start(const filesystem::path& traceFile)
+    {
+        unique_lock<mutex> control(_controlMutex);
+
+        if (_recording.load() || _startFailed)
+        {
+            return !_startFailed;
+        }
+
+        // A recording restarted after the last device went away continues the file of this session
+        _file.open(traceFile, ios::binary | (_fileCreated ? ios::app : ios::trunc));
+        if (!_file.is_open())
+        {
+            _startFailed = true;
+            reshade::log::message(reshade::log::level::warning, std::format("Could not create event trace file \"{}\"", traceFile.string()).c_str());
+            return false;
+        }
+
+        if (!_fileCreated)
+        {
+            const FileHeader header{ { 'S', 'T', 'E', 'T' }, FORMAT_VERSION, static_cast<uint64_t>(chrono::steady_clock::period::den / chrono::steady_clock::period::num) };
+            _file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            _fileCreated = true;
+        }
+
+        {
+            // Discard whatever a callback of a previous recording wrote after it was stopped
+            unique_lock<mutex> lock(_ringsMutex);
+            for (auto& ring : _rings)
+            {
+                ring->tail.store(ring->head.load(memory_order_acquire), memory_order_release);
+                ring->dropped.store(0, memory_order_relaxed);
+            }
+        }
+
+        _writer = jthread(&EventTrace::WriterLoop);
+        _recording.store(true, memory_order_release);
+
+        reshade::log::message(reshade::log::level::info, std::format("Recording event trace to \"{}\"", traceFile.string()).c_str());
+
+        return true;
+    }
+
+
+    void EventTrace::Stop()
+    {
+        unique_lock<mutex> control(_controlMutex);
+
+        if (!_recording.load())
+        {
+            return;
+        }
+
+        _recording.store(false, memory_order_release);
+        _writer.request_stop();
+        _writer.join();
+
+        {
+            unique_lock<mutex> lock(_ringsMutex);
+            for (auto& ring : _rings)
+            {
+                Drain(*ring);
+            }
+        }
+
+        _file.close();
+    }
+}
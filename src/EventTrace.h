@@ -0,0 +1,191 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <filesystem>
+#include <reshade.hpp>
+
+namespace ShaderToggler
+{
+    /// <summary>
+    /// Optional recorder which streams the addon relevant events of a session to a binary file, so the matching and scheduling code can be
+    /// profiled offline against real game workloads. Each thread writes into its own ring buffer, a background thread drains the rings into
+    /// the file. A full ring drops records (counted, never blocks the game).
+    /// 
+    /// File format, version 1, all values little endian, structs packed:
+    /// 
+    ///   FileHeader   { char magic[4] = "STET"; uint32 version; uint64 ticksPerSecond; }
+    ///   then records: RecordHeader { uint8 type; uint8 flags; uint16 payloadSize; uint32 stream; uint64 timestamp; } followed by payloadSize bytes.
+    /// 
+    /// stream identifies the recording thread, a stream is taken over by another thread once its thread exited. Records of a single stream
+    /// are in order, streams are interleaved in chunks so a reader has to order by timestamp to get a global order. Unknown record types can
+    /// be skipped using payloadSize. flags bit 0 means the trailing array was truncated to fit MAX_PAYLOAD_SIZE. All handles are 64 bit.
+    /// Payloads per type:
+    /// 
+    ///   InitPipeline           uint64 pipeline; uint32 vertexShaderHash; uint32 pixelShaderHash; uint32 computeShaderHash (0 if absent)
+    ///   DestroyPipeline        uint64 pipeline
+    ///   BindPipeline           uint64 commandList; uint64 pipeline; uint32 stages
+    ///   Draw                   uint64 commandList; uint32 vertexCount; uint32 instanceCount; uint32 firstVertex; uint32 firstInstance
+    ///   DrawIndexed            uint64 commandList; uint32 indexCount; uint32 instanceCount; uint32 firstIndex; int32 vertexOffset; uint32 firstInstance
+    ///   Dispatch               uint64 commandList; uint32 groupCountX; uint32 groupCountY; uint32 groupCountZ
+    ///   DrawOrDispatchIndirect uint64 commandList; uint32 type; uint64 buffer; uint64 offset; uint32 drawCount; uint32 stride
+    ///   BindRenderTargets      uint64 commandList; uint64 depthStencilView; uint32 count; uint64 renderTargetViews[count]
+    ///   BeginRenderPass        uint64 commandList; uint64 depthStencilView; uint32 count; uint64 renderTargetViews[count]
+    ///   BindDescriptorTables   uint64 commandList; uint32 stages; uint64 layout; uint32 first; uint32 count; uint64 tables[count]
+    ///   UpdateDescriptorTables uint32 count; DescriptorUpdate updates[count]
+    ///   PushDescriptors        uint64 commandList; uint32 stages; uint64 layout; uint32 layoutParam; DescriptorUpdate update
+    ///   MapBufferRegion        uint64 resource; uint64 offset; uint64 size; uint32 access
+    ///   Present                uint64 commandQueue; uint64 swapchain
+    ///   Dropped                uint32 count (records of this stream lost since the previous Dropped record)
+    /// 
+    ///   DescriptorUpdate       uint64 table; uint32 binding; uint32 arrayOffset; uint32 count; uint32 type; then count descriptors, each
+    ///                          3 x uint64 (buffer, offset, size) for constant and storage buffers, 2 x uint64 (sampler, view) for
+    ///                          sampler_with_resource_view and 1 x uint64 handle for everything else.
+    /// </summary>
+    class EventTrace
+    {
+    public:
+        static constexpr uint32_t FORMAT_VERSION = 1;
+        static constexpr uint32_t MAX_PAYLOAD_SIZE = 4080;
+        static constexpr uint8_t FLAG_TRUNCATED = 1;
+
+        enum class RecordType : uint8_t
+        {
+            InitPipeline = 1,
+            DestroyPipeline = 2,
+            BindPipeline = 3,
+            Draw = 4,
+            DrawIndexed = 5,
+            Dispatch = 6,
+            DrawOrDispatchIndirect = 7,
+            BindRenderTargets = 8,
+            BeginRenderPass = 9,
+            BindDescriptorTables = 10,
+            UpdateDescriptorTables = 11,
+            PushDescriptors = 12,
+            MapBufferRegion = 13,
+            Present = 14,
+            Dropped = 15,
+        };
+
+#pragma pack(push, 1)
+        struct FileHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint64_t ticksPerSecond;
+        };
+
+        struct RecordHeader
+        {
+            RecordType type;
+            uint8_t flags;
+            uint16_t payloadSize;
+            uint32_t stream;
+            uint64_t timestamp;
+        };
+#pragma pack(pop)
+
+        /// <summary>
+        /// Opens the trace file and starts the writer thread. Called lazily from the device and present events rather than from DllMain, as
+        /// a thread can't be started or joined under the loader lock. Returns false if the file couldn't be created, recording then stays
+        /// off for the rest of the session.
+        /// </summary>
+        static bool Start(const std::filesystem::path& traceFile);
+        /// <summary>
+        /// Stops and joins the writer thread, flushes what's left in the rings and closes the file. Called when the last device is destroyed.
+        /// Rings are kept alive, as a callback can still be running on another thread.
+        /// </summary>
+        static void Stop();
+        static bool IsRecording() { return _recording.load(std::memory_order_relaxed); }
+
+        /// <summary>
+        /// Registers the recording events. Called once from DllMain, the callbacks return right away while not recording.
+        /// </summary>
+        static void RegisterEvents();
+        static void UnregisterEvents();
+
+        /// <summary>
+        /// Appends a record to the calling thread's ring. Payload has to be at most MAX_PAYLOAD_SIZE bytes.
+        /// </summary>
+        static void Write(RecordType type, const void* payload, uint32_t payloadSize, uint8_t flags = 0);
+
+    private:
+        static constexpr size_t RING_SIZE = 1 << 20;
+
+        /// <summary>
+        /// Single producer (the owning thread), single consumer (the writer thread) byte ring. Head and tail only ever grow.
+        /// </summary>
+        struct Ring
+        {
+            explicit Ring(uint32_t id) : stream(id), data(new uint8_t[RING_SIZE]) {}
+
+            const uint32_t stream;
+            std::unique_ptr<uint8_t[]> data;
+            alignas(64) std::atomic<uint64_t> head = 0;
+            alignas(64) std::atomic<uint64_t> tail = 0;
+            std::atomic<uint32_t> dropped = 0;
+            std::atomic<bool> leased = true;
+        };
+
+        /// <summary>
+        /// Hands the calling thread's ring back when the thread exits, so threads which come and go don't each leave a ring behind.
+        /// </summary>
+        struct RingLease
+        {
+            ~RingLease();
+
+            Ring* ring = nullptr;
+        };
+
+        static Ring* AcquireRing();
+        static void WriterLoop(std::stop_token stopToken);
+        static bool Drain(Ring& ring);
+
+        static std::atomic<bool> _recording;
+        static bool _fileCreated;
+        static bool _startFailed;
+        static std::mutex _controlMutex;
+        static std::mutex _ringsMutex;
+        static std::vector<std::unique_ptr<Ring>> _rings;
+        static std::jthread _writer;
+        static std::ofstream _file;
+        static thread_local RingLease _threadRing;
+    };
+}
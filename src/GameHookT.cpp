@@ -86,8 +86,8 @@ bool GameHookT<T>::Unhook()
 }
 
 template class GameHookT<sig_ffxiv_texture_create>;
+// sig_ffxiv_textures_recreate has the same signature, instantiating it again is ill-formed
 template class GameHookT<sig_ffxiv_textures_create>;
-template class GameHookT<sig_ffxiv_textures_recreate>;
 template class GameHookT<sig_memcpy>;
 template class GameHookT<sig_ffxiv_cbload0>;
 template class GameHookT<sig_ffxiv_cbload1>;
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+namespace ShaderToggler
+{
+    constexpr uint32_t MAX_TOGGLE_GROUPS = 128;
+    constexpr uint32_t INVALID_GROUP_SLOT = UINT32_MAX;
+
+    /// <summary>
+    /// Set of toggle groups, one bit per group slot (see ToggleGroup::getSlot)
+    /// </summary>
+    struct GroupMask
+    {
+        uint64_t bits[MAX_TOGGLE_GROUPS / 64] = { };
+
+        void set(uint32_t slot)
+        {
+            if (slot < MAX_TOGGLE_GROUPS)
+            {
+                bits[slot >> 6] |= 1ull << (slot & 63);
+            }
+        }
+
+        void reset(uint32_t slot)
+        {
+            if (slot < MAX_TOGGLE_GROUPS)
+            {
+                bits[slot >> 6] &= ~(1ull << (slot & 63));
+            }
+        }
+
+        bool test(uint32_t slot) const
+        {
+            return slot < MAX_TOGGLE_GROUPS && (bits[slot >> 6] & (1ull << (slot & 63)));
+        }
+
+        bool any() const
+        {
+            return (bits[0] | bits[1]) != 0;
+        }
+
+        void clear()
+        {
+            bits[0] = 0;
+            bits[1] = 0;
+        }
+
+        GroupMask operator&(const GroupMask& other) const
+        {
+            GroupMask result;
+            result.bits[0] = bits[0] & other.bits[0];
+            result.bits[1] = bits[1] & other.bits[1];
+            return result;
+        }
+
+        GroupMask& operator|=(const GroupMask& other)
+        {
+            bits[0] |= other.bits[0];
+            bits[1] |= other.bits[1];
+            return *this;
+        }
+
+        bool operator==(const GroupMask& other) const = default;
+
+        /// <summary>
+        /// Calls func(slot) for every set slot, in ascending order
+        /// </summary>
+        template<typename F>
+        void forEach(F&& func) const
+        {
+            for (uint32_t i = 0; i < MAX_TOGGLE_GROUPS / 64; i++)
+            {
+                for (uint64_t word = bits[i]; word != 0; word &= word - 1)
+                {
+                    func(i * 64 + static_cast<uint32_t>(std::countr_zero(word)));
+                }
+            }
+        }
+    };
+}
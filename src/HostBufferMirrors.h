@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Shim
+{
+    namespace Constants
+    {
+        /// <summary>
+        /// Byte range of a constant buffer a group reads values from. Copies keep the layout of the buffer, ranges are at the same offset
+        /// in source and destination.
+        /// </summary>
+        struct ConstantRange
+        {
+            size_t offset;
+            size_t size;
+        };
+
+        /// <summary>
+        /// Host copy of a constant buffer written from the CPU. Writers and readers synchronize through a sequence number that is odd while a write is in
+        /// progress, so writes into different buffers never contend and readers retry instead of blocking writers.
+        /// </summary>
+        struct HostConstantBuffer
+        {
+            std::atomic<uint32_t> sequence = 0;
+            std::atomic<uint64_t> lastReference = 0;	// frame a group last extracted from this buffer
+            std::vector<uint8_t> data;
+        };
+
+        /// <summary>
+        /// Host mirrors of the constant buffers the game writes from the CPU, used by the memcpy based constant copies. Every such buffer is
+        /// registered with its size, but only buffers groups extract from get a mirror that writes are copied into. Buffers are spread over
+        /// shards by handle, each behind a shared lock that is exclusive only while buffers or mirrors are added or removed.
+        /// </summary>
+        class HostBufferMirrors
+        {
+        public:
+            // Frames a mirror is kept without any group extracting from it
+            static constexpr uint64_t MIRROR_IDLE_FRAMES = 300;
+
+            void add(uint64_t handle, uint64_t size)
+            {
+                Shard& shard = getShard(handle);
+                std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+                shard.buffers.insert_or_assign(handle, Entry{ size, nullptr });
+            }
+
+            void remove(uint64_t handle)
+            {
+                Shard& shard = getShard(handle);
+                std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+                shard.buffers.erase(handle);
+            }
+
+            bool mirrored(uint64_t handle) const
+            {
+                const Shard& shard = getShard(handle);
+                std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+                const auto& it = shard.buffers.find(handle);
+                return it != shard.buffers.end() && it->second.mirror != nullptr;
+            }
+
+            /// <summary>
+            /// Copies ranges of the mirror of handle into dest, clamped to size. Returns false without touching dest if the buffer isn't
+            /// registered or wasn't mirrored yet, the first read starts mirroring it and values show up once the game writes it next.
+            /// </summary>
+            bool read(uint64_t handle, std::vector<uint8_t>& dest, size_t size, const std::vector<ConstantRange>& ranges)
+            {
+                Shard& shard = getShard(handle);
+                std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+                auto it = shard.buffers.find(handle);
+                if (it == shard.buffers.end())
+                {
+                    return false;
+                }
+
+                if (it->second.mirror == nullptr)
+                {
+                    lock.unlock();
+
+                    std::unique_lock<std::shared_mutex> createLock(shard.mutex);
+                    it = shard.buffers.find(handle);
+                    if (it != shard.buffers.end() && it->second.mirror == nullptr)
+                    {
+                        it->second.mirror = std::make_unique<HostConstantBuffer>();
+                        it->second.mirror->data.resize(static_cast<size_t>(it->second.size), 0);
+                        it->second.mirror->lastReference.store(_frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    }
+                    return false;
+                }
+
+                HostConstantBuffer& buffer = *it->second.mirror;
+                buffer.lastReference.store(_frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                size = std::min(size, buffer.data.size());
+
+                // Retry until no write overlapped the copy
+                for (;;)
+                {
+                    const uint32_t sequence = buffer.sequence.load(std::memory_order_acquire);
+                    if (sequence & 1)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+
+                    for (const auto& range : ranges)
+                    {
+                        if (range.offset < size)
+                        {
+                            std::memcpy(dest.data() + range.offset, buffer.data.data() + range.offset, std::min(range.size, size - range.offset));
+                        }
+                    }
+
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (buffer.sequence.load(std::memory_order_relaxed) == sequence)
+                    {
+                        return true;
+                    }
+                }
+            }
+
+            /// <summary>
+            /// Copies size bytes of data to offset in the mirror of handle, if it has one. Writes past the end of the buffer are cut off.
+            /// </summary>
+            void write(uint64_t handle, const void* data, size_t size, uintptr_t offset)
+            {
+                Shard& shard = getShard(handle);
+                std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+                const auto& it = shard.buffers.find(handle);
+                if (it == shard.buffers.end() || it->second.mirror == nullptr)
+                {
+                    return;
+                }
+
+                HostConstantBuffer& buffer = *it->second.mirror;
+                if (offset >= buffer.data.size())
+                {
+                    return;
+                }
+
+                // Writers of the same buffer serialize on the odd sequence number, writers of other buffers aren't affected
+                uint32_t sequence = buffer.sequence.load(std::memory_order_relaxed);
+                while ((sequence & 1) || !buffer.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    std::this_thread::yield();
+                    sequence = buffer.sequence.load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_release);
+
+                std::memcpy(&buffer.data[offset], data, std::min(size, buffer.data.size() - offset));
+
+                buffer.sequence.store(sequence + 2, std::memory_order_release);
+            }
+
+            /// <summary>
+            /// Called once per presented frame. Drops the mirrors of one shard no group extracted from in MIRROR_IDLE_FRAMES, which keeps
+            /// the cost per present small.
+            /// </summary>
+            void advance_frame()
+            {
+                const uint64_t frame = _frame.fetch_add(1, std::memory_order_relaxed) + 1;
+
+                Shard& shard = _shards[frame % SHARD_COUNT];
+                const auto isIdle = [frame](const Entry& entry) {
+                    return entry.mirror != nullptr && frame > entry.mirror->lastReference.load(std::memory_order_relaxed) + MIRROR_IDLE_FRAMES;
+                    };
+
+                {
+                    // Most of the time there's nothing to drop, don't block writers to the shard for that
+                    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+                    if (std::none_of(shard.buffers.begin(), shard.buffers.end(), [&isIdle](const auto& buffer) { return isIdle(buffer.second); }))
+                    {
+                        return;
+                    }
+                }
+
+                std::unique_lock<std::shared_mutex> lock(shard.mutex);
+                for (auto& [_, entry] : shard.buffers)
+                {
+                    if (isIdle(entry))
+                    {
+                        entry.mirror.reset();
+                    }
+                }
+            }
+
+        private:
+            static constexpr uint32_t SHARD_COUNT = 64;
+
+            struct Entry
+            {
+                uint64_t size = 0;
+                std::unique_ptr<HostConstantBuffer> mirror;
+            };
+
+            struct Shard
+            {
+                mutable std::shared_mutex mutex;
+                std::unordered_map<uint64_t, Entry> buffers;
+            };
+
+            static uint32_t shardIndex(uint64_t handle)
+            {
+                // Handles are usually pointers, mix the bits above the allocation alignment into the shard index
+                return static_cast<uint32_t>(((handle >> 4) * 0x9E3779B97F4A7C15ull) >> 58);
+            }
+
+            Shard& getShard(uint64_t handle)
+            {
+                return _shards[shardIndex(handle)];
+            }
+
+            const Shard& getShard(uint64_t handle) const
+            {
+                return _shards[shardIndex(handle)];
+            }
+
+            Shard _shards[SHARD_COUNT];
+            std::atomic<uint64_t> _frame = 0;
+        };
+    }
+}
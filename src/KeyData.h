@@ -31,6 +31,7 @@
 /////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <cassert>
 #include <reshade_api.hpp>
 
 #include "stdafx.h"
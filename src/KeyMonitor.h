@@ -16,7 +16,7 @@ namespace ShaderToggler
     class __declspec(novtable) KeyMonitor final
     {
     public:
-        static const uint32_t KEY_SCREEN_SHOT = 0;
+        static constexpr uint32_t KEY_SCREEN_SHOT = 0;
 
         void SetKeyMonitor(uint32_t id, uint32_t keys)
         {
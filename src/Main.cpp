@@ -42,6 +42,7 @@
 #include <MinHook.h>
 #include "crc32_hash.hpp"
 #include "ShaderManager.h"
+#include "PipelineLookupTable.h"
 #include "CDataFile.h"
 #include "ToggleGroup.h"
 #include "AddonUIData.h"
@@ -57,6 +58,8 @@
 #include "RenderingPreviewManager.h"
 #include "TechniqueManager.h"
 #include "StateTracking.h"
+#include "PrivateDataCache.h"
+#include "EventTrace.h"
 #include "KeyMonitor.h"
 
 using namespace reshade::api;
@@ -70,6 +73,8 @@ extern "C" __declspec(dllexport) const char* DESCRIPTION = "Addon which allows y
 
 constexpr auto MAX_EFFECT_HANDLES = 128;
 constexpr auto REST_VAR_ANNOTATION = "source";
+constexpr auto HOT_PATH_IDLE_FRAMES = 60;
+constexpr auto EVENT_TRACE_FILE = "ShaderToggler.trace";
 
 static filesystem::path g_dllPath;
 static filesystem::path g_basePath;
@@ -77,6 +82,7 @@ static filesystem::path g_basePath;
 static ShaderToggler::ShaderManager g_pixelShaderManager;
 static ShaderToggler::ShaderManager g_vertexShaderManager;
 static ShaderToggler::ShaderManager g_computeShaderManager;
+static ShaderToggler::PipelineLookupTable g_pipelineLookupTable;
 
 static ConstantManager constantManager;
 static ConstantHandlerBase* constantHandler = nullptr;
@@ -84,7 +90,7 @@ static ConstantCopyBase* constantCopy = nullptr;
 static bool constantHandlerHooked = false;
 
 static atomic_uint32_t g_activeCollectorFrameCounter = 0;
-static AddonUIData g_addonUIData(&g_pixelShaderManager, &g_vertexShaderManager, &g_computeShaderManager, constantHandler, &g_activeCollectorFrameCounter);
+static AddonUIData g_addonUIData(&g_pixelShaderManager, &g_vertexShaderManager, &g_computeShaderManager, &g_pipelineLookupTable, constantHandler, &g_activeCollectorFrameCounter);
 
 static KeyMonitor keyMonitor;
 static Rendering::ResourceManager resourceManager;
@@ -99,6 +105,33 @@ static ShaderToggler::TechniqueManager techniqueManager(keyMonitor);
 // TODO: actually implement ability to turn off srgb-view generation
 static vector<effect_runtime*> runtimes;
 
+// Draw, dispatch and bind events return right away while there's no work possible, see updateHotPathEvents. They stay registered,
+// as ReShade's event lists can't be changed while other threads record command lists.
+static atomic_bool g_hotPathActive = true;
+static atomic_uint32_t g_hotPathIdleFrames = 0;
+static atomic_uint32_t g_hotPathGeneration = 0;
+static atomic_uint32_t g_deviceCount = 0;
+
+static void updateHotPathEvents(effect_runtime* runtime);
+
+/// <summary>
+/// Returns the command list's data, reset if it was recorded before the hot path events were last (re-)activated, as the bound
+/// pipelines and queued work it tracks can't be trusted after a gap in the events.
+/// </summary>
+static CommandListDataContainer& getCommandListData(command_list* commandList)
+{
+    CommandListDataContainer& commandListData = PrivateDataCache::Get<CommandListDataContainer>(commandList);
+    const uint32_t generation = g_hotPathGeneration.load(memory_order_relaxed);
+
+    if (commandListData.eventGeneration != generation)
+    {
+        commandListData.Reset();
+        commandListData.eventGeneration = generation;
+    }
+
+    return commandListData;
+}
+
 /// <summary>
 /// Calculates a crc32 hash from the passed in shader bytecode. The hash is used to identity the shader in future runs.
 /// </summary>
@@ -115,9 +148,25 @@ static uint32_t calculateShaderHash(void* shaderData)
     return compute_crc32(static_cast<const uint8_t*>(shaderDesc.code), shaderDesc.code_size);
 }
 
+/// <summary>
+/// Starts the event trace, if enabled, on the first device or present rather than in DllMain, as the writer thread can't be started under the
+/// loader lock.
+/// </summary>
+static void startEventTrace()
+{
+    if (g_addonUIData.GetRecordEventTrace() && !EventTrace::IsRecording())
+    {
+        EventTrace::Start(g_dllPath.parent_path() / EVENT_TRACE_FILE);
+    }
+}
+
+
 static void onInitDevice(device* device)
 {
+    g_deviceCount++;
     device->create_private_data<DeviceDataContainer>();
+
+    startEventTrace();
 }
 
 
@@ -130,7 +179,16 @@ static void onDestroyDevice(device* device)
     resourceManager.OnDestroyDevice(device);
     renderingShaderManager.DestroyShaders(device);
 
+    if (constantCopy != nullptr)
+        constantCopy->OnDestroyDevice(device);
+
+    PrivateDataCache::Invalidate();
     device->destroy_private_data<DeviceDataContainer>();
+
+    if (--g_deviceCount == 0)
+    {
+        EventTrace::Stop();
+    }
 }
 
 
@@ -142,12 +200,13 @@ static void onInitCommandList(command_list* commandList)
 
 static void onDestroyCommandList(command_list* commandList)
 {
+    PrivateDataCache::Invalidate();
     commandList->destroy_private_data<CommandListDataContainer>();
 }
 
 static void onResetCommandList(command_list* commandList)
 {
-    CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
+    CommandListDataContainer& commandListData = PrivateDataCache::Get<CommandListDataContainer>(commandList);
     commandListData.Reset();
 }
 
@@ -327,17 +386,23 @@ static void onInitPipeline(device* device, pipeline_layout, uint32_t subobjectCo
         {
         case pipeline_subobject_type::vertex_shader:
         {
-            g_vertexShaderManager.addHashHandlePair(calculateShaderHash(subobjects[i].data), pipelineHandle.handle);
+            const uint32_t hash = calculateShaderHash(subobjects[i].data);
+            g_vertexShaderManager.addHashHandlePair(hash, pipelineHandle.handle);
+            g_pipelineLookupTable.addHashHandlePair(STAGE_INDEX_VERTEX, hash, pipelineHandle.handle, g_addonUIData.GetToggleGroupsForVertexShaderHash(hash));
         }
         break;
         case pipeline_subobject_type::pixel_shader:
         {
-            g_pixelShaderManager.addHashHandlePair(calculateShaderHash(subobjects[i].data), pipelineHandle.handle);
+            const uint32_t hash = calculateShaderHash(subobjects[i].data);
+            g_pixelShaderManager.addHashHandlePair(hash, pipelineHandle.handle);
+            g_pipelineLookupTable.addHashHandlePair(STAGE_INDEX_PIXEL, hash, pipelineHandle.handle, g_addonUIData.GetToggleGroupsForPixelShaderHash(hash));
         }
         break;
         case pipeline_subobject_type::compute_shader:
         {
-            g_computeShaderManager.addHashHandlePair(calculateShaderHash(subobjects[i].data), pipelineHandle.handle);
+            const uint32_t hash = calculateShaderHash(subobjects[i].data);
+            g_computeShaderManager.addHashHandlePair(hash, pipelineHandle.handle);
+            g_pipelineLookupTable.addHashHandlePair(STAGE_INDEX_COMPUTE, hash, pipelineHandle.handle, g_addonUIData.GetToggleGroupsForComputeShaderHash(hash));
         }
         break;
         }
@@ -350,26 +415,62 @@ static void onDestroyPipeline(device* device, pipeline pipelineHandle)
     g_pixelShaderManager.removeHandle(pipelineHandle.handle);
     g_vertexShaderManager.removeHandle(pipelineHandle.handle);
     g_computeShaderManager.removeHandle(pipelineHandle.handle);
+    g_pipelineLookupTable.removeHandle(pipelineHandle.handle);
+}
+
+
+static inline bool isPipelineBound(const CommandListDataContainer& commandListData, pipeline_stage stages, uint64_t pipelineHandle)
+{
+    return (!(uint32_t)(stages & pipeline_stage::pixel_shader) || commandListData.ps.boundPipeline == pipelineHandle) &&
+        (!(uint32_t)(stages & pipeline_stage::vertex_shader) || commandListData.vs.boundPipeline == pipelineHandle) &&
+        (!(uint32_t)(stages & pipeline_stage::compute_shader) || commandListData.cs.boundPipeline == pipelineHandle);
 }
 
 
 static void onBindPipeline(command_list* commandList, pipeline_stage stages, pipeline pipelineHandle)
 {
+    if (!g_hotPathActive.load(memory_order_acquire))
+    {
+        return;
+    }
+
     if (nullptr == commandList || pipelineHandle.handle == 0 || !((uint32_t)(stages & pipeline_stage::pixel_shader) || (uint32_t)(stages & pipeline_stage::vertex_shader) || (uint32_t)(stages & pipeline_stage::compute_shader)))
     {
         return;
     }
 
-    const uint32_t handleHasPixelShaderAttached = (uint32_t)(stages & pipeline_stage::pixel_shader) ? g_pixelShaderManager.safeGetShaderHash(pipelineHandle.handle) : 0;
-    const uint32_t handleHasVertexShaderAttached = (uint32_t)(stages & pipeline_stage::vertex_shader) ? g_vertexShaderManager.safeGetShaderHash(pipelineHandle.handle) : 0;
-    const uint32_t handleHasComputeShaderAttached = (uint32_t)(stages & pipeline_stage::compute_shader) ? g_computeShaderManager.safeGetShaderHash(pipelineHandle.handle) : 0;
+    CommandListDataContainer& commandListData = getCommandListData(commandList);
+    const uint32_t pipelineGeneration = g_pipelineLookupTable.generation();
+
+    if (commandListData.pipelineGeneration != pipelineGeneration)
+    {
+        commandListData.ps.boundPipeline = 0;
+        commandListData.vs.boundPipeline = 0;
+        commandListData.cs.boundPipeline = 0;
+        commandListData.pipelineGeneration = pipelineGeneration;
+    }
+    else if (g_activeCollectorFrameCounter == 0 && isPipelineBound(commandListData, stages, pipelineHandle.handle))
+    {
+        // Same pipeline as last time for all stages, hashes and groups are unchanged. While collecting, every bind has to be seen.
+        return;
+    }
+
+    PipelineStageData stageData;
+    if (!g_pipelineLookupTable.safeGetStageData(pipelineHandle.handle, stageData))
+    {
+        // pipeline without any known shaders
+        return;
+    }
+
+    const uint32_t handleHasPixelShaderAttached = (uint32_t)(stages & pipeline_stage::pixel_shader) ? stageData.shaderHash[STAGE_INDEX_PIXEL] : 0;
+    const uint32_t handleHasVertexShaderAttached = (uint32_t)(stages & pipeline_stage::vertex_shader) ? stageData.shaderHash[STAGE_INDEX_VERTEX] : 0;
+    const uint32_t handleHasComputeShaderAttached = (uint32_t)(stages & pipeline_stage::compute_shader) ? stageData.shaderHash[STAGE_INDEX_COMPUTE] : 0;
 
     if (!handleHasPixelShaderAttached && !handleHasVertexShaderAttached && !handleHasComputeShaderAttached)
     {
         // draw call with unknown handle, don't collect it
         return;
     }
-    CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
     DeviceDataContainer& deviceData = commandList->get_device()->get_private_data<DeviceDataContainer>();
 
     if (deviceData.current_runtime == nullptr || !deviceData.current_runtime->get_effects_state())
@@ -379,6 +480,20 @@ static void onBindPipeline(command_list* commandList, pipeline_stage stages, pip
 
     uint32_t pipelineChanged = 0;
 
+    // The stages this pipeline has no shader for are left alone, so binding it again is a no-op for those as well
+    if ((uint32_t)(stages & pipeline_stage::pixel_shader))
+    {
+        commandListData.ps.boundPipeline = pipelineHandle.handle;
+    }
+    if ((uint32_t)(stages & pipeline_stage::vertex_shader))
+    {
+        commandListData.vs.boundPipeline = pipelineHandle.handle;
+    }
+    if ((uint32_t)(stages & pipeline_stage::compute_shader))
+    {
+        commandListData.cs.boundPipeline = pipelineHandle.handle;
+    }
+
     if ((uint32_t)(stages & pipeline_stage::pixel_shader) && handleHasPixelShaderAttached)
     {
         if (g_activeCollectorFrameCounter > 0)
@@ -392,7 +507,7 @@ static void onBindPipeline(command_list* commandList, pipeline_stage stages, pip
             commandListData.ps.constantBuffersToUpdate.clear();
         }
 
-        commandListData.ps.blockedShaderGroups = g_addonUIData.GetToggleGroupsForPixelShaderHash(handleHasPixelShaderAttached);
+        commandListData.ps.blockedShaderGroups = stageData.toggleGroups[STAGE_INDEX_PIXEL];
         commandListData.ps.activeShaderHash = handleHasPixelShaderAttached;
     }
 
@@ -409,7 +524,7 @@ static void onBindPipeline(command_list* commandList, pipeline_stage stages, pip
             commandListData.vs.constantBuffersToUpdate.clear();
         }
 
-        commandListData.vs.blockedShaderGroups = g_addonUIData.GetToggleGroupsForVertexShaderHash(handleHasVertexShaderAttached);
+        commandListData.vs.blockedShaderGroups = stageData.toggleGroups[STAGE_INDEX_VERTEX];
         commandListData.vs.activeShaderHash = handleHasVertexShaderAttached;
     }
 
@@ -426,7 +541,7 @@ static void onBindPipeline(command_list* commandList, pipeline_stage stages, pip
             commandListData.cs.constantBuffersToUpdate.clear();
         }
 
-        commandListData.cs.blockedShaderGroups = g_addonUIData.GetToggleGroupsForComputeShaderHash(handleHasComputeShaderAttached);
+        commandListData.cs.blockedShaderGroups = stageData.toggleGroups[STAGE_INDEX_COMPUTE];
         commandListData.cs.activeShaderHash = handleHasComputeShaderAttached;
     }
 
@@ -456,13 +571,18 @@ static void onBindPipeline(command_list* commandList, pipeline_stage stages, pip
 
 static void onBindRenderTargetsAndDepthStencil(command_list* cmd_list, uint32_t count, const resource_view* rtvs, resource_view dsv)
 {
+    if (!g_hotPathActive.load(memory_order_acquire))
+    {
+        return;
+    }
+
     if (cmd_list == nullptr || cmd_list->get_device() == nullptr)
     {
         return;
     }
     
     device* device = cmd_list->get_device();
-    CommandListDataContainer& commandListData = cmd_list->get_private_data<CommandListDataContainer>();
+    CommandListDataContainer& commandListData = getCommandListData(cmd_list);
     DeviceDataContainer& deviceData = device->get_private_data<DeviceDataContainer>();
 
     //if (count > 0)
@@ -489,13 +609,18 @@ static void onBindRenderTargetsAndDepthStencil(command_list* cmd_list, uint32_t
 
 static void onBeginRenderPass(command_list* cmd_list, uint32_t count, const render_pass_render_target_desc* rts, const render_pass_depth_stencil_desc* ds)
 {
+    if (!g_hotPathActive.load(memory_order_acquire))
+    {
+        return;
+    }
+
     if (cmd_list == nullptr || cmd_list->get_device() == nullptr)
     {
         return;
     }
     
     device* device = cmd_list->get_device();
-    CommandListDataContainer& commandListData = cmd_list->get_private_data<CommandListDataContainer>();
+    CommandListDataContainer& commandListData = getCommandListData(cmd_list);
     DeviceDataContainer& deviceData = device->get_private_data<DeviceDataContainer>();
     
     if (!deviceData.current_runtime->get_effects_state())
@@ -544,6 +669,49 @@ static void onPresent(command_queue* queue, swapchain* swapchain, const rect* so
         onResetCommandList(runtime->get_command_queue()->get_immediate_command_list());
 }
 
+/// <summary>
+/// Narrows state tracking down to the root parameters the groups read constants and resource views from. While hunting or editing
+/// everything is tracked, so cycling through slots and descriptors in the UI keeps working.
+/// </summary>
+static void updateStateTrackingInterest()
+{
+    const bool trackAll = g_pixelShaderManager.isInHuntingMode() || g_vertexShaderManager.isInHuntingMode() || g_computeShaderManager.isInHuntingMode() ||
+        g_addonUIData.GetToggleGroupIdShaderEditing() >= 0 || g_addonUIData.GetToggleGroupIdEffectEditing() >= 0 || g_addonUIData.GetToggleGroupIdConstantEditing() >= 0;
+
+    uint32_t trackedSlots[StateTracking::ALL_SHADER_STAGES_SIZE] = { 0 };
+
+    if (!trackAll)
+    {
+        // Slot indices beyond the bound ones are clamped to the last bound slot, so all slots up to the configured one are of interest
+        const auto addInterest = [&trackedSlots](uint32_t stage, uint32_t slot) {
+            stage = std::min(static_cast<uint32_t>(2), stage);
+            trackedSlots[stage] = std::max(trackedSlots[stage], slot + 1);
+            };
+
+        for (const auto& [_, group] : g_addonUIData.GetToggleGroups())
+        {
+            if (group.getExtractConstants())
+            {
+                addInterest(group.getCBShaderStage(), group.getCBSlotIndex());
+            }
+            if (group.getExtractResourceViews())
+            {
+                addInterest(group.getSRVShaderStage(), group.getBindingSRVSlotIndex());
+            }
+            if (group.getRenderToResourceViews())
+            {
+                addInterest(group.getRenderSRVShaderStage(), group.getRenderSRVSlotIndex());
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < StateTracking::ALL_SHADER_STAGES_SIZE; i++)
+    {
+        state_tracking::set_tracked_slots(i, trackAll ? state_tracking::TRACK_ALL_SLOTS : trackedSlots[i]);
+    }
+}
+
+
 static void onReshadePresent(effect_runtime* runtime)
 {
     device* dev = runtime->get_device();
@@ -552,6 +720,7 @@ static void onReshadePresent(effect_runtime* runtime)
     
     deviceData.rendered_effects = false;
 
+    startEventTrace();
     keyMonitor.PollKeyStates(runtime);
 
     if (g_addonUIData.GetPreventRuntimeReload())
@@ -568,11 +737,16 @@ static void onReshadePresent(effect_runtime* runtime)
     }
 
     techniqueManager.OnReshadePresent(runtime);
+    updateHotPathEvents(runtime);
+    updateStateTrackingInterest();
 
     deviceData.bindingsUpdated.clear();
     deviceData.constantsUpdated.clear();
     deviceData.huntPreview.Reset();
 
+    if (constantCopy != nullptr)
+        constantCopy->OnReshadePresent(runtime);
+
     CheckHotkeys(g_addonUIData, runtime);
 }
 
@@ -610,7 +784,7 @@ static void Init()
 {
     resourceManager.SetResourceShim(g_addonUIData.GetResourceShim());
     resourceManager.Init();
-    constantManager.Init(g_addonUIData, groupResourceManager, &constantCopy, &constantHandler);
+    constantManager.Init(g_addonUIData, &constantCopy, &constantHandler);
 
     g_addonUIData.AddToggleGroupRemovalCallback(std::bind(&Rendering::ToggleGroupResourceManager::ToggleGroupRemoved, &groupResourceManager, std::placeholders::_1, std::placeholders::_2));
     techniqueManager.AddEffectsReloadingCallback(std::bind(&Shim::Constants::ConstantHandlerBase::OnEffectsReloading, constantHandler, std::placeholders::_1));
@@ -627,7 +801,7 @@ static void UnInit()
 
 static void CheckDrawCall(command_list* cmd_list, const uint64_t match_modifier = Rendering::MATCH_ALL)
 {
-    CommandListDataContainer& commandListData = cmd_list->get_private_data<CommandListDataContainer>();
+    CommandListDataContainer& commandListData = getCommandListData(cmd_list);
 
     if (commandListData.commandQueue & Rendering::MATCH_ALL & match_modifier)
     {
@@ -656,6 +830,11 @@ static void CheckDrawCall(command_list* cmd_list, const uint64_t match_modifier
 
 static bool onDraw(command_list* cmd_list, uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance)
 {
+    if (!g_hotPathActive.load(memory_order_acquire))
+    {
+        return false;
+    }
+
     CheckDrawCall(cmd_list, Rendering::MATCH_PS | Rendering::MATCH_VS);
 
     return false;
@@ -663,6 +842,11 @@ static bool onDraw(command_list* cmd_list, uint32_t vertex_count, uint32_t insta
 
 static bool onDispatch(command_list* cmd_list, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
 {
+    if (!g_hotPathActive.load(memory_order_acquire))
+    {
+        return false;
+    }
+
     CheckDrawCall(cmd_list, Rendering::MATCH_CS);
 
     return false;
@@ -670,6 +854,11 @@ static bool onDispatch(command_list* cmd_list, uint32_t group_count_x, uint32_t
 
 static bool onDrawIndexed(command_list* cmd_list, uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
 {
+    if (!g_hotPathActive.load(memory_order_acquire))
+    {
+        return false;
+    }
+
     CheckDrawCall(cmd_list, Rendering::MATCH_PS | Rendering::MATCH_VS);
 
     return false;
@@ -677,6 +866,11 @@ static bool onDrawIndexed(command_list* cmd_list, uint32_t index_count, uint32_t
 
 static bool onDrawOrDispatchIndirect(command_list* cmd_list, indirect_command type, resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride)
 {
+    if (!g_hotPathActive.load(memory_order_acquire))
+    {
+        return false;
+    }
+
     switch (type)
     {
     case indirect_command::unknown:
@@ -694,6 +888,51 @@ static bool onDrawOrDispatchIndirect(command_list* cmd_list, indirect_command ty
     return false;
 }
 
+static void registerHotPathEvents()
+{
+    reshade::register_event<reshade::addon_event::bind_pipeline>(onBindPipeline);
+    reshade::register_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(onBindRenderTargetsAndDepthStencil);
+    reshade::register_event<reshade::addon_event::begin_render_pass>(onBeginRenderPass);
+    reshade::register_event<reshade::addon_event::draw>(onDraw);
+    reshade::register_event<reshade::addon_event::dispatch>(onDispatch);
+    reshade::register_event<reshade::addon_event::draw_indexed>(onDrawIndexed);
+    reshade::register_event<reshade::addon_event::draw_or_dispatch_indirect>(onDrawOrDispatchIndirect);
+}
+
+static void unregisterHotPathEvents()
+{
+    reshade::unregister_event<reshade::addon_event::bind_pipeline>(onBindPipeline);
+    reshade::unregister_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(onBindRenderTargetsAndDepthStencil);
+    reshade::unregister_event<reshade::addon_event::begin_render_pass>(onBeginRenderPass);
+    reshade::unregister_event<reshade::addon_event::draw>(onDraw);
+    reshade::unregister_event<reshade::addon_event::dispatch>(onDispatch);
+    reshade::unregister_event<reshade::addon_event::draw_indexed>(onDrawIndexed);
+    reshade::unregister_event<reshade::addon_event::draw_or_dispatch_indirect>(onDrawOrDispatchIndirect);
+}
+
+/// <summary>
+/// Activates the per draw/bind events as soon as there's work possible and deactivates them again once there hasn't been any for
+/// HOT_PATH_IDLE_FRAMES frames, so an idle addon costs a single load per draw call.
+/// </summary>
+static void updateHotPathEvents(effect_runtime* runtime)
+{
+    if (runtime->get_effects_state() && g_addonUIData.IsWorkPossible())
+    {
+        g_hotPathIdleFrames.store(0, memory_order_relaxed);
+
+        if (!g_hotPathActive.load(memory_order_relaxed))
+        {
+            // Command lists recorded while the events were inactive get reset on their next event
+            g_hotPathGeneration.fetch_add(1, memory_order_relaxed);
+            g_hotPathActive.store(true, memory_order_release);
+        }
+    }
+    else if (g_hotPathActive.load(memory_order_relaxed) && g_hotPathIdleFrames.fetch_add(1, memory_order_relaxed) + 1 >= HOT_PATH_IDLE_FRAMES)
+    {
+        g_hotPathActive.store(false, memory_order_release);
+    }
+}
+
 /// <summary>
 /// copied from Reshade
 /// Returns the path to the module file identified by the specified <paramref name="module"/> handle.
@@ -722,6 +961,11 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
         state_tracking::register_events(g_addonUIData.GetTrackDescriptors());
         Init();
 
+        if (g_addonUIData.GetRecordEventTrace())
+        {
+            EventTrace::RegisterEvents();
+        }
+
         reshade::register_event<reshade::addon_event::create_swapchain>(onCreateSwapchain);
         reshade::register_event<reshade::addon_event::init_swapchain>(onInitSwapchain);
         reshade::register_event<reshade::addon_event::destroy_swapchain>(onDestroySwapchain);
@@ -744,19 +988,13 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
         reshade::register_event<reshade::addon_event::reshade_reloaded_effects>(onReshadeReloadedEffects);
         reshade::register_event<reshade::addon_event::reshade_set_technique_state>(onReshadeSetTechniqueState);
         reshade::register_event<reshade::addon_event::reshade_reorder_techniques>(onReshadeReorderTechniques);
-        reshade::register_event<reshade::addon_event::bind_pipeline>(onBindPipeline);
         reshade::register_event<reshade::addon_event::init_device>(onInitDevice);
         reshade::register_event<reshade::addon_event::destroy_device>(onDestroyDevice);
-        reshade::register_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(onBindRenderTargetsAndDepthStencil);
-        reshade::register_event<reshade::addon_event::begin_render_pass>(onBeginRenderPass);
         reshade::register_event<reshade::addon_event::init_effect_runtime>(onInitEffectRuntime);
         reshade::register_event<reshade::addon_event::destroy_effect_runtime>(onDestroyEffectRuntime);
         reshade::register_event<reshade::addon_event::present>(onPresent);
 
-        reshade::register_event<reshade::addon_event::draw>(onDraw);
-        reshade::register_event<reshade::addon_event::dispatch>(onDispatch);
-        reshade::register_event<reshade::addon_event::draw_indexed>(onDrawIndexed);
-        reshade::register_event<reshade::addon_event::draw_or_dispatch_indirect>(onDrawOrDispatchIndirect);
+        registerHotPathEvents();
 
         reshade::register_overlay(nullptr, &displaySettings);
         break;
@@ -775,14 +1013,11 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
         reshade::unregister_event<reshade::addon_event::reshade_reloaded_effects>(onReshadeReloadedEffects);
         reshade::unregister_event<reshade::addon_event::reshade_set_technique_state>(onReshadeSetTechniqueState);
         reshade::unregister_event<reshade::addon_event::reshade_reorder_techniques>(onReshadeReorderTechniques);
-        reshade::unregister_event<reshade::addon_event::bind_pipeline>(onBindPipeline);
         reshade::unregister_event<reshade::addon_event::init_command_list>(onInitCommandList);
         reshade::unregister_event<reshade::addon_event::destroy_command_list>(onDestroyCommandList);
         reshade::unregister_event<reshade::addon_event::reset_command_list>(onResetCommandList);
         reshade::unregister_event<reshade::addon_event::init_device>(onInitDevice);
         reshade::unregister_event<reshade::addon_event::destroy_device>(onDestroyDevice);
-        reshade::unregister_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(onBindRenderTargetsAndDepthStencil);
-        reshade::unregister_event<reshade::addon_event::begin_render_pass>(onBeginRenderPass);
         reshade::unregister_event<reshade::addon_event::init_effect_runtime>(onInitEffectRuntime);
         reshade::unregister_event<reshade::addon_event::destroy_effect_runtime>(onDestroyEffectRuntime);
         reshade::unregister_event<reshade::addon_event::create_resource>(onCreateResource);
@@ -793,10 +1028,12 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
         reshade::unregister_event<reshade::addon_event::destroy_resource_view>(onDestroyResourceView);
         reshade::unregister_event<reshade::addon_event::present>(onPresent);
 
-        reshade::unregister_event<reshade::addon_event::draw>(onDraw);
-        reshade::unregister_event<reshade::addon_event::dispatch>(onDispatch);
-        reshade::unregister_event<reshade::addon_event::draw_indexed>(onDrawIndexed);
-        reshade::unregister_event<reshade::addon_event::draw_or_dispatch_indirect>(onDrawOrDispatchIndirect);
+        unregisterHotPathEvents();
+
+        if (g_addonUIData.GetRecordEventTrace())
+        {
+            EventTrace::UnregisterEvents();
+        }
 
         reshade::unregister_overlay(nullptr, &displaySettings);
 
@@ -0,0 +1,185 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Shim
+{
+    namespace Constants
+    {
+        struct BufferCopy
+        {
+            uint64_t resource = 0;
+            void* destination = nullptr;
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            uint64_t bufferSize = 0;
+        };
+
+        /// <summary>
+        /// Index of the host memory constant buffers are currently mapped to, queried by the memcpy detour for every copy of the process.
+        /// Ranges are kept sorted by address behind a shared lock, and the atomic [lower, upper) bound of all of them lets find() reject
+        /// copies outside of any mapped buffer with two compares and without taking the lock.
+        /// </summary>
+        class MappedRangeIndex
+        {
+        public:
+            /// <summary>
+            /// Adds the mapping of buffer.resource, replacing an earlier one of the same resource. Memory can only be mapped for one buffer at
+            /// a time, so ranges the new one overlaps belong to buffers that were never unmapped and are dropped.
+            /// </summary>
+            void insert(const BufferCopy& buffer)
+            {
+                std::unique_lock<std::shared_mutex> lock(_mutex);
+
+                const auto& existing = _mappings.find(buffer.resource);
+                if (existing != _mappings.end())
+                {
+                    eraseRange(existing->second);
+                }
+
+                auto it = std::upper_bound(_ranges.begin(), _ranges.end(), begin(buffer), [](uintptr_t address, const BufferCopy& range) { return address < begin(range); });
+
+                auto first = it;
+                while (first != _ranges.begin() && end(*(first - 1)) > begin(buffer))
+                {
+                    first--;
+                }
+                auto last = it;
+                while (last != _ranges.end() && begin(*last) < end(buffer))
+                {
+                    last++;
+                }
+                for (auto stale = first; stale != last; stale++)
+                {
+                    _mappings.erase(stale->resource);
+                }
+
+                it = _ranges.erase(first, last);
+                _ranges.insert(it, buffer);
+                _mappings[buffer.resource] = buffer;
+                updateBounds();
+            }
+
+            bool erase(uint64_t resource)
+            {
+                std::unique_lock<std::shared_mutex> lock(_mutex);
+
+                const auto& it = _mappings.find(resource);
+                if (it == _mappings.end())
+                {
+                    return false;
+                }
+
+                eraseRange(it->second);
+                _mappings.erase(it);
+                updateBounds();
+
+                return true;
+            }
+
+            /// <summary>
+            /// Calls func(buffer, offset) if address lies in a mapped buffer, with offset relative to the mapped memory. The index stays
+            /// locked shared during the call, so func must not change it.
+            /// </summary>
+            template<typename F>
+            bool find(uintptr_t address, F&& func) const
+            {
+                // Almost no copy of the process targets a mapped constant buffer
+                if (address < _lowerBound.load(std::memory_order_acquire) || address >= _upperBound.load(std::memory_order_acquire))
+                {
+                    return false;
+                }
+
+                std::shared_lock<std::shared_mutex> lock(_mutex);
+
+                // Last range starting at or before address
+                const auto it = std::upper_bound(_ranges.begin(), _ranges.end(), address, [](uintptr_t a, const BufferCopy& range) { return a < begin(range); });
+                if (it == _ranges.begin() || address >= end(*(it - 1)))
+                {
+                    return false;
+                }
+
+                func(*(it - 1), address - begin(*(it - 1)));
+                return true;
+            }
+
+            size_t size() const
+            {
+                std::shared_lock<std::shared_mutex> lock(_mutex);
+                return _ranges.size();
+            }
+
+        private:
+            static uintptr_t begin(const BufferCopy& buffer)
+            {
+                return reinterpret_cast<uintptr_t>(buffer.destination);
+            }
+
+            static uintptr_t end(const BufferCopy& buffer)
+            {
+                return reinterpret_cast<uintptr_t>(buffer.destination) + static_cast<uintptr_t>(buffer.bufferSize - buffer.offset);
+            }
+
+            void eraseRange(const BufferCopy& buffer)
+            {
+                const auto it = std::lower_bound(_ranges.begin(), _ranges.end(), begin(buffer), [](const BufferCopy& range, uintptr_t address) { return begin(range) < address; });
+                if (it != _ranges.end() && it->resource == buffer.resource)
+                {
+                    _ranges.erase(it);
+                }
+            }
+
+            void updateBounds()
+            {
+                // Ranges don't overlap, so sorting them by start sorts them by end as well
+                _lowerBound.store(_ranges.size() > 0 ? begin(_ranges.front()) : UINTPTR_MAX, std::memory_order_release);
+                _upperBound.store(_ranges.size() > 0 ? end(_ranges.back()) : 0, std::memory_order_release);
+            }
+
+            std::unordered_map<uint64_t, BufferCopy> _mappings;
+            // Mapped buffers sorted by destination address
+            std::vector<BufferCopy> _ranges;
+            std::atomic<uintptr_t> _lowerBound = UINTPTR_MAX;
+            std::atomic<uintptr_t> _upperBound = 0;
+            mutable std::shared_mutex _mutex;
+        };
+    }
+}
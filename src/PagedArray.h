@@ -0,0 +1,258 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+namespace ShaderToggler
+{
+    /// <summary>
+    /// Sparse array of up to MAX_SIZE elements stored in fixed-size pages, which are allocated the first time an element in them is written.
+    /// Pages are found through a two-level directory whose entries are published with a compare-and-swap, so readers never lock and never
+    /// see a partially constructed page. Pages stay in place until the array is destroyed, so element addresses are stable. Elements that
+    /// were never written read as value initialized T.
+    /// </summary>
+    template<typename T>
+    class PagedArray
+    {
+    public:
+        static constexpr size_t PAGE_SIZE = 1024;
+        static constexpr size_t CHUNK_SIZE = 1024;			// pages per directory chunk
+        static constexpr size_t DIRECTORY_SIZE = 256;
+        static constexpr size_t MAX_SIZE = PAGE_SIZE * CHUNK_SIZE * DIRECTORY_SIZE;
+
+        PagedArray() = default;
+
+        ~PagedArray()
+        {
+            for (auto& entry : _directory)
+            {
+                Chunk* chunk = entry.load(std::memory_order_relaxed);
+                if (chunk == nullptr)
+                {
+                    continue;
+                }
+
+                for (auto& page : chunk->pages)
+                {
+                    delete[] page.load(std::memory_order_relaxed);
+                }
+
+                delete chunk;
+            }
+        }
+
+        PagedArray(const PagedArray&) = delete;
+        PagedArray& operator=(const PagedArray&) = delete;
+
+        /// <summary>
+        /// Returns the element at index, or nullptr if its page wasn't allocated yet.
+        /// </summary>
+        const T* find(size_t index) const
+        {
+            const T* page = pageAt(index / PAGE_SIZE);
+            return page != nullptr ? page + index % PAGE_SIZE : nullptr;
+        }
+
+        /// <summary>
+        /// Returns the element at index, allocating its page if needed. Returns nullptr if index is out of range.
+        /// </summary>
+        T* acquire(size_t index)
+        {
+            T* page = acquirePage(index / PAGE_SIZE);
+            return page != nullptr ? page + index % PAGE_SIZE : nullptr;
+        }
+
+        /// <summary>
+        /// Returns the contiguous run of elements starting at index, at most count long and ending at the end of its page at the latest.
+        /// available receives the length of the run.
+        /// </summary>
+        T* acquire_span(size_t index, size_t count, size_t& available)
+        {
+            available = std::min(count, PAGE_SIZE - index % PAGE_SIZE);
+            return acquire(index);
+        }
+
+        /// <summary>
+        /// Copies count elements starting at index to dest, one memcpy per page.
+        /// </summary>
+        void read(size_t index, size_t count, T* dest) const
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "bulk access requires trivially copyable elements");
+
+            while (count > 0)
+            {
+                const size_t run = std::min(count, PAGE_SIZE - index % PAGE_SIZE);
+
+                const T* source = find(index);
+                if (source != nullptr)
+                {
+                    memcpy(dest, source, run * sizeof(T));
+                }
+                else
+                {
+                    std::fill_n(dest, run, T{});
+                }
+
+                index += run;
+                dest += run;
+                count -= run;
+            }
+        }
+
+        /// <summary>
+        /// Copies count elements from source, which may be this array and overlap the destination range, one memmove per contiguous run.
+        /// </summary>
+        void copy(const PagedArray& source, size_t sourceIndex, size_t destIndex, size_t count)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "bulk access requires trivially copyable elements");
+
+            if (&source == this && destIndex > sourceIndex && destIndex < sourceIndex + count)
+            {
+                // Overlapping forward copy within the same array, go back to front so no source element is overwritten before it's read
+                while (count > 0)
+                {
+                    const size_t sourceEnd = sourceIndex + count;
+                    const size_t destEnd = destIndex + count;
+                    const size_t run = std::min({ count, (sourceEnd - 1) % PAGE_SIZE + 1, (destEnd - 1) % PAGE_SIZE + 1 });
+
+                    copyRun(source, sourceEnd - run, destEnd - run, run);
+                    count -= run;
+                }
+
+                return;
+            }
+
+            while (count > 0)
+            {
+                const size_t run = std::min({ count, PAGE_SIZE - sourceIndex % PAGE_SIZE, PAGE_SIZE - destIndex % PAGE_SIZE });
+
+                copyRun(source, sourceIndex, destIndex, run);
+
+                sourceIndex += run;
+                destIndex += run;
+                count -= run;
+            }
+        }
+
+        size_t page_count() const
+        {
+            return _pageCount.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Chunk
+        {
+            std::atomic<T*> pages[CHUNK_SIZE] = {};
+        };
+
+        void copyRun(const PagedArray& source, size_t sourceIndex, size_t destIndex, size_t run)
+        {
+            const T* from = source.find(sourceIndex);
+            T* to = from != nullptr ? acquire(destIndex) : const_cast<T*>(find(destIndex));
+
+            if (to == nullptr)
+            {
+                // Neither side was ever written, both read as empty already
+                return;
+            }
+
+            if (from != nullptr)
+            {
+                memmove(to, from, run * sizeof(T));
+            }
+            else
+            {
+                std::fill_n(to, run, T{});
+            }
+        }
+
+        T* pageAt(size_t page) const
+        {
+            if (page / CHUNK_SIZE >= DIRECTORY_SIZE)
+            {
+                return nullptr;
+            }
+
+            const Chunk* chunk = _directory[page / CHUNK_SIZE].load(std::memory_order_acquire);
+            return chunk != nullptr ? chunk->pages[page % CHUNK_SIZE].load(std::memory_order_acquire) : nullptr;
+        }
+
+        T* acquirePage(size_t page)
+        {
+            if (page / CHUNK_SIZE >= DIRECTORY_SIZE)
+            {
+                return nullptr;
+            }
+
+            Chunk* chunk = publish(_directory[page / CHUNK_SIZE], []() { return new Chunk(); }, [](Chunk* c) { delete c; });
+
+            return publish(chunk->pages[page % CHUNK_SIZE], [this]() {
+                    _pageCount.fetch_add(1, std::memory_order_relaxed);
+                    return new T[PAGE_SIZE]();
+                }, [this](T* p) {
+                    _pageCount.fetch_sub(1, std::memory_order_relaxed);
+                    delete[] p;
+                });
+        }
+
+        /// <summary>
+        /// Returns the pointer in slot, first installing a newly created one if it's empty. When several threads race, the first
+        /// compare-and-swap wins and the others discard their copy.
+        /// </summary>
+        template<typename P, typename Create, typename Discard>
+        static P* publish(std::atomic<P*>& slot, Create&& create, Discard&& discard)
+        {
+            P* current = slot.load(std::memory_order_acquire);
+            if (current != nullptr)
+            {
+                return current;
+            }
+
+            P* created = create();
+            if (slot.compare_exchange_strong(current, created, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                return created;
+            }
+
+            discard(created);
+            return current;
+        }
+
+        std::atomic<Chunk*> _directory[DIRECTORY_SIZE] = {};
+        std::atomic<size_t> _pageCount = 0;
+    };
+}
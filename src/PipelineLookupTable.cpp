@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#include "PipelineLookupTable.h"
+
+using namespace std;
+
+namespace ShaderToggler
+{
+    void PipelineLookupTable::addHashHandlePair(uint32_t stageIndex, uint32_t shaderHash, uint64_t pipelineHandle, const GroupMask& toggleGroups)
+    {
+        if (pipelineHandle > 0 && shaderHash > 0 && stageIndex < STAGE_INDEX_COUNT)
+        {
+            _pipelines.update(pipelineHandle, [=](PipelineStageData& data) {
+                data.shaderHash[stageIndex] = shaderHash;
+                data.toggleGroups[stageIndex] = toggleGroups;
+                });
+        }
+    }
+
+
+    void PipelineLookupTable::removeHandle(uint64_t pipelineHandle)
+    {
+        _pipelines.erase(pipelineHandle);
+        _generation.fetch_add(1, memory_order_release);
+    }
+
+
+    void PipelineLookupTable::updateToggleGroups(const ToggleGroupResolver& resolver)
+    {
+        _pipelines.update_all([&resolver](uint64_t, PipelineStageData& data) {
+            for (uint32_t i = 0; i < STAGE_INDEX_COUNT; i++)
+            {
+                data.toggleGroups[i] = data.shaderHash[i] > 0 ? resolver(i, data.shaderHash[i]) : GroupMask();
+            }
+            });
+
+        _generation.fetch_add(1, memory_order_release);
+    }
+}
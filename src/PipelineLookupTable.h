@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include "ConcurrentHandleMap.h"
+#include "GroupMask.h"
+
+namespace ShaderToggler
+{
+    enum PipelineStageIndex : uint32_t
+    {
+        STAGE_INDEX_PIXEL = 0,
+        STAGE_INDEX_VERTEX,
+        STAGE_INDEX_COMPUTE,
+        STAGE_INDEX_COUNT
+    };
+
+    /// <summary>
+    /// Everything onBindPipeline needs to know about a pipeline handle, packed in a single cache line. Indexed by PipelineStageIndex, which
+    /// matches ShaderData::id.
+    /// </summary>
+    struct alignas(64) PipelineStageData
+    {
+        uint32_t shaderHash[STAGE_INDEX_COUNT] = { 0, 0, 0 };
+        GroupMask toggleGroups[STAGE_INDEX_COUNT];
+    };
+
+    /// <summary>
+    /// Flat table mapping pipeline handles to the shader hashes of their stages and the toggle groups these hashes belong to, so a pipeline
+    /// bind only has to do a single, lock-free lookup.
+    /// </summary>
+    class PipelineLookupTable
+    {
+    public:
+        using ToggleGroupResolver = std::function<GroupMask(uint32_t stageIndex, uint32_t shaderHash)>;
+
+        void addHashHandlePair(uint32_t stageIndex, uint32_t shaderHash, uint64_t pipelineHandle, const GroupMask& toggleGroups);
+        void removeHandle(uint64_t pipelineHandle);
+        /// <summary>
+        /// Re-resolves the toggle groups of every known pipeline. Has to be called whenever the hash to toggle group mapping is rebuilt.
+        /// </summary>
+        /// <param name="resolver"></param>
+        void updateToggleGroups(const ToggleGroupResolver& resolver);
+
+        inline bool safeGetStageData(uint64_t pipelineHandle, PipelineStageData& data)
+        {
+            return _pipelines.find(pipelineHandle, data);
+        }
+
+        /// <summary>
+        /// Changes whenever data returned earlier by safeGetStageData may have become stale: a handle was removed (and could be reused) or the
+        /// toggle groups were re-resolved.
+        /// </summary>
+        inline uint32_t generation() const
+        {
+            return _generation.load(std::memory_order_acquire);
+        }
+
+    private:
+        static_assert(sizeof(PipelineStageData) == 64, "PipelineStageData is expected to fit a single cache line");
+
+        ConcurrentHandleMap<PipelineStageData> _pipelines;
+        std::atomic<uint32_t> _generation = 1;
+    };
+}
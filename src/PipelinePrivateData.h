@@ -1,14 +1,19 @@
 #pragma once
 
 #include <vector>
+#include <array>
 #include <unordered_map>
 #include <tuple>
 #include <shared_mutex>
 #include <chrono>
+#include <atomic>
+#include <unordered_set>
 #include "reshade.hpp"
 #include "CDataFile.h"
 #include "ToggleGroup.h"
+#include "GroupMask.h"
 #include "EffectData.h"
+#include "RenderQueue.h"
 
 struct __declspec(novtable) ResourceRenderData final {
     constexpr ResourceRenderData() : group(nullptr), invocationLocation(0), resource({0}), format(reshade::api::format::unknown) { }
@@ -20,8 +25,11 @@ struct __declspec(novtable) ResourceRenderData final {
     reshade::api::format format;
 };
 
-using effect_queue = std::unordered_map<EffectData*, ResourceRenderData>;
-using binding_queue = std::unordered_map<ShaderToggler::ToggleGroup*, ResourceRenderData>;
+inline uint32_t effect_queue_index(const EffectData* effect) { return effect->index; }
+inline uint32_t binding_queue_index(const ShaderToggler::ToggleGroup* group) { return group->getSlot(); }
+
+using effect_queue = render_queue<EffectData, ResourceRenderData, effect_queue_index>;
+using binding_queue = render_queue<ShaderToggler::ToggleGroup, ResourceRenderData, binding_queue_index>;
 
 struct __declspec(novtable) ShaderData final {
     uint32_t activeShaderHash = -1;
@@ -29,7 +37,8 @@ struct __declspec(novtable) ShaderData final {
     std::unordered_set<ShaderToggler::ToggleGroup*> constantBuffersToUpdate;
     effect_queue techniquesToRender;
     std::unordered_set<ShaderToggler::ToggleGroup*> srvToUpdate;
-    const std::vector<ShaderToggler::ToggleGroup*>* blockedShaderGroups = nullptr;
+    ShaderToggler::GroupMask blockedShaderGroups;
+    uint64_t boundPipeline = 0;		// last pipeline bound to this stage, rebinding it is a no-op
     uint32_t id = 0;
 
     ShaderData(uint32_t _id) : id(_id) { }
@@ -41,12 +50,15 @@ struct __declspec(novtable) ShaderData final {
         constantBuffersToUpdate.clear();
         techniquesToRender.clear();
         srvToUpdate.clear();
-        blockedShaderGroups = nullptr;
+        blockedShaderGroups.clear();
+        boundPipeline = 0;
     }
 };
 
 struct __declspec(uuid("222F7169-3C09-40DB-9BC9-EC53842CE537")) CommandListDataContainer {
     uint64_t commandQueue = 0;
+    uint32_t eventGeneration = 0;
+    uint32_t pipelineGeneration = 0;	// pipeline lookup table generation the boundPipeline members were recorded in
     ShaderData ps{ 0 };
     ShaderData vs{ 1 };
     ShaderData cs{ 2 };
@@ -119,17 +131,36 @@ struct __declspec(uuid("C63E95B1-4E2F-46D6-A276-E8B4612C069A")) DeviceDataContai
     std::atomic_bool rendered_effects = false;
     std::shared_mutex binding_mutex;
     std::shared_mutex render_mutex;
-    std::unordered_set<const ShaderToggler::ToggleGroup*> bindingsUpdated;
-    std::unordered_set<const ShaderToggler::ToggleGroup*> constantsUpdated;
-    std::unordered_set<const ShaderToggler::ToggleGroup*> srvUpdated;
+    ShaderToggler::GroupMask bindingsUpdated;
+    ShaderToggler::GroupMask constantsUpdated;
+    ShaderToggler::GroupMask srvUpdated;
     HuntPreview huntPreview;
 };
 
+// Precomputed work a toggle group schedules when one of its shaders gets bound. Masks are in pixel shader terms and get shifted by
+// ShaderData::id when used. Rebuilt when the group's schedule version or the runtime's technique generation changes.
+struct GroupSchedulePlan {
+    int groupId = -1;
+    uint32_t scheduleVersion = 0;
+    uint64_t techniqueGeneration = 0;
+    bool extractConstants = false;
+    bool providesBinding = false;
+    uint64_t bindingInvocationLocation = 0;
+    uint64_t bindingMask = 0;
+    uint64_t effectInvocationLocation = 0;
+    uint64_t effectMask = 0;
+    std::vector<EffectData*> techniques;
+};
+
 struct __declspec(uuid("838BAF1D-95C0-4A7E-A517-052642879986")) RuntimeDataContainer {
     std::shared_mutex technique_mutex;
     std::unordered_map<std::string, EffectData> allTechniques;
     std::unordered_set<EffectData*> allEnabledTechniques;
     std::vector<EffectData*> allSortedTechniques;
+    // Bumped under technique_mutex whenever the technique set, enable state or ordering changes
+    uint64_t techniqueGeneration = 1;
+    // Indexed by group slot, only touched while holding technique_mutex shared and the device's binding_mutex exclusively
+    std::array<GroupSchedulePlan, ShaderToggler::MAX_TOGGLE_GROUPS> schedulePlans;
 
     SpecialEffect specialEffects[4] = {
         SpecialEffect{ "REST_TONEMAP_TO_SDR", reshade::api::effect_technique {0} },
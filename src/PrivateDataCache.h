@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace ShaderToggler
+{
+    /// <summary>
+    /// Remembers per thread which object's private data of type T was looked up last, so hooks that run many times in a row for the same
+    /// command list or device get it with a pointer compare instead of a lookup in ReShade. Any destroyed command list or device invalidates
+    /// the cache of every thread, as the address of a destroyed object can be reused by the next one.
+    /// </summary>
+    class PrivateDataCache
+    {
+    public:
+        template<typename T, typename Owner>
+        static T& Get(Owner* owner)
+        {
+            thread_local Entry entry;
+
+            const uint32_t generation = _generation.load(std::memory_order_acquire);
+            if (entry.owner != owner || entry.generation != generation)
+            {
+                entry.owner = owner;
+                entry.data = &owner->template get_private_data<T>();
+                entry.generation = generation;
+            }
+
+            return *static_cast<T*>(entry.data);
+        }
+
+        /// <summary>
+        /// Has to be called before private data of a command list or device is destroyed.
+        /// </summary>
+        static void Invalidate()
+        {
+            _generation.fetch_add(1, std::memory_order_acq_rel);
+        }
+
+    private:
+        struct Entry
+        {
+            const void* owner = nullptr;
+            void* data = nullptr;
+            uint32_t generation = 0;
+        };
+
+        static inline std::atomic<uint32_t> _generation = 1;
+    };
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Flat queue of work items keyed by objects with a small dense index (technique index, group slot). Entries live in a contiguous
+/// vector, a second vector maps key indices to entry positions, so lookups, inserts and removals are O(1) and, once both vectors
+/// have grown to their working size, never allocate. Removal moves the last entry into the freed position, order is not preserved.
+/// </summary>
+template<typename Key, typename Value, uint32_t(*IndexOf)(const Key*)>
+class render_queue final
+{
+public:
+    struct entry
+    {
+        Key* key;
+        uint32_t index;
+        Value data;
+        bool scheduled;		// picked up for the invocation currently being processed
+    };
+
+    size_t size() const { return _entries.size(); }
+    bool empty() const { return _entries.empty(); }
+    entry& operator[](size_t position) { return _entries[position]; }
+    typename std::vector<entry>::iterator begin() { return _entries.begin(); }
+    typename std::vector<entry>::iterator end() { return _entries.end(); }
+    typename std::vector<entry>::const_iterator begin() const { return _entries.begin(); }
+    typename std::vector<entry>::const_iterator end() const { return _entries.end(); }
+
+    bool contains(const Key* key) const
+    {
+        return positionOf(key) != NOT_QUEUED;
+    }
+
+    entry* find(const Key* key)
+    {
+        const uint32_t position = positionOf(key);
+        return position != NOT_QUEUED ? &_entries[position] : nullptr;
+    }
+
+    /// <summary>
+    /// Adds an entry for key if there isn't one yet. Returns false if the key was already queued.
+    /// </summary>
+    bool emplace(Key* key, const Value& data)
+    {
+        const uint32_t index = IndexOf(key);
+        if (index == NOT_QUEUED || positionOf(key) != NOT_QUEUED)
+        {
+            return false;
+        }
+
+        if (index >= _positions.size())
+        {
+            _positions.resize(static_cast<size_t>(index) + 1, NOT_QUEUED);
+        }
+
+        _positions[index] = static_cast<uint32_t>(_entries.size());
+        _entries.push_back(entry{ key, index, data, false });
+
+        return true;
+    }
+
+    bool erase(const Key* key)
+    {
+        const uint32_t position = positionOf(key);
+        if (position == NOT_QUEUED)
+        {
+            return false;
+        }
+
+        erase_at(position);
+        return true;
+    }
+
+    /// <summary>
+    /// Removes the entry at position by moving the last entry into its place. When iterating by position, don't advance after calling this.
+    /// </summary>
+    void erase_at(size_t position)
+    {
+        releasePosition(_entries[position].index, position);
+
+        const size_t last = _entries.size() - 1;
+        if (position < last)
+        {
+            _entries[position] = _entries[last];
+            if (_positions[_entries[position].index] == static_cast<uint32_t>(last))
+            {
+                _positions[_entries[position].index] = static_cast<uint32_t>(position);
+            }
+        }
+
+        _entries.pop_back();
+    }
+
+    /// <summary>
+    /// Removes all entries for which pred(entry) returns true in a single pass.
+    /// </summary>
+    template<typename F>
+    void erase_if(F&& pred)
+    {
+        for (size_t i = 0; i < _entries.size();)
+        {
+            if (pred(_entries[i]))
+            {
+                erase_at(i);
+                continue;
+            }
+            i++;
+        }
+    }
+
+    void clear()
+    {
+        for (const auto& e : _entries)
+        {
+            _positions[e.index] = NOT_QUEUED;
+        }
+
+        _entries.clear();
+    }
+
+private:
+    static constexpr uint32_t NOT_QUEUED = UINT32_MAX;
+
+    uint32_t positionOf(const Key* key) const
+    {
+        const uint32_t index = IndexOf(key);
+        if (index >= _positions.size())
+        {
+            return NOT_QUEUED;
+        }
+
+        const uint32_t position = _positions[index];
+        // Keys of a previous technique set can share an index with current ones, so verify the key as well
+        return position != NOT_QUEUED && _entries[position].key == key ? position : NOT_QUEUED;
+    }
+
+    void releasePosition(uint32_t index, size_t position)
+    {
+        if (_positions[index] == static_cast<uint32_t>(position))
+        {
+            _positions[index] = NOT_QUEUED;
+        }
+    }
+
+    std::vector<entry> _entries;
+    std::vector<uint32_t> _positions;
+};
@@ -146,19 +146,24 @@ uint32_t RenderingBindingManager::UpdateTextureBinding(effect_runtime* runtime,
     return 1;
 }
 
-void RenderingBindingManager::_QueueOrDequeue(
+uint32_t RenderingBindingManager::_QueueOrDequeue(
     command_list* cmd_list,
     DeviceDataContainer& deviceData,
     CommandListDataContainer& commandListData,
     binding_queue& queue,
-    unordered_set<ToggleGroup*>& immediateQueue,
     uint64_t callLocation,
     uint32_t layoutIndex,
     uint64_t action)
 {
-    for (auto it = queue.begin(); it != queue.end();)
+    uint32_t scheduled = 0;
+
+    for (size_t i = 0; i < queue.size();)
     {
-        auto& [group, data] = *it;
+        auto& entry = queue[i];
+        ToggleGroup* group = entry.key;
+        ResourceRenderData& data = entry.data;
+        entry.scheduled = false;
+
         // Set views during draw call since we can be sure the correct ones are bound at that point
         if (!callLocation && data.resource == 0)
         {
@@ -172,12 +177,12 @@ void RenderingBindingManager::_QueueOrDequeue(
             else if (group->getRequeueAfterRTMatchingFailure())
             {
                 // Leave loaded up in the effect/bind list and re-issue command on RT change
-                it++;
+                i++;
                 continue;
             }
             else
             {
-                it = queue.erase(it);
+                queue.erase_at(i);
                 continue;
             }
         }
@@ -185,18 +190,19 @@ void RenderingBindingManager::_QueueOrDequeue(
         // Queue updates depending on the place their supposed to be called at
         if (data.resource != 0 && (!callLocation && !data.invocationLocation || callLocation & data.invocationLocation))
         {
-            immediateQueue.insert(group);
+            entry.scheduled = true;
+            scheduled++;
         }
 
-        it++;
+        i++;
     }
+
+    return scheduled;
 }
 
 void RenderingBindingManager::_UpdateTextureBindings(command_list* cmd_list,
     DeviceDataContainer& deviceData,
-    const binding_queue& bindingsToUpdate,
-    vector<ToggleGroup*>& removalList,
-    const unordered_set<ToggleGroup*>& toUpdateBindings)
+    binding_queue& bindingsToUpdate)
 {
     effect_runtime* runtime = deviceData.current_runtime;
 
@@ -205,12 +211,16 @@ void RenderingBindingManager::_UpdateTextureBindings(command_list* cmd_list,
 
     auto& runtimeData = runtime->get_private_data<RuntimeDataContainer>();
 
-    for (auto& [group, bindingData] : bindingsToUpdate)
+    for (size_t i = 0; i < bindingsToUpdate.size();)
     {
-        if (toUpdateBindings.contains(group) && !deviceData.bindingsUpdated.contains(group))
+        ToggleGroup* group = bindingsToUpdate[i].key;
+        const ResourceRenderData& bindingData = bindingsToUpdate[i].data;
+
+        if (bindingsToUpdate[i].scheduled && !deviceData.bindingsUpdated.test(group->getSlot()))
         {
             if (bindingData.resource == 0)
             {
+                i++;
                 continue;
             }
 
@@ -259,9 +269,12 @@ void RenderingBindingManager::_UpdateTextureBindings(command_list* cmd_list,
                 }
             }
 
-            deviceData.bindingsUpdated.emplace(group);
-            removalList.push_back(group);
+            deviceData.bindingsUpdated.set(group->getSlot());
+            bindingsToUpdate.erase_at(i);
+            continue;
         }
+
+        i++;
     }
 }
 
@@ -285,63 +298,42 @@ void RenderingBindingManager::UpdateTextureBindings(command_list* cmd_list, uint
         return;
     }
 
-    unordered_set<ToggleGroup*> psToUpdateBindings;
-    unordered_set<ToggleGroup*> vsToUpdateBindings;
-    unordered_set<ToggleGroup*> csToUpdateBindings;
+    uint32_t psToUpdate = 0;
+    uint32_t vsToUpdate = 0;
+    uint32_t csToUpdate = 0;
 
     if (invocation & MATCH_BINDING_PS)
     {
-        _QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.ps.bindingsToUpdate, psToUpdateBindings, callLocation, 0, MATCH_BINDING_PS);
+        psToUpdate = _QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.ps.bindingsToUpdate, callLocation, 0, MATCH_BINDING_PS);
     }
 
     if (invocation & MATCH_BINDING_VS)
     {
-        _QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.vs.bindingsToUpdate, vsToUpdateBindings, callLocation, 1, MATCH_BINDING_VS);
+        vsToUpdate = _QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.vs.bindingsToUpdate, callLocation, 1, MATCH_BINDING_VS);
     }
 
     if (invocation & MATCH_BINDING_CS)
     {
-        _QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.cs.bindingsToUpdate, csToUpdateBindings, callLocation, 2, MATCH_BINDING_CS);
+        csToUpdate = _QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.cs.bindingsToUpdate, callLocation, 2, MATCH_BINDING_CS);
     }
 
-    if (psToUpdateBindings.size() == 0 && vsToUpdateBindings.size() == 0 && csToUpdateBindings.size() == 0)
+    if (psToUpdate == 0 && vsToUpdate == 0 && csToUpdate == 0)
     {
         return;
     }
 
-    vector<ToggleGroup*> psRemovalList;
-    vector<ToggleGroup*> vsRemovalList;
-    vector<ToggleGroup*> csRemovalList;
-
-    if (psToUpdateBindings.size() > 0)
-    {
-        _UpdateTextureBindings(cmd_list, deviceData, commandListData.ps.bindingsToUpdate, psRemovalList, psToUpdateBindings);
-    }
-    if (vsToUpdateBindings.size() > 0)
-    {
-        _UpdateTextureBindings(cmd_list, deviceData, commandListData.vs.bindingsToUpdate, vsRemovalList, vsToUpdateBindings);
-    }
-    if (csToUpdateBindings.size() > 0)
-    {
-        _UpdateTextureBindings(cmd_list, deviceData, commandListData.cs.bindingsToUpdate, csRemovalList, csToUpdateBindings);
-    }
-    mtx.unlock();
-
-    for (auto& g : psRemovalList)
+    if (psToUpdate > 0)
     {
-        commandListData.ps.bindingsToUpdate.erase(g);
+        _UpdateTextureBindings(cmd_list, deviceData, commandListData.ps.bindingsToUpdate);
     }
-
-    for (auto& g : vsRemovalList)
+    if (vsToUpdate > 0)
     {
-        commandListData.vs.bindingsToUpdate.erase(g);
+        _UpdateTextureBindings(cmd_list, deviceData, commandListData.vs.bindingsToUpdate);
     }
-
-    for (auto& g : csRemovalList)
+    if (csToUpdate > 0)
     {
-        commandListData.cs.bindingsToUpdate.erase(g);
+        _UpdateTextureBindings(cmd_list, deviceData, commandListData.cs.bindingsToUpdate);
     }
-
 }
 
 void RenderingBindingManager::ClearUnmatchedTextureBindings(reshade::api::command_list* cmd_list)
@@ -357,7 +349,7 @@ void RenderingBindingManager::ClearUnmatchedTextureBindings(reshade::api::comman
         ToggleGroup& group = groupData.second;
         GroupResource& resources = group.GetGroupResource(ShaderToggler::GroupResourceType::RESOURCE_BINDING);
 
-        if (!data.bindingsUpdated.contains(&group) && (resources.clear_on_miss() && empty_srv != 0 && resources.state != ShaderToggler::GroupResourceState::RESOURCE_CLEARED))
+        if (!data.bindingsUpdated.test(group.getSlot()) && (resources.clear_on_miss() && empty_srv != 0 && resources.state != ShaderToggler::GroupResourceState::RESOURCE_CLEARED))
         {
             data.current_runtime->update_texture_bindings(group.getTextureBindingName().c_str(), empty_srv, empty_srv);
             resources.state = ShaderToggler::GroupResourceState::RESOURCE_CLEARED;
@@ -29,9 +29,7 @@ namespace Rendering
 
         void _UpdateTextureBindings(reshade::api::command_list* cmd_list,
             DeviceDataContainer& deviceData,
-            const binding_queue& bindingsToUpdate,
-            std::vector<ShaderToggler::ToggleGroup*>& removalList,
-            const std::unordered_set<ShaderToggler::ToggleGroup*>& toUpdateBindings);
+            binding_queue& bindingsToUpdate);
         bool _CreateTextureBinding(reshade::api::effect_runtime* runtime,
             reshade::api::resource* res,
             reshade::api::resource_view* srv,
@@ -40,12 +38,11 @@ namespace Rendering
             uint32_t width,
             uint32_t height,
             uint16_t levels);
-        void _QueueOrDequeue(
+        uint32_t _QueueOrDequeue(
             reshade::api::command_list* cmd_list,
             DeviceDataContainer& deviceData,
             CommandListDataContainer& commandListData,
             binding_queue& queue,
-            std::unordered_set<ShaderToggler::ToggleGroup*>& immediateQueue,
             uint64_t callLocation,
             uint32_t layoutIndex,
             uint64_t action);
@@ -1,5 +1,6 @@
 #include "RenderingEffectManager.h"
 #include "StateTracking.h"
+#include "PrivateDataCache.h"
 #include "Util.h"
 
 using namespace Rendering;
@@ -59,44 +60,48 @@ bool RenderingEffectManager::_RenderEffects(
     command_list* cmd_list,
     DeviceDataContainer& deviceData,
     RuntimeDataContainer& runtimeData,
-    const effect_queue& techniquesToRender,
-    vector<EffectData*>& removalList,
-    const unordered_set<EffectData*>& toRenderNames)
+    effect_queue& techniquesToRender)
 {
     bool rendered = false;
-    CommandListDataContainer& cmdData = cmd_list->get_private_data<CommandListDataContainer>();
     effect_runtime* runtime = deviceData.current_runtime;
 
-    unordered_map<ToggleGroup*, pair<vector<EffectData*>, ResourceRenderData>> groupTechMap;
+    const auto pendingEntry = [&techniquesToRender](const EffectData* tech) -> effect_queue::entry* {
+        effect_queue::entry* queued = techniquesToRender.find(tech);
+        return queued != nullptr && queued->scheduled && tech->enabled && !tech->rendered ? queued : nullptr;
+        };
+
+    GroupMask pendingGroups;
+    // A group renders to the resource queued with its last pending technique in render order, later entries overwrite earlier ones.
+    // Only read for slots in pendingGroups, so it's left uninitialized.
+    const EffectData* lastPending[MAX_TOGGLE_GROUPS];
 
     for (const auto& aTech : runtimeData.allSortedTechniques)
     {
-        const auto& sTech = techniquesToRender.find(aTech);
-
-        if (sTech == techniquesToRender.end())
+        const effect_queue::entry* queued = pendingEntry(aTech);
+        if (queued == nullptr)
         {
             continue;
         }
 
-        if (sTech->first->enabled && !sTech->first->rendered && toRenderNames.contains(sTech->first))
+        // Entries can still reference a group whose slot was released
+        const uint32_t slot = queued->data.group->getSlot();
+        if (slot >= MAX_TOGGLE_GROUPS)
         {
-            const auto& [techName, techData] = *sTech;
-
-            auto& [gEffects, gResource] = groupTechMap[techData.group];
-
-            gEffects.push_back(sTech->first);
-            gResource = sTech->second;
+            continue;
         }
+
+        pendingGroups.set(slot);
+        lastPending[slot] = aTech;
     }
 
-    for (const auto& tech : groupTechMap)
-    {
-        const auto& group = tech.first;
-        const auto& [effectList, active_resource] = tech.second;
+    pendingGroups.forEach([&](uint32_t slot) {
+        // Rendering other groups removed only their own entries, this one is still pending. Copied, as rendering this group removes it.
+        const ResourceRenderData active_resource = pendingEntry(lastPending[slot])->data;
+        ToggleGroup* group = active_resource.group;
 
         if (active_resource.resource == 0)
         {
-            continue;
+            return;
         }
 
         resource_view view_non_srgb = {};
@@ -109,7 +114,7 @@ bool RenderingEffectManager::_RenderEffects(
 
         if (view == nullptr)
         {
-            continue;
+            return;
         }
 
         if (group->getPreserveAlpha())
@@ -139,7 +144,7 @@ bool RenderingEffectManager::_RenderEffects(
 
         if (view_non_srgb == 0)
         {
-            continue;
+            return;
         }
 
         if (group->getFlipBuffer() && runtimeData.specialEffects[REST_FLIP].technique != 0)
@@ -152,13 +157,19 @@ bool RenderingEffectManager::_RenderEffects(
             runtime->render_technique(runtimeData.specialEffects[REST_TONEMAP_TO_SDR].technique, cmd_list, view_non_srgb, view_srgb);
         }
 
-        for (const auto& effectTech : effectList)
+        for (const auto& effectTech : runtimeData.allSortedTechniques)
         {
+            const effect_queue::entry* queued = pendingEntry(effectTech);
+            if (queued == nullptr || queued->data.group != group)
+            {
+                continue;
+            }
+
             runtime->render_technique(effectTech->technique, cmd_list, view_non_srgb, view_srgb);
 
             effectTech->rendered = true;
 
-            removalList.push_back(effectTech);
+            techniquesToRender.erase(effectTech);
 
             rendered = true;
         }
@@ -181,7 +192,7 @@ bool RenderingEffectManager::_RenderEffects(
             if (target_view_non_srgb != 0)
                 shaderManager.CopyResourceMaskAlpha(cmd_list, group_view, target_view_non_srgb, desc.texture.width, desc.texture.height);
         }
-    }
+        });
 
     return rendered;
 }
@@ -194,8 +205,8 @@ void RenderingEffectManager::RenderEffects(command_list* cmd_list, uint64_t call
     }
 
     device* device = cmd_list->get_device();
-    CommandListDataContainer& commandListData = cmd_list->get_private_data<CommandListDataContainer>();
-    DeviceDataContainer& deviceData = device->get_private_data<DeviceDataContainer>();
+    CommandListDataContainer& commandListData = PrivateDataCache::Get<CommandListDataContainer>(cmd_list);
+    DeviceDataContainer& deviceData = PrivateDataCache::Get<DeviceDataContainer>(device);
 
     // Remove call location from queue
     commandListData.commandQueue &= ~(invocation << (callLocation * MATCH_DELIMITER));
@@ -207,32 +218,28 @@ void RenderingEffectManager::RenderEffects(command_list* cmd_list, uint64_t call
     }
 
     RuntimeDataContainer& runtimeData = deviceData.current_runtime->get_private_data<RuntimeDataContainer>();
-    bool toRender = false;
-    unordered_set<EffectData*> psToRenderNames;
-    unordered_set<EffectData*> vsToRenderNames;
-    unordered_set<EffectData*> csToRenderNames;
+    uint32_t psToRender = 0;
+    uint32_t vsToRender = 0;
+    uint32_t csToRender = 0;
 
     if (invocation & MATCH_EFFECT_PS)
     {
-        RenderingManager::QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.ps.techniquesToRender, psToRenderNames, callLocation, 0, MATCH_EFFECT_PS);
+        psToRender = RenderingManager::QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.ps.techniquesToRender, callLocation, 0, MATCH_EFFECT_PS);
     }
 
     if (invocation & MATCH_EFFECT_VS)
     {
-        RenderingManager::QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.vs.techniquesToRender, vsToRenderNames, callLocation, 1, MATCH_EFFECT_VS);
+        vsToRender = RenderingManager::QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.vs.techniquesToRender, callLocation, 1, MATCH_EFFECT_VS);
     }
 
     if (invocation & MATCH_EFFECT_CS)
     {
-        RenderingManager::QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.cs.techniquesToRender, csToRenderNames, callLocation, 2, MATCH_EFFECT_CS);
+        csToRender = RenderingManager::QueueOrDequeue(cmd_list, deviceData, commandListData, commandListData.cs.techniquesToRender, callLocation, 2, MATCH_EFFECT_CS);
     }
 
     bool rendered = false;
-    vector<EffectData*> psRemovalList;
-    vector<EffectData*> vsRemovalList;
-    vector<EffectData*> csRemovalList;
 
-    if (psToRenderNames.size() == 0 && vsToRenderNames.size() == 0)
+    if (psToRender == 0 && vsToRender == 0)
     {
         return;
     }
@@ -245,29 +252,17 @@ void RenderingEffectManager::RenderEffects(command_list* cmd_list, uint64_t call
 
     shared_lock<shared_mutex> techLock(runtimeData.technique_mutex);
     rendered =
-        (psToRenderNames.size() > 0) && _RenderEffects(cmd_list, deviceData, runtimeData, commandListData.ps.techniquesToRender, psRemovalList, psToRenderNames) ||
-        (vsToRenderNames.size() > 0) && _RenderEffects(cmd_list, deviceData, runtimeData, commandListData.vs.techniquesToRender, vsRemovalList, vsToRenderNames) ||
-        (csToRenderNames.size() > 0) && _RenderEffects(cmd_list, deviceData, runtimeData, commandListData.cs.techniquesToRender, csRemovalList, csToRenderNames);
+        (psToRender > 0) && _RenderEffects(cmd_list, deviceData, runtimeData, commandListData.ps.techniquesToRender) ||
+        (vsToRender > 0) && _RenderEffects(cmd_list, deviceData, runtimeData, commandListData.vs.techniquesToRender) ||
+        (csToRender > 0) && _RenderEffects(cmd_list, deviceData, runtimeData, commandListData.cs.techniquesToRender);
     techLock.unlock();
 
-    for (auto& g : psRemovalList)
-    {
-        commandListData.ps.techniquesToRender.erase(g);
-    }
-
-    for (auto& g : vsRemovalList)
-    {
-        commandListData.vs.techniquesToRender.erase(g);
-    }
-
-    for (auto& g : csRemovalList)
-    {
-        commandListData.cs.techniquesToRender.erase(g);
-    }
-
     if (rendered)
     {
-        cmd_list->get_private_data<state_tracking>().apply(cmd_list);
+        // ReShade doesn't report what it binds while rendering techniques, compute passes included, so everything has to be restored
+        state_tracking& state = PrivateDataCache::Get<state_tracking>(cmd_list);
+        state.mark_dirty(StateTracking::state_category::all);
+        state.apply(cmd_list);
     }
 }
 
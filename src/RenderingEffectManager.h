@@ -25,8 +25,6 @@ namespace Rendering
             reshade::api::command_list* cmd_list,
             DeviceDataContainer& deviceData,
             RuntimeDataContainer& runtimeData,
-            const effect_queue& techniquesToRender,
-            std::vector<EffectData*>& removalList,
-            const std::unordered_set<EffectData*>& toRenderNames);
+            effect_queue& techniquesToRender);
     };
 }
\ No newline at end of file
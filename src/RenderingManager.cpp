@@ -1,5 +1,7 @@
 #include "RenderingManager.h"
 #include "PipelinePrivateData.h"
+#include "PrivateDataCache.h"
+#include <cmath>
 
 using namespace Rendering;
 using namespace ShaderToggler;
@@ -159,8 +161,8 @@ const ResourceViewData RenderingManager::GetCurrentResourceView(command_list* cm
 
     device* device = deviceData.current_runtime->get_device();
 
-    state_tracking& state = cmd_list->get_private_data<state_tracking>();
-    const vector<resource_view>& rtvs = state.render_targets;
+    state_tracking& state = PrivateDataCache::Get<state_tracking>(cmd_list);
+    const auto& rtvs = state.render_targets;
 
     size_t index = group->getRenderTargetIndex();
     index = std::min(index, rtvs.size() - 1);
@@ -286,19 +288,23 @@ const ResourceViewData RenderingManager::GetCurrentResourceView(command_list* cm
     return active_data;
 }
 
-void RenderingManager::QueueOrDequeue(
+uint32_t RenderingManager::QueueOrDequeue(
     command_list* cmd_list,
     DeviceDataContainer& deviceData,
     CommandListDataContainer& commandListData,
     effect_queue& queue,
-    unordered_set<EffectData*>& immediateQueue,
     uint64_t callLocation,
     uint32_t layoutIndex,
     uint64_t action)
 {
-    for (auto it = queue.begin(); it != queue.end();)
+    uint32_t scheduled = 0;
+
+    for (size_t i = 0; i < queue.size();)
     {
-        auto& [name, data] = *it;
+        auto& entry = queue[i];
+        ResourceRenderData& data = entry.data;
+        entry.scheduled = false;
+
         // Set views during draw call since we can be sure the correct ones are bound at that point
         if (!callLocation && data.resource == 0)
         {
@@ -312,12 +318,12 @@ void RenderingManager::QueueOrDequeue(
             else if(data.group->getRequeueAfterRTMatchingFailure())
             {
                 // Leave loaded up in the effect/bind list and re-issue command on RT change
-                it++;
+                i++;
                 continue;
             }
             else
             {
-                it = queue.erase(it);
+                queue.erase_at(i);
                 continue;
             }
         }
@@ -325,9 +331,12 @@ void RenderingManager::QueueOrDequeue(
         // Queue updates depending on the place their supposed to be called at
         if (data.resource != 0 && (!callLocation && !data.invocationLocation || callLocation & data.invocationLocation))
         {
-            immediateQueue.insert(name);
+            entry.scheduled = true;
+            scheduled++;
         }
 
-        it++;
+        i++;
     }
+
+    return scheduled;
 }
\ No newline at end of file
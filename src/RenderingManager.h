@@ -71,12 +71,11 @@ namespace Rendering
         static bool check_aspect_ratio(float width_to_check, float height_to_check, uint32_t width, uint32_t height, uint32_t matchingMode);
         
         static void EnumerateTechniques(reshade::api::effect_runtime* runtime, std::function<void(reshade::api::effect_runtime*, reshade::api::effect_technique, std::string&, std::string&)> func);
-        static void QueueOrDequeue(
+        static uint32_t QueueOrDequeue(
             reshade::api::command_list* cmd_list,
             DeviceDataContainer& deviceData,
             CommandListDataContainer& commandListData,
             effect_queue& queue,
-            std::unordered_set<EffectData*>& immediateQueue,
             uint64_t callLocation,
             uint32_t layoutIndex,
             uint64_t action);
@@ -1,4 +1,5 @@
 #include "RenderingQueueManager.h"
+#include "PrivateDataCache.h"
 
 using namespace Rendering;
 using namespace ShaderToggler;
@@ -14,6 +15,68 @@ RenderingQueueManager::~RenderingQueueManager()
 
 }
 
+const GroupSchedulePlan& RenderingQueueManager::_GetSchedulePlan(ToggleGroup* group, RuntimeDataContainer& runtimeData) const
+{
+    GroupSchedulePlan& plan = runtimeData.schedulePlans[group->getSlot()];
+
+    if (plan.groupId == group->getId() && plan.scheduleVersion == group->getScheduleVersion() && plan.techniqueGeneration == runtimeData.techniqueGeneration)
+    {
+        return plan;
+    }
+
+    plan.groupId = group->getId();
+    plan.scheduleVersion = group->getScheduleVersion();
+    plan.techniqueGeneration = runtimeData.techniqueGeneration;
+    plan.extractConstants = group->getExtractConstants();
+    plan.providesBinding = group->isProvidingTextureBinding();
+
+    if (!group->getCopyTextureBinding() || group->getExtractResourceViews())
+    {
+        plan.bindingInvocationLocation = CALL_DRAW;
+        plan.bindingMask = MATCH_BINDING_PS << (CALL_DRAW * MATCH_DELIMITER);
+    }
+    else
+    {
+        plan.bindingInvocationLocation = group->getBindingInvocationLocation();
+        plan.bindingMask = (MATCH_BINDING_PS << (plan.bindingInvocationLocation * MATCH_DELIMITER)) | (MATCH_BINDING_PS << (CALL_DRAW * MATCH_DELIMITER));
+    }
+
+    if (group->getRenderToResourceViews())
+    {
+        plan.effectInvocationLocation = CALL_DRAW;
+        plan.effectMask = MATCH_EFFECT_PS << (CALL_DRAW * MATCH_DELIMITER);
+    }
+    else
+    {
+        plan.effectInvocationLocation = group->getInvocationLocation();
+        plan.effectMask = (MATCH_EFFECT_PS << (plan.effectInvocationLocation * MATCH_DELIMITER)) | (MATCH_EFFECT_PS << (CALL_DRAW * MATCH_DELIMITER));
+    }
+
+    plan.techniques.clear();
+
+    if (group->getAllowAllTechniques())
+    {
+        const auto& preferred = group->GetPreferredTechniqueData();
+
+        for (const auto& techData : runtimeData.allEnabledTechniques)
+        {
+            if (group->getHasTechniqueExceptions() && preferred.contains(techData))
+            {
+                continue;
+            }
+
+            plan.techniques.push_back(techData);
+        }
+    }
+    else if (group->preferredTechniques().size() > 0)
+    {
+        const auto& preferred = group->GetPreferredTechniqueData();
+        plan.techniques.assign(preferred.begin(), preferred.end());
+    }
+
+    return plan;
+}
+
 void RenderingQueueManager::_CheckCallForCommandList(ShaderData& sData, CommandListDataContainer& commandListData, DeviceDataContainer& deviceData, RuntimeDataContainer& runtimeData) const
 {
     // Masks which checks to perform. Note that we will always schedule a draw call check for binding and effect updates,
@@ -21,112 +84,65 @@ void RenderingQueueManager::_CheckCallForCommandList(ShaderData& sData, CommandL
     uint64_t queue_mask = MATCH_NONE;
 
     // Shift in case of VS using data id
-    const uint64_t match_effect = MATCH_EFFECT_PS << sData.id;
-    const uint64_t match_binding = MATCH_BINDING_PS << sData.id;
     const uint64_t match_const = MATCH_CONST_PS << sData.id;
     const uint64_t match_preview = MATCH_PREVIEW_PS << sData.id;
 
-    if (sData.blockedShaderGroups != nullptr)
-    {
-        for (auto group : *sData.blockedShaderGroups)
+    // Only groups matched by the bound shader which are also toggled on are of interest
+    const GroupMask matchedGroups = sData.blockedShaderGroups & uiData.GetActiveToggleGroups();
+
+    matchedGroups.forEach([&](uint32_t slot) {
+        ToggleGroup* group = uiData.GetToggleGroupBySlot(slot);
+        if (group == nullptr)
         {
-            if (group->isActive())
+            return;
+        }
+
+        const GroupSchedulePlan& plan = _GetSchedulePlan(group, runtimeData);
+
+        if (plan.extractConstants && !deviceData.constantsUpdated.test(slot))
+        {
+            if (!sData.constantBuffersToUpdate.contains(group))
             {
-                if (group->getExtractConstants() && !deviceData.constantsUpdated.contains(group))
-                {
-                    if (!sData.constantBuffersToUpdate.contains(group))
-                    {
-                        sData.constantBuffersToUpdate.emplace(group);
-                        queue_mask |= match_const;
-                    }
-                }
+                sData.constantBuffersToUpdate.emplace(group);
+                queue_mask |= match_const;
+            }
+        }
 
-                if (group->getId() == uiData.GetToggleGroupIdShaderEditing() && !deviceData.huntPreview.matched)
+        if (group->getId() == uiData.GetToggleGroupIdShaderEditing() && !deviceData.huntPreview.matched)
+        {
+            if (uiData.GetCurrentTabType() == AddonImGui::TAB_RENDER_TARGET)
+            {
+                if (group->getRenderToResourceViews())
                 {
-                    if (uiData.GetCurrentTabType() == AddonImGui::TAB_RENDER_TARGET)
-                    {
-                        if (group->getRenderToResourceViews())
-                        {
-                            queue_mask |= match_preview << (CALL_DRAW * MATCH_DELIMITER);
-                            deviceData.huntPreview.target_invocation_location = CALL_DRAW;
-                        }
-                        else
-                        {
-                            queue_mask |= (match_preview << (group->getInvocationLocation() * MATCH_DELIMITER)) | (match_preview << (CALL_DRAW * MATCH_DELIMITER));
-                            deviceData.huntPreview.target_invocation_location = group->getInvocationLocation();
-                        }
-                    }
+                    queue_mask |= match_preview << (CALL_DRAW * MATCH_DELIMITER);
+                    deviceData.huntPreview.target_invocation_location = CALL_DRAW;
                 }
-
-                if (group->isProvidingTextureBinding() && !deviceData.bindingsUpdated.contains(group))
+                else
                 {
-                    if (!sData.bindingsToUpdate.contains(group))
-                    {
-                        if (!group->getCopyTextureBinding() || group->getExtractResourceViews())
-                        {
-                            sData.bindingsToUpdate.emplace(group, ResourceRenderData{ group, CALL_DRAW, resource{ 0 }, format::unknown });
-                            queue_mask |= (match_binding << CALL_DRAW * MATCH_DELIMITER);
-                        }
-                        else
-                        {
-                            sData.bindingsToUpdate.emplace(group, ResourceRenderData{ group, group->getBindingInvocationLocation(), resource{ 0 }, format::unknown });
-                            queue_mask |= (match_binding << (group->getBindingInvocationLocation() * MATCH_DELIMITER)) | (match_binding << (CALL_DRAW * MATCH_DELIMITER));
-                        }
-                    }
+                    queue_mask |= (match_preview << (group->getInvocationLocation() * MATCH_DELIMITER)) | (match_preview << (CALL_DRAW * MATCH_DELIMITER));
+                    deviceData.huntPreview.target_invocation_location = group->getInvocationLocation();
                 }
+            }
+        }
 
-                if (group->getAllowAllTechniques())
-                {
-                    auto& preferred = group->GetPreferredTechniqueData();
-
-                    for (const auto& techData : runtimeData.allEnabledTechniques)
-                    {
-                        if (group->getHasTechniqueExceptions() && preferred.contains(techData))
-                        {
-                            continue;
-                        }
-
-                        if (!techData->rendered)
-                        {
-                            if (!sData.techniquesToRender.contains(techData))
-                            {
-                                if (group->getRenderToResourceViews())
-                                {
-                                    sData.techniquesToRender.emplace(techData, ResourceRenderData{ group, CALL_DRAW, resource{ 0 }, format::unknown });
-                                    queue_mask |= (match_effect << CALL_DRAW * MATCH_DELIMITER);
-                                }
-                                else
-                                {
-                                    sData.techniquesToRender.emplace(techData, ResourceRenderData{ group, group->getInvocationLocation(), resource{ 0 }, format::unknown });
-                                    queue_mask |= (match_effect << (group->getInvocationLocation() * MATCH_DELIMITER)) | (match_effect << (CALL_DRAW * MATCH_DELIMITER));
-                                }
-                            }
-                        }
-                    }
-                }
-                else if (group->preferredTechniques().size() > 0) {
-                    auto& preferred = group->GetPreferredTechniqueData();
-
-                    for (auto& eff : preferred)
-                    {
-                        if (!eff->rendered && !sData.techniquesToRender.contains(eff))
-                        {
-                            if (group->getRenderToResourceViews())
-                            {
-                                sData.techniquesToRender.emplace(eff, ResourceRenderData{ group, CALL_DRAW, resource{ 0 }, format::unknown });
-                                queue_mask |= (match_effect << CALL_DRAW * MATCH_DELIMITER);
-                            }
-                            else
-                            {
-                                sData.techniquesToRender.emplace(eff, ResourceRenderData{ group, group->getInvocationLocation(), resource{ 0 }, format::unknown });
-                                queue_mask |= (match_effect << (group->getInvocationLocation() * MATCH_DELIMITER)) | (match_effect << (CALL_DRAW * MATCH_DELIMITER));
-                            }
-                        }
-                    }
-                }
+        if (plan.providesBinding && !deviceData.bindingsUpdated.test(slot))
+        {
+            if (!sData.bindingsToUpdate.contains(group))
+            {
+                sData.bindingsToUpdate.emplace(group, ResourceRenderData{ group, plan.bindingInvocationLocation, resource{ 0 }, format::unknown });
+                queue_mask |= plan.bindingMask << sData.id;
             }
         }
-    }
+
+        for (EffectData* techData : plan.techniques)
+        {
+            if (!techData->rendered && !sData.techniquesToRender.contains(techData))
+            {
+                sData.techniquesToRender.emplace(techData, ResourceRenderData{ group, plan.effectInvocationLocation, resource{ 0 }, format::unknown });
+                queue_mask |= plan.effectMask << sData.id;
+            }
+        }
+        });
 
     commandListData.commandQueue |= queue_mask;
 }
@@ -138,8 +154,8 @@ void RenderingQueueManager::CheckCallForCommandList(reshade::api::command_list*
         return;
     }
 
-    CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
-    DeviceDataContainer& deviceData = commandList->get_device()->get_private_data<DeviceDataContainer>();
+    CommandListDataContainer& commandListData = PrivateDataCache::Get<CommandListDataContainer>(commandList);
+    DeviceDataContainer& deviceData = PrivateDataCache::Get<DeviceDataContainer>(commandList->get_device());
     RuntimeDataContainer& runtimeData = deviceData.current_runtime->get_private_data<RuntimeDataContainer>();
 
     shared_lock<shared_mutex> t_mutex(runtimeData.technique_mutex);
@@ -165,8 +181,8 @@ void RenderingQueueManager::_RescheduleGroups(ShaderData& sData, CommandListData
 
     for (const auto& tech : sData.techniquesToRender)
     {
-        const ToggleGroup* group = tech.second.group;
-        const resource res = tech.second.resource;
+        const ToggleGroup* group = tech.data.group;
+        const resource res = tech.data.resource;
 
         if (res == 0 && group->getRequeueAfterRTMatchingFailure())
         {
@@ -186,9 +202,9 @@ void RenderingQueueManager::_RescheduleGroups(ShaderData& sData, CommandListData
 
     for (const auto& tech : sData.bindingsToUpdate)
     {
-        const ToggleGroup* group = tech.first;
+        const ToggleGroup* group = tech.key;
 
-        if (tech.second.resource == 0 && group->getRequeueAfterRTMatchingFailure())
+        if (tech.data.resource == 0 && group->getRequeueAfterRTMatchingFailure())
         {
             queue_mask |= (match_binding << (group->getInvocationLocation() * MATCH_DELIMITER)) | (match_binding << (CALL_DRAW * MATCH_DELIMITER));
 
@@ -226,37 +242,12 @@ void RenderingQueueManager::RescheduleGroups(CommandListDataContainer& commandLi
 }
 
 
-static void clearStage(CommandListDataContainer& commandListData, effect_queue& queuedTasks, uint64_t pipelineChange, uint64_t clearFlag, uint64_t location)
-{
-    if (queuedTasks.size() > 0 && (pipelineChange & clearFlag))
-    {
-        for (auto it = queuedTasks.begin(); it != queuedTasks.end();)
-        {
-            uint64_t callLocation = it->second.invocationLocation;
-            if (callLocation == location)
-            {
-                it = queuedTasks.erase(it);
-                continue;
-            }
-            it++;
-        }
-    }
-}
-
-static void clearStage(CommandListDataContainer& commandListData, binding_queue& queuedTasks, uint64_t pipelineChange, uint64_t clearFlag, uint64_t location)
+template<typename Q>
+static void clearStage(CommandListDataContainer& commandListData, Q& queuedTasks, uint64_t pipelineChange, uint64_t clearFlag, uint64_t location)
 {
     if (queuedTasks.size() > 0 && (pipelineChange & clearFlag))
     {
-        for (auto it = queuedTasks.begin(); it != queuedTasks.end();)
-        {
-            uint64_t callLocation = it->second.invocationLocation;
-            if (callLocation == location)
-            {
-                it = queuedTasks.erase(it);
-                continue;
-            }
-            it++;
-        }
+        queuedTasks.erase_if([location](const auto& task) { return task.data.invocationLocation == location; });
     }
 }
 
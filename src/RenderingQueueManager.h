@@ -20,5 +20,6 @@ namespace Rendering
 
         void _RescheduleGroups(ShaderData& sData, CommandListDataContainer& commandListData, DeviceDataContainer& deviceData);
         void _CheckCallForCommandList(ShaderData& sData, CommandListDataContainer& commandListData, DeviceDataContainer& deviceData, RuntimeDataContainer& runtimeData) const;
+        const GroupSchedulePlan& _GetSchedulePlan(ShaderToggler::ToggleGroup* group, RuntimeDataContainer& runtimeData) const;
     };
 }
\ No newline at end of file
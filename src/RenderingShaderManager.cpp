@@ -181,7 +181,10 @@ void RenderingShaderManager::ApplyShader(command_list* cmd_list, resource_view s
         return;
     }
 
-    cmd_list->get_private_data<state_tracking>().capture(cmd_list, true);
+    state_tracking& state = cmd_list->get_private_data<state_tracking>();
+    state.capture(cmd_list, true);
+    // Binding a pipeline also resets topology, blend and stencil state on d3d10/11. Compute state is left alone
+    state.mark_dirty(StateTracking::state_category::all, pipeline_stage::all_graphics, shader_stage::all_graphics);
 
     cmd_list->bind_render_targets_and_depth_stencil(1, &rtv_dst);
 
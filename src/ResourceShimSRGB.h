@@ -5,6 +5,7 @@
 #include <reshade_api_pipeline.hpp>
 #include <unordered_map>
 #include <shared_mutex>
+#include <mutex>
 
 #include "ResourceShim.h"
 
@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <bit>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace ShaderToggler
+{
+    /// <summary>
+    /// Blocked bloom filter over shader hashes. Every hash maps to a single cache line in which it sets a few bits, so a negative lookup,
+    /// which is by far the most common outcome as almost no shader belongs to a toggle group, costs one memory access.
+    /// </summary>
+    class ShaderHashFilter
+    {
+    public:
+        ShaderHashFilter(size_t expectedHashes)
+        {
+            // ~16 bits per hash keeps false positives well below one percent
+            size_t blockCount = 1;
+            while (blockCount * BITS_PER_BLOCK < expectedHashes * 16)
+            {
+                blockCount *= 2;
+            }
+
+            _blockShift = 64 - std::countr_zero(blockCount);
+            _blocks.resize(blockCount);
+        }
+
+        void add(uint32_t hash)
+        {
+            Block& block = _blocks[blockIndex(hash)];
+            uint64_t bits = bitPositions(hash);
+            for (uint32_t i = 0; i < BITS_PER_HASH; i++, bits >>= 9)
+            {
+                block.words[(bits >> 6) & 7] |= 1ull << (bits & 63);
+            }
+        }
+
+        bool mayContain(uint32_t hash) const
+        {
+            const Block& block = _blocks[blockIndex(hash)];
+            uint64_t bits = bitPositions(hash);
+            for (uint32_t i = 0; i < BITS_PER_HASH; i++, bits >>= 9)
+            {
+                if (!(block.words[(bits >> 6) & 7] & (1ull << (bits & 63))))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        static constexpr uint32_t BITS_PER_BLOCK = 512;
+        static constexpr uint32_t BITS_PER_HASH = 4;
+
+        struct alignas(64) Block
+        {
+            uint64_t words[BITS_PER_BLOCK / 64] = { };
+        };
+
+        size_t blockIndex(uint32_t hash) const
+        {
+            // shifting a 64 bit value by 64 is undefined, a single block always has index 0
+            return _blockShift >= 64 ? 0 : static_cast<size_t>((hash * 0x9E3779B97F4A7C15ull) >> _blockShift);
+        }
+
+        static uint64_t bitPositions(uint32_t hash)
+        {
+            // 4 bit positions of 9 bits each (word index + bit index within the block)
+            return (hash * 0xC2B2AE3D27D4EB4Full) >> 28;
+        }
+
+        std::vector<Block> _blocks;
+        uint32_t _blockShift = 64;
+    };
+}
@@ -47,7 +47,7 @@ namespace ShaderToggler
         if (pipelineHandle > 0 && shaderHash > 0)
         {
             unique_lock lock(_hashHandlesMutex);
-            _handleToShaderHash[pipelineHandle] = shaderHash;
+            _handleToShaderHash.insert_or_assign(pipelineHandle, shaderHash);
             _shaderHashes.emplace(shaderHash);
         }
     }
@@ -56,11 +56,9 @@ namespace ShaderToggler
     void ShaderManager::removeHandle(uint64_t handle)
     {
         unique_lock ulock(_hashHandlesMutex);
-        if (_handleToShaderHash.contains(handle))
+        uint32_t shaderHash = 0;
+        if (_handleToShaderHash.erase(handle, &shaderHash))
         {
-            const auto& it = _handleToShaderHash.find(handle);
-            const auto& shaderHash = it->second;
-            _handleToShaderHash.erase(handle);
             _collectedActiveShaderHashes.erase(shaderHash);
             _shaderHashes.erase(shaderHash);
         }
@@ -217,9 +215,8 @@ namespace ShaderToggler
             {
                 if (it == _collectedActiveShaderHashes.begin())
                 {
-                    it = _collectedActiveShaderHashes.end();
-                    --it;
                     index = static_cast<int32_t>(_collectedActiveShaderHashes.size()) - 1;
+                    it = std::next(_collectedActiveShaderHashes.begin(), index);
                 }
                 hash = *it;
                 if (_markedShaderHashes.contains(hash))
@@ -228,8 +225,9 @@ namespace ShaderToggler
                     foundHash = true;
                     break;
                 }
-                --it;
+                // unordered_set iterators are forward only
                 index--;
+                it = std::next(_collectedActiveShaderHashes.begin(), index);
             }
             if (foundHash)
             {
@@ -328,10 +326,6 @@ namespace ShaderToggler
 
     uint32_t ShaderManager::getShaderHash(uint64_t handle)
     {
-        if (!_handleToShaderHash.contains(handle))
-        {
-            return 0;
-        }
-        return _handleToShaderHash.at(handle);
+        return safeGetShaderHash(handle);
     }
 }
@@ -37,7 +37,7 @@
 #include <reshade_api_pipeline.hpp>
 #include <shared_mutex>
 #include <unordered_set>
-#include <tsl/robin_map.h>
+#include "ConcurrentHandleMap.h"
 #include "CDataFile.h"
 #include "ToggleGroup.h"
 
@@ -140,16 +140,13 @@ namespace ShaderToggler
 
         bool isKnownHandle(uint64_t pipelineHandle)
         {
-            std::shared_lock lock(_hashHandlesMutex);
             return _handleToShaderHash.contains(pipelineHandle);
         }
 
         inline uint32_t safeGetShaderHash(uint64_t pipelineHandle)
         {
-            std::shared_lock lock(_hashHandlesMutex);
-            const auto& it = _handleToShaderHash.find(pipelineHandle);
-
-            return it == _handleToShaderHash.end() ? 0 : it->second;
+            uint32_t shaderHash = 0;
+            return _handleToShaderHash.find(pipelineHandle, shaderHash) ? shaderHash : 0;
         }
 
     private:
@@ -157,7 +154,7 @@ namespace ShaderToggler
 
         std::unordered_set<uint32_t> _shaderHashes;				// all shader hashes added through init pipeline
         //std::unordered_map<uint64_t, uint32_t> _handleToShaderHash;		// pipeline handle per shader hash. Handle is removed when a pipeline is destroyed.
-        tsl::robin_map<uint64_t, uint32_t> _handleToShaderHash;
+        ConcurrentHandleMap<uint32_t> _handleToShaderHash;			// lock-free for readers, _hashHandlesMutex only serializes writers with _shaderHashes
         std::unordered_set<uint32_t> _collectedActiveShaderHashes;	// shader hashes bound to pipeline handles which were collected during the collection phase after hunting was enabled, which are the pipeline handles active during the last X frames
         std::unordered_set<uint32_t> _markedShaderHashes;		// the hashes for shaders which are currently marked.
 
@@ -4,13 +4,55 @@
  */
 
 #include <limits>
+#include <format>
+#include <bit>
 #include "reshade.hpp"
 #include "StateTracking.h"
+#include "PrivateDataCache.h"
 
 using namespace reshade::api;
 using namespace StateTracking;
+using ShaderToggler::PrivateDataCache;
 
 bool state_tracking::track_descriptors = true;
+// Resources with barrier tracking across all command lists, lets on_barrier return before looking up the command list state
+static std::atomic<uint32_t> s_barrier_tracked_resources = 0;
+std::atomic<uint32_t> state_tracking::tracked_slots[ALL_SHADER_STAGES_SIZE] = { TRACK_ALL_SLOTS, TRACK_ALL_SLOTS, TRACK_ALL_SLOTS, TRACK_ALL_SLOTS, TRACK_ALL_SLOTS, TRACK_ALL_SLOTS };
+
+void* state_arena::allocate_bytes(size_t size, size_t alignment)
+{
+    for (; current_block < blocks.size(); current_block++, block_offset = 0)
+    {
+        auto& [block, block_size] = blocks[current_block];
+        const size_t aligned_offset = (block_offset + alignment - 1) & ~(alignment - 1);
+
+        if (aligned_offset + size <= block_size)
+        {
+            block_offset = aligned_offset + size;
+            used_bytes += size;
+            high_water_mark_bytes = std::max(high_water_mark_bytes, used_bytes);
+
+            return block.get() + aligned_offset;
+        }
+    }
+
+    // Only reached until the arena has grown to its working size
+    const size_t block_size = std::max(BLOCK_SIZE, size);
+    blocks.emplace_back(std::make_unique<uint8_t[]>(block_size), block_size);
+    current_block = blocks.size() - 1;
+    block_offset = size;
+    used_bytes += size;
+    high_water_mark_bytes = std::max(high_water_mark_bytes, used_bytes);
+
+    return blocks.back().first.get();
+}
+
+void state_arena::rewind()
+{
+    current_block = 0;
+    block_offset = 0;
+    used_bytes = 0;
+}
 
 void state_block::apply_descriptors_dx12_vulkan(command_list* cmd_list) const
 {
@@ -21,7 +63,7 @@ void state_block::apply_descriptors_dx12_vulkan(command_list* cmd_list) const
         const auto& [pipelinelayout, root_table] = root_tables[stageIdx];
         shader_stage stages = root_table_stages[stageIdx];
 
-        if ((static_cast<uint32_t>(stages) | shader_stages_set) <= shader_stages_set)
+        if (!is_stage_current(stageIdx) || (static_cast<uint32_t>(stages) | shader_stages_set) <= shader_stages_set || (static_cast<uint32_t>(stages) & dirty_shader_stages) == 0)
         {
             continue;
         }
@@ -47,9 +89,10 @@ void state_block::apply_descriptors_dx12_vulkan(command_list* cmd_list) const
                 cmd_list->bind_descriptor_tables(stages, pipelinelayout, i, 1, &root_table[i].descriptor_table);
             }
 
-            if (root_table[i].type == root_entry_type::push_constants && root_table[i].buffer_index >= 0 && constant_buffer[root_table[i].buffer_index].size() > 0)
+            if (root_table[i].type == root_entry_type::push_constants && root_table[i].buffer_index >= 0 && constant_buffer[stageIdx][root_table[i].buffer_index].size > 0)
             {
-                cmd_list->push_constants(stages, pipelinelayout, i, 0, static_cast<uint32_t>(constant_buffer[root_table[i].buffer_index].size()), constant_buffer[root_table[i].buffer_index].data());
+                const arena_span<uint32_t>& constants = constant_buffer[stageIdx][root_table[i].buffer_index];
+                cmd_list->push_constants(stages, pipelinelayout, i, 0, constants.size, constants.data);
             }
         }
     }
@@ -57,12 +100,17 @@ void state_block::apply_descriptors_dx12_vulkan(command_list* cmd_list) const
 
 void state_block::apply_descriptors(command_list* cmd_list) const
 {
-    auto& [desc_layout, descriptors] = cmd_list->get_private_data<state_tracking>().root_tables[0];
+    if (!is_stage_current(0))
+    {
+        return;
+    }
+
+    auto& [desc_layout, descriptors] = root_tables[0];
     const size_t it = std::min(static_cast<size_t>(2), descriptors.size());
 
     for (uint32_t i = 0; i < it; i++)
     {
-        if (descriptors[i].type == root_entry_type::push_descriptors && descriptors[i].buffer_index >= 0 && descriptor_buffer[0][descriptors[i].buffer_index].size() > 0)
+        if (descriptors[i].type == root_entry_type::push_descriptors && descriptors[i].buffer_index >= 0 && descriptor_buffer[0][descriptors[i].buffer_index].size > 0)
         {
             const descriptor_tracking::descriptor_data* desc = &descriptor_buffer[0][descriptors[i].buffer_index][0];
 
@@ -101,6 +149,29 @@ void state_block::capture(command_list* cmd_list, bool force_restore)
     }
 }
 
+void state_block::mark_dirty(uint32_t categories, pipeline_stage pipeline_stages, shader_stage shader_stages)
+{
+    dirty_categories |= categories;
+
+    if (categories & state_category::pipelines)
+    {
+        dirty_pipeline_stages |= static_cast<uint32_t>(pipeline_stages);
+    }
+
+    if (categories & state_category::descriptors)
+    {
+        dirty_shader_stages |= static_cast<uint32_t>(shader_stages);
+    }
+}
+
+bool state_block::restores(uint32_t category)
+{
+    const bool dirty = (dirty_categories & category) != 0;
+    (dirty ? stats.restored : stats.skipped)[std::countr_zero(category)]++;
+
+    return dirty;
+}
+
 void state_block::apply(command_list* cmd_list, bool force_restore)
 {
     switch (cmd_list->get_device()->get_api())
@@ -111,6 +182,10 @@ void state_block::apply(command_list* cmd_list, bool force_restore)
     default:
         apply_default(cmd_list, force_restore);
     }
+
+    dirty_categories = 0;
+    dirty_pipeline_stages = 0;
+    dirty_shader_stages = 0;
 }
 
 void state_block::apply_dx9(reshade::api::command_list* cmd_list, bool force_restore)
@@ -121,9 +196,10 @@ void state_block::apply_dx9(reshade::api::command_list* cmd_list, bool force_res
     }
 
     // ???
-    if (!render_targets.empty() || depth_stencil != 0)
+    if (restores(state_category::render_targets) && (!render_targets.empty() || depth_stencil != 0))
         cmd_list->bind_render_targets_and_depth_stencil(static_cast<uint32_t>(render_targets.size()), render_targets.data(), depth_stencil);
 
+    // The captured d3d9 state block restores everything else at once
     if (dx_state != nullptr)
     {
         dx_state->Apply();
@@ -132,7 +208,7 @@ void state_block::apply_dx9(reshade::api::command_list* cmd_list, bool force_res
     }
 }
 
-void state_block::apply_default(reshade::api::command_list* cmd_list, bool force_restore) const
+void state_block::apply_default(reshade::api::command_list* cmd_list, bool force_restore)
 {
     // For dx12 and vulkan, always force full state restoration
     if (!force_restore && cmd_list->get_device()->get_api() != device_api::d3d12 && cmd_list->get_device()->get_api() != device_api::vulkan)
@@ -140,38 +216,50 @@ void state_block::apply_default(reshade::api::command_list* cmd_list, bool force
         return;
     }
 
-    if (!render_targets.empty() || depth_stencil != 0)
+    if (restores(state_category::render_targets) && (!render_targets.empty() || depth_stencil != 0))
         cmd_list->bind_render_targets_and_depth_stencil(static_cast<uint32_t>(render_targets.size()), render_targets.data(), depth_stencil);
 
-    uint32_t pipeline_stages_set = 0;
-    for (uint32_t s = 0; s < ALL_PIPELINE_STAGES_SIZE; s++)
+    if (restores(state_category::pipelines))
     {
-        if ((static_cast<uint32_t>(current_pipeline_stage[s]) | pipeline_stages_set) > pipeline_stages_set)
+        uint32_t pipeline_stages_set = 0;
+        for (uint32_t bound = bound_pipeline_stages; bound != 0; bound &= bound - 1)
         {
-            pipeline_stages_set |= static_cast<uint32_t>(current_pipeline_stage[s]);
-            cmd_list->bind_pipeline(current_pipeline_stage[s], current_pipeline[s]);
+            const uint32_t s = std::countr_zero(bound);
+            if ((static_cast<uint32_t>(current_pipeline_stage[s]) | pipeline_stages_set) > pipeline_stages_set && (static_cast<uint32_t>(current_pipeline_stage[s]) & dirty_pipeline_stages) != 0)
+            {
+                pipeline_stages_set |= static_cast<uint32_t>(current_pipeline_stage[s]);
+                cmd_list->bind_pipeline(current_pipeline_stage[s], current_pipeline[s]);
+            }
         }
     }
 
-    if (primitive_topology != primitive_topology::undefined)
-        cmd_list->bind_pipeline_state(dynamic_state::primitive_topology, static_cast<uint32_t>(primitive_topology));
-    if (blend_constant != 0)
-        cmd_list->bind_pipeline_state(dynamic_state::blend_constant, blend_constant);
-    if (sample_mask != 0xFFFFFFFF)
-        cmd_list->bind_pipeline_state(dynamic_state::sample_mask, sample_mask);
-    if (front_stencil_reference_value != 0)
-        cmd_list->bind_pipeline_state(dynamic_state::front_stencil_reference_value, front_stencil_reference_value);
-    if (cmd_list->get_device()->get_api() >= device_api::d3d12)
+    if (restores(state_category::pipeline_states))
     {
-        if (back_stencil_reference_value != 0)
-            cmd_list->bind_pipeline_state(dynamic_state::back_stencil_reference_value, back_stencil_reference_value);
+        if (primitive_topology != primitive_topology::undefined)
+            cmd_list->bind_pipeline_state(dynamic_state::primitive_topology, static_cast<uint32_t>(primitive_topology));
+        if (blend_constant != 0)
+            cmd_list->bind_pipeline_state(dynamic_state::blend_constant, blend_constant);
+        if (sample_mask != 0xFFFFFFFF)
+            cmd_list->bind_pipeline_state(dynamic_state::sample_mask, sample_mask);
+        if (front_stencil_reference_value != 0)
+            cmd_list->bind_pipeline_state(dynamic_state::front_stencil_reference_value, front_stencil_reference_value);
+        if (cmd_list->get_device()->get_api() >= device_api::d3d12)
+        {
+            if (back_stencil_reference_value != 0)
+                cmd_list->bind_pipeline_state(dynamic_state::back_stencil_reference_value, back_stencil_reference_value);
+        }
     }
 
-    if (!viewports.empty())
+    if (restores(state_category::viewports) && !viewports.empty())
         cmd_list->bind_viewports(0, static_cast<uint32_t>(viewports.size()), viewports.data());
-    if (!scissor_rects.empty())
+    if (restores(state_category::scissor_rects) && !scissor_rects.empty())
         cmd_list->bind_scissor_rects(0, static_cast<uint32_t>(scissor_rects.size()), scissor_rects.data());
 
+    if (!restores(state_category::descriptors))
+    {
+        return;
+    }
+
     if (cmd_list->get_device()->get_api() == device_api::d3d12 || cmd_list->get_device()->get_api() == device_api::vulkan)
     {
         apply_descriptors_dx12_vulkan(cmd_list);
@@ -193,13 +281,24 @@ void state_block::clear()
     sample_mask = 0xFFFFFFFF;
     viewports.clear();
     scissor_rects.clear();
-    root_tables.fill(make_pair(pipeline_layout{ 0 }, std::vector<root_entry>()));
-    root_table_stages.fill(static_cast<shader_stage>(0));
-    std::for_each(constant_buffer.begin(), constant_buffer.end(), [](std::vector<std::vector<uint32_t>>& v) { v.clear(); });
-    std::for_each(descriptor_buffer.begin(), descriptor_buffer.end(), [](std::vector<std::vector<descriptor_tracking::descriptor_data>>& v) { v.clear(); });
-    current_pipeline.fill(pipeline{ 0 });
-    current_pipeline_stage.fill(static_cast<pipeline_stage>(0));
+    bound_pipeline_stages = 0;
+    generation++;
+    s_barrier_tracked_resources.fetch_sub(resource_barrier_track.size(), std::memory_order_relaxed);
     resource_barrier_track.clear();
+    dirty_categories = 0;
+    dirty_pipeline_stages = 0;
+    dirty_shader_stages = 0;
+}
+
+void state_block::reset_stage(uint32_t stageIndex)
+{
+    root_tables[stageIndex].first = { 0 };
+    root_tables[stageIndex].second.clear();
+    root_table_stages[stageIndex] = static_cast<shader_stage>(0);
+    constant_buffer[stageIndex].clear();
+    descriptor_buffer[stageIndex].clear();
+    arenas[stageIndex].rewind();
+    layout_metadata_indices[stageIndex] = std::make_pair(pipeline_layout{ 0 }, descriptor_tracking::INVALID_LAYOUT_INDEX);
 }
 
 void state_block::clear_present(effect_runtime* runtime)
@@ -240,7 +339,9 @@ static inline int32_t get_pipeline_stage_index(pipeline_stage stages)
 
 static void on_init_command_list(command_list* cmd_list)
 {
-    cmd_list->create_private_data<state_tracking>();
+    auto& state = cmd_list->create_private_data<state_tracking>();
+    state.parent_device = cmd_list->get_device();
+    state.restores_root_constants = state.parent_device->get_api() == device_api::d3d12 || state.parent_device->get_api() == device_api::vulkan;
 
     auto& deviceState = cmd_list->get_device()->get_private_data<DeviceStateTracking>();
     std::unique_lock<std::shared_mutex> lock(deviceState.cmd_list_mutex);
@@ -248,6 +349,34 @@ static void on_init_command_list(command_list* cmd_list)
 }
 static void on_destroy_command_list(command_list* cmd_list)
 {
+    auto& state = cmd_list->get_private_data<state_tracking>();
+
+    size_t high_water_mark = 0;
+    for (const auto& arena : state.arenas)
+    {
+        high_water_mark += arena.high_water_mark();
+    }
+
+    if (high_water_mark > 0)
+    {
+        reshade::log::message(reshade::log::level::info, std::format("State tracking arena high-water mark for command list {:#x}: {} bytes", reinterpret_cast<uintptr_t>(cmd_list), high_water_mark).c_str());
+    }
+
+    const restore_stats& stats = state.get_restore_stats();
+    if (stats.restored[0] + stats.skipped[0] > 0)
+    {
+        // Restored out of total applies, per category
+        reshade::log::message(reshade::log::level::info, std::format("State restores for command list {:#x}: render targets {}/{}, pipelines {}/{}, pipeline states {}/{}, viewports {}/{}, scissor rects {}/{}, descriptors {}/{}",
+            reinterpret_cast<uintptr_t>(cmd_list),
+            stats.restored[0], stats.restored[0] + stats.skipped[0],
+            stats.restored[1], stats.restored[1] + stats.skipped[1],
+            stats.restored[2], stats.restored[2] + stats.skipped[2],
+            stats.restored[3], stats.restored[3] + stats.skipped[3],
+            stats.restored[4], stats.restored[4] + stats.skipped[4],
+            stats.restored[5], stats.restored[5] + stats.skipped[5]).c_str());
+    }
+
+    PrivateDataCache::Invalidate();
     cmd_list->destroy_private_data<state_tracking>();
 
     auto& deviceState = cmd_list->get_device()->get_private_data<DeviceStateTracking>();
@@ -257,19 +386,22 @@ static void on_destroy_command_list(command_list* cmd_list)
 
 static void on_bind_render_targets_and_depth_stencil(command_list* cmd_list, uint32_t count, const resource_view* rtvs, resource_view dsv)
 {
-    auto& state = cmd_list->get_private_data<state_tracking>();
+    auto& state = PrivateDataCache::Get<state_tracking>(cmd_list);
     state.render_targets.assign(rtvs, rtvs + count);
     state.depth_stencil = dsv;
 }
 
 static void on_bind_pipeline(command_list* cmd_list, pipeline_stage stages, pipeline pipeline)
 {
-    auto& state = cmd_list->get_private_data<state_tracking>();
+    auto& state = PrivateDataCache::Get<state_tracking>(cmd_list);
 
-    uint32_t idx = get_pipeline_stage_index(stages);
+    const int32_t idx = get_pipeline_stage_index(stages);
+    if (idx < 0)
+        return;
 
     state.current_pipeline[idx] = pipeline;
     state.current_pipeline_stage[idx] = stages;
+    state.bound_pipeline_stages |= 1u << idx;
 }
 
 static void on_destroy_pipeline(device* device, pipeline pipeline)
@@ -281,12 +413,12 @@ static void on_destroy_pipeline(device* device, pipeline pipeline)
     {
         auto& state = cmd_list->get_private_data<state_tracking>();
         
-        for (uint32_t s = 0; s < ALL_PIPELINE_STAGES_SIZE; s++)
+        for (uint32_t bound = state.bound_pipeline_stages; bound != 0; bound &= bound - 1)
         {
+            const uint32_t s = std::countr_zero(bound);
             if (state.current_pipeline[s] == pipeline)
             {
-                state.current_pipeline[s] = {};
-                state.current_pipeline_stage[s] = static_cast<pipeline_stage>(0);
+                state.bound_pipeline_stages &= ~(1u << s);
             }
         }
     }
@@ -313,7 +445,7 @@ static void on_destroy_pipeline(device* device, pipeline pipeline)
 
 static void on_bind_pipeline_states(command_list* cmd_list, uint32_t count, const dynamic_state* states, const uint32_t* values)
 {
-    auto& state = cmd_list->get_private_data<state_tracking>();
+    auto& state = PrivateDataCache::Get<state_tracking>(cmd_list);
 
     for (uint32_t i = 0; i < count; ++i)
     {
@@ -340,23 +472,23 @@ static void on_bind_pipeline_states(command_list* cmd_list, uint32_t count, cons
 
 static void on_bind_viewports(command_list* cmd_list, uint32_t first, uint32_t count, const viewport* viewports)
 {
-    auto& state = cmd_list->get_private_data<state_tracking>();
+    auto& state = PrivateDataCache::Get<state_tracking>(cmd_list);
 
     if (state.viewports.size() < (first + count))
         state.viewports.resize(first + count);
 
-    for (uint32_t i = 0; i < count; ++i)
+    for (uint32_t i = 0; i < count && i + first < state.viewports.size(); ++i)
         state.viewports[i + first] = viewports[i];
 }
 
 static void on_bind_scissor_rects(command_list* cmd_list, uint32_t first, uint32_t count, const rect* rects)
 {
-    auto& state = cmd_list->get_private_data<state_tracking>();
+    auto& state = PrivateDataCache::Get<state_tracking>(cmd_list);
 
     if (state.scissor_rects.size() < (first + count))
         state.scissor_rects.resize(first + count);
 
-    for (uint32_t i = 0; i < count; ++i)
+    for (uint32_t i = 0; i < count && i + first < state.scissor_rects.size(); ++i)
         state.scissor_rects[i + first] = rects[i];
 }
 
@@ -367,18 +499,15 @@ static void on_bind_descriptor_tables(command_list* cmd_list, shader_stage stage
     if (idx < 0)
         return;
 
-    auto& state_tracker = cmd_list->get_private_data<state_tracking>();
-    const auto& descriptor_state = cmd_list->get_device()->get_private_data<descriptor_tracking>();
+    auto& state_tracker = PrivateDataCache::Get<state_tracking>(cmd_list);
+    state_tracker.validate_stage(idx);
+
     auto& [desc_layout, root_table] = state_tracker.root_tables[idx];
     auto& state_stages = state_tracker.root_table_stages[idx];
-    auto& descriptor_buffer = state_tracker.descriptor_buffer[idx];
-    auto& constant_buffer = state_tracker.constant_buffer[idx];
 
     if (desc_layout != layout)
     {
-        root_table.clear(); // Layout changed, which resets all descriptor set bindings
-        descriptor_buffer.clear();
-        constant_buffer.clear();
+        state_tracker.reset_stage(idx); // Layout changed, which resets all descriptor set bindings
     }
 
     desc_layout = layout;
@@ -387,75 +516,37 @@ static void on_bind_descriptor_tables(command_list* cmd_list, shader_stage stage
     if (root_table.size() < (first + count))
         root_table.resize(first + count);
 
-    for (uint32_t i = 0; i < count; ++i)
+    // Descriptors are only copied out of the heap when they're first asked for, see resolve_descriptor_table. The snapshot of a
+    // previously bound table is kept so its memory can be reused.
+    for (uint32_t i = 0; i < count && i + first < root_table.size(); ++i)
     {
-        const pipeline_layout_param param = descriptor_state.get_pipeline_layout_param(layout, first + i);
-        if (param.type != pipeline_layout_param_type::descriptor_table)
-            continue;
-    
-        uint32_t max_descriptor_size = 0;
-        for (uint32_t k = 0; k < param.descriptor_table.count; ++k)
-        {
-            const descriptor_range& range = param.descriptor_table.ranges[k];
-            if (range.count != UINT32_MAX && range.type != descriptor_type::sampler)
-                max_descriptor_size = std::max(max_descriptor_size, range.binding + range.count);
-        }
+        root_entry& entry = root_table[i + first];
+        const int32_t buffer_index = entry.type == root_entry_type::descriptor_table ? entry.buffer_index : -1;
 
-        std::vector<descriptor_tracking::descriptor_data> descriptors(max_descriptor_size);
-    
-        for (uint32_t k = 0; k < param.descriptor_table.count; ++k)
-        {
-            const descriptor_range& range = param.descriptor_table.ranges[k];
-    
-            if (range.count == UINT32_MAX || range.type == descriptor_type::sampler)
-                continue; // Skip unbounded ranges
-    
-            uint32_t base_offset = 0;
-            descriptor_heap heap = { 0 };
-            cmd_list->get_device()->get_descriptor_heap_offset(tables[i], range.binding, 0, &heap, &base_offset);
-    
-            descriptor_state.set_all_descriptors(heap, base_offset, range.count, descriptors, range.binding);
-        }
-
-        descriptor_buffer.push_back(std::move(descriptors));
-
-        root_table[i + first] = { root_entry_type::descriptor_table, static_cast<int32_t>(descriptor_buffer.size()) - 1, tables[i]};
+        entry = { root_entry_type::descriptor_table, buffer_index, tables[i] };
+        entry.resolved = false;
     }
 }
 
-static void on_bind_descriptor_tables_no_track(command_list* cmd_list, shader_stage stages, pipeline_layout layout, uint32_t first, uint32_t count, const descriptor_table* tables)
+static inline bool is_slot_tracked(int32_t idx, uint32_t layout_param)
 {
-    int32_t idx = get_shader_stage_index(stages);
+    // The first two pixel shader slots are restored after rendering effects on the d3d9-11 and opengl path, see state_block::apply_descriptors
+    return layout_param < state_tracking::get_tracked_slots(idx) || (idx == 0 && layout_param < 2);
+}
 
-    if (idx < 0)
+// Keeps the slot in the root table so its size still matches the game's bindings, but empties it so it can't go stale while untracked
+static inline void drop_slot_content(state_tracking& state, int32_t idx, const root_entry& entry)
+{
+    if (entry.buffer_index < 0)
         return;
 
-    auto& state_tracker = cmd_list->get_private_data<state_tracking>();
-    auto& [desc_layout, root_table] = state_tracker.root_tables[idx];
-    auto& state_stages = state_tracker.root_table_stages[idx];
-    auto& constant_buffer = state_tracker.constant_buffer[idx];
-    auto& descriptor_buffer = state_tracker.descriptor_buffer[idx];
-
-    if (desc_layout != layout)
-    {
-        root_table.clear(); // Layout changed, which resets all descriptor set bindings
-        constant_buffer.clear();
-        descriptor_buffer.clear();
-    }
-
-    desc_layout = layout;
-    state_stages = stages;
-
-    if (root_table.size() < (first + count))
-        root_table.resize(first + count);
-
-    for (uint32_t i = 0; i < count; ++i)
-    {
-        root_table[i + first] = tables[i];
-    }
+    if (entry.type == root_entry_type::push_descriptors)
+        state.descriptor_buffer[idx][entry.buffer_index].size = 0;
+    else if (entry.type == root_entry_type::push_constants)
+        state.constant_buffer[idx][entry.buffer_index].size = 0;
 }
 
-static inline void fill_descriptors(std::vector<descriptor_tracking::descriptor_data>& table, const descriptor_table_update& update)
+static inline void fill_descriptors(arena_span<descriptor_tracking::descriptor_data>& table, const descriptor_table_update& update)
 {
     for (uint32_t i = 0; i < update.count; i++)
     {
@@ -491,10 +582,16 @@ static void on_push_descriptors(command_list* cmd_list, shader_stage stages, pip
     if (idx < 0)
         return;
 
-    auto& state_tracker = cmd_list->get_private_data<state_tracking>();
+    if (layout_param >= MAX_ROOT_PARAMETERS)
+        return;
+
+    auto& state_tracker = PrivateDataCache::Get<state_tracking>(cmd_list);
+    state_tracker.validate_stage(idx);
+
     auto& [desc_layout, root_table] = state_tracker.root_tables[idx];
     auto& state_stages = state_tracker.root_table_stages[idx];
     auto& descriptor_buffer = state_tracker.descriptor_buffer[idx];
+    auto& arena = state_tracker.arenas[idx];
     
     desc_layout = layout;
     state_stages = stages;
@@ -506,24 +603,26 @@ static void on_push_descriptors(command_list* cmd_list, shader_stage stages, pip
 
     auto& root_table_entry = root_table[layout_param];
 
+    if (!is_slot_tracked(idx, layout_param))
+    {
+        drop_slot_content(state_tracker, idx, root_table_entry);
+        return;
+    }
+
     // Initialize table for descriptors
-    if (root_table_entry.type == root_entry_type::undefined)
+    if (root_table_entry.type != root_entry_type::push_descriptors || root_table_entry.buffer_index < 0)
     {
-        std::vector<descriptor_tracking::descriptor_data> buf(update.binding + update.count);
+        descriptor_buffer.push_back(arena.allocate<descriptor_tracking::descriptor_data>(update.binding + update.count));
 
-        fill_descriptors(buf, update);
+        fill_descriptors(descriptor_buffer.back(), update);
 
-        descriptor_buffer.push_back(std::move(buf));
         root_table_entry = { root_entry_type::push_descriptors, static_cast<int32_t>(descriptor_buffer.size()) - 1, {} };
     }
     else
     {
         auto& buf = descriptor_buffer[root_table_entry.buffer_index];
 
-        if (buf.size() < update.binding + update.count)
-        {
-            buf.resize(update.binding + update.count);
-        }
+        arena.grow(buf, update.binding + update.count);
 
         fill_descriptors(buf, update);
     }
@@ -536,10 +635,16 @@ static void on_push_constants(command_list* cmd_list, shader_stage stages, pipel
     if (idx < 0)
         return;
 
-    auto& state_tracker = cmd_list->get_private_data<state_tracking>();
+    if (layout_param >= MAX_ROOT_PARAMETERS)
+        return;
+
+    auto& state_tracker = PrivateDataCache::Get<state_tracking>(cmd_list);
+    state_tracker.validate_stage(idx);
+
     auto& [desc_layout, root_table] = state_tracker.root_tables[idx];
     auto& state_stages = state_tracker.root_table_stages[idx];
     auto& constant_buffer = state_tracker.constant_buffer[idx];
+    auto& arena = state_tracker.arenas[idx];
     
     desc_layout = layout;
     state_stages = stages;
@@ -551,28 +656,30 @@ static void on_push_constants(command_list* cmd_list, shader_stage stages, pipel
 
     auto& root_table_entry = root_table[layout_param];
 
+    if (!state_tracker.restores_root_constants && !is_slot_tracked(idx, layout_param))
+    {
+        drop_slot_content(state_tracker, idx, root_table_entry);
+        return;
+    }
+
     // Not buffered yet, initialize
-    if (root_table_entry.type == root_entry_type::undefined)
+    if (root_table_entry.type != root_entry_type::push_constants || root_table_entry.buffer_index < 0)
     {
-        std::vector<uint32_t> buf(first + count);
+        constant_buffer.push_back(arena.allocate<uint32_t>(first + count));
 
+        auto& buf = constant_buffer.back();
         for (uint32_t i = 0; i < count; i++)
         {
             buf[first + i] = reinterpret_cast<const uint32_t*>(values)[i];
         }
 
-        constant_buffer.push_back(std::move(buf));
-
         root_table_entry = { root_entry_type::push_constants, static_cast<int32_t>(constant_buffer.size()) - 1, {} };
     }
     else // Write to existing buffer index
     {
         auto& buf = constant_buffer[root_table_entry.buffer_index];
 
-        if (buf.size() < first + count)
-        {
-            buf.resize(first + count);
-        }
+        arena.grow(buf, first + count);
 
         for (uint32_t i = 0; i < count; i++)
         {
@@ -581,17 +688,92 @@ static void on_push_constants(command_list* cmd_list, shader_stage stages, pipel
     }
 }
 
-const descriptor_tracking::descriptor_data* state_block::get_descriptor_at(uint32_t stageIndex, uint32_t layout_param, uint32_t binding) const
+void state_block::resolve_descriptor_table(uint32_t stageIndex, root_entry& entry, uint32_t layout_param)
 {
-    if (root_tables[stageIndex].second.size() > layout_param)
+    entry.resolved = true;
+
+    auto& descriptor_buffer_stage = descriptor_buffer[stageIndex];
+    if (entry.buffer_index >= 0)
     {
-        const auto& root_entry = root_tables[stageIndex].second[layout_param];
+        descriptor_buffer_stage[entry.buffer_index].size = 0;
+    }
+
+    if (parent_device == nullptr || entry.descriptor_table.handle == 0 || !state_tracking::is_tracking_descriptors())
+    {
+        return;
+    }
+
+    const auto& descriptor_state = parent_device->get_private_data<descriptor_tracking>();
+    const pipeline_layout layout = root_tables[stageIndex].first;
+    if (layout == 0)
+    {
+        return;
+    }
+
+    // Only a layout change costs a map lookup, the ranges and binding extent of each parameter were precomputed on layout creation
+    auto& [cached_layout, layout_index] = layout_metadata_indices[stageIndex];
+    if (cached_layout != layout)
+    {
+        cached_layout = layout;
+        layout_index = descriptor_state.get_pipeline_layout_index(layout);
+    }
+
+    if (layout_index == descriptor_tracking::INVALID_LAYOUT_INDEX)
+    {
+        return;
+    }
+
+    const descriptor_tracking::pipeline_layout_metadata& metadata = descriptor_state.get_pipeline_layout_metadata(layout_index);
+    if (layout_param >= metadata.params.size() || !metadata.params[layout_param].is_descriptor_table)
+    {
+        return;
+    }
+
+    const descriptor_tracking::layout_param_metadata& param = metadata.params[layout_param];
+
+    // Overwrite the snapshot of the previously bound table if it's large enough
+    if (entry.buffer_index < 0 || descriptor_buffer_stage[entry.buffer_index].capacity < param.binding_extent)
+    {
+        descriptor_buffer_stage.push_back(arenas[stageIndex].allocate<descriptor_tracking::descriptor_data>(param.binding_extent));
+        entry.buffer_index = static_cast<int32_t>(descriptor_buffer_stage.size()) - 1;
+    }
+    else
+    {
+        arena_span<descriptor_tracking::descriptor_data>& reused = descriptor_buffer_stage[entry.buffer_index];
+        std::fill_n(reused.data, param.binding_extent, descriptor_tracking::descriptor_data{});
+        reused.size = param.binding_extent;
+    }
+
+    arena_span<descriptor_tracking::descriptor_data>& descriptors = descriptor_buffer_stage[entry.buffer_index];
+
+    for (uint32_t k = param.first_range; k < param.first_range + param.range_count; ++k)
+    {
+        const descriptor_range& range = metadata.tracked_ranges[k];
+
+        uint32_t base_offset = 0;
+        descriptor_heap heap = { 0 };
+        descriptor_state.get_descriptor_heap_offset(parent_device, entry.descriptor_table, range.binding, 0, &heap, &base_offset);
+
+        descriptor_state.set_all_descriptors(heap, base_offset, range.count, descriptors.data, range.binding);
+    }
+}
+
+const descriptor_tracking::descriptor_data* state_block::get_descriptor_at(uint32_t stageIndex, uint32_t layout_param, uint32_t binding)
+{
+    if (is_stage_current(stageIndex) && root_tables[stageIndex].second.size() > layout_param)
+    {
+        auto& root_entry = root_tables[stageIndex].second[layout_param];
+
+        if (root_entry.type == root_entry_type::descriptor_table && !root_entry.resolved)
+        {
+            resolve_descriptor_table(stageIndex, root_entry, layout_param);
+        }
 
         if ((root_entry.type == root_entry_type::push_descriptors || root_entry.type == root_entry_type::descriptor_table) && root_entry.buffer_index >= 0)
         {
             const auto& table_entry = descriptor_buffer[stageIndex][root_entry.buffer_index];
 
-            if (table_entry.size() > binding)
+            if (table_entry.size > binding)
             {
                 return &table_entry[binding];
             }
@@ -602,19 +784,24 @@ const descriptor_tracking::descriptor_data* state_block::get_descriptor_at(uint3
 }
 
 
-const size_t state_block::get_root_table_entry_size_at(uint32_t stageIndex, uint32_t layout_param) const
+const size_t state_block::get_root_table_entry_size_at(uint32_t stageIndex, uint32_t layout_param)
 {
-    if (root_tables[stageIndex].second.size() > layout_param)
+    if (is_stage_current(stageIndex) && root_tables[stageIndex].second.size() > layout_param)
     {
-        const auto& root_entry = root_tables[stageIndex].second[layout_param];
+        auto& root_entry = root_tables[stageIndex].second[layout_param];
+
+        if (root_entry.type == root_entry_type::descriptor_table && !root_entry.resolved)
+        {
+            resolve_descriptor_table(stageIndex, root_entry, layout_param);
+        }
 
         if ((root_entry.type == root_entry_type::push_descriptors || root_entry.type == root_entry_type::descriptor_table) && root_entry.buffer_index >= 0)
         {
-            return descriptor_buffer[stageIndex][root_entry.buffer_index].size();
+            return descriptor_buffer[stageIndex][root_entry.buffer_index].size;
         }
         else if (root_entry.type == root_entry_type::push_constants && root_entry.buffer_index >= 0)
         {
-            return constant_buffer[root_entry.buffer_index].size();
+            return constant_buffer[stageIndex][root_entry.buffer_index].size;
         }
     }
 
@@ -623,12 +810,12 @@ const size_t state_block::get_root_table_entry_size_at(uint32_t stageIndex, uint
 
 const size_t state_block::get_root_table_size_at(uint32_t stageIndex) const
 {
-    return root_tables[stageIndex].second.size();
+    return is_stage_current(stageIndex) ? root_tables[stageIndex].second.size() : 0;
 }
 
-const std::vector<uint32_t>* state_block::get_constants_at(uint32_t stageIndex, uint32_t layout_param) const
+const arena_span<uint32_t>* state_block::get_constants_at(uint32_t stageIndex, uint32_t layout_param) const
 {
-    if (root_tables[stageIndex].second.size() > layout_param)
+    if (is_stage_current(stageIndex) && root_tables[stageIndex].second.size() > layout_param)
     {
         const auto& root_entry = root_tables[stageIndex].second[layout_param];
 
@@ -643,7 +830,7 @@ const std::vector<uint32_t>* state_block::get_constants_at(uint32_t stageIndex,
 
 static void on_reset_command_list(command_list* cmd_list)
 {
-    auto& state = cmd_list->get_private_data<state_tracking>();
+    auto& state = PrivateDataCache::Get<state_tracking>(cmd_list);
     state.clear();
 }
 
@@ -658,30 +845,34 @@ static void on_reshade_present(effect_runtime* runtime)
 
 void state_block::start_resource_barrier_tracking(reshade::api::resource res, reshade::api::resource_usage current_usage)
 {
-    const auto& restrack = resource_barrier_track.find(res.handle);
+    barrier_track* restrack = resource_barrier_track.find(res.handle);
 
-    if (restrack != resource_barrier_track.end())
+    if (restrack != nullptr)
+    {
+        restrack->ref_count++;
+    }
+    else if (resource_barrier_track.insert(res.handle, barrier_track{ current_usage, 1 }))
     {
-        restrack->second.ref_count++;
+        s_barrier_tracked_resources.fetch_add(1, std::memory_order_relaxed);
     }
     else
     {
-        resource_barrier_track.emplace(res.handle, barrier_track{ current_usage, 1 });
+        reshade::log::message(reshade::log::level::warning, std::format("Can't track barriers of resource {:#x}, already tracking {} resources", res.handle, barrier_tracker::CAPACITY).c_str());
     }
 }
-
 reshade::api::resource_usage state_block::stop_resource_barrier_tracking(reshade::api::resource res)
 {
-    const auto& restrack = resource_barrier_track.find(res.handle);
+    barrier_track* restrack = resource_barrier_track.find(res.handle);
 
-    if (restrack != resource_barrier_track.end())
+    if (restrack != nullptr)
     {
-        resource_usage usage = restrack->second.usage;
+        resource_usage usage = restrack->usage;
 
-        restrack->second.ref_count--;
-        if (restrack->second.ref_count <= 0)
+        restrack->ref_count--;
+        if (restrack->ref_count <= 0)
         {
             resource_barrier_track.erase(res.handle);
+            s_barrier_tracked_resources.fetch_sub(1, std::memory_order_relaxed);
         }
 
         return usage;
@@ -692,18 +883,15 @@ reshade::api::resource_usage state_block::stop_resource_barrier_tracking(reshade
 
 static void on_barrier(command_list* cmd_list, uint32_t count, const resource* resources, const resource_usage* old_states, const resource_usage* new_states)
 {
-    auto& barrier_track = cmd_list->get_private_data<state_tracking>().resource_barrier_track;
-    if (barrier_track.size() > 0)
+    if (s_barrier_tracked_resources.load(std::memory_order_relaxed) == 0)
     {
-        for (uint32_t i = 0; i < count; i++)
-        {
-            const auto& restrack = barrier_track.find(resources[i].handle);
+        return;
+    }
 
-            if (restrack != barrier_track.end())
-            {
-                restrack->second.usage = new_states[i];
-            }
-        }
+    auto& barrier_track = PrivateDataCache::Get<state_tracking>(cmd_list).resource_barrier_track;
+    if (!barrier_track.empty())
+    {
+        barrier_track.update(count, resources, new_states);
     }
 }
 
@@ -714,14 +902,12 @@ static void on_init_device(device* device)
 
 static void on_destroy_device(device* device)
 {
+    PrivateDataCache::Invalidate();
     device->destroy_private_data<DeviceStateTracking>();
 }
 
 void state_tracking::register_events(bool track)
 {
-    // disable for now
-    track = false;
-
     track_descriptors = track;
     descriptor_tracking::register_events(track);
 
@@ -739,14 +925,7 @@ void state_tracking::register_events(bool track)
     reshade::register_event<reshade::addon_event::push_descriptors>(on_push_descriptors);
     reshade::register_event<reshade::addon_event::push_constants>(on_push_constants);
 
-    if (track_descriptors)
-    {
-        reshade::register_event<reshade::addon_event::bind_descriptor_tables>(on_bind_descriptor_tables);
-    }
-    else
-    {
-        reshade::register_event<reshade::addon_event::bind_descriptor_tables>(on_bind_descriptor_tables_no_track);
-    }
+    reshade::register_event<reshade::addon_event::bind_descriptor_tables>(on_bind_descriptor_tables);
 
     reshade::register_event<reshade::addon_event::reset_command_list>(on_reset_command_list);
 
@@ -773,14 +952,7 @@ void state_tracking::unregister_events()
     reshade::unregister_event<reshade::addon_event::push_descriptors>(on_push_descriptors);
     reshade::unregister_event<reshade::addon_event::push_constants>(on_push_constants);
 
-    if (track_descriptors)
-    {
-        reshade::unregister_event<reshade::addon_event::bind_descriptor_tables>(on_bind_descriptor_tables);
-    }
-    else
-    {
-        reshade::unregister_event<reshade::addon_event::bind_descriptor_tables>(on_bind_descriptor_tables_no_track);
-    }
+    reshade::unregister_event<reshade::addon_event::bind_descriptor_tables>(on_bind_descriptor_tables);
 
     reshade::unregister_event<reshade::addon_event::reset_command_list>(on_reset_command_list);
 
@@ -7,10 +7,19 @@
 
 #include <vector>
 #include <array>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
 #include <unordered_map>
 #include <shared_mutex>
 #include <unordered_set>
+#include <bit>
 #include <d3d9.h>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define STATE_TRACKING_SSE2
+#endif
 #include "DescriptorTracking.h"
 
  /// <summary>
@@ -52,6 +61,131 @@ namespace StateTracking
         int32_t ref_count = 0;
     };
 
+    /// <summary>
+    /// The few resources whose barriers are tracked on a command list. Slots are kept in a flat array that is small enough to compare against
+    /// all at once, so lookups don't hash and barrier batches are matched a pair of handles per compare.
+    /// </summary>
+    class barrier_tracker
+    {
+    public:
+        static constexpr uint32_t CAPACITY = 8;
+
+        bool empty() const { return occupied == 0; }
+        uint32_t size() const { return static_cast<uint32_t>(std::popcount(occupied)); }
+
+        barrier_track* find(uint64_t handle)
+        {
+            const uint32_t matches = match(handle);
+            return matches != 0 ? &tracks[std::countr_zero(matches)] : nullptr;
+        }
+
+        /// <summary>
+        /// Returns false if all slots are in use.
+        /// </summary>
+        bool insert(uint64_t handle, const barrier_track& track)
+        {
+            if (occupied == (1u << CAPACITY) - 1)
+            {
+                return false;
+            }
+
+            const uint32_t slot = std::countr_one(occupied);
+            handles[slot] = handle;
+            tracks[slot] = track;
+            occupied |= 1u << slot;
+
+            return true;
+        }
+
+        void erase(uint64_t handle)
+        {
+            const uint32_t matches = match(handle);
+            if (matches != 0)
+            {
+                occupied &= ~(1u << std::countr_zero(matches));
+            }
+        }
+
+        void clear()
+        {
+            // Handles of free slots are never looked at
+            occupied = 0;
+        }
+
+        /// <summary>
+        /// Applies the new states of a barrier batch to the tracked resources. If a resource occurs more than once, its last barrier wins.
+        /// </summary>
+        void update(uint32_t count, const reshade::api::resource* resources, const reshade::api::resource_usage* new_states)
+        {
+            static_assert(sizeof(reshade::api::resource) == sizeof(uint64_t), "resource handles are compared as packed 64 bit values");
+
+            for (uint32_t remaining = occupied; remaining != 0; remaining &= remaining - 1)
+            {
+                const uint32_t slot = std::countr_zero(remaining);
+                const uint64_t handle = handles[slot];
+                int32_t last = -1;
+                uint32_t i = 0;
+
+#ifdef STATE_TRACKING_SSE2
+                const __m128i key = _mm_set1_epi64x(static_cast<int64_t>(handle));
+                for (; i + 2 <= count; i += 2)
+                {
+                    const uint32_t pair = equal_pairs(_mm_loadu_si128(reinterpret_cast<const __m128i*>(resources + i)), key);
+                    if (pair != 0)
+                    {
+                        last = static_cast<int32_t>(i + 31 - std::countl_zero(pair));
+                    }
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    if (resources[i].handle == handle)
+                    {
+                        last = static_cast<int32_t>(i);
+                    }
+                }
+
+                if (last >= 0)
+                {
+                    tracks[slot].usage = new_states[last];
+                }
+            }
+        }
+
+    private:
+#ifdef STATE_TRACKING_SSE2
+        // SSE2 has no 64 bit compare, so both 32 bit halves have to match. Returns one bit per 64 bit lane.
+        static uint32_t equal_pairs(__m128i values, __m128i key)
+        {
+            const __m128i halves = _mm_cmpeq_epi32(values, key);
+            const __m128i both = _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+            return static_cast<uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(both)));
+        }
+#endif
+
+        uint32_t match(uint64_t handle) const
+        {
+            uint32_t matches = 0;
+#ifdef STATE_TRACKING_SSE2
+            const __m128i key = _mm_set1_epi64x(static_cast<int64_t>(handle));
+            for (uint32_t i = 0; i < CAPACITY; i += 2)
+            {
+                matches |= equal_pairs(_mm_load_si128(reinterpret_cast<const __m128i*>(handles + i)), key) << i;
+            }
+#else
+            for (uint32_t i = 0; i < CAPACITY; i++)
+            {
+                matches |= static_cast<uint32_t>(handles[i] == handle) << i;
+            }
+#endif
+            return matches & occupied;
+        }
+
+        alignas(16) uint64_t handles[CAPACITY] = {};
+        barrier_track tracks[CAPACITY];
+        uint32_t occupied = 0;
+    };
+
     enum class root_entry_type : int32_t
     {
         undefined = -1,
@@ -70,6 +204,153 @@ namespace StateTracking
         root_entry_type type = root_entry_type::undefined;
         int32_t buffer_index = -1;;
         reshade::api::descriptor_table descriptor_table = {};
+        bool resolved = true;		// false while the descriptors of a bound descriptor_table haven't been copied to buffer_index yet
+    };
+
+    /// <summary>
+    /// Categories of command list state the addon clobbers when it renders on a command list itself. state_block::apply only restores
+    /// the categories marked dirty since the last restore.
+    /// </summary>
+    namespace state_category
+    {
+        constexpr uint32_t render_targets = 1 << 0;
+        constexpr uint32_t pipelines = 1 << 1;
+        constexpr uint32_t pipeline_states = 1 << 2;	// primitive topology, blend constant, sample mask and stencil reference values
+        constexpr uint32_t viewports = 1 << 3;
+        constexpr uint32_t scissor_rects = 1 << 4;
+        constexpr uint32_t descriptors = 1 << 5;
+
+        constexpr uint32_t count = 6;
+        constexpr uint32_t all = (1 << count) - 1;
+    }
+
+    struct restore_stats
+    {
+        std::array<uint64_t, state_category::count> restored = {};
+        std::array<uint64_t, state_category::count> skipped = {};	// not clobbered since the last restore, so nothing was re-bound
+    };
+
+    /// <summary>
+    /// Array allocated from a state_arena, valid until the arena is rewound.
+    /// </summary>
+    template<typename T>
+    struct arena_span
+    {
+        T* data = nullptr;
+        uint32_t size = 0;
+        uint32_t capacity = 0;
+
+        T& operator[](size_t index) { return data[index]; }
+        const T& operator[](size_t index) const { return data[index]; }
+    };
+
+    /// <summary>
+    /// Vector with inline storage for up to N elements, for state with a small API limit. Clearing only resets the size, elements past
+    /// the end are value initialized when the vector grows over them again. Growing past N is clamped.
+    /// </summary>
+    template<typename T, uint32_t N>
+    struct inline_vector
+    {
+        static constexpr size_t capacity() { return N; }
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        T* data() { return items; }
+        const T* data() const { return items; }
+        T* begin() { return items; }
+        T* end() { return items + count; }
+        const T* begin() const { return items; }
+        const T* end() const { return items + count; }
+
+        T& operator[](size_t index) { return items[index]; }
+        const T& operator[](size_t index) const { return items[index]; }
+
+        void clear() { count = 0; }
+
+        void resize(size_t new_size)
+        {
+            new_size = std::min(new_size, static_cast<size_t>(N));
+            if (new_size > count)
+            {
+                std::fill(items + count, items + new_size, T{});
+            }
+            count = static_cast<uint32_t>(new_size);
+        }
+
+        void assign(const T* first, const T* last)
+        {
+            count = static_cast<uint32_t>(std::min(static_cast<size_t>(last - first), static_cast<size_t>(N)));
+            std::copy_n(first, count, items);
+        }
+
+        T items[N] = {};
+        uint32_t count = 0;
+    };
+
+    constexpr uint32_t MAX_RENDER_TARGETS = 8;
+    constexpr uint32_t MAX_VIEWPORTS = 16;
+    constexpr uint32_t MAX_ROOT_PARAMETERS = 64;		// d3d12 root signatures are limited to 64 DWORDs
+
+    /// <summary>
+    /// Bump allocator for the descriptor and constant snapshots of a command list. Blocks are kept when the arena is rewound, so once a
+    /// command list recorded a typical frame, recording the next one doesn't touch the heap.
+    /// </summary>
+    class state_arena
+    {
+    public:
+        static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+        /// <summary>
+        /// Returns a zeroed array of count elements.
+        /// </summary>
+        template<typename T>
+        arena_span<T> allocate(uint32_t count)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "arena memory is never destructed");
+
+            T* data = static_cast<T*>(allocate_bytes(count * sizeof(T), alignof(T)));
+            std::fill_n(data, count, T{});
+
+            return { data, count, count };
+        }
+
+        /// <summary>
+        /// Grows span to at least count elements, keeping its contents and zeroing the new ones. Memory it moves out of is only reused after a rewind.
+        /// </summary>
+        template<typename T>
+        void grow(arena_span<T>& span, uint32_t count)
+        {
+            if (count <= span.size)
+            {
+                return;
+            }
+
+            if (count > span.capacity)
+            {
+                arena_span<T> grown = allocate<T>(std::max(count, span.capacity * 2));
+                std::copy_n(span.data, span.size, grown.data);
+                grown.size = span.size;
+                span = grown;
+            }
+
+            std::fill(span.data + span.size, span.data + count, T{});
+            span.size = count;
+        }
+
+        void rewind();
+
+        size_t used() const { return used_bytes; }
+        size_t high_water_mark() const { return high_water_mark_bytes; }
+
+    private:
+        void* allocate_bytes(size_t size, size_t alignment);
+
+        std::vector<std::pair<std::unique_ptr<uint8_t[]>, size_t>> blocks;
+        size_t current_block = 0;
+        size_t block_offset = 0;
+        size_t used_bytes = 0;
+        size_t high_water_mark_bytes = 0;
     };
 
     struct state_block
@@ -81,47 +362,96 @@ namespace StateTracking
 
         void capture(reshade::api::command_list* cmd_list, bool force_restore = false);
 
+        /// <summary>
+        /// Marks state the addon is about to overwrite (or just did) on the command list, so the next apply restores it. Pipelines and
+        /// descriptors are only restored for the given stages.
+        /// </summary>
+        void mark_dirty(uint32_t categories, reshade::api::pipeline_stage pipeline_stages = reshade::api::pipeline_stage::all, reshade::api::shader_stage shader_stages = reshade::api::shader_stage::all);
+
         void apply(reshade::api::command_list* cmd_list, bool force_restore = false);
         void apply_dx9(reshade::api::command_list* cmd_list, bool force_restore);
-        void apply_default(reshade::api::command_list* cmd_list, bool force_restore) const;
+        void apply_default(reshade::api::command_list* cmd_list, bool force_restore);
 
         void apply_descriptors_dx12_vulkan(reshade::api::command_list* cmd_list) const;
         void apply_descriptors(reshade::api::command_list* cmd_list) const;
 
+        const restore_stats& get_restore_stats() const { return stats; }
+
         void start_resource_barrier_tracking(reshade::api::resource res, reshade::api::resource_usage current_usage);
         reshade::api::resource_usage stop_resource_barrier_tracking(reshade::api::resource res);
 
-        const descriptor_tracking::descriptor_data* get_descriptor_at(uint32_t stageIndex, uint32_t layout_param, uint32_t binding) const;
-        const size_t get_root_table_entry_size_at(uint32_t stageIndex, uint32_t layout_param) const;
+        /// <summary>
+        /// Drops the root table and snapshots a shader stage still has from before the last clear. Has to be called before modifying them.
+        /// </summary>
+        void validate_stage(uint32_t stageIndex)
+        {
+            if (stage_generation[stageIndex] != generation)
+            {
+                reset_stage(stageIndex);
+                stage_generation[stageIndex] = generation;
+            }
+        }
+        void reset_stage(uint32_t stageIndex);
+        bool is_stage_current(uint32_t stageIndex) const { return stage_generation[stageIndex] == generation; }
+
+        const descriptor_tracking::descriptor_data* get_descriptor_at(uint32_t stageIndex, uint32_t layout_param, uint32_t binding);
+        const size_t get_root_table_entry_size_at(uint32_t stageIndex, uint32_t layout_param);
         const size_t get_root_table_size_at(uint32_t stageIndex) const;
-        const std::vector<uint32_t>* get_constants_at(uint32_t stageIndex, uint32_t layout_param) const;
+        const arena_span<uint32_t>* get_constants_at(uint32_t stageIndex, uint32_t layout_param) const;
 
         /// <summary>
-        /// Removes all state in this state block.
+        /// Removes all state in this state block. Per stage state is only dropped when the stage is next used, see validate_stage.
         /// </summary>
         void clear();
         void clear_present(reshade::api::effect_runtime* runtime);
 
-        std::vector<reshade::api::resource_view> render_targets;
+        inline_vector<reshade::api::resource_view, MAX_RENDER_TARGETS> render_targets;
         reshade::api::resource_view depth_stencil = { 0 };
         std::array<reshade::api::pipeline, ALL_PIPELINE_STAGES_SIZE> current_pipeline;
         std::array<reshade::api::pipeline_stage, ALL_PIPELINE_STAGES_SIZE> current_pipeline_stage;
+        uint32_t bound_pipeline_stages = 0;	// bit per ALL_PIPELINE_STAGES index, current_pipeline is only valid for set bits
         reshade::api::primitive_topology primitive_topology = reshade::api::primitive_topology::undefined;
         uint32_t blend_constant = 0;
         uint32_t sample_mask = 0xFFFFFFFF;
         uint32_t front_stencil_reference_value = 0;
         uint32_t back_stencil_reference_value = 0;
-        std::vector<reshade::api::viewport> viewports;
-        std::vector<reshade::api::rect> scissor_rects;
+        inline_vector<reshade::api::viewport, MAX_VIEWPORTS> viewports;
+        inline_vector<reshade::api::rect, MAX_VIEWPORTS> scissor_rects;
 
-        std::array<std::pair<reshade::api::pipeline_layout, std::vector<root_entry>>, ALL_SHADER_STAGES_SIZE> root_tables;
-        std::array<reshade::api::shader_stage, ALL_SHADER_STAGES_SIZE> root_table_stages;
-        std::array<std::vector<std::vector<uint32_t>>, ALL_SHADER_STAGES_SIZE> constant_buffer;
-        std::array<std::vector<std::vector<descriptor_tracking::descriptor_data>>, ALL_SHADER_STAGES_SIZE> descriptor_buffer;
+        // Per stage state below is only valid while the stage's generation matches the block's, see validate_stage
+        uint32_t generation = 0;
+        std::array<uint32_t, ALL_SHADER_STAGES_SIZE> stage_generation = {};
+        std::array<std::pair<reshade::api::pipeline_layout, inline_vector<root_entry, MAX_ROOT_PARAMETERS>>, ALL_SHADER_STAGES_SIZE> root_tables = {};
+        std::array<reshade::api::shader_stage, ALL_SHADER_STAGES_SIZE> root_table_stages = {};
+        std::array<std::vector<arena_span<uint32_t>>, ALL_SHADER_STAGES_SIZE> constant_buffer;
+        std::array<std::vector<arena_span<descriptor_tracking::descriptor_data>>, ALL_SHADER_STAGES_SIZE> descriptor_buffer;
+        // Backing memory of constant_buffer and descriptor_buffer, per stage so a layout change can drop a stage's snapshots at once
+        std::array<state_arena, ALL_SHADER_STAGES_SIZE> arenas;
+        // Layout whose metadata was last looked up for a stage and its index in descriptor_tracking, see resolve_descriptor_table
+        std::array<std::pair<reshade::api::pipeline_layout, uint32_t>, ALL_SHADER_STAGES_SIZE> layout_metadata_indices = {};
 
-        std::unordered_map<uint64_t, barrier_track> resource_barrier_track;
+        barrier_tracker resource_barrier_track;
 
         IDirect3DStateBlock9* dx_state;
+        reshade::api::device* parent_device = nullptr;
+        bool restores_root_constants = false;	// d3d12 and vulkan restore push constants of every stage, so they can't be filtered
+
+        uint32_t dirty_categories = 0;
+        uint32_t dirty_pipeline_stages = 0;
+        uint32_t dirty_shader_stages = 0;
+
+    private:
+        /// <summary>
+        /// Returns whether category has to be restored and counts the outcome.
+        /// </summary>
+        bool restores(uint32_t category);
+
+        restore_stats stats;
+
+        /// <summary>
+        /// Copies the descriptors of a bound table out of the tracked heaps. Done on first access rather than on bind, as most binds are never looked at.
+        /// </summary>
+        void resolve_descriptor_table(uint32_t stageIndex, root_entry& entry, uint32_t layout_param);
     };
 
     struct __declspec(uuid("EE0C0141-E361-42E5-AF64-25F2F677F37F")) DeviceStateTracking {
@@ -144,6 +474,18 @@ public:
     /// Unregisters all the necessary add-on events for state tracking to work.
     /// </summary>
     static void unregister_events();
+
+    static bool is_tracking_descriptors() { return track_descriptors; }
+
+    static constexpr uint32_t TRACK_ALL_SLOTS = UINT32_MAX;
+
+    /// <summary>
+    /// Limits tracking of pushed descriptors and constants of a shader stage to its first count root parameters, the content of the
+    /// others is dropped. Bound descriptor tables are always recorded, as they're resolved lazily anyway.
+    /// </summary>
+    static void set_tracked_slots(uint32_t stage_index, uint32_t count) { tracked_slots[stage_index].store(count, std::memory_order_relaxed); }
+    static uint32_t get_tracked_slots(uint32_t stage_index) { return tracked_slots[stage_index].load(std::memory_order_relaxed); }
 private:
     static bool track_descriptors;
+    static std::atomic<uint32_t> tracked_slots[StateTracking::ALL_SHADER_STAGES_SIZE];
 };
@@ -46,6 +46,7 @@ void TechniqueManager::OnReshadeReloadedEffects(reshade::api::effect_runtime* ru
     data.allEnabledTechniques.clear();
     data.allTechniques.clear();
     data.allSortedTechniques.clear();
+    data.techniqueGeneration++;
 
     Rendering::RenderingManager::EnumerateTechniques(runtime, [&data, this](effect_runtime* runtime, effect_technique technique, string& name, string& eff_name) {
         bool enabled = runtime->get_technique_state(technique);
@@ -68,6 +69,7 @@ void TechniqueManager::OnReshadeReloadedEffects(reshade::api::effect_runtime* ru
         }
 
         const auto& it = data.allTechniques.emplace(name + " [" + eff_name + "]", EffectData{technique, runtime, enabled});
+        it.first->second.index = static_cast<uint32_t>(data.allSortedTechniques.size());
         data.allSortedTechniques.push_back(&it.first->second);
 
         if (enabled)
@@ -122,6 +124,7 @@ bool TechniqueManager::OnReshadeSetTechniqueState(reshade::api::effect_runtime*
     }
 
     it->second.enabled = enabled;
+    data.techniqueGeneration++;
 
     if (!enabled)
     {
@@ -149,6 +152,7 @@ bool TechniqueManager::OnReshadeReorderTechniques(reshade::api::effect_runtime*
     data.allEnabledTechniques.clear();
     data.allTechniques.clear();
     data.allSortedTechniques.clear();
+    data.techniqueGeneration++;
 
     for (uint32_t i = 0; i < count; i++)
     {
@@ -184,6 +188,7 @@ bool TechniqueManager::OnReshadeReorderTechniques(reshade::api::effect_runtime*
         }
 
         const auto& it = data.allTechniques.emplace(effKey, EffectData{ technique, runtime, enabled });
+        it.first->second.index = static_cast<uint32_t>(data.allSortedTechniques.size());
         data.allSortedTechniques.push_back(&it.first->second);
 
         if (enabled)
@@ -211,6 +216,7 @@ void TechniqueManager::OnReshadePresent(reshade::api::effect_runtime* runtime)
         {
             runtime->set_technique_state(eff->technique, false);
             el = deviceData.allEnabledTechniques.erase(el);
+            deviceData.techniqueGeneration++;
             continue;
         }
 
@@ -31,6 +31,7 @@
 /////////////////////////////////////////////////////////////////////////
 
 #include <sstream>
+#include <atomic>
 #include "stdafx.h"
 #include "ToggleGroup.h"
 
@@ -52,17 +53,20 @@ namespace ShaderToggler
         _extractResourceViews = false;
         _matchSwapchainResolution = true;
         _copyTextureBinding = false;
+        _clearBindings = false;
         _previewClearAlpha = true;
         _tonemapHDRtoSDRtoHDR = false;
         _preserveAlpha = false;
         _renderToResourceViews = false;
+        _requeueAfterRTMatchingFailure = false;
         _cbCycle = CYCLE_NONE;
         _srvCycle = CYCLE_NONE;
         _rtCycle = CYCLE_NONE;
 
         _group_buffers[static_cast<uint32_t>(GroupResourceType::RESOURCE_ALPHA)] = { {}, {}, {}, {}, {}, {}, {}, [&]() { return _preserveAlpha; }, [&]() { return false; }, GroupResourceState::RESOURCE_INVALID, true };
         _group_buffers[static_cast<uint32_t>(GroupResourceType::RESOURCE_BINDING)] = { {}, {}, {}, {}, {}, {}, {}, [&]() { return _copyTextureBinding && _isProvidingTextureBinding; }, [&]() { return _clearBindings; }, GroupResourceState::RESOURCE_INVALID, true };
-        _group_buffers[static_cast<uint32_t>(GroupResourceType::RESOURCE_CONSTANTS_COPY)] = { {}, {}, {}, {}, {}, {}, {}, [&]() { return _extractConstants; }, [&]() { return false; }, GroupResourceState::RESOURCE_INVALID, true };
+        // Constant readback buffers are owned by ConstantCopyGPUReadback, which keeps a ring of them per group
+        _group_buffers[static_cast<uint32_t>(GroupResourceType::RESOURCE_CONSTANTS_COPY)] = { {}, {}, {}, {}, {}, {}, {}, [&]() { return _extractConstants; }, [&]() { return false; }, GroupResourceState::RESOURCE_INVALID, false };
     }
 
 
@@ -75,6 +79,7 @@ namespace ShaderToggler
     ToggleGroup::ToggleGroup(const ToggleGroup& other) : ToggleGroup()
     {
         _id = other._id;
+        _slot = other._slot;
         _name = other._name;
         _keybind = other._keybind;
         _vertexShaderHashes = other._vertexShaderHashes;
@@ -112,6 +117,7 @@ namespace ShaderToggler
         _preferredTechniques = other._preferredTechniques;
         _preferredTechniqueData = other._preferredTechniqueData;
         _varOffsetMapping = other._varOffsetMapping;
+        _varMappingVersion++;
         _cbCycle = other._cbCycle;
         _srvCycle = other._srvCycle;
         _rtCycle = other._rtCycle;
@@ -134,6 +140,8 @@ namespace ShaderToggler
                 _preferredTechniqueData.emplace(&techData->second);
             }
         }
+
+        _scheduleVersion++;
     }
 
 
@@ -218,6 +226,7 @@ namespace ShaderToggler
     bool ToggleGroup::SetVarMapping(uintptr_t offset, string& variable, bool prev)
     {
         _varOffsetMapping.emplace(variable, make_tuple(offset, prev));
+        _varMappingVersion++;
 
         return true; // do some sanity checking?
     }
@@ -226,6 +235,7 @@ namespace ShaderToggler
     bool ToggleGroup::RemoveVarMapping(string& variable)
     {
         _varOffsetMapping.erase(variable);
+        _varMappingVersion++;
 
         return true; // do some sanity checking?
     }
@@ -352,6 +362,9 @@ namespace ShaderToggler
 
     void ToggleGroup::loadState(CDataFile& iniFile, int groupCounter)
     {
+        _scheduleVersion++;
+        _varMappingVersion++;
+
         if (groupCounter < 0)
         {
             int amount = iniFile.GetInt("AmountHashes", "PixelShaders");
@@ -41,6 +41,7 @@
 #include "CDataFile.h"
 #include "EffectData.h"
 #include "GlobalResourceView.h"
+#include "GroupMask.h"
 
 namespace ShaderToggler
 {
@@ -130,14 +131,17 @@ namespace ShaderToggler
         bool isEditing() { return _isEditing; }
         bool isEmpty() const { return _vertexShaderHashes.size() <= 0 && _pixelShaderHashes.size() <= 0; }
         int getId() const { return _id; }
+        uint32_t getSlot() const { return _slot; }
+        void setSlot(uint32_t slot) { _slot = slot; }
+        uint32_t getScheduleVersion() const { return _scheduleVersion; }
         const std::unordered_set<std::string>& preferredTechniques() const { return _preferredTechniques; }
-        void setPreferredTechniques(std::unordered_set<std::string>& techniques) { _preferredTechniques = techniques; }
+        void setPreferredTechniques(std::unordered_set<std::string>& techniques) { _preferredTechniques = techniques; _scheduleVersion++; }
         std::unordered_set<uint32_t> getPixelShaderHashes() const { return _pixelShaderHashes; }
         std::unordered_set<uint32_t> getVertexShaderHashes() const { return _vertexShaderHashes; }
         std::unordered_set<uint32_t> getComputeShaderHashes() const { return _computeShaderHashes; }
-        void setInvocationLocation(uint32_t location) { _invocationLocation = location; }
+        void setInvocationLocation(uint32_t location) { _invocationLocation = location; _scheduleVersion++; }
         uint32_t getInvocationLocation() const { return _invocationLocation; }
-        void setBindingInvocationLocation(uint32_t location) { _bindingInvocationLocation = location; }
+        void setBindingInvocationLocation(uint32_t location) { _bindingInvocationLocation = location; _scheduleVersion++; }
         uint32_t getBindingInvocationLocation() const { return _bindingInvocationLocation; }
         void setCBSlotIndex(uint32_t index) { _cbSlotIndex = index; }
         uint32_t getCBSlotIndex() const { return _cbSlotIndex; }
@@ -148,21 +152,21 @@ namespace ShaderToggler
         void setRenderTargetIndex(uint32_t index) { _rtIndex = index; }
         uint32_t getRenderTargetIndex() const { return _rtIndex; }
         bool isProvidingTextureBinding() const { return _isProvidingTextureBinding; }
-        void setProvidingTextureBinding(bool isProvidingTextureBinding) { _isProvidingTextureBinding = isProvidingTextureBinding; }
+        void setProvidingTextureBinding(bool isProvidingTextureBinding) { _isProvidingTextureBinding = isProvidingTextureBinding; _scheduleVersion++; }
         const std::string& getTextureBindingName() const { return _textureBindingName; }
         void setTextureBindingName(std::string textureBindingName) { _textureBindingName = textureBindingName; }
         bool getClearBindings() { return _clearBindings; }
         void setClearBindings(bool clear) { _clearBindings = clear; }
         bool getAllowAllTechniques() const { return _allowAllTechniques; }
-        void setAllowAllTechniques(bool allowAllTechniques) { _allowAllTechniques = allowAllTechniques; }
+        void setAllowAllTechniques(bool allowAllTechniques) { _allowAllTechniques = allowAllTechniques; _scheduleVersion++; }
         bool getExtractConstants() const { return _extractConstants; }
-        void setExtractConstant(bool extract) { _extractConstants = extract; }
+        void setExtractConstant(bool extract) { _extractConstants = extract; _scheduleVersion++; }
         uint32_t getCBShaderStage() const { return _cbShaderStage; }
         void setCBShaderStage(uint32_t shaderStage) { _cbShaderStage = shaderStage; }
         bool getExtractResourceViews() const { return _extractResourceViews; }
-        void setExtractResourceViews(bool extract) { _extractResourceViews = extract; }
+        void setExtractResourceViews(bool extract) { _extractResourceViews = extract; _scheduleVersion++; }
         bool getRenderToResourceViews() const { return _renderToResourceViews; }
-        void setRenderToResourceViews(bool render) { _renderToResourceViews = render; }
+        void setRenderToResourceViews(bool render) { _renderToResourceViews = render; _scheduleVersion++; }
         void setBindingSRVSlotIndex(uint32_t index) { _bindingSrvSlotIndex = index; }
         uint32_t getBindingSRVSlotIndex() const { return _bindingSrvSlotIndex; }
         void setRenderSRVSlotIndex(uint32_t index) { _renderSrvSlotIndex = index; }
@@ -178,7 +182,7 @@ namespace ShaderToggler
         void setBindingRenderTargetIndex(uint32_t index) { _bindingRTIndex = index; }
         uint32_t getBindingRenderTargetIndex() const { return _bindingRTIndex; }
         bool getHasTechniqueExceptions() const { return _hasTechniqueExceptions; }
-        void setHasTechniqueExceptions(bool exceptions) { _hasTechniqueExceptions = exceptions; }
+        void setHasTechniqueExceptions(bool exceptions) { _hasTechniqueExceptions = exceptions; _scheduleVersion++; }
         uint32_t getMatchSwapchainResolution() const { return _matchSwapchainResolution; }
         void setMatchSwapchainResolution(uint32_t match) { _matchSwapchainResolution = match; }
         uint32_t getBindingMatchSwapchainResolution() const { return _bindingMatchSwapchainResolution; }
@@ -186,8 +190,9 @@ namespace ShaderToggler
         bool getRequeueAfterRTMatchingFailure() const { return _requeueAfterRTMatchingFailure; }
         void setRequeueAfterRTMatchingFailure(bool requeue) { _requeueAfterRTMatchingFailure = requeue; }
         bool getCopyTextureBinding() const { return _copyTextureBinding; }
-        void setCopyTextureBinding(bool copy) { _copyTextureBinding = copy; }
+        void setCopyTextureBinding(bool copy) { _copyTextureBinding = copy; _scheduleVersion++; }
         const std::unordered_map<std::string, std::tuple<uintptr_t, bool>>& GetVarOffsetMapping() const { return _varOffsetMapping; }
+        uint32_t getVarMappingVersion() const { return _varMappingVersion; }
         bool SetVarMapping(uintptr_t, std::string&, bool);
         bool RemoveVarMapping(std::string&);
         bool getClearPreviewAlpha() const { return _previewClearAlpha; }
@@ -238,6 +243,9 @@ namespace ShaderToggler
 
     private:
         int _id;
+        uint32_t _slot = INVALID_GROUP_SLOT;	// dense index of the group, used as its bit in a GroupMask
+        uint32_t _scheduleVersion = 0;		// bumped whenever a setting changes which affects the group's schedule plan
+        uint32_t _varMappingVersion = 0;	// bumped whenever _varOffsetMapping changes
         std::string	_name;
         uint32_t _keybind;
         std::unordered_set<uint32_t> _vertexShaderHashes;
@@ -221,13 +221,6 @@ void ToggleGroupResourceManager::CheckGroupBuffers(reshade::api::effect_runtime*
                     reshade::log::message(reshade::log::level::error, "Failed to create group SRGB render target view!");
                 }
             }
-            else if (static_cast<GroupResourceType>(i) == GroupResourceType::RESOURCE_CONSTANTS_COPY)
-            {
-                if (!runtime->get_device()->create_resource(resource_desc(resources.target_description.buffer.size, memory_heap::gpu_to_cpu, resource_usage::copy_dest | resource_usage::copy_source), nullptr, resource_usage::copy_dest, &resources.res))
-                {
-                    reshade::log::message(reshade::log::level::error, "Failed to create group constant copy buffer!");
-                }
-            }
 
             resources.state = GroupResourceState::RESOURCE_RECREATED;
         }
@@ -268,13 +261,6 @@ bool ToggleGroupResourceManager::IsCompatibleWithGroupFormat(reshade::api::devic
             return true;
         }
     }
-    else if (type == GroupResourceType::RESOURCE_CONSTANTS_COPY)
-    {
-        if (tdesc.buffer.size == preview_desc.buffer.size)
-        {
-            return true;
-        }
-    }
 
     return false;
 }
\ No newline at end of file
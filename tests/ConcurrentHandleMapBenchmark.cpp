@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Measures lookup throughput of N reader threads while one writer keeps creating and destroying pipelines, for ConcurrentHandleMap and
+// the shared_mutex guarded map ShaderManager used before (see LockedHandleMap.h). Not run by ctest; run the executable of a release
+// build directly, on a machine with at least as many cores as readers for the numbers to mean anything.
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include "ConcurrentHandleMap.h"
+#include "LockedHandleMap.h"
+#include "Benchmark.h"
+#include "TestCheck.h"
+
+using namespace ShaderToggler;
+
+static constexpr uint64_t LIVE_PIPELINES = 50000;
+static constexpr auto RUN_TIME = std::chrono::milliseconds(300);
+
+static uint32_t hashOf(uint64_t handle)
+{
+    return static_cast<uint32_t>(handle * 0x9E3779B97F4A7C15ull >> 32) | 1;
+}
+
+struct Throughput
+{
+    double readsPerSecond;
+    double churnPerSecond;
+};
+
+/// <summary>
+/// Readers look up random handles of the live window, which the writer slides forward by destroying the oldest pipeline and creating a
+/// new one, like a game streaming pipelines in and out.
+/// </summary>
+template<typename Map>
+static Throughput run(uint32_t readers)
+{
+    Map map;
+    for (uint64_t handle = 1; handle <= LIVE_PIPELINES; handle++)
+    {
+        map.insert_or_assign(handle, hashOf(handle));
+    }
+
+    std::atomic<uint64_t> oldest = 1;
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> reads = 0;
+    std::atomic<uint64_t> wrongValues = 0;
+    uint64_t churned = 0;
+
+    std::vector<std::thread> threads;
+    for (uint32_t r = 0; r < readers; r++)
+    {
+        threads.emplace_back([&, r]() {
+            std::mt19937_64 random(r);
+            uint64_t local = 0;
+            uint64_t wrong = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                for (int i = 0; i < 256; i++)
+                {
+                    const uint64_t handle = oldest.load(std::memory_order_relaxed) + random() % LIVE_PIPELINES;
+                    uint32_t hash = 0;
+                    if (map.find(handle, hash) && hash != hashOf(handle))
+                    {
+                        wrong++;
+                    }
+                }
+                local += 256;
+            }
+            reads += local;
+            wrongValues += wrong;
+            });
+    }
+
+    std::thread writer([&]() {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            const uint64_t first = oldest.load(std::memory_order_relaxed);
+            map.insert_or_assign(first + LIVE_PIPELINES, hashOf(first + LIVE_PIPELINES));
+            map.erase(first);
+            oldest.store(first + 1, std::memory_order_relaxed);
+            churned++;
+        }
+        });
+
+    std::this_thread::sleep_for(RUN_TIME);
+    stop = true;
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    writer.join();
+
+    CHECK(wrongValues.load() == 0);
+
+    const double seconds = std::chrono::duration<double>(RUN_TIME).count();
+    return { reads.load() / seconds, churned / seconds };
+}
+
+int main()
+{
+    printf("old: %s, new: ConcurrentHandleMap\n", BASELINE_NAME);
+    printf("%llu live pipelines, one writer churning, %u hardware threads\n", static_cast<unsigned long long>(LIVE_PIPELINES), std::thread::hardware_concurrency());
+
+    for (const uint32_t readers : { 1u, 2u, 4u, 8u })
+    {
+        const Throughput baseline = run<LockedHandleMap>(readers);
+        const Throughput lockFree = run<ConcurrentHandleMap<uint32_t>>(readers);
+
+        printf("%u readers   old %8.2f M lookups/s (%7.0f churn/s)   new %8.2f M lookups/s (%7.0f churn/s)   %6.2fx\n", readers,
+            baseline.readsPerSecond / 1e6, baseline.churnPerSecond, lockFree.readsPerSecond / 1e6, lockFree.churnPerSecond,
+            lockFree.readsPerSecond / baseline.readsPerSecond);
+    }
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <thread>
+#include <random>
+#include <vector>
+#include <unordered_map>
+#include "ConcurrentHandleMap.h"
+#include "TestCheck.h"
+
+using namespace ShaderToggler;
+
+struct WideValue
+{
+    uint64_t words[3];
+    const void* pointer;
+};
+
+static void testAgainstReference()
+{
+    ConcurrentHandleMap<uint32_t> map;
+    std::unordered_map<uint64_t, uint32_t> reference;
+    std::mt19937_64 random(7);
+
+    for (int iteration = 0; iteration < 200000; iteration++)
+    {
+        // Handles are aligned, like pointers handed out by the runtime
+        const uint64_t key = (random() % 5000 + 1) * 16;
+
+        switch (random() % 4)
+        {
+        case 0:
+        case 1:
+        {
+            const uint32_t value = static_cast<uint32_t>(random());
+            map.insert_or_assign(key, value);
+            reference[key] = value;
+            break;
+        }
+        case 2:
+        {
+            uint32_t removed = 0;
+            const bool erased = map.erase(key, &removed);
+            const auto it = reference.find(key);
+            CHECK(erased == (it != reference.end()));
+            if (erased)
+            {
+                CHECK(removed == it->second);
+                reference.erase(it);
+            }
+            break;
+        }
+        default:
+            map.update(key, [](uint32_t& value) { value++; });
+            reference[key]++;
+            break;
+        }
+
+        CHECK(map.size() == reference.size());
+    }
+
+    for (uint64_t key = 16; key <= 5000 * 16; key += 16)
+    {
+        uint32_t value = 0;
+        const auto it = reference.find(key);
+        CHECK(map.find(key, value) == (it != reference.end()));
+        CHECK(map.contains(key) == (it != reference.end()));
+        if (it != reference.end())
+        {
+            CHECK(value == it->second);
+        }
+    }
+
+    size_t visited = 0;
+    map.update_all([&](uint64_t key, uint32_t& value) {
+        CHECK(reference.at(key) == value);
+        value = 0;
+        visited++;
+        });
+    CHECK(visited == reference.size());
+}
+
+static void testReservedKeys()
+{
+    ConcurrentHandleMap<uint32_t> map;
+    map.insert_or_assign(0, 1);
+    map.insert_or_assign(UINT64_MAX, 1);
+    CHECK(map.size() == 0);
+    CHECK(!map.erase(0));
+    CHECK(!map.contains(0));
+}
+
+static void testConcurrentReaders()
+{
+    ConcurrentHandleMap<uint32_t> map;
+    ConcurrentHandleMap<WideValue> wideMap;
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> failures = 0;
+
+    // Keys 1..1000 are always present, the writer churns other keys so tables get rehashed while readers look them up
+    for (uint64_t key = 1; key <= 1000; key++)
+    {
+        map.insert_or_assign(key * 4096, static_cast<uint32_t>(key * 3));
+        wideMap.insert_or_assign(key * 4096, WideValue{ { key, key * 2, key * 3 }, reinterpret_cast<const void*>(key) });
+    }
+
+    std::vector<std::thread> readers;
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        readers.emplace_back([&, t]() {
+            std::mt19937_64 random(t);
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                const uint64_t key = random() % 1000 + 1;
+
+                uint32_t value = 0;
+                if (!map.find(key * 4096, value) || value != key * 3)
+                {
+                    failures++;
+                }
+
+                // A torn read would mix words of different writes
+                WideValue wide{};
+                if (!wideMap.find(key * 4096, wide) || wide.words[0] != key || wide.words[1] != key * 2 || wide.words[2] != key * 3 || wide.pointer != reinterpret_cast<const void*>(key))
+                {
+                    failures++;
+                }
+
+                const uint64_t churnKey = (random() % 100000 + 2000) * 4096;
+                if (map.find(churnKey, value) && value != static_cast<uint32_t>(churnKey))
+                {
+                    failures++;
+                }
+            }
+            });
+    }
+
+    std::mt19937_64 random(99);
+    for (int i = 0; i < 200000; i++)
+    {
+        const uint64_t churnKey = (random() % 100000 + 2000) * 4096;
+        if (random() & 1)
+        {
+            map.insert_or_assign(churnKey, static_cast<uint32_t>(churnKey));
+        }
+        else
+        {
+            map.erase(churnKey);
+        }
+
+        if (i % 1000 == 0)
+        {
+            wideMap.update_all([](uint64_t, WideValue&) {});
+        }
+    }
+
+    stop = true;
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    CHECK(failures.load() == 0);
+    EpochDomain::Reclaim();
+}
+
+int main()
+{
+    testAgainstReference();
+    testReservedKeys();
+    testConcurrentReaders();
+
+    return 0;
+}
@@ -0,0 +1,398 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "reshade.hpp"
+#include "ConstantCopyGPUReadback.h"
+#include "ToggleGroup.h"
+#include "TestCheck.h"
+
+using namespace reshade::api;
+using namespace Shim::Constants;
+using namespace ShaderToggler;
+
+static constexpr uint64_t BUFFER_SIZE = 256;
+
+/// <summary>
+/// Watches the resource calls of a device and checks the readback buffers against the presents that have passed. A present returns once
+/// the GPU is at most latency frames of that swapchain behind, so a copy has retired once any runtime presented latency times after
+/// it. A buffer mapped or destroyed before that is counted as a stall.
+/// </summary>
+struct ReadbackTracker
+{
+    ReadbackTracker(device& dev, uint32_t latency) : dev(dev), latency(latency)
+    {
+        dev.observer = [this](std::string_view call, uint64_t handle) { observe(call, handle); };
+    }
+
+    ~ReadbackTracker()
+    {
+        dev.observer = nullptr;
+    }
+
+    void observe(std::string_view call, uint64_t handle)
+    {
+        if (call == "create_resource" && dev.get_resource_desc(resource{ handle }).heap == memory_heap::gpu_to_cpu)
+        {
+            readbackBuffers.insert(handle);
+            created++;
+            return;
+        }
+
+        if (!readbackBuffers.contains(handle))
+        {
+            return;
+        }
+
+        const auto copied = lastCopy.find(handle);
+        const bool inFlight = copied != lastCopy.end() && std::none_of(presents.begin(), presents.end(), [&](const auto& runtimePresents) {
+            const auto atCopy = copied->second.find(runtimePresents.first);
+            return runtimePresents.second >= (atCopy != copied->second.end() ? atCopy->second : 0) + latency;
+            });
+
+        if (call == "copy_buffer_region")
+        {
+            lastCopy[handle] = presents;
+            copies.push_back(handle);
+        }
+        else if (call == "map_buffer_region")
+        {
+            // Mapping a buffer nothing was copied into yet is as wrong as mapping one whose copy is in flight
+            stalls += inFlight || copied == lastCopy.end() ? 1 : 0;
+            maps++;
+        }
+        else if (call == "destroy_resource")
+        {
+            stalls += inFlight && !deviceIdle ? 1 : 0;
+            readbackBuffers.erase(handle);
+            destroyed++;
+        }
+    }
+
+    void present(ConstantCopyGPUReadback& copy, effect_runtime* runtime)
+    {
+        copy.OnReshadePresent(runtime);
+        presents[runtime]++;
+    }
+
+    device& dev;
+    const uint32_t latency;
+    bool deviceIdle = false;
+    std::unordered_map<const effect_runtime*, uint64_t> presents;
+    std::unordered_set<uint64_t> readbackBuffers;
+    std::unordered_map<uint64_t, std::unordered_map<const effect_runtime*, uint64_t>> lastCopy;
+    std::vector<uint64_t> copies;
+    uint32_t created = 0;
+    uint32_t destroyed = 0;
+    uint32_t maps = 0;
+    uint32_t stalls = 0;
+};
+
+/// <summary>
+/// A device with a command list, a runtime presenting on it and a constant buffer the game writes a stamp into every frame.
+/// </summary>
+struct ReadbackContext
+{
+    ReadbackContext() : cmd(&dev), queue(&cmd), runtime(&dev, &queue)
+    {
+        dev.create_resource(resource_desc(BUFFER_SIZE, memory_heap::cpu_to_gpu, resource_usage::constant_buffer), nullptr, resource_usage::cpu_access, &constants);
+    }
+
+    void write(uint32_t stamp)
+    {
+        std::vector<uint8_t>& contents = dev.contents(constants);
+        for (size_t offset = 0; offset < contents.size(); offset += sizeof(stamp))
+        {
+            std::memcpy(contents.data() + offset, &stamp, sizeof(stamp));
+        }
+    }
+
+    uint32_t extract(ConstantCopyGPUReadback& copy, ToggleGroup* group, const std::vector<ConstantRange>& ranges = { { 0, BUFFER_SIZE } })
+    {
+        std::vector<uint8_t> dest(BUFFER_SIZE, 0);
+        copy.GetHostConstantBuffer(&cmd, group, dest, BUFFER_SIZE, constants.handle, ranges);
+
+        uint32_t value = 0;
+        std::memcpy(&value, dest.data() + ranges.front().offset, sizeof(value));
+        return value;
+    }
+
+    device dev{ device_api::d3d11 };
+    command_list cmd;
+    command_queue queue;
+    effect_runtime runtime;
+    resource constants = { 0 };
+};
+
+static void testRingRotation(uint32_t latency)
+{
+    ReadbackContext context;
+    ReadbackTracker tracker(context.dev, latency);
+    ConstantCopyGPUReadback copy(latency);
+    ToggleGroup group("Group", 1);
+
+    // One buffer per frame in flight and one for the frame being recorded, used round robin
+    const uint32_t frames = 6 * (latency + 1);
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        context.write(frame + 1);
+        const uint32_t value = context.extract(copy, &group);
+
+        // Values show up latency frames after the game wrote them
+        CHECK(value == (frame >= latency ? frame - latency + 1 : 0));
+
+        tracker.present(copy, &context.runtime);
+    }
+
+    CHECK(tracker.created == latency + 1);
+    CHECK(tracker.copies.size() == frames);
+    CHECK(std::unordered_set<uint64_t>(tracker.copies.begin(), tracker.copies.begin() + latency + 1).size() == latency + 1);
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        CHECK(tracker.copies[i] == tracker.copies[i % (latency + 1)]);
+    }
+    CHECK(tracker.maps == frames - latency);
+    CHECK(tracker.stalls == 0);
+
+    tracker.deviceIdle = true;
+    copy.OnDestroyDevice(&context.dev);
+}
+
+static void testLatencyClamped()
+{
+    for (const auto& [requested, used] : { std::pair{ 1u, ConstantCopyGPUReadback::MIN_LATENCY }, std::pair{ 8u, ConstantCopyGPUReadback::MAX_LATENCY } })
+    {
+        ReadbackContext context;
+        ReadbackTracker tracker(context.dev, used);
+        ConstantCopyGPUReadback copy(requested);
+        ToggleGroup group("Group", 1);
+
+        context.extract(copy, &group);
+        CHECK(tracker.created == used + 1);
+        copy.OnDestroyDevice(&context.dev);
+    }
+}
+
+static void testExtractTwicePerFrame(uint32_t latency)
+{
+    ReadbackContext context;
+    ReadbackTracker tracker(context.dev, latency);
+    ConstantCopyGPUReadback copy(latency);
+    ToggleGroup group("Group", 1);
+
+    // Both extractions of a frame copy into the same buffer, the second one with other ranges. Only the first reads back.
+    for (uint32_t frame = 0; frame < 4 * (latency + 1); frame++)
+    {
+        const uint32_t maps = tracker.maps;
+
+        context.write(frame + 1);
+        const uint32_t first = context.extract(copy, &group, { { 0, 16 } });
+        context.write(frame + 1001);
+        const uint32_t second = context.extract(copy, &group, { { 128, 16 } });
+
+        CHECK(tracker.maps - maps == (frame >= latency ? 1u : 0u));
+        CHECK(tracker.copies.size() == 2 * (frame + 1));
+        CHECK(tracker.copies[2 * frame] == tracker.copies[2 * frame + 1]);
+
+        // The buffer of a frame holds the ranges of its last extraction
+        CHECK(first == 0);
+        CHECK(second == (frame >= latency ? frame - latency + 1001 : 0));
+
+        tracker.present(copy, &context.runtime);
+    }
+
+    CHECK(tracker.created == latency + 1);
+    CHECK(tracker.stalls == 0);
+
+    tracker.deviceIdle = true;
+    copy.OnDestroyDevice(&context.dev);
+}
+
+static void testTwoRuntimes(uint32_t latency)
+{
+    ReadbackContext context;
+    effect_runtime second(&context.dev, &context.queue);
+    ReadbackTracker tracker(context.dev, latency);
+    ConstantCopyGPUReadback copy(latency);
+    ToggleGroup group("Group", 1);
+    uint32_t stamp = 0;
+
+    const auto frame = [&](bool presentFirstTwice, bool presentSecond) {
+        context.write(++stamp);
+        context.extract(copy, &group);
+        tracker.present(copy, &context.runtime);
+        if (presentFirstTwice)
+        {
+            context.extract(copy, &group);
+            tracker.present(copy, &context.runtime);
+        }
+        if (presentSecond)
+        {
+            tracker.present(copy, &second);
+        }
+        };
+
+    // Both swapchains present every frame
+    for (uint32_t i = 0; i < 20; i++)
+    {
+        frame(false, true);
+    }
+
+    // The first one presents twice as often for long enough to be more than the idle frames ahead, the frame still only advances once
+    // the second one presented
+    uint32_t maps = tracker.maps;
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        frame(true, true);
+    }
+    CHECK(tracker.maps - maps > 190 && tracker.maps - maps <= 201);
+    maps = tracker.maps;
+
+    // The second one stops presenting, it holds back the readback until it's considered gone
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        frame(false, false);
+    }
+    CHECK(tracker.maps > maps);
+    CHECK(context.extract(copy, &group) == stamp - latency + 1);
+    CHECK(tracker.stalls == 0);
+
+    tracker.deviceIdle = true;
+    copy.OnDestroyDevice(&context.dev);
+}
+
+static void testRetiredBuffers(uint32_t latency)
+{
+    ReadbackContext context;
+    ReadbackTracker tracker(context.dev, latency);
+    ConstantCopyGPUReadback copy(latency);
+    ToggleGroup first("First", 1);
+    ToggleGroup second("Second", 2);
+
+    for (uint32_t frame = 0; frame < 2 * latency; frame++)
+    {
+        context.write(frame + 1);
+        context.extract(copy, &first);
+        context.extract(copy, &second);
+        tracker.present(copy, &context.runtime);
+    }
+    CHECK(tracker.created == 2 * (latency + 1));
+
+    // A removed group's buffers are destroyed once their last copies retired
+    copy.RemoveGroup(&first, &context.dev);
+    CHECK(tracker.destroyed == 0);
+    for (uint32_t frame = 0; frame <= latency; frame++)
+    {
+        context.extract(copy, &second);
+        tracker.present(copy, &context.runtime);
+    }
+    CHECK(tracker.destroyed == latency + 1);
+
+    // So are the ones of a ring recreated for a buffer of another size
+    resource larger = { 0 };
+    context.dev.create_resource(resource_desc(2 * BUFFER_SIZE, memory_heap::cpu_to_gpu, resource_usage::constant_buffer), nullptr, resource_usage::cpu_access, &larger);
+    std::vector<uint8_t> dest(2 * BUFFER_SIZE);
+    copy.GetHostConstantBuffer(&context.cmd, &second, dest, dest.size(), larger.handle, { { 0, dest.size() } });
+    CHECK(tracker.created == 3 * (latency + 1));
+    for (uint32_t frame = 0; frame <= latency; frame++)
+    {
+        tracker.present(copy, &context.runtime);
+    }
+    CHECK(tracker.destroyed == 2 * (latency + 1));
+    CHECK(tracker.stalls == 0);
+
+    // Destroying the device releases the rest right away, it's idle by then
+    copy.GetHostConstantBuffer(&context.cmd, &second, dest, dest.size(), larger.handle, { { 0, dest.size() } });
+    tracker.deviceIdle = true;
+    copy.OnDestroyDevice(&context.dev);
+    CHECK(tracker.destroyed == tracker.created);
+    CHECK(tracker.readbackBuffers.empty());
+}
+
+static void testDeviceDestroyedWithOtherDevice(uint32_t latency)
+{
+    ReadbackContext first;
+    ReadbackContext second;
+    ReadbackTracker tracker(second.dev, latency);
+    ConstantCopyGPUReadback copy(latency);
+    ToggleGroup group("First", 1);
+    ToggleGroup other("Second", 2);
+
+    first.extract(copy, &group);
+    second.extract(copy, &other);
+
+    // Only the buffers of the destroyed device go
+    copy.OnDestroyDevice(&first.dev);
+    CHECK(first.dev.resources.size() == 1);
+    CHECK(tracker.destroyed == 0 && second.dev.resources.size() == 1 + latency + 1);
+
+    tracker.deviceIdle = true;
+    copy.OnDestroyDevice(&second.dev);
+    CHECK(second.dev.resources.size() == 1);
+}
+
+static void testCreationFailure()
+{
+    ReadbackContext context;
+    ConstantCopyGPUReadback copy(3);
+    ToggleGroup group("Group", 1);
+
+    // Failing buffers leave the destination alone and aren't created again on every extraction
+    context.dev.fail_resource_creation = true;
+    context.write(7);
+    CHECK(context.extract(copy, &group) == 0);
+    context.dev.fail_resource_creation = false;
+    CHECK(context.extract(copy, &group) == 0);
+    CHECK(context.dev.resources.size() == 1);
+}
+
+int main()
+{
+    for (const uint32_t latency : { 3u, 4u })
+    {
+        testRingRotation(latency);
+        testExtractTwicePerFrame(latency);
+        testTwoRuntimes(latency);
+        testRetiredBuffers(latency);
+        testDeviceDestroyedWithOtherDevice(latency);
+    }
+    testLatencyClamped();
+    testCreationFailure();
+
+    return 0;
+}
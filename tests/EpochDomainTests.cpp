@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "EpochDomain.h"
+#include "TestCheck.h"
+
+using namespace ShaderToggler;
+
+static void testRetireWithoutReaders()
+{
+    bool deleted = false;
+    EpochDomain::Retire([&]() { deleted = true; });
+    CHECK(deleted);
+}
+
+static void testRetireWaitsForReaders()
+{
+    std::atomic<int> stage = 0;
+    std::atomic<bool> deleted = false;
+
+    std::thread reader([&]() {
+        EpochDomain::ReadGuard guard;
+        {
+            // Guards nest, leaving the inner one doesn't end the read
+            EpochDomain::ReadGuard inner;
+        }
+        stage = 1;
+        while (stage.load() != 2)
+        {
+            std::this_thread::yield();
+        }
+        });
+
+    while (stage.load() != 1)
+    {
+        std::this_thread::yield();
+    }
+
+    EpochDomain::Retire([&]() { deleted = true; });
+    CHECK(!deleted);
+    EpochDomain::Reclaim();
+    CHECK(!deleted);
+
+    stage = 2;
+    reader.join();
+
+    EpochDomain::Reclaim();
+    CHECK(deleted);
+}
+
+static void testReadersEnteringLaterDontBlock()
+{
+    // A reader which entered after the memory was retired can't have seen it
+    std::atomic<bool> deleted = false;
+    std::atomic<int> stage = 0;
+
+    std::thread reader;
+    {
+        EpochDomain::ReadGuard guard;
+        EpochDomain::Retire([&]() { deleted = true; });
+        CHECK(!deleted);
+
+        reader = std::thread([&]() {
+            EpochDomain::ReadGuard late;
+            stage = 1;
+            while (stage.load() != 2)
+            {
+                std::this_thread::yield();
+            }
+            });
+
+        while (stage.load() != 1)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    EpochDomain::Reclaim();
+    CHECK(deleted);
+
+    stage = 2;
+    reader.join();
+}
+
+static void testPublishAndRetireUnderLoad()
+{
+    struct Node
+    {
+        uint64_t value;
+    };
+
+    std::atomic<Node*> current = new Node{ 0 };
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> failures = 0;
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++)
+    {
+        readers.emplace_back([&]() {
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                EpochDomain::ReadGuard guard;
+                const Node* node = current.load(std::memory_order_acquire);
+                // Reads freed memory (caught by sanitizers) or a poisoned value if reclamation was early
+                if (node->value == UINT64_MAX)
+                {
+                    failures++;
+                }
+            }
+            });
+    }
+
+    for (uint64_t i = 1; i < 20000; i++)
+    {
+        Node* previous = current.exchange(new Node{ i }, std::memory_order_acq_rel);
+        EpochDomain::Retire([previous]() {
+            previous->value = UINT64_MAX;
+            delete previous;
+            });
+    }
+
+    stop = true;
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    EpochDomain::Reclaim();
+    delete current.load();
+
+    CHECK(failures.load() == 0);
+}
+
+int main()
+{
+    testRetireWithoutReaders();
+    testRetireWaitsForReaders();
+    testReadersEnteringLaterDontBlock();
+    testPublishAndRetireUnderLoad();
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <bit>
+#include <iterator>
+#include "GroupMask.h"
+#include "TestCheck.h"
+
+using namespace ShaderToggler;
+
+static void testSetAndReset()
+{
+    GroupMask mask;
+    CHECK(!mask.any());
+
+    mask.set(0);
+    mask.set(63);
+    mask.set(64);
+    mask.set(MAX_TOGGLE_GROUPS - 1);
+    mask.set(MAX_TOGGLE_GROUPS);
+    mask.set(INVALID_GROUP_SLOT);
+    CHECK(mask.any());
+    CHECK(mask.test(0) && mask.test(63) && mask.test(64) && mask.test(MAX_TOGGLE_GROUPS - 1));
+    CHECK(!mask.test(1) && !mask.test(MAX_TOGGLE_GROUPS) && !mask.test(INVALID_GROUP_SLOT));
+    CHECK(std::popcount(mask.bits[0]) + std::popcount(mask.bits[1]) == 4);
+
+    mask.reset(63);
+    mask.reset(INVALID_GROUP_SLOT);
+    CHECK(!mask.test(63) && mask.test(64));
+
+    mask.clear();
+    CHECK(!mask.any());
+}
+
+static void testSetOperations()
+{
+    GroupMask a;
+    GroupMask b;
+    a.set(3);
+    a.set(70);
+    a.set(100);
+    b.set(70);
+    b.set(5);
+
+    const GroupMask both = a & b;
+    GroupMask expected;
+    expected.set(70);
+    CHECK(both == expected);
+
+    a |= b;
+    CHECK(a.test(3) && a.test(5) && a.test(70) && a.test(100));
+}
+
+static void testForEach()
+{
+    GroupMask mask;
+    const uint32_t slots[] = { 0, 1, 62, 63, 64, 65, 126, 127 };
+    for (uint32_t slot : slots)
+    {
+        mask.set(slot);
+    }
+
+    uint32_t visited = 0;
+    mask.forEach([&](uint32_t slot) {
+        CHECK(visited < std::size(slots) && slots[visited] == slot);
+        visited++;
+        });
+    CHECK(visited == std::size(slots));
+}
+
+int main()
+{
+    testSetAndReset();
+    testSetOperations();
+    testForEach();
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Game threads writing constant buffers through the memcpy hooks (ConstantCopyBase::SetHostConstantBuffer) while the render thread
+// extracts the ranges groups read from them (GetHostConstantBuffer), comparing HostBufferMirrors with the single lock it replaced. Not
+// run by ctest; run the executable of a release build directly.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "HostBufferMirrors.h"
+#include "LockedHostBuffers.h"
+#include "Benchmark.h"
+
+using namespace Shim::Constants;
+
+static constexpr uint32_t WRITES = 200000;
+static constexpr uint64_t BUFFERS = 512;
+static constexpr size_t BUFFER_SIZE = 256;
+// Buffers groups extract from, the render thread reads them round robin
+static constexpr uint64_t EXTRACTED = 16;
+
+/// <summary>
+/// Runs writers threads doing WRITES writes each, into their own buffers or all into the first one, while one reader extracts two
+/// ranges from the extracted buffers until the writers are done.
+/// </summary>
+template<typename Buffers>
+static double run(uint32_t writers, bool sharedBuffer)
+{
+    Buffers buffers;
+    std::vector<uint8_t> dest(BUFFER_SIZE);
+    const std::vector<ConstantRange> ranges = { { 0, 64 }, { 128, 64 } };
+    for (uint64_t buffer = 1; buffer <= BUFFERS; buffer++)
+    {
+        buffers.add(buffer * 0x100, BUFFER_SIZE);
+        buffers.read(buffer * 0x100, dest, BUFFER_SIZE, ranges);
+    }
+
+    std::atomic<uint32_t> running = writers;
+    return measure([&]() {
+        std::vector<std::thread> threads;
+        for (uint32_t w = 0; w < writers; w++)
+        {
+            threads.emplace_back([&, w]() {
+                uint8_t data[BUFFER_SIZE] = {};
+                for (uint32_t i = 0; i < WRITES; i++)
+                {
+                    data[0] = static_cast<uint8_t>(i);
+                    const uint64_t buffer = sharedBuffer ? 1 : (w + i * writers) % BUFFERS + 1;
+                    buffers.write(buffer * 0x100, data, sizeof(data), 0);
+                }
+                running--;
+                });
+        }
+
+        threads.emplace_back([&]() {
+            std::vector<uint8_t> snapshot(BUFFER_SIZE);
+            uint64_t sum = 0;
+            for (uint64_t i = 0; running.load(std::memory_order_relaxed) > 0; i++)
+            {
+                buffers.read((i % EXTRACTED + 1) * 0x100, snapshot, BUFFER_SIZE, ranges);
+                sum += snapshot[0];
+            }
+            keep(sum);
+            });
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        });
+}
+
+int main()
+{
+    printf("old: shared_mutex over all host buffers, new: HostBufferMirrors (sharded, seqlock per buffer)\n");
+    printf("%u writes of %zu bytes per writer, 1 reader extracting from %llu buffers\n", WRITES, BUFFER_SIZE, static_cast<unsigned long long>(EXTRACTED));
+
+    for (const uint32_t writers : { 1u, 2u, 4u, 8u })
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%u writers, own buffers", writers);
+        report(name, run<LockedHostBuffers>(writers, false), run<HostBufferMirrors>(writers, false));
+    }
+
+    for (const uint32_t writers : { 2u, 8u })
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "%u writers, one buffer", writers);
+        report(name, run<LockedHostBuffers>(writers, true), run<HostBufferMirrors>(writers, true));
+    }
+
+    return 0;
+}
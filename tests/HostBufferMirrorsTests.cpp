@@ -0,0 +1,206 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "HostBufferMirrors.h"
+#include "LockedHostBuffers.h"
+#include "TestCheck.h"
+
+using namespace Shim::Constants;
+
+static constexpr size_t BUFFER_SIZE = 256;
+
+static void testMirrorOnFirstRead()
+{
+    HostBufferMirrors mirrors;
+    std::vector<uint8_t> dest(BUFFER_SIZE, 0xCD);
+    const std::vector<ConstantRange> all = { { 0, BUFFER_SIZE } };
+
+    CHECK(!mirrors.read(1, dest, BUFFER_SIZE, all));
+
+    // Registered buffers aren't mirrored until a group extracts from them, writes before that are dropped
+    mirrors.add(1, BUFFER_SIZE);
+    CHECK(!mirrors.mirrored(1));
+    const std::vector<uint8_t> ones(BUFFER_SIZE, 1);
+    mirrors.write(1, ones.data(), ones.size(), 0);
+    CHECK(!mirrors.read(1, dest, BUFFER_SIZE, all));
+    CHECK(dest[0] == 0xCD);
+    CHECK(mirrors.mirrored(1));
+    CHECK(mirrors.read(1, dest, BUFFER_SIZE, all));
+    CHECK(dest[0] == 0 && dest[BUFFER_SIZE - 1] == 0);
+
+    // Only the requested ranges are copied, writes are cut off at the end of the buffer
+    const std::vector<uint8_t> twos(64, 2);
+    mirrors.write(1, twos.data(), twos.size(), BUFFER_SIZE - 32);
+    mirrors.write(1, twos.data(), twos.size(), BUFFER_SIZE);
+    mirrors.write(1, ones.data(), 16, 0);
+    std::fill(dest.begin(), dest.end(), 0xCD);
+    CHECK(mirrors.read(1, dest, BUFFER_SIZE, { { 8, 16 }, { BUFFER_SIZE - 16, 64 } }));
+    CHECK(dest[7] == 0xCD && dest[8] == 1 && dest[15] == 1 && dest[16] == 0 && dest[23] == 0 && dest[24] == 0xCD);
+    CHECK(dest[BUFFER_SIZE - 17] == 0xCD && dest[BUFFER_SIZE - 16] == 2 && dest[BUFFER_SIZE - 1] == 2);
+
+    // A smaller size clamps the ranges
+    std::fill(dest.begin(), dest.end(), 0xCD);
+    CHECK(mirrors.read(1, dest, 12, all));
+    CHECK(dest[11] == 1 && dest[12] == 0xCD);
+
+    mirrors.remove(1);
+    CHECK(!mirrors.mirrored(1));
+    CHECK(!mirrors.read(1, dest, BUFFER_SIZE, all));
+}
+
+static void testIdleMirrorsDropped()
+{
+    HostBufferMirrors mirrors;
+    std::vector<uint8_t> dest(BUFFER_SIZE);
+    const std::vector<ConstantRange> all = { { 0, BUFFER_SIZE } };
+
+    for (uint64_t handle = 1; handle <= 64; handle++)
+    {
+        mirrors.add(handle * 0x1000, BUFFER_SIZE);
+        mirrors.read(handle * 0x1000, dest, BUFFER_SIZE, all);
+    }
+
+    // Buffers read every frame keep their mirror, the others lose it once every shard was visited after the idle frames
+    for (uint64_t frame = 0; frame < HostBufferMirrors::MIRROR_IDLE_FRAMES + 128; frame++)
+    {
+        CHECK(mirrors.read(0x1000, dest, BUFFER_SIZE, all));
+        mirrors.advance_frame();
+    }
+
+    CHECK(mirrors.mirrored(0x1000));
+    for (uint64_t handle = 2; handle <= 64; handle++)
+    {
+        CHECK(!mirrors.mirrored(handle * 0x1000));
+    }
+}
+
+/// <summary>
+/// Writers fill whole buffers with one stamp per write while readers extract two ranges of them, and another thread registers and
+/// removes buffers and advances frames. Every word a read returns has to carry the same stamp, otherwise it saw parts of two writes.
+/// </summary>
+template<typename Buffers>
+static void testTornReads(uint32_t writers)
+{
+    static constexpr uint64_t BUFFERS = 4;
+    // Large enough for a copy to be preempted halfway on a single core
+    static constexpr size_t SIZE = 64 * 1024;
+    static constexpr size_t WORDS = SIZE / sizeof(uint32_t);
+    static constexpr uint32_t WRITES = 2000;
+    // Writers keep going until the readers saw this many snapshots, on few cores they'd otherwise finish before the readers run
+    static constexpr uint64_t MIN_READS = 500;
+    const std::vector<ConstantRange> ranges = { { 0, 4096 }, { SIZE / 2, SIZE / 2 } };
+
+    Buffers buffers;
+    std::vector<uint8_t> dest(SIZE);
+    for (uint64_t buffer = 1; buffer <= BUFFERS; buffer++)
+    {
+        buffers.add(buffer, SIZE);
+        buffers.read(buffer, dest, SIZE, ranges);
+    }
+
+    std::atomic<uint32_t> running = writers;
+    std::atomic<uint64_t> reads = 0;
+    std::atomic<uint64_t> tornReads = 0;
+    std::vector<std::thread> threads;
+
+    for (uint32_t w = 0; w < writers; w++)
+    {
+        threads.emplace_back([&, w]() {
+            std::vector<uint32_t> stamp(WORDS);
+            for (uint32_t i = 1; i <= WRITES || reads.load() < MIN_READS; i++)
+            {
+                std::fill(stamp.begin(), stamp.end(), (w << 24) | i);
+                buffers.write(w % BUFFERS + 1, stamp.data(), SIZE, 0);
+            }
+            running--;
+            });
+    }
+
+    for (uint32_t r = 0; r < 2; r++)
+    {
+        threads.emplace_back([&, r]() {
+            std::vector<uint8_t> snapshot(SIZE);
+            for (uint64_t i = r; running.load() > 0; i++)
+            {
+                if (!buffers.read(i % BUFFERS + 1, snapshot, SIZE, ranges))
+                {
+                    continue;
+                }
+
+                const uint32_t* words = reinterpret_cast<const uint32_t*>(snapshot.data());
+                const auto sameStamp = [words](uint32_t word) { return word == words[0]; };
+                const bool consistent = std::all_of(words + 1, words + 4096 / sizeof(uint32_t), sameStamp)
+                    && std::all_of(words + WORDS / 2, words + WORDS, sameStamp);
+                tornReads += consistent ? 0 : 1;
+                reads++;
+            }
+            });
+    }
+
+    threads.emplace_back([&]() {
+        for (uint64_t i = 0; running.load() > 0; i++)
+        {
+            buffers.add(0x100 + i % 256, SIZE);
+            buffers.remove(0x100 + (i + 128) % 256);
+            buffers.advance_frame();
+            std::this_thread::yield();
+        }
+        });
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK(reads.load() >= MIN_READS);
+    CHECK(tornReads.load() == 0);
+}
+
+int main()
+{
+    testMirrorOnFirstRead();
+    testIdleMirrorsDropped();
+
+    // The single lock of the old mirrors serializes all writes, the seqlock has to give readers the same consistency
+    for (const uint32_t writers : { 1u, 2u, 4u, 8u })
+    {
+        testTornReads<LockedHostBuffers>(writers);
+        testTornReads<HostBufferMirrors>(writers);
+    }
+
+    return 0;
+}
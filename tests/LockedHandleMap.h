@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <shared_mutex>
+
+// The shared_mutex guarded robin_map ShaderManager kept its pipeline handles in before ConcurrentHandleMap, for the benchmarks to compare
+// against. robin_map comes from deps/robin-map; without that submodule checked out, std::unordered_map stands in for it.
+
+#if __has_include(<tsl/robin_map.h>)
+#include <tsl/robin_map.h>
+using BaselineMap = tsl::robin_map<uint64_t, uint32_t>;
+static constexpr const char* BASELINE_NAME = "shared_mutex + tsl::robin_map";
+#else
+#include <unordered_map>
+using BaselineMap = std::unordered_map<uint64_t, uint32_t>;
+static constexpr const char* BASELINE_NAME = "shared_mutex + std::unordered_map (robin-map not checked out)";
+#endif
+
+/// <summary>
+/// The handle to shader hash map of ShaderManager before it became lock-free.
+/// </summary>
+class LockedHandleMap
+{
+public:
+    bool find(uint64_t key, uint32_t& value) const
+    {
+        std::shared_lock lock(_mutex);
+        const auto& it = _map.find(key);
+        if (it == _map.end())
+        {
+            return false;
+        }
+
+        value = it->second;
+        return true;
+    }
+
+    void insert_or_assign(uint64_t key, uint32_t value)
+    {
+        std::unique_lock lock(_mutex);
+        _map[key] = value;
+    }
+
+    void erase(uint64_t key)
+    {
+        std::unique_lock lock(_mutex);
+        _map.erase(key);
+    }
+
+private:
+    mutable std::shared_mutex _mutex;
+    BaselineMap _map;
+};
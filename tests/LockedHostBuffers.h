@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include "HostBufferMirrors.h"
+
+/// <summary>
+/// The host constant buffers of ConstantCopyBase before HostBufferMirrors: one map behind one shared_mutex, every write takes it exclusively.
+/// Has the interface of HostBufferMirrors so the stress test and the benchmark run the same code against both.
+/// </summary>
+class LockedHostBuffers
+{
+public:
+    void add(uint64_t handle, uint64_t size)
+    {
+        std::unique_lock lock(_mutex);
+        _buffers.insert_or_assign(handle, std::vector<uint8_t>(static_cast<size_t>(size), 0));
+    }
+
+    void remove(uint64_t handle)
+    {
+        std::unique_lock lock(_mutex);
+        _buffers.erase(handle);
+    }
+
+    bool read(uint64_t handle, std::vector<uint8_t>& dest, size_t size, const std::vector<Shim::Constants::ConstantRange>& ranges)
+    {
+        std::shared_lock lock(_mutex);
+        const auto& it = _buffers.find(handle);
+        if (it == _buffers.end())
+        {
+            return false;
+        }
+
+        size = std::min(size, it->second.size());
+        for (const auto& range : ranges)
+        {
+            if (range.offset < size)
+            {
+                std::memcpy(dest.data() + range.offset, it->second.data() + range.offset, std::min(range.size, size - range.offset));
+            }
+        }
+        return true;
+    }
+
+    void write(uint64_t handle, const void* data, size_t size, uintptr_t offset)
+    {
+        std::unique_lock lock(_mutex);
+        const auto& it = _buffers.find(handle);
+        if (it != _buffers.end() && offset < it->second.size())
+        {
+            std::memcpy(it->second.data() + offset, data, std::min(size, it->second.size() - offset));
+        }
+    }
+
+    void advance_frame()
+    {
+    }
+
+private:
+    std::shared_mutex _mutex;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> _buffers;
+};
@@ -0,0 +1,227 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Calls the body of the nested memcpy detour (ConstantCopyMemcpyNested::OnMemcpy) with 0 to 500 mapped constant buffers, comparing the
+// MappedRangeIndex with the shared lock and linear scan over all mappings it replaced. Writing into the host mirror is left out, the
+// benchmark only counts the hits. Not run by ctest; run the executable of a release build directly.
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "MappedRangeIndex.h"
+#include "Benchmark.h"
+#include "TestCheck.h"
+
+using namespace Shim::Constants;
+
+/// <summary>
+/// The mappings of ConstantCopyMemcpyNested before the index, scanned under a shared lock for every memcpy.
+/// </summary>
+class LinearMappings
+{
+public:
+    void insert(const BufferCopy& buffer)
+    {
+        std::unique_lock lock(_mutex);
+        _mappings[buffer.resource] = buffer;
+    }
+
+    void erase(uint64_t resource)
+    {
+        std::unique_lock lock(_mutex);
+        _mappings.erase(resource);
+    }
+
+    template<typename F>
+    bool find(uintptr_t address, F&& func) const
+    {
+        std::shared_lock lock(_mutex);
+        for (const auto& [_, buffer] : _mappings)
+        {
+            const uintptr_t begin = reinterpret_cast<uintptr_t>(buffer.destination);
+            if (address >= begin && address < begin + buffer.bufferSize - buffer.offset)
+            {
+                func(buffer, address - begin);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    mutable std::shared_mutex _mutex;
+    std::unordered_map<uint64_t, BufferCopy> _mappings;
+};
+
+static constexpr size_t COPIES = 2000000;
+// Upload heaps of the driver, where mapped buffers live, next to the heap and stacks of the game
+static constexpr uintptr_t UPLOAD_BASE = 0x7FF600000000;
+static constexpr uintptr_t BUFFER_STRIDE = 0x10000;
+static constexpr uint32_t UPLOAD_BUFFERS = 4096;
+
+struct Scenario
+{
+    std::vector<BufferCopy> mapped;
+    std::vector<uintptr_t> destinations;
+};
+
+/// <summary>
+/// Maps count of the upload buffers and generates memcpy destinations: 1% into a mapped constant buffer, 9% into other upload buffers
+/// (vertex data, unmapped constant buffers) and the rest spread over the game's heap.
+/// </summary>
+static Scenario makeScenario(uint32_t count, std::mt19937_64& random)
+{
+    Scenario scenario;
+    std::vector<uint32_t> slots(UPLOAD_BUFFERS);
+    for (uint32_t i = 0; i < UPLOAD_BUFFERS; i++)
+    {
+        slots[i] = i;
+    }
+    std::shuffle(slots.begin(), slots.end(), random);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint64_t size = 256ull << (random() % 7);		// 256 bytes to 16 KB
+        scenario.mapped.push_back(BufferCopy{ i + 1, reinterpret_cast<void*>(UPLOAD_BASE + slots[i] * BUFFER_STRIDE), 0, size, size });
+    }
+
+    scenario.destinations.resize(COPIES);
+    for (auto& destination : scenario.destinations)
+    {
+        const uint64_t kind = random() % 100;
+        if (kind == 0 && count > 0)
+        {
+            const BufferCopy& buffer = scenario.mapped[random() % count];
+            destination = reinterpret_cast<uintptr_t>(buffer.destination) + random() % buffer.bufferSize;
+        }
+        else if (kind < 10)
+        {
+            destination = UPLOAD_BASE + slots[count + random() % (UPLOAD_BUFFERS - count)] * BUFFER_STRIDE + random() % BUFFER_STRIDE;
+        }
+        else
+        {
+            destination = 0x10000000 + random() % 0x400000000;
+        }
+    }
+
+    return scenario;
+}
+
+template<typename Index>
+static uint64_t copyAll(const Index& index, const std::vector<uintptr_t>& destinations, size_t first, size_t step)
+{
+    uint64_t hits = 0;
+    for (size_t i = first; i < destinations.size(); i += step)
+    {
+        index.find(destinations[i], [&hits](const BufferCopy& buffer, uintptr_t offset) { hits += buffer.resource + offset; });
+    }
+    return hits;
+}
+
+int main()
+{
+    printf("old: shared_mutex + linear scan of the mappings, new: MappedRangeIndex\n");
+    printf("%zu memcpys per scenario, 1%% into mapped constant buffers\n", COPIES);
+
+    std::mt19937_64 random(1);
+    for (const uint32_t count : { 0u, 1u, 10u, 100u, 500u })
+    {
+        const Scenario scenario = makeScenario(count, random);
+        LinearMappings linear;
+        MappedRangeIndex index;
+        for (const BufferCopy& buffer : scenario.mapped)
+        {
+            linear.insert(buffer);
+            index.insert(buffer);
+        }
+
+        uint64_t linearHits = 0;
+        uint64_t indexHits = 0;
+        const double old = measure([&]() { linearHits = copyAll(linear, scenario.destinations, 0, 1); });
+        const double indexed = measure([&]() { indexHits = copyAll(index, scenario.destinations, 0, 1); });
+        CHECK(linearHits == indexHits);
+
+        char name[64];
+        snprintf(name, sizeof(name), "%u mapped buffers", count);
+        report(name, old, indexed);
+    }
+
+    // Game threads copying while the render thread maps and unmaps buffers every few hundred copies
+    const uint32_t threads = 4;
+    const Scenario scenario = makeScenario(500, random);
+    const auto concurrent = [&](auto& mappings) {
+        for (const BufferCopy& buffer : scenario.mapped)
+        {
+            mappings.insert(buffer);
+        }
+
+        std::atomic<bool> stop = false;
+        std::thread mapper([&]() {
+            for (size_t i = 0; !stop.load(std::memory_order_relaxed); i++)
+            {
+                const BufferCopy& buffer = scenario.mapped[i % scenario.mapped.size()];
+                mappings.erase(buffer.resource);
+                mappings.insert(buffer);
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+            });
+
+        std::vector<std::thread> copiers;
+        std::atomic<uint64_t> hits = 0;
+        for (uint32_t t = 0; t < threads; t++)
+        {
+            copiers.emplace_back([&, t]() { hits += copyAll(mappings, scenario.destinations, t, threads); });
+        }
+        for (auto& copier : copiers)
+        {
+            copier.join();
+        }
+
+        stop = true;
+        mapper.join();
+        keep(hits.load());
+        };
+
+    LinearMappings linear;
+    MappedRangeIndex index;
+    report("500 mapped, 4 threads, remapping",
+        measure([&]() { concurrent(linear); }),
+        measure([&]() { concurrent(index); }));
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <vector>
+#include "MappedRangeIndex.h"
+#include "TestCheck.h"
+
+using namespace Shim::Constants;
+
+static void* address(uintptr_t value)
+{
+    return reinterpret_cast<void*>(value);
+}
+
+static uint64_t resourceAt(const MappedRangeIndex& index, uintptr_t value, uintptr_t* offset = nullptr)
+{
+    uint64_t resource = 0;
+    index.find(value, [&](const BufferCopy& buffer, uintptr_t bufferOffset) {
+        resource = buffer.resource;
+        if (offset != nullptr)
+        {
+            *offset = bufferOffset;
+        }
+        });
+    return resource;
+}
+
+static void testFind()
+{
+    MappedRangeIndex index;
+    CHECK(resourceAt(index, 0x1000) == 0);
+
+    // Mapped memory covers the buffer from the mapped offset on
+    index.insert(BufferCopy{ 1, address(0x1000), 0, 256, 256 });
+    index.insert(BufferCopy{ 2, address(0x3000), 64, 64, 256 });
+    index.insert(BufferCopy{ 3, address(0x2000), 0, 16, 512 });
+
+    uintptr_t offset = 0;
+    CHECK(resourceAt(index, 0x1000) == 1);
+    CHECK(resourceAt(index, 0x10FF, &offset) == 1 && offset == 0xFF);
+    CHECK(resourceAt(index, 0x1100) == 0);
+    CHECK(resourceAt(index, 0x21FF) == 3);
+    CHECK(resourceAt(index, 0x3000 + 191, &offset) == 2 && offset == 191);
+    CHECK(resourceAt(index, 0x3000 + 192) == 0);
+    CHECK(resourceAt(index, 0xFFF) == 0);
+    CHECK(resourceAt(index, 0x2800) == 0);
+
+    CHECK(index.erase(3));
+    CHECK(!index.erase(3));
+    CHECK(resourceAt(index, 0x2000) == 0);
+    CHECK(index.size() == 2);
+
+    CHECK(index.erase(1) && index.erase(2));
+    CHECK(resourceAt(index, 0x3000) == 0);
+}
+
+static void testRemap()
+{
+    MappedRangeIndex index;
+
+    // Mapping a resource again moves it
+    index.insert(BufferCopy{ 1, address(0x1000), 0, 256, 256 });
+    index.insert(BufferCopy{ 1, address(0x8000), 0, 256, 256 });
+    CHECK(resourceAt(index, 0x1000) == 0);
+    CHECK(resourceAt(index, 0x8000) == 1);
+    CHECK(index.size() == 1);
+
+    // A buffer mapped over memory of buffers that weren't unmapped replaces them
+    index.insert(BufferCopy{ 2, address(0x7F80), 0, 256, 256 });
+    index.insert(BufferCopy{ 3, address(0x8080), 0, 256, 256 });
+    CHECK(index.size() == 2);
+    CHECK(resourceAt(index, 0x7F80) == 2);
+    CHECK(resourceAt(index, 0x8100) == 3);
+    CHECK(!index.erase(1));
+}
+
+static void testAgainstLinearScan()
+{
+    MappedRangeIndex index;
+    std::vector<BufferCopy> reference;
+    uint64_t seed = 1;
+    const auto random = [&seed]() { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return seed >> 33; };
+
+    for (int iteration = 0; iteration < 20000; iteration++)
+    {
+        // Buffers sit in 4 KB slots, so the reference doesn't need to handle overlaps
+        const uint64_t resource = random() % 64 + 1;
+        if (random() % 3 == 0)
+        {
+            index.erase(resource);
+            std::erase_if(reference, [resource](const BufferCopy& b) { return b.resource == resource; });
+        }
+        else
+        {
+            const BufferCopy buffer = { resource, address(0x100000 + resource * 0x1000), random() % 4 * 16, 64, 256 + random() % 3840 };
+            index.insert(buffer);
+            std::erase_if(reference, [resource](const BufferCopy& b) { return b.resource == resource; });
+            reference.push_back(buffer);
+        }
+
+        for (int probe = 0; probe < 16; probe++)
+        {
+            const uintptr_t value = 0x100000 + random() % (66 * 0x1000);
+            uint64_t expected = 0;
+            for (const BufferCopy& b : reference)
+            {
+                const uintptr_t begin = reinterpret_cast<uintptr_t>(b.destination);
+                if (value >= begin && value < begin + b.bufferSize - b.offset)
+                {
+                    expected = b.resource;
+                }
+            }
+            CHECK(resourceAt(index, value) == expected);
+        }
+    }
+}
+
+int main()
+{
+    testFind();
+    testRemap();
+    testAgainstLinearScan();
+
+    return 0;
+}
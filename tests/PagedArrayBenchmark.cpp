@@ -0,0 +1,288 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Compares PagedArray with the concurrent_vector it replaced as the storage of descriptor heaps, on heaps of 1M+ descriptors.
+// concurrent_vector is part of PPL and only builds on Windows, so SegmentedVector below reproduces how it stores elements: segments
+// doubling in size, allocated under a lock by grow_to_at_least and addressed through a segment table. The baseline loops are the ones
+// the descriptor tracking used with it. Not run by ctest; run the executable of a release build directly.
+
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "DescriptorTracking.h"
+#include "PagedArray.h"
+#include "Benchmark.h"
+
+using namespace ShaderToggler;
+using namespace reshade::api;
+using descriptor_data = descriptor_tracking::descriptor_data;
+
+template<typename T>
+class SegmentedVector
+{
+public:
+    ~SegmentedVector()
+    {
+        for (auto& segment : _segments)
+        {
+            delete[] segment.load(std::memory_order_relaxed);
+        }
+    }
+
+    size_t size() const { return _size.load(std::memory_order_acquire); }
+
+    void grow_to_at_least(size_t count)
+    {
+        std::lock_guard lock(_mutex);
+        for (size_t segment = 0; segmentBase(segment) < count; segment++)
+        {
+            if (_segments[segment].load(std::memory_order_relaxed) == nullptr)
+            {
+                _segments[segment].store(new T[segmentSize(segment)](), std::memory_order_release);
+            }
+        }
+        if (count > _size.load(std::memory_order_relaxed))
+        {
+            _size.store(count, std::memory_order_release);
+        }
+    }
+
+    T& operator[](size_t index)
+    {
+        const size_t segment = segmentOf(index);
+        return _segments[segment].load(std::memory_order_acquire)[index - segmentBase(segment)];
+    }
+
+    const T& operator[](size_t index) const
+    {
+        return const_cast<SegmentedVector*>(this)->operator[](index);
+    }
+
+private:
+    static constexpr size_t FIRST_SEGMENT_SIZE = 8;
+
+    static size_t segmentOf(size_t index) { return std::bit_width(index / FIRST_SEGMENT_SIZE + 1) - 1; }
+    static size_t segmentBase(size_t segment) { return ((size_t(1) << segment) - 1) * FIRST_SEGMENT_SIZE; }
+    static size_t segmentSize(size_t segment) { return FIRST_SEGMENT_SIZE << segment; }
+
+    std::atomic<T*> _segments[48] = {};
+    std::atomic<size_t> _size = 0;
+    std::mutex _mutex;
+};
+
+static constexpr size_t HEAP_SIZE = 1u << 20;		// 1M descriptors, the size of a D3D12 shader visible heap
+static constexpr uint32_t TABLE_SIZE = 64;
+
+/// <summary>
+/// Writes descriptor tables of TABLE_SIZE entries the way on_update_descriptor_tables does, filling the heap.
+/// </summary>
+static void updateBaseline(SegmentedVector<descriptor_data>& heap, size_t first, size_t last)
+{
+    for (size_t offset = first; offset < last; offset += TABLE_SIZE)
+    {
+        if (offset + TABLE_SIZE > heap.size())
+        {
+            heap.grow_to_at_least(offset + TABLE_SIZE);
+        }
+
+        for (uint32_t k = 0; k < TABLE_SIZE; ++k)
+        {
+            descriptor_data& descriptor = heap[offset + k];
+            descriptor.type = descriptor_type::shader_resource_view;
+            descriptor.view = resource_view{ offset + k + 1 };
+        }
+    }
+}
+
+static void updatePaged(PagedArray<descriptor_data>& heap, size_t first, size_t last)
+{
+    for (size_t offset = first; offset < last; offset += TABLE_SIZE)
+    {
+        for (uint32_t k = 0; k < TABLE_SIZE;)
+        {
+            size_t available = 0;
+            descriptor_data* descriptors = heap.acquire_span(offset + k, TABLE_SIZE - k, available);
+            for (size_t i = 0; i < available; i++, k++)
+            {
+                descriptors[i].type = descriptor_type::shader_resource_view;
+                descriptors[i].view = resource_view{ offset + k + 1 };
+            }
+        }
+    }
+}
+
+static void copyBaseline(SegmentedVector<descriptor_data>& dst, const SegmentedVector<descriptor_data>& src, size_t src_offset, size_t dst_offset, uint32_t count)
+{
+    if (dst_offset + count > dst.size())
+    {
+        dst.grow_to_at_least(dst_offset + count);
+    }
+
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        dst[dst_offset + k] = src[src_offset + k];
+    }
+}
+
+static uint64_t readBaseline(const SegmentedVector<descriptor_data>& heap, size_t offset, descriptor_data* dest)
+{
+    uint64_t sum = 0;
+    for (uint32_t k = 0; k < TABLE_SIZE; ++k)
+    {
+        dest[k] = heap[offset + k];
+        sum += dest[k].view.handle;
+    }
+    return sum;
+}
+
+static uint64_t readPaged(const PagedArray<descriptor_data>& heap, size_t offset, descriptor_data* dest)
+{
+    heap.read(offset, TABLE_SIZE, dest);
+    uint64_t sum = 0;
+    for (uint32_t k = 0; k < TABLE_SIZE; ++k)
+    {
+        sum += dest[k].view.handle;
+    }
+    return sum;
+}
+
+int main()
+{
+    const size_t copies = HEAP_SIZE / 8;
+    const size_t reads = HEAP_SIZE * 4 / TABLE_SIZE;
+    const unsigned threads = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+    uint64_t checksum = 0;
+
+    printf("old: concurrent_vector, new: PagedArray\n");
+    printf("%zu descriptors of %zu bytes, tables of %u, %u threads\n", HEAP_SIZE, sizeof(descriptor_data), TABLE_SIZE, threads);
+
+    // Offsets of copies and reads are the same for both containers
+    std::mt19937_64 random(1);
+    std::vector<std::pair<size_t, size_t>> copyOffsets(copies);
+    for (auto& offsets : copyOffsets)
+    {
+        offsets = { random() % (HEAP_SIZE - TABLE_SIZE), random() % (HEAP_SIZE - TABLE_SIZE) };
+    }
+    std::vector<size_t> readOffsets(reads);
+    for (auto& offset : readOffsets)
+    {
+        offset = random() % (HEAP_SIZE - TABLE_SIZE);
+    }
+
+    SegmentedVector<descriptor_data> baselineHeap;
+    SegmentedVector<descriptor_data> baselineStaging;
+    PagedArray<descriptor_data> pagedHeap;
+    PagedArray<descriptor_data> pagedStaging;
+
+    report("fill 1M descriptors by table",
+        measure([&]() { updateBaseline(baselineStaging, 0, HEAP_SIZE); }),
+        measure([&]() { updatePaged(pagedStaging, 0, HEAP_SIZE); }));
+
+    report("copy staging tables to the heap",
+        measure([&]() {
+            for (const auto& [src, dst] : copyOffsets)
+            {
+                copyBaseline(baselineHeap, baselineStaging, src, dst, TABLE_SIZE);
+            }
+            }),
+        measure([&]() {
+            for (const auto& [src, dst] : copyOffsets)
+            {
+                pagedHeap.copy(pagedStaging, src, dst, TABLE_SIZE);
+            }
+            }));
+
+    std::vector<descriptor_data> tables(TABLE_SIZE);
+    report("read bound tables",
+        measure([&]() {
+            for (const size_t offset : readOffsets)
+            {
+                checksum += readBaseline(baselineStaging, offset, tables.data());
+            }
+            }),
+        measure([&]() {
+            for (const size_t offset : readOffsets)
+            {
+                checksum += readPaged(pagedStaging, offset, tables.data());
+            }
+            }));
+
+    // Render threads updating their own part of a fresh heap while others read tables of the staging heap, as with deferred contexts
+    const auto concurrent = [&](auto&& update, auto&& read) {
+        std::vector<std::thread> workers;
+        std::atomic<uint64_t> sum = 0;
+        for (unsigned t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&, t]() {
+                if (t % 2 == 0)
+                {
+                    const size_t part = HEAP_SIZE / ((threads + 1) / 2);
+                    update(t / 2 * part, t / 2 * part + part);
+                }
+                else
+                {
+                    std::vector<descriptor_data> dest(TABLE_SIZE);
+                    uint64_t local = 0;
+                    for (size_t i = t; i < reads; i += threads)
+                    {
+                        local += read(readOffsets[i], dest.data());
+                    }
+                    sum += local;
+                }
+                });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        checksum += sum;
+        };
+
+    SegmentedVector<descriptor_data> baselineShared;
+    PagedArray<descriptor_data> pagedShared;
+    report("concurrent updates and reads",
+        measure([&]() {
+            concurrent([&](size_t first, size_t last) { updateBaseline(baselineShared, first, last); },
+                [&](size_t offset, descriptor_data* dest) { return readBaseline(baselineStaging, offset, dest); });
+            }),
+        measure([&]() {
+            concurrent([&](size_t first, size_t last) { updatePaged(pagedShared, first, last); },
+                [&](size_t offset, descriptor_data* dest) { return readPaged(pagedStaging, offset, dest); });
+            }));
+
+    printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+    return 0;
+}
@@ -0,0 +1,309 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include "PagedArray.h"
+#include "TestCheck.h"
+
+using namespace ShaderToggler;
+
+static void testAcquireAndFind()
+{
+    PagedArray<uint32_t> array;
+    CHECK(array.find(0) == nullptr);
+    CHECK(array.page_count() == 0);
+
+    *array.acquire(5) = 42;
+    *array.acquire(PagedArray<uint32_t>::PAGE_SIZE * 3 + 1) = 7;
+    CHECK(array.page_count() == 2);
+    CHECK(*array.find(5) == 42);
+    CHECK(*array.find(6) == 0);
+    CHECK(*array.find(PagedArray<uint32_t>::PAGE_SIZE * 3 + 1) == 7);
+    CHECK(array.find(PagedArray<uint32_t>::PAGE_SIZE) == nullptr);
+
+    // Element addresses stay stable
+    CHECK(array.acquire(5) == array.find(5));
+
+    CHECK(array.acquire(PagedArray<uint32_t>::MAX_SIZE) == nullptr);
+    CHECK(array.find(PagedArray<uint32_t>::MAX_SIZE) == nullptr);
+}
+
+static void testAcquireSpan()
+{
+    PagedArray<uint32_t> array;
+    const size_t pageSize = PagedArray<uint32_t>::PAGE_SIZE;
+
+    size_t available = 0;
+    uint32_t* span = array.acquire_span(pageSize - 3, 10, available);
+    CHECK(span != nullptr && available == 3);
+    CHECK(array.acquire_span(pageSize, 10, available) != nullptr && available == 10);
+}
+
+static void testRead()
+{
+    PagedArray<uint32_t> array;
+    const size_t pageSize = PagedArray<uint32_t>::PAGE_SIZE;
+
+    for (size_t i = pageSize - 10; i < pageSize + 10; i++)
+    {
+        *array.acquire(i) = static_cast<uint32_t>(i);
+    }
+
+    std::vector<uint32_t> values(pageSize * 3, 1);
+    array.read(0, values.size(), values.data());
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        CHECK(values[i] == (i >= pageSize - 10 && i < pageSize + 10 ? i : 0));
+    }
+}
+
+static void testUnwrittenPagesReadAsZero()
+{
+    struct Element
+    {
+        uint64_t a;
+        uint32_t b;
+    };
+
+    PagedArray<Element> array;
+    const size_t pageSize = PagedArray<Element>::PAGE_SIZE;
+
+    // Spans an allocated page between two that were never written, and a chunk of the directory that doesn't exist yet
+    array.acquire(pageSize * 2 + 7)->a = 1;
+    std::vector<Element> values(pageSize * 5, Element{ 0xCD, 0xCD });
+    array.read(pageSize, values.size(), values.data());
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        CHECK(values[i].a == (i == pageSize + 7 ? 1 : 0) && values[i].b == 0);
+    }
+
+    const size_t farAway = PagedArray<Element>::PAGE_SIZE * PagedArray<Element>::CHUNK_SIZE * 3;
+    array.read(farAway, 4, values.data());
+    CHECK(values[0].a == 0 && values[3].a == 0);
+    CHECK(array.page_count() == 1);
+}
+
+static void testCopyUnwritten()
+{
+    PagedArray<uint32_t> array;
+    const size_t pageSize = PagedArray<uint32_t>::PAGE_SIZE;
+
+    // Copying unwritten elements over unwritten ones doesn't allocate anything
+    array.copy(array, pageSize * 10, pageSize * 20, pageSize * 2);
+    CHECK(array.page_count() == 0);
+
+    // Copying unwritten elements over written ones clears them
+    for (size_t i = 0; i < pageSize * 2; i++)
+    {
+        *array.acquire(i) = 5;
+    }
+    array.copy(array, pageSize * 10 + 3, 5, pageSize);
+    std::vector<uint32_t> values(pageSize * 2);
+    array.read(0, values.size(), values.data());
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        CHECK(values[i] == (i >= 5 && i < pageSize + 5 ? 0 : 5));
+    }
+}
+
+/// <summary>
+/// Compares copies within a single array against memmove on a flat reference, with sources and destinations placed around page
+/// boundaries so forward, backward and overlapping copies are all split into several runs.
+/// </summary>
+static void testCopyWithinArray()
+{
+    const size_t pageSize = PagedArray<uint32_t>::PAGE_SIZE;
+    const size_t size = pageSize * 6;
+    std::mt19937 random(1);
+
+    const auto nearBoundary = [&](size_t limit) {
+        const size_t boundary = (random() % (size / pageSize)) * pageSize;
+        const size_t position = boundary + random() % 7 - 3;
+        return std::min(position, limit);
+        };
+
+    for (int iteration = 0; iteration < 3000; iteration++)
+    {
+        PagedArray<uint32_t> array;
+        std::vector<uint32_t> reference(size, 0);
+
+        // Leave some pages unwritten so copies mix written and empty runs
+        for (int i = 0; i < 200; i++)
+        {
+            const size_t index = random() % size;
+            if (index / pageSize != 3)
+            {
+                *array.acquire(index) = static_cast<uint32_t>(index + 1);
+                reference[index] = static_cast<uint32_t>(index + 1);
+            }
+        }
+
+        const size_t count = random() % 4 == 0 ? random() % 16 : random() % (pageSize * 3);
+        size_t source = nearBoundary(size - count);
+        size_t dest = 0;
+
+        switch (iteration % 4)
+        {
+        case 0:		// forward overlapping, destination behind source within the range
+            dest = std::min(source + random() % (count + 1), size - count);
+            break;
+        case 1:		// backward overlapping
+            dest = source >= count ? source - random() % (count + 1) : source - random() % (source + 1);
+            break;
+        case 2:		// identical ranges
+            dest = source;
+            break;
+        default:	// anywhere
+            dest = nearBoundary(size - count);
+            break;
+        }
+
+        array.copy(array, source, dest, count);
+        memmove(reference.data() + dest, reference.data() + source, count * sizeof(uint32_t));
+
+        std::vector<uint32_t> values(size);
+        array.read(0, size, values.data());
+        CHECK(values == reference);
+    }
+}
+
+static void testCopyBetweenArrays()
+{
+    const size_t pageSize = PagedArray<uint32_t>::PAGE_SIZE;
+    PagedArray<uint32_t> source;
+    PagedArray<uint32_t> dest;
+
+    for (size_t i = 0; i < pageSize * 3; i++)
+    {
+        *source.acquire(i) = static_cast<uint32_t>(i);
+    }
+
+    dest.copy(source, 10, pageSize - 1, pageSize * 2);
+    std::vector<uint32_t> values(pageSize * 4);
+    dest.read(0, values.size(), values.data());
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        CHECK(values[i] == (i >= pageSize - 1 && i < pageSize * 3 - 1 ? i - (pageSize - 1) + 10 : 0));
+    }
+}
+
+/// <summary>
+/// Writers race to allocate the same pages while readers look elements up. A reader may find an element not yet written, but never a
+/// partially constructed page or a value that wasn't written to that index, and losers of an allocation race must not discard writes.
+/// </summary>
+static void testConcurrentPublication()
+{
+    struct Element
+    {
+        uint64_t index;
+        uint64_t check;
+    };
+
+    const size_t count = PagedArray<Element>::PAGE_SIZE * 512;
+    PagedArray<Element> array;
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> failures = 0;
+
+    std::vector<std::thread> readers;
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        readers.emplace_back([&, t]() {
+            std::mt19937_64 random(t);
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                const size_t index = random() % count;
+                const Element* element = array.find(index);
+                if (element != nullptr)
+                {
+                    // The page must be visible fully zeroed, and a published index must come with its payload
+                    const uint64_t published = reinterpret_cast<const std::atomic<uint64_t>*>(&element->index)->load(std::memory_order_acquire);
+                    if (published != 0 && (published != index + 1 || element->check != ~published))
+                    {
+                        failures++;
+                    }
+                }
+            }
+            });
+    }
+
+    // Every writer covers every page, interleaved with the others, so each page is raced for
+    std::vector<std::thread> writers;
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        writers.emplace_back([&, t]() {
+            for (size_t index = t; index < count; index += 4)
+            {
+                Element* element = array.acquire(index);
+                element->check = ~(index + 1);
+                reinterpret_cast<std::atomic<uint64_t>*>(&element->index)->store(index + 1, std::memory_order_release);
+            }
+            });
+    }
+
+    for (auto& writer : writers)
+    {
+        writer.join();
+    }
+
+    stop = true;
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    CHECK(failures.load() == 0);
+    CHECK(array.page_count() == count / PagedArray<Element>::PAGE_SIZE);
+    for (size_t index = 0; index < count; index++)
+    {
+        const Element* element = array.find(index);
+        CHECK(element != nullptr && element->index == index + 1 && element->check == ~(index + 1));
+    }
+}
+
+int main()
+{
+    testAcquireAndFind();
+    testAcquireSpan();
+    testRead();
+    testUnwrittenPagesReadAsZero();
+    testCopyUnwritten();
+    testCopyWithinArray();
+    testCopyBetweenArrays();
+    testConcurrentPublication();
+
+    return 0;
+}
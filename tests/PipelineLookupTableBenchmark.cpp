@@ -0,0 +1,234 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Compares the per bind cost of resolving a pipeline through the PipelineLookupTable with the lookups onBindPipeline did before it: one
+// safeGetShaderHash per shader stage on the locked handle maps of the three ShaderManagers, then GetToggleGroupsFor*ShaderHash on the
+// hash to toggle group maps for every stage with a shader. Not run by ctest; run the executable of a release build directly.
+
+#include <atomic>
+#include <bit>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "PipelineLookupTable.h"
+#include "LockedHandleMap.h"
+#include "Benchmark.h"
+#include "TestCheck.h"
+
+namespace ShaderToggler
+{
+    class ToggleGroup;
+}
+
+using namespace ShaderToggler;
+
+static constexpr uint32_t GRAPHICS_PIPELINES = 20000;
+static constexpr uint32_t COMPUTE_PIPELINES = 4000;
+static constexpr size_t BINDS = 4000000;
+
+/// <summary>
+/// The state onBindPipeline read before the lookup table: the handle to hash maps of the pixel, vertex and compute ShaderManager and the
+/// hash to toggle group lists of AddonUIData.
+/// </summary>
+struct BaselineLookups
+{
+    LockedHandleMap shaderManagers[STAGE_INDEX_COUNT];
+    std::unordered_map<uint32_t, std::vector<ToggleGroup*>> hashToToggleGroups[STAGE_INDEX_COUNT];
+
+    const std::vector<ToggleGroup*>* getToggleGroups(uint32_t stage, uint32_t hash) const
+    {
+        const auto& it = hashToToggleGroups[stage].find(hash);
+        return it != hashToToggleGroups[stage].end() ? &it->second : nullptr;
+    }
+};
+
+struct Pipeline
+{
+    uint64_t handle;
+    bool compute;
+};
+
+static uint64_t bindBaseline(const BaselineLookups& lookups, const Pipeline& pipeline)
+{
+    uint64_t result = 0;
+    uint32_t hashes[STAGE_INDEX_COUNT] = { 0, 0, 0 };
+
+    // Graphics pipelines are bound with the pixel and vertex stage, compute ones with the compute stage
+    for (uint32_t stage = 0; stage < STAGE_INDEX_COUNT; stage++)
+    {
+        if ((stage == STAGE_INDEX_COMPUTE) == pipeline.compute)
+        {
+            lookups.shaderManagers[stage].find(pipeline.handle, hashes[stage]);
+        }
+    }
+
+    for (uint32_t stage = 0; stage < STAGE_INDEX_COUNT; stage++)
+    {
+        if (hashes[stage] != 0)
+        {
+            const std::vector<ToggleGroup*>* groups = lookups.getToggleGroups(stage, hashes[stage]);
+            result += hashes[stage] + (groups != nullptr ? groups->size() : 0);
+        }
+    }
+
+    return result;
+}
+
+static uint64_t bindLookupTable(PipelineLookupTable& table, const Pipeline& pipeline)
+{
+    PipelineStageData data;
+    if (!table.safeGetStageData(pipeline.handle, data))
+    {
+        return 0;
+    }
+
+    uint64_t result = 0;
+    for (uint32_t stage = 0; stage < STAGE_INDEX_COUNT; stage++)
+    {
+        if (data.shaderHash[stage] != 0)
+        {
+            result += data.shaderHash[stage] + std::popcount(data.toggleGroups[stage].bits[0]) + std::popcount(data.toggleGroups[stage].bits[1]);
+        }
+    }
+
+    return result;
+}
+
+int main()
+{
+    printf("old: 3x safeGetShaderHash (%s) + GetToggleGroupsFor*ShaderHash, new: PipelineLookupTable\n", BASELINE_NAME);
+    printf("%u graphics and %u compute pipelines, %zu binds per stream\n", GRAPHICS_PIPELINES, COMPUTE_PIPELINES, BINDS);
+
+    std::mt19937_64 random(1);
+    BaselineLookups baseline;
+    PipelineLookupTable table;
+    std::vector<Pipeline> pipelines;
+
+    // One shader hash per stage and pipeline, 1% of them belong to a toggle group
+    for (uint32_t i = 0; i < GRAPHICS_PIPELINES + COMPUTE_PIPELINES; i++)
+    {
+        const Pipeline pipeline = { 0x10000 + i * 0x40ull, i >= GRAPHICS_PIPELINES };
+        pipelines.push_back(pipeline);
+
+        for (uint32_t stage = 0; stage < STAGE_INDEX_COUNT; stage++)
+        {
+            if ((stage == STAGE_INDEX_COMPUTE) != pipeline.compute)
+            {
+                continue;
+            }
+
+            const uint32_t hash = static_cast<uint32_t>(random()) | 1;
+            GroupMask groups;
+            if (random() % 100 == 0)
+            {
+                groups.set(static_cast<uint32_t>(random() % 8));
+                baseline.hashToToggleGroups[stage][hash].push_back(nullptr);
+            }
+
+            baseline.shaderManagers[stage].insert_or_assign(pipeline.handle, hash);
+            table.addHashHandlePair(stage, hash, pipeline.handle, groups);
+        }
+    }
+
+    // Frames bind a few hundred hot pipelines over and over, loading screens and streaming go through all of them
+    std::vector<Pipeline> hotStream(BINDS);
+    std::vector<Pipeline> uniformStream(BINDS);
+    for (size_t i = 0; i < BINDS; i++)
+    {
+        hotStream[i] = pipelines[random() % 256 * (pipelines.size() / 256)];
+        uniformStream[i] = pipelines[random() % pipelines.size()];
+    }
+
+    uint64_t baselineSum = 0;
+    uint64_t tableSum = 0;
+    for (const auto& [name, stream] : { std::make_pair("hot set of 256 pipelines", &hotStream), std::make_pair("all pipelines", &uniformStream) })
+    {
+        const double old = measure([&]() {
+            for (const Pipeline& pipeline : *stream)
+            {
+                baselineSum += bindBaseline(baseline, pipeline);
+            }
+            });
+        const double lookupTable = measure([&]() {
+            for (const Pipeline& pipeline : *stream)
+            {
+                tableSum += bindLookupTable(table, pipeline);
+            }
+            });
+
+        char scenario[64];
+        snprintf(scenario, sizeof(scenario), "%s (%.1f vs %.1f ns/bind)", name, old * 1e6 / BINDS, lookupTable * 1e6 / BINDS);
+        report(scenario, old, lookupTable);
+    }
+
+    // Command lists recorded on several threads at once, the locked maps have every bind touch the same shared_mutex
+    for (const uint32_t threads : { 2u, 4u })
+    {
+        const auto parallel = [&](auto&& bind) {
+            std::vector<std::thread> workers;
+            std::atomic<uint64_t> sum = 0;
+            for (uint32_t t = 0; t < threads; t++)
+            {
+                workers.emplace_back([&, t]() {
+                    uint64_t local = 0;
+                    for (size_t i = t; i < BINDS; i += threads)
+                    {
+                        local += bind(hotStream[i]);
+                    }
+                    sum += local;
+                    });
+            }
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+            return sum.load();
+            };
+
+        uint64_t parallelBaseline = 0;
+        uint64_t parallelTable = 0;
+        const double old = measure([&]() { parallelBaseline = parallel([&](const Pipeline& p) { return bindBaseline(baseline, p); }); });
+        const double lookupTable = measure([&]() { parallelTable = parallel([&](const Pipeline& p) { return bindLookupTable(table, p); }); });
+        CHECK(parallelBaseline == parallelTable);
+
+        char scenario[64];
+        snprintf(scenario, sizeof(scenario), "hot set, %u recording threads", threads);
+        report(scenario, old, lookupTable);
+    }
+
+    // Both resolve the same hashes and the same number of groups
+    CHECK(baselineSum == tableSum);
+
+    return 0;
+}
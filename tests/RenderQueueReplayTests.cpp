@@ -0,0 +1,324 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include "CountingAllocator.h"
+#include "PipelinePrivateData.h"
+#include "TestCheck.h"
+
+using namespace ShaderToggler;
+using namespace reshade::api;
+
+// Replays the queue traffic of a frame, as RenderingQueueManager, RenderingManager::QueueOrDequeue, RenderingEffectManager and
+// RenderingBindingManager generate it, over the flat effect and binding queues and over the node based maps they replaced, and counts
+// the allocations every frame makes.
+
+static constexpr uint32_t GROUPS = 16;
+static constexpr uint32_t TECHNIQUES = 64;
+static constexpr uint32_t COMMAND_LISTS = 4;
+static constexpr uint32_t EVENTS_PER_COMMAND_LIST = 2000;
+static constexpr uint32_t WARMUP_FRAMES = 10;
+static constexpr uint32_t FRAMES = 200;
+
+// Invocation locations of RenderingManager.h: CALL_DRAW, CALL_BIND_PIPELINE, CALL_BIND_RENDER_TARGET
+static constexpr uint64_t LOCATIONS[] = { 0, 1, 2 };
+
+enum class EventType : uint8_t
+{
+    BindPipeline,		// a group's shader got bound, it queues its binding and techniques
+    Draw,				// queued entries pick up the render target, ones without one are dequeued, scheduled ones get rendered
+    ClearLocation,		// the pipeline changed, entries waiting for a location are dropped
+};
+
+struct Event
+{
+    EventType type;
+    uint8_t stage;
+    uint8_t location;
+    uint8_t group;
+    uint8_t techniques;		// number of techniques the group queues
+    bool resolves;			// a render target is bound at the draw
+};
+
+struct OldShaderData
+{
+    std::unordered_map<ToggleGroup*, ResourceRenderData> bindingsToUpdate;
+    std::unordered_map<EffectData*, ResourceRenderData> techniquesToRender;
+};
+
+struct Scene
+{
+    Scene()
+    {
+        groups.reserve(GROUPS);
+        for (uint32_t i = 0; i < GROUPS; i++)
+        {
+            groups.emplace_back("Group", i);
+            groups.back().setSlot(i);
+        }
+
+        for (uint32_t i = 0; i < TECHNIQUES; i++)
+        {
+            techniques[i].index = i;
+        }
+
+        // One frame of events per command list, the same every frame like a game rendering the same scene
+        std::mt19937 random(1);
+        frame.resize(COMMAND_LISTS);
+        for (auto& events : frame)
+        {
+            for (uint32_t i = 0; i < EVENTS_PER_COMMAND_LIST; i++)
+            {
+                const uint32_t r = random() % 10;
+                events.push_back(Event{
+                    r < 4 ? EventType::BindPipeline : r < 9 ? EventType::Draw : EventType::ClearLocation,
+                    static_cast<uint8_t>(random() % 3),
+                    static_cast<uint8_t>(LOCATIONS[random() % std::size(LOCATIONS)]),
+                    static_cast<uint8_t>(random() % GROUPS),
+                    static_cast<uint8_t>(1 + random() % 4),
+                    random() % 4 != 0 });
+            }
+        }
+    }
+
+    EffectData* technique(uint32_t group, uint32_t i)
+    {
+        return &techniques[(group * 5 + i) % TECHNIQUES];
+    }
+
+    std::vector<ToggleGroup> groups;
+    EffectData techniques[TECHNIQUES];
+    std::vector<std::vector<Event>> frame;
+};
+
+static void drawPass(effect_queue& queue, bool resolves, uint64_t callLocation)
+{
+    for (size_t i = 0; i < queue.size();)
+    {
+        auto& entry = queue[i];
+        entry.scheduled = false;
+
+        if (!callLocation && entry.data.resource == 0)
+        {
+            if (!resolves)
+            {
+                queue.erase_at(i);
+                continue;
+            }
+            entry.data.resource = resource{ 1 };
+        }
+
+        entry.scheduled = entry.data.resource != 0 && (!callLocation && !entry.data.invocationLocation || callLocation & entry.data.invocationLocation);
+        i++;
+    }
+
+    // Rendered techniques leave the queue
+    queue.erase_if([](const effect_queue::entry& entry) { return entry.scheduled; });
+}
+
+static void drawPass(binding_queue& queue, bool resolves, uint64_t callLocation)
+{
+    for (size_t i = 0; i < queue.size();)
+    {
+        auto& entry = queue[i];
+        entry.scheduled = false;
+
+        if (!callLocation && entry.data.resource == 0)
+        {
+            if (!resolves)
+            {
+                queue.erase_at(i);
+                continue;
+            }
+            entry.data.resource = resource{ 1 };
+        }
+
+        entry.scheduled = entry.data.resource != 0 && (!callLocation && !entry.data.invocationLocation || callLocation & entry.data.invocationLocation);
+
+        // Updated bindings leave the queue
+        if (entry.scheduled)
+        {
+            queue.erase_at(i);
+            continue;
+        }
+        i++;
+    }
+}
+
+template<typename Map>
+static void drawPass(Map& queue, bool resolves, uint64_t callLocation)
+{
+    std::vector<typename Map::key_type> removalList;
+
+    for (auto it = queue.begin(); it != queue.end();)
+    {
+        ResourceRenderData& data = it->second;
+
+        if (!callLocation && data.resource == 0)
+        {
+            if (!resolves)
+            {
+                it = queue.erase(it);
+                continue;
+            }
+            data.resource = resource{ 1 };
+        }
+
+        if (data.resource != 0 && (!callLocation && !data.invocationLocation || callLocation & data.invocationLocation))
+        {
+            removalList.push_back(it->first);
+        }
+        it++;
+    }
+
+    for (const auto& key : removalList)
+    {
+        queue.erase(key);
+    }
+}
+
+static void clearLocation(effect_queue& queue, uint64_t location)
+{
+    queue.erase_if([location](const effect_queue::entry& entry) { return entry.data.invocationLocation == location; });
+}
+
+static void clearLocation(binding_queue& queue, uint64_t location)
+{
+    queue.erase_if([location](const binding_queue::entry& entry) { return entry.data.invocationLocation == location; });
+}
+
+template<typename Map>
+static void clearLocation(Map& queue, uint64_t location)
+{
+    for (auto it = queue.begin(); it != queue.end();)
+    {
+        if (it->second.invocationLocation == location)
+        {
+            it = queue.erase(it);
+            continue;
+        }
+        it++;
+    }
+}
+
+/// <summary>
+/// Plays one frame of scene over the command lists and returns the allocations it made.
+/// </summary>
+template<typename Stages>
+static uint64_t replayFrame(Scene& scene, std::vector<Stages>& commandLists)
+{
+    const uint64_t before = allocations();
+
+    for (uint32_t list = 0; list < COMMAND_LISTS; list++)
+    {
+        for (const Event& event : scene.frame[list])
+        {
+            auto& stage = commandLists[list][event.stage];
+            ToggleGroup* group = &scene.groups[event.group];
+
+            switch (event.type)
+            {
+            case EventType::BindPipeline:
+                stage.bindingsToUpdate.emplace(group, ResourceRenderData{ group, event.location, resource{ 0 }, format::unknown });
+                for (uint32_t i = 0; i < event.techniques; i++)
+                {
+                    stage.techniquesToRender.emplace(scene.technique(event.group, i), ResourceRenderData{ group, event.location, resource{ 0 }, format::unknown });
+                }
+                break;
+            case EventType::Draw:
+                drawPass(stage.bindingsToUpdate, event.resolves, 0);
+                drawPass(stage.techniquesToRender, event.resolves, 0);
+                break;
+            case EventType::ClearLocation:
+                clearLocation(stage.bindingsToUpdate, event.location);
+                clearLocation(stage.techniquesToRender, event.location);
+                break;
+            }
+        }
+
+        // The command list gets reset for its next frame
+        for (auto& stage : commandLists[list])
+        {
+            stage.bindingsToUpdate.clear();
+            stage.techniquesToRender.clear();
+        }
+    }
+
+    return allocations() - before;
+}
+
+template<typename Stages>
+static uint64_t steadyStateAllocations(std::vector<Stages>& commandLists)
+{
+    Scene scene;
+
+    for (uint32_t frame = 0; frame < WARMUP_FRAMES; frame++)
+    {
+        replayFrame(scene, commandLists);
+    }
+
+    uint64_t total = 0;
+    for (uint32_t frame = 0; frame < FRAMES; frame++)
+    {
+        total += replayFrame(scene, commandLists);
+    }
+    return total / FRAMES;
+}
+
+static void testNoAllocationsAfterWarmup()
+{
+    std::vector<std::array<ShaderData, 3>> commandLists;
+    for (uint32_t i = 0; i < COMMAND_LISTS; i++)
+    {
+        commandLists.push_back({ ShaderData{ 0 }, ShaderData{ 1 }, ShaderData{ 2 } });
+    }
+
+    std::vector<std::array<OldShaderData, 3>> oldCommandLists(COMMAND_LISTS);
+
+    const uint64_t flat = steadyStateAllocations(commandLists);
+    const uint64_t nodeBased = steadyStateAllocations(oldCommandLists);
+    std::printf("allocations per frame: old %llu, new %llu\n", static_cast<unsigned long long>(nodeBased), static_cast<unsigned long long>(flat));
+
+    CHECK(nodeBased > 0);
+    CHECK(flat == 0);
+}
+
+int main()
+{
+    testNoAllocationsAfterWarmup();
+
+    return 0;
+}
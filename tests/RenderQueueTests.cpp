@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <set>
+#include <random>
+#include "RenderQueue.h"
+#include "TestCheck.h"
+
+struct QueueKey
+{
+    uint32_t index;
+};
+
+static uint32_t indexOf(const QueueKey* key)
+{
+    return key->index;
+}
+
+using TestQueue = render_queue<QueueKey, int, indexOf>;
+
+static void testAgainstReference()
+{
+    QueueKey keys[50];
+    for (uint32_t i = 0; i < std::size(keys); i++)
+    {
+        keys[i].index = i;
+    }
+
+    TestQueue queue;
+    std::set<int> reference;
+    std::mt19937 random(1);
+
+    for (int iteration = 0; iteration < 200000; iteration++)
+    {
+        const int key = static_cast<int>(random() % std::size(keys));
+
+        switch (random() % 4)
+        {
+        case 0:
+            CHECK(queue.emplace(&keys[key], key) == reference.insert(key).second);
+            break;
+        case 1:
+            CHECK(queue.erase(&keys[key]) == (reference.erase(key) > 0));
+            break;
+        case 2:
+        {
+            const int remainder = static_cast<int>(random() % 5);
+            queue.erase_if([remainder](const TestQueue::entry& e) { return e.data % 5 == remainder; });
+            std::erase_if(reference, [remainder](int value) { return value % 5 == remainder; });
+            break;
+        }
+        default:
+            if (random() % 50 == 0)
+            {
+                queue.clear();
+                reference.clear();
+            }
+            break;
+        }
+
+        CHECK(queue.size() == reference.size());
+        for (uint32_t i = 0; i < std::size(keys); i++)
+        {
+            CHECK(queue.contains(&keys[i]) == reference.contains(static_cast<int>(i)));
+        }
+        for (auto& e : queue)
+        {
+            CHECK(queue.find(e.key) == &e && e.data == static_cast<int>(e.key->index));
+        }
+    }
+}
+
+static void testStaleKeySharingAnIndex()
+{
+    // A key of a previous technique set with the same index as a queued one isn't considered queued
+    QueueKey current{ 3 };
+    QueueKey stale{ 3 };
+
+    TestQueue queue;
+    CHECK(queue.emplace(&current, 1));
+    CHECK(!queue.contains(&stale));
+    CHECK(queue.find(&stale) == nullptr);
+    CHECK(!queue.erase(&stale));
+    CHECK(queue.size() == 1);
+}
+
+int main()
+{
+    testAgainstReference();
+    testStaleKeySharingAnIndex();
+
+    return 0;
+}
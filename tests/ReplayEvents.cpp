@@ -0,0 +1,962 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Replays a frame's bind, draw and present events through the managers Main.cpp wires to ReShade's events, on the mock device, and
+// prints per event latency histograms, allocations per frame and lock acquisitions per frame. The callbacks below mirror the hot path
+// ones of Main.cpp without the UI, hotkeys and event trace; keep them in sync. Not run by ctest; run the executable of a release build.
+//
+// Locks are counted by wrapping the pthread lock functions at link time (see CMakeLists.txt), which covers std::mutex and
+// std::shared_mutex, so this only builds with linkers supporting --wrap.
+
+#include <pthread.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "reshade.hpp"
+#include "crc32_hash.hpp"
+#include "ShaderManager.h"
+#include "PipelineLookupTable.h"
+#include "ToggleGroup.h"
+#include "AddonUIData.h"
+#include "ConstantHandlerBase.h"
+#include "ConstantCopyGPUReadback.h"
+#include "PipelinePrivateData.h"
+#include "ResourceManager.h"
+#include "ToggleGroupResourceManager.h"
+#include "RenderingManager.h"
+#include "RenderingShaderManager.h"
+#include "RenderingQueueManager.h"
+#include "RenderingEffectManager.h"
+#include "RenderingBindingManager.h"
+#include "RenderingPreviewManager.h"
+#include "TechniqueManager.h"
+#include "StateTracking.h"
+#include "PrivateDataCache.h"
+#include "KeyMonitor.h"
+#include "CountingAllocator.h"
+#include "TestCheck.h"
+
+using namespace reshade;
+using namespace reshade::api;
+using namespace ShaderToggler;
+using namespace Shim::Constants;
+
+static std::atomic<uint64_t> mutexLocks = 0;
+static std::atomic<uint64_t> sharedLocks = 0;
+static std::atomic<uint64_t> exclusiveLocks = 0;
+
+extern "C"
+{
+    int __real_pthread_mutex_lock(pthread_mutex_t* mutex);
+    int __real_pthread_mutex_trylock(pthread_mutex_t* mutex);
+    int __real_pthread_rwlock_rdlock(pthread_rwlock_t* lock);
+    int __real_pthread_rwlock_tryrdlock(pthread_rwlock_t* lock);
+    int __real_pthread_rwlock_wrlock(pthread_rwlock_t* lock);
+    int __real_pthread_rwlock_trywrlock(pthread_rwlock_t* lock);
+
+    int __wrap_pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        mutexLocks.fetch_add(1, std::memory_order_relaxed);
+        return __real_pthread_mutex_lock(mutex);
+    }
+
+    int __wrap_pthread_mutex_trylock(pthread_mutex_t* mutex)
+    {
+        const int result = __real_pthread_mutex_trylock(mutex);
+        mutexLocks.fetch_add(result == 0 ? 1 : 0, std::memory_order_relaxed);
+        return result;
+    }
+
+    int __wrap_pthread_rwlock_rdlock(pthread_rwlock_t* lock)
+    {
+        sharedLocks.fetch_add(1, std::memory_order_relaxed);
+        return __real_pthread_rwlock_rdlock(lock);
+    }
+
+    int __wrap_pthread_rwlock_tryrdlock(pthread_rwlock_t* lock)
+    {
+        const int result = __real_pthread_rwlock_tryrdlock(lock);
+        sharedLocks.fetch_add(result == 0 ? 1 : 0, std::memory_order_relaxed);
+        return result;
+    }
+
+    int __wrap_pthread_rwlock_wrlock(pthread_rwlock_t* lock)
+    {
+        exclusiveLocks.fetch_add(1, std::memory_order_relaxed);
+        return __real_pthread_rwlock_wrlock(lock);
+    }
+
+    int __wrap_pthread_rwlock_trywrlock(pthread_rwlock_t* lock)
+    {
+        const int result = __real_pthread_rwlock_trywrlock(lock);
+        exclusiveLocks.fetch_add(result == 0 ? 1 : 0, std::memory_order_relaxed);
+        return result;
+    }
+}
+
+// The addon's state, set up like the globals of Main.cpp
+static ShaderManager g_pixelShaderManager;
+static ShaderManager g_vertexShaderManager;
+static ShaderManager g_computeShaderManager;
+static PipelineLookupTable g_pipelineLookupTable;
+
+static ConstantHandlerBase* constantHandler = nullptr;
+static ConstantCopyBase* constantCopy = nullptr;
+
+static std::atomic_uint32_t g_activeCollectorFrameCounter = 0;
+static AddonImGui::AddonUIData g_addonUIData(&g_pixelShaderManager, &g_vertexShaderManager, &g_computeShaderManager, &g_pipelineLookupTable, constantHandler, &g_activeCollectorFrameCounter);
+
+static KeyMonitor keyMonitor;
+static Rendering::ResourceManager resourceManager;
+static Rendering::ToggleGroupResourceManager groupResourceManager;
+static Rendering::RenderingShaderManager renderingShaderManager(g_addonUIData, resourceManager);
+static Rendering::RenderingEffectManager renderingEffectManager(g_addonUIData, resourceManager, renderingShaderManager, groupResourceManager);
+static Rendering::RenderingBindingManager renderingBindingManager(g_addonUIData, resourceManager, groupResourceManager);
+static Rendering::RenderingPreviewManager renderingPreviewManager(g_addonUIData, resourceManager, renderingShaderManager);
+static Rendering::RenderingQueueManager renderingQueueManager(g_addonUIData, resourceManager);
+static TechniqueManager techniqueManager(keyMonitor);
+
+static void onInitDevice(device* device)
+{
+    device->create_private_data<DeviceDataContainer>();
+}
+
+static void onDestroyDevice(device* device)
+{
+    groupResourceManager.DisposeGroupBuffers(device, g_addonUIData.GetToggleGroups());
+    renderingBindingManager.DisposeTextureBindings(device, g_addonUIData.GetToggleGroups());
+    resourceManager.OnDestroyDevice(device);
+    renderingShaderManager.DestroyShaders(device);
+
+    if (constantCopy != nullptr)
+        constantCopy->OnDestroyDevice(device);
+
+    PrivateDataCache::Invalidate();
+    device->destroy_private_data<DeviceDataContainer>();
+}
+
+static void onInitCommandList(command_list* commandList)
+{
+    commandList->create_private_data<CommandListDataContainer>();
+}
+
+static void onDestroyCommandList(command_list* commandList)
+{
+    PrivateDataCache::Invalidate();
+    commandList->destroy_private_data<CommandListDataContainer>();
+}
+
+static void onResetCommandList(command_list* commandList)
+{
+    CommandListDataContainer& commandListData = PrivateDataCache::Get<CommandListDataContainer>(commandList);
+    commandListData.Reset();
+}
+
+static void onInitEffectRuntime(effect_runtime* runtime)
+{
+    runtime->create_private_data<RuntimeDataContainer>();
+    DeviceDataContainer& data = runtime->get_device()->get_private_data<DeviceDataContainer>();
+
+    keyMonitor.Init(runtime);
+    renderingShaderManager.InitShaders(runtime->get_device());
+    data.current_runtime = runtime;
+    renderingBindingManager.InitTextureBingings(runtime);
+
+    if (constantHandler != nullptr)
+    {
+        constantHandler->ReloadConstantVariables(runtime);
+    }
+}
+
+static void onDestroyEffectRuntime(effect_runtime* runtime)
+{
+    DeviceDataContainer& data = runtime->get_device()->get_private_data<DeviceDataContainer>();
+
+    renderingBindingManager.DisposeTextureBindings(runtime->get_device(), g_addonUIData.GetToggleGroups());
+
+    if (runtime == data.current_runtime)
+    {
+        data.current_runtime = nullptr;
+
+        if (constantHandler != nullptr)
+        {
+            constantHandler->ClearConstantVariables();
+        }
+    }
+
+    runtime->destroy_private_data<RuntimeDataContainer>();
+}
+
+static void onReshadeReloadedEffects(effect_runtime* runtime)
+{
+    RuntimeDataContainer& runtimeData = runtime->get_private_data<RuntimeDataContainer>();
+    DeviceDataContainer& deviceData = runtime->get_device()->get_private_data<DeviceDataContainer>();
+
+    techniqueManager.OnReshadeReloadedEffects(runtime);
+
+    if (deviceData.current_runtime == runtime)
+    {
+        std::shared_lock<std::shared_mutex> techLock(runtimeData.technique_mutex);
+        g_addonUIData.AssignPreferredGroupTechniques(runtimeData.allTechniques);
+    }
+}
+
+static void onInitPipeline(device* device, pipeline_layout, uint32_t subobjectCount, const pipeline_subobject* subobjects, pipeline pipelineHandle)
+{
+    for (uint32_t i = 0; i < subobjectCount; ++i)
+    {
+        const shader_desc* desc = static_cast<const shader_desc*>(subobjects[i].data);
+        const uint32_t hash = compute_crc32(static_cast<const uint8_t*>(desc->code), desc->code_size);
+
+        switch (subobjects[i].type)
+        {
+        case pipeline_subobject_type::vertex_shader:
+            g_vertexShaderManager.addHashHandlePair(hash, pipelineHandle.handle);
+            g_pipelineLookupTable.addHashHandlePair(STAGE_INDEX_VERTEX, hash, pipelineHandle.handle, g_addonUIData.GetToggleGroupsForVertexShaderHash(hash));
+            break;
+        case pipeline_subobject_type::pixel_shader:
+            g_pixelShaderManager.addHashHandlePair(hash, pipelineHandle.handle);
+            g_pipelineLookupTable.addHashHandlePair(STAGE_INDEX_PIXEL, hash, pipelineHandle.handle, g_addonUIData.GetToggleGroupsForPixelShaderHash(hash));
+            break;
+        case pipeline_subobject_type::compute_shader:
+            g_computeShaderManager.addHashHandlePair(hash, pipelineHandle.handle);
+            g_pipelineLookupTable.addHashHandlePair(STAGE_INDEX_COMPUTE, hash, pipelineHandle.handle, g_addonUIData.GetToggleGroupsForComputeShaderHash(hash));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static inline bool isPipelineBound(const CommandListDataContainer& commandListData, pipeline_stage stages, uint64_t pipelineHandle)
+{
+    return (!(uint32_t)(stages & pipeline_stage::pixel_shader) || commandListData.ps.boundPipeline == pipelineHandle) &&
+        (!(uint32_t)(stages & pipeline_stage::vertex_shader) || commandListData.vs.boundPipeline == pipelineHandle) &&
+        (!(uint32_t)(stages & pipeline_stage::compute_shader) || commandListData.cs.boundPipeline == pipelineHandle);
+}
+
+/// <summary>
+/// Main.cpp's onBindPipeline, the per stage updates are folded into one loop over the stages.
+/// </summary>
+static void onBindPipeline(command_list* commandList, pipeline_stage stages, pipeline pipelineHandle)
+{
+    if (nullptr == commandList || pipelineHandle.handle == 0 || !((uint32_t)(stages & pipeline_stage::pixel_shader) || (uint32_t)(stages & pipeline_stage::vertex_shader) || (uint32_t)(stages & pipeline_stage::compute_shader)))
+    {
+        return;
+    }
+
+    CommandListDataContainer& commandListData = PrivateDataCache::Get<CommandListDataContainer>(commandList);
+    const uint32_t pipelineGeneration = g_pipelineLookupTable.generation();
+
+    if (commandListData.pipelineGeneration != pipelineGeneration)
+    {
+        commandListData.ps.boundPipeline = 0;
+        commandListData.vs.boundPipeline = 0;
+        commandListData.cs.boundPipeline = 0;
+        commandListData.pipelineGeneration = pipelineGeneration;
+    }
+    else if (g_activeCollectorFrameCounter == 0 && isPipelineBound(commandListData, stages, pipelineHandle.handle))
+    {
+        return;
+    }
+
+    PipelineStageData stageData;
+    if (!g_pipelineLookupTable.safeGetStageData(pipelineHandle.handle, stageData))
+    {
+        return;
+    }
+
+    struct Stage
+    {
+        pipeline_stage stage;
+        uint32_t index;
+        ShaderData& data;
+        uint32_t changed;
+    };
+    const Stage stageList[] = {
+        { pipeline_stage::pixel_shader, STAGE_INDEX_PIXEL, commandListData.ps, Rendering::MATCH_EFFECT_PS | Rendering::MATCH_BINDING_PS | Rendering::MATCH_PREVIEW_PS | Rendering::MATCH_CONST_PS },
+        { pipeline_stage::vertex_shader, STAGE_INDEX_VERTEX, commandListData.vs, Rendering::MATCH_EFFECT_VS | Rendering::MATCH_BINDING_VS | Rendering::MATCH_PREVIEW_VS | Rendering::MATCH_CONST_VS },
+        { pipeline_stage::compute_shader, STAGE_INDEX_COMPUTE, commandListData.cs, Rendering::MATCH_EFFECT_CS | Rendering::MATCH_BINDING_CS | Rendering::MATCH_PREVIEW_CS | Rendering::MATCH_CONST_CS },
+    };
+
+    bool attached = false;
+    for (const Stage& stage : stageList)
+    {
+        attached |= (uint32_t)(stages & stage.stage) && stageData.shaderHash[stage.index] != 0;
+    }
+
+    if (!attached)
+    {
+        return;
+    }
+
+    DeviceDataContainer& deviceData = commandList->get_device()->get_private_data<DeviceDataContainer>();
+
+    if (deviceData.current_runtime == nullptr || !deviceData.current_runtime->get_effects_state())
+    {
+        return;
+    }
+
+    uint32_t pipelineChanged = 0;
+
+    for (const Stage& stage : stageList)
+    {
+        if (!(uint32_t)(stages & stage.stage))
+        {
+            continue;
+        }
+
+        stage.data.boundPipeline = pipelineHandle.handle;
+
+        const uint32_t hash = stageData.shaderHash[stage.index];
+        if (hash == 0)
+        {
+            continue;
+        }
+
+        if (stage.data.activeShaderHash != hash)
+        {
+            pipelineChanged |= stage.changed;
+            stage.data.constantBuffersToUpdate.clear();
+        }
+
+        stage.data.blockedShaderGroups = stageData.toggleGroups[stage.index];
+        stage.data.activeShaderHash = hash;
+    }
+
+    if (pipelineChanged > 0)
+    {
+        if (commandListData.commandQueue & Rendering::CHECK_MATCH_BIND_PIPELINE_PREVIEW && !(commandListData.commandQueue & pipelineChanged & Rendering::MATCH_PREVIEW))
+        {
+            renderingPreviewManager.UpdatePreview(commandList, Rendering::CALL_BIND_PIPELINE, pipelineChanged & Rendering::MATCH_PREVIEW);
+        }
+
+        if (commandListData.commandQueue & Rendering::CHECK_MATCH_BIND_PIPELINE_BINDING && !(commandListData.commandQueue & pipelineChanged & Rendering::MATCH_BINDING))
+        {
+            renderingBindingManager.UpdateTextureBindings(commandList, Rendering::CALL_BIND_PIPELINE, pipelineChanged & Rendering::MATCH_BINDING);
+        }
+
+        if (commandListData.commandQueue & Rendering::CHECK_MATCH_BIND_PIPELINE_EFFECT && !(commandListData.commandQueue & pipelineChanged & Rendering::MATCH_EFFECT))
+        {
+            renderingEffectManager.RenderEffects(commandList, Rendering::CALL_BIND_PIPELINE, pipelineChanged & Rendering::MATCH_EFFECT);
+        }
+
+        renderingQueueManager.ClearQueue(commandListData, pipelineChanged);
+        renderingQueueManager.CheckCallForCommandList(commandList);
+    }
+}
+
+static void onBindRenderTargetsAndDepthStencil(command_list* cmd_list, uint32_t, const resource_view*, resource_view)
+{
+    CommandListDataContainer& commandListData = PrivateDataCache::Get<CommandListDataContainer>(cmd_list);
+    DeviceDataContainer& deviceData = cmd_list->get_device()->get_private_data<DeviceDataContainer>();
+
+    if (commandListData.commandQueue & Rendering::CHECK_MATCH_BIND_RENDERTARGET_PREVIEW && !(commandListData.commandQueue & Rendering::CHECK_MATCH_DRAW_PREVIEW))
+    {
+        renderingPreviewManager.UpdatePreview(cmd_list, Rendering::CALL_BIND_RENDER_TARGET, Rendering::MATCH_PREVIEW);
+    }
+
+    if (commandListData.commandQueue & Rendering::CHECK_MATCH_BIND_RENDERTARGET_BINDING && !(commandListData.commandQueue & Rendering::CHECK_MATCH_DRAW_BINDING))
+    {
+        renderingBindingManager.UpdateTextureBindings(cmd_list, Rendering::CALL_BIND_RENDER_TARGET, Rendering::MATCH_BINDING);
+    }
+
+    if (commandListData.commandQueue & Rendering::CHECK_MATCH_BIND_RENDERTARGET_EFFECT && !(commandListData.commandQueue & Rendering::CHECK_MATCH_DRAW_EFFECT))
+    {
+        renderingEffectManager.RenderEffects(cmd_list, Rendering::CALL_BIND_RENDER_TARGET, Rendering::MATCH_EFFECT);
+    }
+
+    renderingQueueManager.RescheduleGroups(commandListData, deviceData);
+}
+
+static void checkDrawCall(command_list* cmd_list, const uint64_t match_modifier)
+{
+    CommandListDataContainer& commandListData = PrivateDataCache::Get<CommandListDataContainer>(cmd_list);
+
+    if (commandListData.commandQueue & Rendering::MATCH_ALL & match_modifier)
+    {
+        if (constantHandler != nullptr && (commandListData.commandQueue & Rendering::MATCH_CONST & match_modifier))
+        {
+            constantHandler->UpdateConstants(cmd_list);
+            commandListData.commandQueue &= ~(Rendering::MATCH_CONST & match_modifier);
+        }
+
+        if (commandListData.commandQueue & Rendering::MATCH_PREVIEW & match_modifier)
+        {
+            renderingPreviewManager.UpdatePreview(cmd_list, Rendering::CALL_DRAW, Rendering::MATCH_PREVIEW & match_modifier);
+        }
+
+        if (commandListData.commandQueue & Rendering::MATCH_BINDING & match_modifier)
+        {
+            renderingBindingManager.UpdateTextureBindings(cmd_list, Rendering::CALL_DRAW, Rendering::MATCH_BINDING & match_modifier);
+        }
+
+        if (commandListData.commandQueue & Rendering::MATCH_EFFECT & match_modifier)
+        {
+            renderingEffectManager.RenderEffects(cmd_list, Rendering::CALL_DRAW, Rendering::MATCH_EFFECT & match_modifier);
+        }
+    }
+}
+
+static bool onDraw(command_list* cmd_list, uint32_t, uint32_t, uint32_t, uint32_t)
+{
+    checkDrawCall(cmd_list, Rendering::MATCH_PS | Rendering::MATCH_VS);
+    return false;
+}
+
+static bool onDispatch(command_list* cmd_list, uint32_t, uint32_t, uint32_t)
+{
+    checkDrawCall(cmd_list, Rendering::MATCH_CS);
+    return false;
+}
+
+static void onPresent(command_queue* queue, swapchain*, const rect*, const rect*, uint32_t, const rect*)
+{
+    device* dev = queue->get_device();
+    DeviceDataContainer& deviceData = dev->get_private_data<DeviceDataContainer>();
+
+    if (deviceData.current_runtime == nullptr)
+    {
+        return;
+    }
+
+    effect_runtime* runtime = deviceData.current_runtime;
+
+    if (queue == runtime->get_command_queue() && runtime->get_effects_state())
+    {
+        renderingEffectManager.RenderRemainingEffects(runtime);
+    }
+}
+
+static void updateStateTrackingInterest()
+{
+    uint32_t trackedSlots[StateTracking::ALL_SHADER_STAGES_SIZE] = { 0 };
+
+    const auto addInterest = [&trackedSlots](uint32_t stage, uint32_t slot) {
+        stage = std::min(static_cast<uint32_t>(2), stage);
+        trackedSlots[stage] = std::max(trackedSlots[stage], slot + 1);
+        };
+
+    for (const auto& [_, group] : g_addonUIData.GetToggleGroups())
+    {
+        if (group.getExtractConstants())
+        {
+            addInterest(group.getCBShaderStage(), group.getCBSlotIndex());
+        }
+        if (group.getExtractResourceViews())
+        {
+            addInterest(group.getSRVShaderStage(), group.getBindingSRVSlotIndex());
+        }
+        if (group.getRenderToResourceViews())
+        {
+            addInterest(group.getRenderSRVShaderStage(), group.getRenderSRVSlotIndex());
+        }
+    }
+
+    for (uint32_t i = 0; i < StateTracking::ALL_SHADER_STAGES_SIZE; i++)
+    {
+        state_tracking::set_tracked_slots(i, trackedSlots[i]);
+    }
+}
+
+static void onReshadePresent(effect_runtime* runtime)
+{
+    device* dev = runtime->get_device();
+    DeviceDataContainer& deviceData = dev->get_private_data<DeviceDataContainer>();
+    command_queue* queue = runtime->get_command_queue();
+
+    deviceData.rendered_effects = false;
+
+    keyMonitor.PollKeyStates(runtime);
+
+    if (runtime->get_effects_state())
+    {
+        resourceManager.CheckPreview(queue->get_immediate_command_list(), dev);
+        groupResourceManager.CheckGroupBuffers(runtime, g_addonUIData.GetToggleGroups());
+        renderingBindingManager.ClearUnmatchedTextureBindings(queue->get_immediate_command_list());
+        resourceManager.CheckResourceViews(runtime);
+    }
+
+    techniqueManager.OnReshadePresent(runtime);
+    updateStateTrackingInterest();
+
+    deviceData.bindingsUpdated.clear();
+    deviceData.constantsUpdated.clear();
+    deviceData.huntPreview.Reset();
+
+    if (constantCopy != nullptr)
+        constantCopy->OnReshadePresent(runtime);
+}
+
+static void registerEvents()
+{
+    state_tracking::register_events(true);
+
+    register_event<addon_event::init_device>(onInitDevice);
+    register_event<addon_event::destroy_device>(onDestroyDevice);
+    register_event<addon_event::init_command_list>(onInitCommandList);
+    register_event<addon_event::destroy_command_list>(onDestroyCommandList);
+    register_event<addon_event::reset_command_list>(onResetCommandList);
+    register_event<addon_event::init_effect_runtime>(onInitEffectRuntime);
+    register_event<addon_event::destroy_effect_runtime>(onDestroyEffectRuntime);
+    register_event<addon_event::reshade_reloaded_effects>(onReshadeReloadedEffects);
+    register_event<addon_event::init_pipeline>(onInitPipeline);
+    register_event<addon_event::bind_pipeline>(onBindPipeline);
+    register_event<addon_event::bind_render_targets_and_depth_stencil>(onBindRenderTargetsAndDepthStencil);
+    register_event<addon_event::draw>(onDraw);
+    register_event<addon_event::dispatch>(onDispatch);
+    register_event<addon_event::present>(onPresent);
+    register_event<addon_event::reshade_present>(onReshadePresent);
+}
+
+/// <summary>
+/// Latencies of one event type in power of two nanosecond buckets, fixed size so recording doesn't allocate.
+/// </summary>
+struct LatencyHistogram
+{
+    static constexpr uint32_t BUCKETS = 32;
+
+    void add(uint64_t ns)
+    {
+        buckets[std::min<uint32_t>(std::bit_width(ns), BUCKETS - 1)]++;
+        count++;
+        total += ns;
+        max = std::max(max, ns);
+    }
+
+    uint64_t percentile(double p) const
+    {
+        const uint64_t rank = static_cast<uint64_t>(p * count);
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BUCKETS; i++)
+        {
+            seen += buckets[i];
+            if (seen > rank)
+            {
+                return i == 0 ? 0 : (1ull << i) - 1;
+            }
+        }
+        return max;
+    }
+
+    void print(const char* name) const
+    {
+        printf("%-40s %9llu events, mean %6.0f ns, p50 < %6llu ns, p99 < %6llu ns, max %8llu ns\n", name, static_cast<unsigned long long>(count),
+            count > 0 ? static_cast<double>(total) / count : 0.0, static_cast<unsigned long long>(percentile(0.5) + 1),
+            static_cast<unsigned long long>(percentile(0.99) + 1), static_cast<unsigned long long>(max));
+
+        const uint64_t peak = *std::max_element(std::begin(buckets), std::end(buckets));
+        for (uint32_t i = 0; i < BUCKETS; i++)
+        {
+            if (buckets[i] == 0)
+            {
+                continue;
+            }
+
+            char bar[41] = {};
+            std::fill_n(bar, std::max<uint64_t>(1, buckets[i] * 40 / peak), '#');
+            printf("    < %8llu ns %9llu %s\n", 1ull << i, static_cast<unsigned long long>(buckets[i]), bar);
+        }
+    }
+
+    uint64_t buckets[BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t max = 0;
+};
+
+enum EventType : uint32_t
+{
+    EVENT_BIND_RENDER_TARGETS,
+    EVENT_PUSH_DESCRIPTORS,
+    EVENT_BIND_PIPELINE,
+    EVENT_DRAW,
+    EVENT_DISPATCH,
+    EVENT_PRESENT,
+    EVENT_RESHADE_PRESENT,
+    EVENT_TYPE_COUNT
+};
+
+static const char* EVENT_NAMES[EVENT_TYPE_COUNT] = {
+    "bind_render_targets_and_depth_stencil", "push_descriptors", "bind_pipeline", "draw", "dispatch", "present", "reshade_present"
+};
+
+struct Event
+{
+    EventType type;
+    uint32_t index;		// pipeline, render target or constant buffer, depending on the type
+};
+
+/// <summary>
+/// Per frame counts, kept in preallocated arrays during the measured frames.
+/// </summary>
+struct FrameCounters
+{
+    uint64_t allocations;
+    uint64_t mutexLocks;
+    uint64_t sharedLocks;
+    uint64_t exclusiveLocks;
+};
+
+static void printFrameStat(const char* name, const std::vector<FrameCounters>& frames, uint64_t FrameCounters::* member)
+{
+    uint64_t total = 0;
+    uint64_t low = UINT64_MAX;
+    uint64_t high = 0;
+    for (const FrameCounters& frame : frames)
+    {
+        total += frame.*member;
+        low = std::min(low, frame.*member);
+        high = std::max(high, frame.*member);
+    }
+    printf("%-40s mean %10.1f, min %8llu, max %8llu\n", name, static_cast<double>(total) / frames.size(), static_cast<unsigned long long>(low), static_cast<unsigned long long>(high));
+}
+
+static constexpr uint32_t WIDTH = 1920;
+static constexpr uint32_t HEIGHT = 1080;
+static constexpr uint32_t GRAPHICS_PIPELINES = 2048;
+static constexpr uint32_t COMPUTE_PIPELINES = 128;
+static constexpr uint32_t HOT_PIPELINES = 512;
+static constexpr uint32_t RENDER_TARGETS = 4;
+static constexpr uint32_t CONSTANT_BUFFERS = 64;
+static constexpr uint32_t EFFECTS = 12;
+static constexpr uint32_t TECHNIQUES_PER_EFFECT = 4;
+static constexpr uint32_t GROUPS = 16;
+static constexpr uint32_t GROUP_SHADERS = 8;
+static constexpr uint32_t CONSTANT_GROUPS = 4;
+static constexpr uint32_t COMMAND_LISTS = 4;
+static constexpr uint32_t EVENTS_PER_LIST = 2000;
+static constexpr uint32_t WARMUP_FRAMES = 10;
+static constexpr uint32_t FRAMES = 200;
+static constexpr pipeline_layout LAYOUT = { 0x77 };
+
+int main()
+{
+    std::mt19937_64 random(9);
+
+    registerEvents();
+
+    constantCopy = new ConstantCopyGPUReadback(2);
+    constantHandler = new ConstantHandlerBase();
+    ConstantHandlerBase::SetConstantCopy(constantCopy);
+    g_addonUIData.SetConstantHandler(constantHandler);
+    techniqueManager.AddEffectsReloadingCallback(std::bind(&ConstantHandlerBase::OnEffectsReloading, constantHandler, std::placeholders::_1));
+    techniqueManager.AddEffectsReloadedCallback(std::bind(&ConstantHandlerBase::OnEffectsReloaded, constantHandler, std::placeholders::_1));
+    techniqueManager.AddEffectsReloadingCallback(std::bind(&Rendering::ResourceManager::OnEffectsReloading, &resourceManager, std::placeholders::_1));
+    techniqueManager.AddEffectsReloadedCallback(std::bind(&Rendering::ResourceManager::OnEffectsReloaded, &resourceManager, std::placeholders::_1));
+
+    device dev(device_api::d3d12);
+    command_list immediate(&dev);
+    command_queue queue(&immediate);
+    std::vector<command_list> lists(COMMAND_LISTS, command_list(&dev));
+    effect_runtime runtime(&dev, &queue);
+
+    mock::dispatch<addon_event::init_device>(&dev);
+    mock::dispatch<addon_event::init_command_list>(&immediate);
+    for (command_list& list : lists)
+    {
+        mock::dispatch<addon_event::init_command_list>(&list);
+    }
+
+    // One constant buffer parameter per stage, pushed like D3D12 root descriptors
+    const pipeline_layout_param params[] = {
+        pipeline_layout_param(descriptor_range{ 0, 0, 0, 1, shader_stage::all, 1, descriptor_type::constant_buffer }),
+    };
+    mock::dispatch<addon_event::init_pipeline_layout>(&dev, static_cast<uint32_t>(std::size(params)), params, LAYOUT);
+
+    // Every shader gets its own made up bytecode, the hashes are what the groups refer to
+    std::vector<std::vector<uint8_t>> bytecode;
+    const auto addShader = [&]() {
+        std::vector<uint8_t> code(64);
+        for (uint8_t& byte : code)
+        {
+            byte = static_cast<uint8_t>(random());
+        }
+        bytecode.push_back(std::move(code));
+        return compute_crc32(bytecode.back().data(), bytecode.back().size());
+        };
+
+    std::vector<uint32_t> pixelHashes;
+    for (uint32_t i = 0; i < GRAPHICS_PIPELINES * 2 + COMPUTE_PIPELINES; i++)
+    {
+        const uint32_t hash = addShader();
+        if (i % 2 == 1 && i < GRAPHICS_PIPELINES * 2)
+        {
+            pixelHashes.push_back(hash);
+        }
+    }
+
+    // Effects, each group renders two techniques and the first few extract a constant into a uniform variable
+    for (uint32_t e = 0; e < EFFECTS; e++)
+    {
+        for (uint32_t t = 0; t < TECHNIQUES_PER_EFFECT; t++)
+        {
+            runtime.add_technique("Technique" + std::to_string(t), "Effect" + std::to_string(e) + ".fx", t % 2 == 0);
+        }
+    }
+    runtime.add_uniform_variable("fov", "replay_fov", format::r32_float, 1);
+    runtime.add_uniform_variable("view", "replay_view", format::r32_float, 4, 4);
+
+    for (uint32_t g = 0; g < GROUPS; g++)
+    {
+        g_addonUIData.AddDefaultGroup();
+    }
+
+    uint32_t g = 0;
+    for (auto& [_, group] : g_addonUIData.GetToggleGroups())
+    {
+        std::unordered_set<uint32_t> groupHashes;
+        for (uint32_t i = 0; i < GROUP_SHADERS; i++)
+        {
+            groupHashes.insert(pixelHashes[(g * GROUP_SHADERS + i) * (HOT_PIPELINES / (GROUPS * GROUP_SHADERS))]);
+        }
+        group.storeCollectedHashes(groupHashes, {}, {});
+
+        const uint32_t effect = g % EFFECTS;
+        std::unordered_set<std::string> techniques = {
+            "Technique0 [Effect" + std::to_string(effect) + ".fx]",
+            "Technique2 [Effect" + std::to_string(effect) + ".fx]",
+        };
+        group.setAllowAllTechniques(false);
+        group.setPreferredTechniques(techniques);
+
+        if (g < CONSTANT_GROUPS)
+        {
+            std::string fov = "replay_fov";
+            std::string view = "replay_view";
+            group.setExtractConstant(true);
+            group.setCBShaderStage(0);
+            group.setCBSlotIndex(0);
+            group.SetVarMapping(0, fov, false);
+            group.SetVarMapping(16, view, false);
+        }
+
+        g_addonUIData.ToggleGroupActive(group);
+        g++;
+    }
+    g_addonUIData.UpdateToggleGroupsForShaderHashes();
+
+    runtime.create_back_buffers(WIDTH, HEIGHT, format::r8g8b8a8_unorm);
+    mock::dispatch<addon_event::init_effect_runtime>(&runtime);
+    mock::dispatch<addon_event::reshade_reloaded_effects>(&runtime);
+
+    std::vector<pipeline> pipelines;
+    for (uint32_t i = 0; i < GRAPHICS_PIPELINES + COMPUTE_PIPELINES; i++)
+    {
+        shader_desc shaders[2];
+        pipeline_subobject subobjects[2];
+        uint32_t count = 0;
+        if (i < GRAPHICS_PIPELINES)
+        {
+            shaders[0] = { bytecode[i * 2].data(), bytecode[i * 2].size() };
+            shaders[1] = { bytecode[i * 2 + 1].data(), bytecode[i * 2 + 1].size() };
+            subobjects[count++] = { pipeline_subobject_type::vertex_shader, 1, &shaders[0] };
+            subobjects[count++] = { pipeline_subobject_type::pixel_shader, 1, &shaders[1] };
+        }
+        else
+        {
+            const std::vector<uint8_t>& code = bytecode[GRAPHICS_PIPELINES * 2 + i - GRAPHICS_PIPELINES];
+            shaders[0] = { code.data(), code.size() };
+            subobjects[count++] = { pipeline_subobject_type::compute_shader, 1, &shaders[0] };
+        }
+
+        pipeline handle = {};
+        dev.create_pipeline(LAYOUT, count, subobjects, &handle);
+        mock::dispatch<addon_event::init_pipeline>(&dev, LAYOUT, count, static_cast<const pipeline_subobject*>(subobjects), handle);
+        pipelines.push_back(handle);
+    }
+
+    std::vector<resource_view> renderTargets;
+    for (uint32_t i = 0; i < RENDER_TARGETS; i++)
+    {
+        resource res = {};
+        resource_view rtv = {};
+        dev.create_resource(resource_desc(WIDTH, HEIGHT, 1, 1, format::r8g8b8a8_unorm, 1, memory_heap::gpu_only, resource_usage::render_target | resource_usage::shader_resource), nullptr, resource_usage::render_target, &res);
+        dev.create_resource_view(res, resource_usage::render_target, resource_view_desc(format::r8g8b8a8_unorm), &rtv);
+        renderTargets.push_back(rtv);
+    }
+
+    std::vector<resource> constantBuffers;
+    for (uint32_t i = 0; i < CONSTANT_BUFFERS; i++)
+    {
+        resource res = {};
+        dev.create_resource(resource_desc(256, memory_heap::cpu_to_gpu, resource_usage::constant_buffer), nullptr, resource_usage::constant_buffer, &res);
+        constantBuffers.push_back(res);
+    }
+
+    // Passes switch render targets every few draws, most draws push a constant buffer first, a few dispatches in between. Frames
+    // draw with a hot set of pipelines, the groups' shaders among them.
+    std::vector<std::vector<Event>> streams(COMMAND_LISTS);
+    for (std::vector<Event>& stream : streams)
+    {
+        while (stream.size() < EVENTS_PER_LIST)
+        {
+            if (random() % 8 == 0)
+            {
+                stream.push_back({ EVENT_BIND_RENDER_TARGETS, static_cast<uint32_t>(random() % RENDER_TARGETS) });
+            }
+
+            if (random() % 16 == 0)
+            {
+                stream.push_back({ EVENT_BIND_PIPELINE, GRAPHICS_PIPELINES + static_cast<uint32_t>(random() % COMPUTE_PIPELINES) });
+                stream.push_back({ EVENT_DISPATCH, 0 });
+                continue;
+            }
+
+            if (random() % 2 == 0)
+            {
+                stream.push_back({ EVENT_PUSH_DESCRIPTORS, static_cast<uint32_t>(random() % CONSTANT_BUFFERS) });
+            }
+            stream.push_back({ EVENT_BIND_PIPELINE, static_cast<uint32_t>(random() % HOT_PIPELINES) });
+            stream.push_back({ EVENT_DRAW, 0 });
+        }
+    }
+
+    LatencyHistogram histograms[EVENT_TYPE_COUNT];
+    std::vector<FrameCounters> frames;
+    frames.reserve(FRAMES);
+
+    const auto timed = [&histograms](EventType type, auto&& dispatch) {
+        const auto start = std::chrono::steady_clock::now();
+        dispatch();
+        histograms[type].add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+        };
+
+    const uint64_t renderedBefore = runtime.rendered_techniques;
+    for (uint32_t frame = 0; frame < WARMUP_FRAMES + FRAMES; frame++)
+    {
+        if (frame == WARMUP_FRAMES)
+        {
+            // Only the measured frames count
+            for (LatencyHistogram& histogram : histograms)
+            {
+                histogram = LatencyHistogram();
+            }
+        }
+
+        const FrameCounters start = { allocations(), mutexLocks.load(), sharedLocks.load(), exclusiveLocks.load() };
+
+        for (uint32_t l = 0; l < COMMAND_LISTS; l++)
+        {
+            command_list* cmd = &lists[l];
+            mock::dispatch<addon_event::reset_command_list>(cmd);
+
+            for (const Event& event : streams[l])
+            {
+                switch (event.type)
+                {
+                case EVENT_BIND_RENDER_TARGETS:
+                    timed(event.type, [&]() { mock::dispatch<addon_event::bind_render_targets_and_depth_stencil>(cmd, 1u, &renderTargets[event.index], resource_view{ 0 }); });
+                    break;
+                case EVENT_PUSH_DESCRIPTORS:
+                {
+                    const buffer_range range = { constantBuffers[event.index], 0, 256 };
+                    const descriptor_table_update update = { {}, 0, 0, 1, descriptor_type::constant_buffer, &range };
+                    timed(event.type, [&]() { mock::dispatch<addon_event::push_descriptors>(cmd, shader_stage::all, LAYOUT, 0u, update); });
+                }
+                break;
+                case EVENT_BIND_PIPELINE:
+                {
+                    const pipeline_stage stages = event.index < GRAPHICS_PIPELINES ? pipeline_stage::all_graphics : pipeline_stage::compute_shader;
+                    timed(event.type, [&]() { mock::dispatch<addon_event::bind_pipeline>(cmd, stages, pipelines[event.index]); });
+                }
+                break;
+                case EVENT_DRAW:
+                    timed(event.type, [&]() { mock::dispatch<addon_event::draw>(cmd, 3u, 1u, 0u, 0u); });
+                    break;
+                case EVENT_DISPATCH:
+                    timed(event.type, [&]() { mock::dispatch<addon_event::dispatch>(cmd, 8u, 8u, 1u); });
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        timed(EVENT_PRESENT, [&]() { mock::dispatch<addon_event::present>(&queue, static_cast<swapchain*>(&runtime), nullptr, nullptr, 0u, nullptr); });
+        timed(EVENT_RESHADE_PRESENT, [&]() { mock::dispatch<addon_event::reshade_present>(&runtime); });
+        runtime.present();
+
+        if (frame >= WARMUP_FRAMES)
+        {
+            frames.push_back({ allocations() - start.allocations, mutexLocks.load() - start.mutexLocks, sharedLocks.load() - start.sharedLocks, exclusiveLocks.load() - start.exclusiveLocks });
+        }
+    }
+
+    printf("%u command lists of %u events, %u groups on %u of %u hot pipelines, %u measured frames after %u warm up frames\n\n",
+        COMMAND_LISTS, EVENTS_PER_LIST, GROUPS, GROUPS * GROUP_SHADERS, HOT_PIPELINES, FRAMES, WARMUP_FRAMES);
+
+    printf("Latency per event, all registered callbacks:\n");
+    for (uint32_t type = 0; type < EVENT_TYPE_COUNT; type++)
+    {
+        histograms[type].print(EVENT_NAMES[type]);
+    }
+
+    printf("\nPer frame:\n");
+    printFrameStat("allocations", frames, &FrameCounters::allocations);
+    printFrameStat("std::mutex locks", frames, &FrameCounters::mutexLocks);
+    printFrameStat("std::shared_mutex shared locks", frames, &FrameCounters::sharedLocks);
+    printFrameStat("std::shared_mutex exclusive locks", frames, &FrameCounters::exclusiveLocks);
+
+    uint32_t copies = 0;
+    for (command_list& list : lists)
+    {
+        copies += list.calls["copy_buffer_region"];
+    }
+
+    const uint64_t rendered = runtime.rendered_techniques - renderedBefore;
+    printf("\n%.1f techniques rendered and %.1f constant buffer copies per frame\n", static_cast<double>(rendered) / (WARMUP_FRAMES + FRAMES),
+        static_cast<double>(copies) / (WARMUP_FRAMES + FRAMES));
+
+    // The replay has to reach the managers, or the numbers above measure nothing
+    CHECK(rendered > 0);
+    CHECK(mutexLocks.load() + sharedLocks.load() + exclusiveLocks.load() > 0);
+
+    // Torn down through the events as well, the managers hold views on the device
+    mock::dispatch<addon_event::destroy_effect_runtime>(&runtime);
+    for (command_list& list : lists)
+    {
+        mock::dispatch<addon_event::destroy_command_list>(&list);
+    }
+    mock::dispatch<addon_event::destroy_command_list>(&immediate);
+    mock::dispatch<addon_event::destroy_device>(&dev);
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Compares resolving the toggle groups of a shader hash through the ShaderHashFilter first with looking it up in the hash to group map
+// directly, for 10, 1,000 and 50,000 marked hashes. Both lookups are done as AddonUIData::GetToggleGroupsFor*ShaderHash does them,
+// the filter behind an EpochDomain guard. Not run by ctest; run the executable of a release build directly.
+
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "EpochDomain.h"
+#include "GroupMask.h"
+#include "ShaderHashFilter.h"
+#include "Benchmark.h"
+#include "TestCheck.h"
+
+using namespace ShaderToggler;
+
+static constexpr size_t LOOKUPS = 10000000;
+
+static GroupMask lookupMap(const std::unordered_map<uint32_t, GroupMask>& groups, uint32_t hash)
+{
+    const auto& it = groups.find(hash);
+    return it != groups.end() ? it->second : GroupMask();
+}
+
+static GroupMask lookupFiltered(const ShaderHashFilter& filter, const std::unordered_map<uint32_t, GroupMask>& groups, uint32_t hash)
+{
+    {
+        EpochDomain::ReadGuard guard;
+        if (!filter.mayContain(hash))
+        {
+            return GroupMask();
+        }
+    }
+
+    return lookupMap(groups, hash);
+}
+
+int main()
+{
+    printf("old: unordered_map<uint32_t, GroupMask>::find, new: ShaderHashFilter::mayContain, then find on a hit\n");
+    printf("%zu lookups per scenario\n", LOOKUPS);
+
+    for (const size_t marked : { 10, 1000, 50000 })
+    {
+        std::mt19937 random(static_cast<uint32_t>(marked));
+        std::unordered_map<uint32_t, GroupMask> groups;
+        std::vector<uint32_t> markedHashes;
+        while (groups.size() < marked)
+        {
+            const uint32_t hash = random();
+            if (groups.try_emplace(hash).second)
+            {
+                groups[hash].set(static_cast<uint32_t>(groups.size() % MAX_TOGGLE_GROUPS));
+                markedHashes.push_back(hash);
+            }
+        }
+
+        ShaderHashFilter filter(groups.size());
+        for (const auto& [hash, _] : groups)
+        {
+            filter.add(hash);
+        }
+
+        // Almost no shader belongs to a group, the second stream has 1% of the lookups hit
+        for (const uint32_t hitPercent : { 0u, 1u })
+        {
+            std::vector<uint32_t> hashes(LOOKUPS);
+            for (auto& hash : hashes)
+            {
+                hash = random() % 100 < hitPercent ? markedHashes[random() % markedHashes.size()] : random();
+            }
+
+            uint64_t baselineHits = 0;
+            uint64_t filteredHits = 0;
+            const double baseline = measure([&]() {
+                for (const uint32_t hash : hashes)
+                {
+                    baselineHits += lookupMap(groups, hash).any();
+                }
+                });
+            const double filtered = measure([&]() {
+                for (const uint32_t hash : hashes)
+                {
+                    filteredHits += lookupFiltered(filter, groups, hash).any();
+                }
+                });
+
+            CHECK(baselineHits == filteredHits);
+
+            char scenario[64];
+            snprintf(scenario, sizeof(scenario), "%zu marked hashes, %u%% hits", marked, hitPercent);
+            report(scenario, baseline, filtered);
+        }
+    }
+
+    return 0;
+}
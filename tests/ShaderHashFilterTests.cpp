@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <random>
+#include <unordered_set>
+#include "ShaderHashFilter.h"
+#include "TestCheck.h"
+
+using namespace ShaderToggler;
+
+static void testNoFalseNegatives()
+{
+    for (size_t count : { 0, 1, 10, 1000, 50000 })
+    {
+        ShaderHashFilter filter(count);
+        std::mt19937 random(static_cast<uint32_t>(count));
+        std::unordered_set<uint32_t> hashes;
+        while (hashes.size() < count)
+        {
+            hashes.insert(random());
+        }
+
+        for (uint32_t hash : hashes)
+        {
+            filter.add(hash);
+        }
+
+        for (uint32_t hash : hashes)
+        {
+            CHECK(filter.mayContain(hash));
+        }
+
+        // Sized for ~16 bits per hash, false positives have to stay rare
+        size_t falsePositives = 0;
+        const size_t probes = 1000000;
+        for (size_t i = 0; i < probes; i++)
+        {
+            const uint32_t hash = random();
+            if (!hashes.contains(hash) && filter.mayContain(hash))
+            {
+                falsePositives++;
+            }
+        }
+        CHECK(falsePositives < probes / 100);
+    }
+}
+
+static void testEmptyFilter()
+{
+    ShaderHashFilter filter(0);
+    CHECK(!filter.mayContain(0));
+    CHECK(!filter.mayContain(0xDEADBEEF));
+}
+
+int main()
+{
+    testNoFalseNegatives();
+    testEmptyFilter();
+
+    return 0;
+}
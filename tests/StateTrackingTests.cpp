@@ -0,0 +1,391 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+#include <map>
+#include <random>
+#include <vector>
+#include "reshade.hpp"
+#include "StateTracking.h"
+#include "DescriptorTracking.h"
+#include "EpochDomain.h"
+#include "TestCheck.h"
+
+using namespace reshade;
+using namespace reshade::api;
+using namespace StateTracking;
+
+static constexpr uint32_t PIXEL_STAGE = 0;		// index of shader_stage::pixel in ALL_SHADER_STAGES
+
+/// <summary>
+/// A device with one command list, both announced through the init events like ReShade does, and destroyed the same way.
+/// </summary>
+struct MockContext
+{
+    explicit MockContext(device_api api) : dev(api), cmd(&dev)
+    {
+        mock::dispatch<addon_event::init_device>(&dev);
+        mock::dispatch<addon_event::init_command_list>(&cmd);
+    }
+
+    ~MockContext()
+    {
+        mock::dispatch<addon_event::destroy_command_list>(&cmd);
+        mock::dispatch<addon_event::destroy_device>(&dev);
+    }
+
+    state_tracking& state() { return cmd.get_private_data<state_tracking>(); }
+
+    device dev;
+    command_list cmd;
+};
+
+// Descriptor tables are encoded as heap << 32 | base offset by the mock device
+static constexpr descriptor_table makeTable(uint64_t heap, uint32_t offset)
+{
+    return { heap << 32 | offset };
+}
+
+static const descriptor_range TABLE_RANGES[] = {
+    { 0, 0, 0, 4, shader_stage::pixel, 1, descriptor_type::shader_resource_view },
+    { 4, 0, 0, 2, shader_stage::pixel, 1, descriptor_type::sampler },
+};
+static constexpr pipeline_layout LAYOUT = { 77 };
+
+static void createLayout(device& dev)
+{
+    const pipeline_layout_param params[] = {
+        pipeline_layout_param(static_cast<uint32_t>(std::size(TABLE_RANGES)), TABLE_RANGES),
+        pipeline_layout_param(constant_range{ 0, 0, 0, 4, shader_stage::pixel }),
+    };
+    mock::dispatch<addon_event::init_pipeline_layout>(&dev, static_cast<uint32_t>(std::size(params)), params, LAYOUT);
+}
+
+static void writeViews(device& dev, descriptor_table table, uint32_t binding, std::vector<resource_view> views)
+{
+    const descriptor_table_update update = { table, binding, 0, static_cast<uint32_t>(views.size()), descriptor_type::shader_resource_view, views.data() };
+    mock::dispatch<addon_event::update_descriptor_tables>(&dev, 1u, &update);
+}
+
+static void testBarrierTracker()
+{
+    std::mt19937_64 random(3);
+
+    for (int iteration = 0; iteration < 20000; iteration++)
+    {
+        barrier_tracker tracker;
+        std::map<uint64_t, uint32_t> reference;
+        std::vector<uint64_t> handles;
+
+        // Handles differing only in their upper half must not match each other
+        const int inserts = static_cast<int>(random() % 9);
+        for (int i = 0; i < inserts; i++)
+        {
+            const uint64_t handle = (random() % 20 + 1) | ((random() % 2) << 40);
+            if (reference.contains(handle))
+            {
+                continue;
+            }
+
+            const bool inserted = tracker.insert(handle, { resource_usage::undefined, 1 });
+            CHECK(inserted == (reference.size() < barrier_tracker::CAPACITY));
+            if (inserted)
+            {
+                reference[handle] = 0;
+                handles.push_back(handle);
+            }
+        }
+
+        if (!handles.empty() && random() % 2)
+        {
+            const uint64_t erased = handles[random() % handles.size()];
+            tracker.erase(erased);
+            reference.erase(erased);
+        }
+
+        // Barrier batches may name a resource more than once, the last barrier wins
+        const uint32_t count = static_cast<uint32_t>(random() % 17);
+        std::vector<resource> resources(count);
+        std::vector<resource_usage> states(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            resources[i].handle = (random() % 20 + 1) | ((random() % 2) << 40);
+            states[i] = static_cast<resource_usage>(random() % 1000 + 1);
+            if (reference.contains(resources[i].handle))
+            {
+                reference[resources[i].handle] = static_cast<uint32_t>(states[i]);
+            }
+        }
+        tracker.update(count, resources.data(), states.data());
+
+        CHECK(tracker.size() == reference.size());
+        for (const auto& [handle, usage] : reference)
+        {
+            const barrier_track* track = tracker.find(handle);
+            CHECK(track != nullptr && static_cast<uint32_t>(track->usage) == usage);
+        }
+        CHECK(tracker.find(0) == nullptr);
+    }
+}
+
+static void testInlineVector()
+{
+    inline_vector<uint32_t, 4> vector;
+    vector.resize(2);
+    vector[0] = 1;
+    vector[1] = 2;
+
+    // Elements a clear left behind are zeroed when the vector grows over them again
+    vector.clear();
+    vector.resize(3);
+    CHECK(vector.size() == 3 && vector[0] == 0 && vector[1] == 0 && vector[2] == 0);
+
+    vector.resize(10);
+    CHECK(vector.size() == 4);
+
+    const uint32_t values[] = { 1, 2, 3, 4, 5, 6 };
+    vector.assign(values, values + std::size(values));
+    CHECK(vector.size() == 4 && vector[3] == 4);
+}
+
+static void testCaptureAndRestore()
+{
+    MockContext context(device_api::d3d12);
+    command_list* cmd = &context.cmd;
+    state_tracking& state = context.state();
+
+    const resource_view rtv = { 9 };
+    mock::dispatch<addon_event::bind_render_targets_and_depth_stencil>(cmd, 1u, &rtv, resource_view{ 10 });
+    mock::dispatch<addon_event::bind_pipeline>(cmd, pipeline_stage::all_graphics, pipeline{ 5 });
+    mock::dispatch<addon_event::bind_pipeline>(cmd, pipeline_stage::compute_shader, pipeline{ 6 });
+    const dynamic_state states[] = { dynamic_state::primitive_topology, dynamic_state::blend_constant };
+    const uint32_t values[] = { static_cast<uint32_t>(primitive_topology::triangle_list), 0xFF };
+    mock::dispatch<addon_event::bind_pipeline_states>(cmd, 2u, states, values);
+    const viewport viewports[2] = {};
+    mock::dispatch<addon_event::bind_viewports>(cmd, 1u, 2u, viewports);
+    const rect scissor = {};
+    mock::dispatch<addon_event::bind_scissor_rects>(cmd, 0u, 1u, &scissor);
+
+    CHECK(state.render_targets.size() == 1 && state.render_targets[0] == rtv && state.depth_stencil == 10);
+    CHECK(state.primitive_topology == primitive_topology::triangle_list && state.blend_constant == 0xFF);
+    CHECK(state.viewports.size() == 3 && state.scissor_rects.size() == 1);
+
+    // Viewports past the API limit are dropped
+    mock::dispatch<addon_event::bind_viewports>(cmd, 20u, 2u, viewports);
+    CHECK(state.viewports.size() == MAX_VIEWPORTS);
+
+    // Nothing clobbered, nothing restored
+    state.apply(cmd);
+    CHECK(cmd->calls.empty());
+
+    state.mark_dirty(state_category::all, pipeline_stage::all_graphics, shader_stage::all_graphics);
+    state.apply(cmd);
+    CHECK(cmd->calls["bind_render_targets_and_depth_stencil"] == 1);
+    CHECK(cmd->calls["bind_pipeline"] == 1);
+    CHECK(cmd->calls["bind_pipeline_state"] == 2);
+    CHECK(cmd->calls["bind_viewports"] == 1 && cmd->calls["bind_scissor_rects"] == 1);
+
+    cmd->calls.clear();
+    state.mark_dirty(state_category::viewports);
+    state.apply(cmd);
+    CHECK(cmd->calls.size() == 1 && cmd->calls["bind_viewports"] == 1);
+
+    const restore_stats& stats = state.get_restore_stats();
+    CHECK(stats.restored[std::countr_zero(state_category::viewports)] == 2);
+    CHECK(stats.skipped[std::countr_zero(state_category::render_targets)] == 2);
+
+    // A destroyed pipeline isn't restored anymore, the compute pipeline still is
+    mock::dispatch<addon_event::destroy_pipeline>(&context.dev, pipeline{ 5 });
+    cmd->calls.clear();
+    state.mark_dirty(state_category::pipelines, pipeline_stage::all_graphics);
+    state.apply(cmd);
+    CHECK(cmd->calls.empty());
+    state.mark_dirty(state_category::pipelines);
+    state.apply(cmd);
+    CHECK(cmd->calls.size() == 1 && cmd->calls["bind_pipeline"] == 1);
+
+    // Resetting the command list drops everything
+    mock::dispatch<addon_event::reset_command_list>(cmd);
+    CHECK(state.render_targets.empty() && state.viewports.empty() && state.bound_pipeline_stages == 0);
+}
+
+static void testDescriptorTables()
+{
+    MockContext context(device_api::d3d12);
+    command_list* cmd = &context.cmd;
+    state_tracking& state = context.state();
+    createLayout(context.dev);
+
+    const descriptor_table table = makeTable(1, 100);
+    const descriptor_table copied = makeTable(1, 5000);
+    writeViews(context.dev, table, 0, { { 55 }, { 56 } });
+    writeViews(context.dev, table, 2, { { 57 } });
+
+    mock::dispatch<addon_event::bind_descriptor_tables>(cmd, shader_stage::all_graphics, LAYOUT, 0u, 1u, &table);
+    const uint32_t constants[] = { 1, 2, 3, 4 };
+    mock::dispatch<addon_event::push_constants>(cmd, shader_stage::all_graphics, LAYOUT, 1u, 0u, 4u, static_cast<const void*>(constants));
+
+    CHECK(state.get_root_table_size_at(PIXEL_STAGE) == 2);
+    CHECK(state.get_descriptor_at(PIXEL_STAGE, 0, 0)->view == 55);
+    CHECK(state.get_descriptor_at(PIXEL_STAGE, 0, 1)->view == 56);
+    CHECK(state.get_descriptor_at(PIXEL_STAGE, 0, 2)->view == 57);
+    CHECK(state.get_descriptor_at(PIXEL_STAGE, 0, 3)->view == 0);
+    // Samplers aren't tracked, so the table snapshot ends after the views
+    CHECK(state.get_root_table_entry_size_at(PIXEL_STAGE, 0) == 4);
+    CHECK(state.get_descriptor_at(PIXEL_STAGE, 0, 4) == nullptr);
+    CHECK(state.get_constants_at(PIXEL_STAGE, 1)->size == 4 && state.get_constants_at(PIXEL_STAGE, 1)->data[3] == 4);
+
+    const descriptor_table_copy copy = { table, 0, 0, copied, 0, 0, 3 };
+    mock::dispatch<addon_event::copy_descriptor_tables>(&context.dev, 1u, &copy);
+    mock::dispatch<addon_event::bind_descriptor_tables>(cmd, shader_stage::all_graphics, LAYOUT, 0u, 1u, &copied);
+    CHECK(state.get_descriptor_at(PIXEL_STAGE, 0, 0)->view == 55);
+    CHECK(state.get_descriptor_at(PIXEL_STAGE, 0, 2)->view == 57);
+
+    // Restoring re-binds the table and the constants
+    cmd->calls.clear();
+    state.mark_dirty(state_category::descriptors, pipeline_stage::all, shader_stage::all_graphics);
+    state.apply(cmd);
+    CHECK(cmd->calls["bind_descriptor_tables"] >= 1 && cmd->calls["push_constants"] == 1);
+
+    // Clearing is lazy, the stage drops its tables when it's next used
+    mock::dispatch<addon_event::reset_command_list>(cmd);
+    CHECK(state.get_root_table_size_at(PIXEL_STAGE) == 0 && state.get_descriptor_at(PIXEL_STAGE, 0, 0) == nullptr);
+    mock::dispatch<addon_event::bind_descriptor_tables>(cmd, shader_stage::all_graphics, LAYOUT, 0u, 1u, &table);
+    CHECK(state.get_root_table_size_at(PIXEL_STAGE) == 1 && state.get_descriptor_at(PIXEL_STAGE, 0, 0)->view == 55);
+}
+
+static void testHeapOffsetCache()
+{
+    // D3D12 translations of the same table are answered from the cache within a frame
+    {
+        MockContext context(device_api::d3d12);
+        createLayout(context.dev);
+        const descriptor_table table = makeTable(1, 100);
+        writeViews(context.dev, table, 0, { { 55 } });
+
+        const uint64_t translations = context.dev.translations;
+        for (int i = 0; i < 3; i++)
+        {
+            mock::dispatch<addon_event::bind_descriptor_tables>(&context.cmd, shader_stage::all_graphics, LAYOUT, 0u, 1u, &table);
+            CHECK(context.state().get_descriptor_at(PIXEL_STAGE, 0, 0)->view == 55);
+        }
+        CHECK(context.dev.translations == translations);
+    }
+
+    // Vulkan pools can be reset and reallocated within a frame, so every update, copy and resolve translates afresh
+    {
+        MockContext context(device_api::vulkan);
+        createLayout(context.dev);
+        const descriptor_table table = makeTable(1, 100);
+        writeViews(context.dev, table, 0, { { 55 } });
+        writeViews(context.dev, table, 0, { { 56 } });
+        CHECK(context.dev.translations == 2);
+
+        const descriptor_table_copy copy = { table, 0, 0, makeTable(1, 200), 0, 0, 1 };
+        mock::dispatch<addon_event::copy_descriptor_tables>(&context.dev, 1u, &copy);
+        CHECK(context.dev.translations == 4);
+
+        for (int i = 0; i < 2; i++)
+        {
+            mock::dispatch<addon_event::bind_descriptor_tables>(&context.cmd, shader_stage::all_graphics, LAYOUT, 0u, 1u, &table);
+            CHECK(context.state().get_descriptor_at(PIXEL_STAGE, 0, 0)->view == 56);
+        }
+        CHECK(context.dev.translations == 4 + 2 * 1);
+    }
+}
+
+/// <summary>
+/// The metadata of a destroyed layout is still walked by state blocks that resolved it, its index may only be handed to a new layout
+/// once those readers left.
+/// </summary>
+static void testLayoutMetadataRecycling()
+{
+    MockContext context(device_api::d3d12);
+    const descriptor_tracking& tracking = context.dev.get_private_data<descriptor_tracking>();
+    createLayout(context.dev);
+    const uint32_t index = tracking.get_pipeline_layout_index(LAYOUT);
+    CHECK(index != descriptor_tracking::INVALID_LAYOUT_INDEX);
+
+    const pipeline_layout_param single[] = { pipeline_layout_param(constant_range{ 0, 0, 0, 1, shader_stage::vertex }) };
+    {
+        ShaderToggler::EpochDomain::ReadGuard guard;
+        const descriptor_tracking::pipeline_layout_metadata& metadata = tracking.get_pipeline_layout_metadata(index);
+
+        mock::dispatch<addon_event::destroy_pipeline_layout>(&context.dev, LAYOUT);
+        mock::dispatch<addon_event::init_pipeline_layout>(&context.dev, 1u, single, pipeline_layout{ 78 });
+        CHECK(tracking.get_pipeline_layout_index({ 78 }) != index);
+        CHECK(metadata.params.size() == 2 && metadata.params[0].is_descriptor_table && metadata.tracked_ranges.size() == 1);
+    }
+
+    ShaderToggler::EpochDomain::Reclaim();
+    mock::dispatch<addon_event::init_pipeline_layout>(&context.dev, 1u, single, pipeline_layout{ 79 });
+    CHECK(tracking.get_pipeline_layout_index({ 79 }) == index);
+    CHECK(tracking.get_pipeline_layout_metadata(index).params.size() == 1);
+}
+
+static void testBarrierTrackingThroughEvents()
+{
+    MockContext context(device_api::d3d12);
+    state_tracking& state = context.state();
+
+    const resource tracked = { 0x1000 };
+    const resource other = { 0x2000 };
+    state.start_resource_barrier_tracking(tracked, resource_usage::render_target);
+
+    const resource resources[] = { other, tracked };
+    const resource_usage old_states[] = { resource_usage::undefined, resource_usage::render_target };
+    const resource_usage new_states[] = { resource_usage::copy_dest, resource_usage::shader_resource };
+    mock::dispatch<addon_event::barrier>(&context.cmd, 2u, resources, old_states, new_states);
+
+    CHECK(state.stop_resource_barrier_tracking(tracked) == resource_usage::shader_resource);
+    CHECK(state.stop_resource_barrier_tracking(other) == resource_usage::undefined);
+    CHECK(state.resource_barrier_track.empty());
+}
+
+int main()
+{
+    state_tracking::register_events(true);
+
+    testBarrierTracker();
+    testInlineVector();
+    testCaptureAndRestore();
+    testDescriptorTables();
+    testHeapOffsetCache();
+    testLayoutMetadataRecycling();
+    testBarrierTrackingThroughEvents();
+
+    state_tracking::unregister_events();
+    CHECK(mock::callbacks<addon_event::bind_pipeline>.empty());
+    CHECK(mock::callbacks<addon_event::update_descriptor_tables>.empty());
+
+    return 0;
+}
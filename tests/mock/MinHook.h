@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Stand-in for MinHook, which game hooks (GameHookT) are installed with. Nothing gets hooked on Linux, every call fails.
+
+#pragma once
+
+#include "windows.h"
+
+typedef enum MH_STATUS
+{
+    MH_UNKNOWN = -1,
+    MH_OK = 0,
+    MH_ERROR_NOT_INITIALIZED = 2,
+} MH_STATUS;
+
+#define MH_ALL_HOOKS nullptr
+
+inline MH_STATUS MH_Initialize() { return MH_ERROR_NOT_INITIALIZED; }
+inline MH_STATUS MH_Uninitialize() { return MH_ERROR_NOT_INITIALIZED; }
+inline MH_STATUS MH_CreateHook(void*, void*, void**) { return MH_ERROR_NOT_INITIALIZED; }
+inline MH_STATUS MH_CreateHookApi(const wchar_t*, const char*, void*, void**) { return MH_ERROR_NOT_INITIALIZED; }
+inline MH_STATUS MH_EnableHook(void*) { return MH_ERROR_NOT_INITIALIZED; }
+inline MH_STATUS MH_DisableHook(void*) { return MH_ERROR_NOT_INITIALIZED; }
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Minimal stand-in for the ReShade 5.8 addon API, just enough to build the platform independent parts of the addon on Linux and drive
+// them from tests. The API objects are split over the reshade_api*.hpp headers like in ReShade. Registered events are kept per event and
+// can be invoked with reshade::mock::dispatch.
+
+#pragma once
+
+#include <vector>
+#include "reshade_api.hpp"
+
+namespace reshade
+{
+    enum class addon_event
+    {
+        init_device, destroy_device, init_command_list, destroy_command_list, reset_command_list, execute_secondary_command_list,
+        init_pipeline_layout, destroy_pipeline_layout, destroy_pipeline, destroy_resource_view, copy_descriptor_tables, update_descriptor_tables,
+        barrier, bind_render_targets_and_depth_stencil, bind_pipeline, bind_pipeline_states, bind_viewports, bind_scissor_rects,
+        bind_descriptor_tables, push_descriptors, push_constants, reshade_present,
+        init_resource, destroy_resource, init_pipeline, draw, dispatch, present, init_effect_runtime, destroy_effect_runtime, reshade_reloaded_effects
+    };
+
+    template<addon_event ev>
+    struct addon_event_traits;
+
+#define RESHADE_MOCK_EVENT(ev, ...) \
+    template<> \
+    struct addon_event_traits<addon_event::ev> { using decl = __VA_ARGS__; };
+
+    RESHADE_MOCK_EVENT(init_device, void(*)(api::device*))
+    RESHADE_MOCK_EVENT(destroy_device, void(*)(api::device*))
+    RESHADE_MOCK_EVENT(init_command_list, void(*)(api::command_list*))
+    RESHADE_MOCK_EVENT(destroy_command_list, void(*)(api::command_list*))
+    RESHADE_MOCK_EVENT(reset_command_list, void(*)(api::command_list*))
+    RESHADE_MOCK_EVENT(execute_secondary_command_list, void(*)(api::command_list*, api::command_list*))
+    RESHADE_MOCK_EVENT(init_pipeline_layout, void(*)(api::device*, uint32_t, const api::pipeline_layout_param*, api::pipeline_layout))
+    RESHADE_MOCK_EVENT(destroy_pipeline_layout, void(*)(api::device*, api::pipeline_layout))
+    RESHADE_MOCK_EVENT(destroy_pipeline, void(*)(api::device*, api::pipeline))
+    RESHADE_MOCK_EVENT(destroy_resource_view, void(*)(api::device*, api::resource_view))
+    RESHADE_MOCK_EVENT(copy_descriptor_tables, bool(*)(api::device*, uint32_t, const api::descriptor_table_copy*))
+    RESHADE_MOCK_EVENT(update_descriptor_tables, bool(*)(api::device*, uint32_t, const api::descriptor_table_update*))
+    RESHADE_MOCK_EVENT(barrier, void(*)(api::command_list*, uint32_t, const api::resource*, const api::resource_usage*, const api::resource_usage*))
+    RESHADE_MOCK_EVENT(bind_render_targets_and_depth_stencil, void(*)(api::command_list*, uint32_t, const api::resource_view*, api::resource_view))
+    RESHADE_MOCK_EVENT(bind_pipeline, void(*)(api::command_list*, api::pipeline_stage, api::pipeline))
+    RESHADE_MOCK_EVENT(bind_pipeline_states, void(*)(api::command_list*, uint32_t, const api::dynamic_state*, const uint32_t*))
+    RESHADE_MOCK_EVENT(bind_viewports, void(*)(api::command_list*, uint32_t, uint32_t, const api::viewport*))
+    RESHADE_MOCK_EVENT(bind_scissor_rects, void(*)(api::command_list*, uint32_t, uint32_t, const api::rect*))
+    RESHADE_MOCK_EVENT(bind_descriptor_tables, void(*)(api::command_list*, api::shader_stage, api::pipeline_layout, uint32_t, uint32_t, const api::descriptor_table*))
+    RESHADE_MOCK_EVENT(push_descriptors, void(*)(api::command_list*, api::shader_stage, api::pipeline_layout, uint32_t, const api::descriptor_table_update&))
+    RESHADE_MOCK_EVENT(push_constants, void(*)(api::command_list*, api::shader_stage, api::pipeline_layout, uint32_t, uint32_t, uint32_t, const void*))
+    RESHADE_MOCK_EVENT(reshade_present, void(*)(api::effect_runtime*))
+    RESHADE_MOCK_EVENT(init_resource, void(*)(api::device*, const api::resource_desc&, const api::subresource_data*, api::resource_usage, api::resource))
+    RESHADE_MOCK_EVENT(destroy_resource, void(*)(api::device*, api::resource))
+    RESHADE_MOCK_EVENT(init_pipeline, void(*)(api::device*, api::pipeline_layout, uint32_t, const api::pipeline_subobject*, api::pipeline))
+    RESHADE_MOCK_EVENT(draw, bool(*)(api::command_list*, uint32_t, uint32_t, uint32_t, uint32_t))
+    RESHADE_MOCK_EVENT(dispatch, bool(*)(api::command_list*, uint32_t, uint32_t, uint32_t))
+    RESHADE_MOCK_EVENT(present, void(*)(api::command_queue*, api::swapchain*, const api::rect*, const api::rect*, uint32_t, const api::rect*))
+    RESHADE_MOCK_EVENT(init_effect_runtime, void(*)(api::effect_runtime*))
+    RESHADE_MOCK_EVENT(destroy_effect_runtime, void(*)(api::effect_runtime*))
+    RESHADE_MOCK_EVENT(reshade_reloaded_effects, void(*)(api::effect_runtime*))
+#undef RESHADE_MOCK_EVENT
+
+    namespace mock
+    {
+        template<addon_event ev>
+        inline std::vector<typename addon_event_traits<ev>::decl> callbacks;
+
+        /// <summary>
+        /// Invokes the callbacks registered for ev in registration order, like ReShade does when the event occurs.
+        /// </summary>
+        template<addon_event ev, typename... Args>
+        void dispatch(Args&&... args)
+        {
+            for (auto callback : callbacks<ev>)
+            {
+                callback(args...);
+            }
+        }
+    }
+
+    template<addon_event ev>
+    void register_event(typename addon_event_traits<ev>::decl callback)
+    {
+        mock::callbacks<ev>.push_back(callback);
+    }
+
+    template<addon_event ev>
+    void unregister_event(typename addon_event_traits<ev>::decl callback)
+    {
+        std::erase(mock::callbacks<ev>, callback);
+    }
+
+    /// <summary>
+    /// The mock has no ReShade.ini, configuration values are never found.
+    /// </summary>
+    inline bool get_config_value(api::effect_runtime*, const char*, const char*, char*, size_t*) { return false; }
+    template<typename T>
+    bool get_config_value(api::effect_runtime*, const char*, const char*, T&) { return false; }
+    inline void set_config_value(api::effect_runtime*, const char*, const char*, const char*) {}
+    template<typename T>
+    void set_config_value(api::effect_runtime*, const char*, const char*, const T&) {}
+
+    namespace log
+    {
+        enum class level { error = 1, warning = 2, info = 3, debug = 4 };
+
+        inline void message(level, const char*) {}
+    }
+}
@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Swapchains and effect runtimes of the mock ReShade API. A runtime holds the techniques and uniform variables a test adds to it, in the
+// order they were added, and counts the calls rendering techniques or updating bindings and uniforms like command lists do.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "reshade_api_device.hpp"
+
+namespace reshade
+{
+    namespace api
+    {
+        RESHADE_MOCK_HANDLE(effect_technique)
+        RESHADE_MOCK_HANDLE(effect_uniform_variable)
+        RESHADE_MOCK_HANDLE(effect_texture_variable)
+
+        struct swapchain_desc
+        {
+            resource_desc back_buffer;
+            uint32_t back_buffer_count = 2;
+        };
+
+        struct swapchain : api_object
+        {
+            explicit swapchain(device* parent) : parent(parent) {}
+
+            device* get_device() const { return parent; }
+            uint32_t get_back_buffer_count() const { return static_cast<uint32_t>(back_buffers.size()); }
+            resource get_back_buffer(uint32_t index) const { return index < back_buffers.size() ? back_buffers[index] : resource{ 0 }; }
+            resource get_current_back_buffer() const { return get_back_buffer(current_back_buffer); }
+
+            /// <summary>
+            /// Creates the back buffers on the device and makes the first one current.
+            /// </summary>
+            void create_back_buffers(uint32_t width, uint32_t height, format format, uint32_t count = 2)
+            {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    resource back_buffer = { 0 };
+                    parent->create_resource(resource_desc(width, height, 1, 1, format, 1, memory_heap::gpu_only, resource_usage::render_target | resource_usage::shader_resource), nullptr, resource_usage::present, &back_buffer);
+                    back_buffers.push_back(back_buffer);
+                }
+                current_back_buffer = 0;
+            }
+
+            /// <summary>
+            /// Advances to the next back buffer, as presenting does.
+            /// </summary>
+            void present()
+            {
+                current_back_buffer = back_buffers.empty() ? 0 : (current_back_buffer + 1) % static_cast<uint32_t>(back_buffers.size());
+            }
+
+            device* parent;
+            std::vector<resource> back_buffers;
+            uint32_t current_back_buffer = 0;
+        };
+
+        struct effect_runtime : swapchain
+        {
+            effect_runtime(device* parent, command_queue* queue) : swapchain(parent), queue(queue) {}
+
+            command_queue* get_command_queue() const { return queue; }
+
+            bool get_effects_state() const { return effects_enabled; }
+            void set_effects_state(bool enabled) { effects_enabled = enabled; }
+
+            void get_screenshot_width_and_height(uint32_t* width, uint32_t* height) const
+            {
+                const resource_desc desc = parent->get_resource_desc(get_current_back_buffer());
+                *width = desc.texture.width;
+                *height = desc.texture.height;
+            }
+
+            /// <summary>
+            /// The mock has no input, keys are never down.
+            /// </summary>
+            bool is_key_down(uint32_t) const { return false; }
+            bool is_key_pressed(uint32_t) const { return false; }
+
+            struct mock_technique
+            {
+                std::string name;
+                std::string effect_name;
+                bool enabled;
+            };
+
+            struct mock_uniform_variable
+            {
+                std::string name;
+                std::string source;		// the source annotation, empty if the variable has none
+                format base_type;
+                uint32_t rows;
+                uint32_t columns;
+                uint32_t array_length;
+                std::vector<uint8_t> value;
+            };
+
+            effect_technique add_technique(std::string name, std::string effect_name, bool enabled = false)
+            {
+                techniques.push_back(mock_technique{ std::move(name), std::move(effect_name), enabled });
+                return { techniques.size() };
+            }
+
+            effect_uniform_variable add_uniform_variable(std::string name, std::string source, format base_type, uint32_t rows, uint32_t columns = 1, uint32_t array_length = 0)
+            {
+                const size_t size = static_cast<size_t>(rows) * columns * std::max(array_length, 1u) * 4;
+                uniforms.push_back(mock_uniform_variable{ std::move(name), std::move(source), base_type, rows, columns, array_length, std::vector<uint8_t>(size, 0) });
+                return { uniforms.size() };
+            }
+
+            mock_technique* technique(effect_technique handle) { return handle.handle - 1 < techniques.size() ? &techniques[handle.handle - 1] : nullptr; }
+            const mock_technique* technique(effect_technique handle) const { return handle.handle - 1 < techniques.size() ? &techniques[handle.handle - 1] : nullptr; }
+            mock_uniform_variable* uniform(effect_uniform_variable handle) { return handle.handle - 1 < uniforms.size() ? &uniforms[handle.handle - 1] : nullptr; }
+            const mock_uniform_variable* uniform(effect_uniform_variable handle) const { return handle.handle - 1 < uniforms.size() ? &uniforms[handle.handle - 1] : nullptr; }
+
+            template<typename F>
+            void enumerate_techniques(const char* effect_name, F lambda)
+            {
+                for (size_t i = 0; i < techniques.size(); i++)
+                {
+                    if (effect_name == nullptr || techniques[i].effect_name == effect_name)
+                    {
+                        lambda(this, effect_technique{ i + 1 });
+                    }
+                }
+            }
+
+            template<typename F>
+            void enumerate_uniform_variables(const char* effect_name, F lambda)
+            {
+                for (size_t i = 0; i < uniforms.size(); i++)
+                {
+                    lambda(this, effect_uniform_variable{ i + 1 });
+                }
+            }
+
+            void get_technique_name(effect_technique handle, char* name, size_t* name_size) const
+            {
+                const mock_technique* t = technique(handle);
+                copy_string(t != nullptr ? t->name : std::string_view(), name, name_size);
+            }
+
+            void get_technique_effect_name(effect_technique handle, char* name, size_t* name_size) const
+            {
+                const mock_technique* t = technique(handle);
+                copy_string(t != nullptr ? t->effect_name : std::string_view(), name, name_size);
+            }
+
+            bool get_technique_state(effect_technique handle) const
+            {
+                const mock_technique* t = technique(handle);
+                return t != nullptr && t->enabled;
+            }
+
+            void set_technique_state(effect_technique handle, bool enabled)
+            {
+                if (mock_technique* t = technique(handle))
+                {
+                    t->enabled = enabled;
+                }
+            }
+
+            /// <summary>
+            /// Techniques of the mock have no annotations.
+            /// </summary>
+            bool get_annotation_bool_from_technique(effect_technique, const char*, bool*, size_t, size_t = 0) const { return false; }
+            bool get_annotation_int_from_technique(effect_technique, const char*, int32_t*, size_t, size_t = 0) const { return false; }
+
+            /// <summary>
+            /// Uniform variables only have the source annotation.
+            /// </summary>
+            bool get_annotation_string_from_uniform_variable(effect_uniform_variable handle, const char* name, char* value, size_t* value_size) const
+            {
+                const mock_uniform_variable* u = uniform(handle);
+                if (u == nullptr || u->source.empty() || std::string_view(name) != "source")
+                {
+                    return false;
+                }
+                copy_string(u->source, value, value_size);
+                return true;
+            }
+
+            template<size_t SIZE>
+            bool get_annotation_string_from_uniform_variable(effect_uniform_variable handle, const char* name, char(&value)[SIZE]) const
+            {
+                size_t value_size = SIZE;
+                return get_annotation_string_from_uniform_variable(handle, name, value, &value_size);
+            }
+
+            void get_uniform_variable_type(effect_uniform_variable handle, format* base_type, uint32_t* rows = nullptr, uint32_t* columns = nullptr, uint32_t* array_length = nullptr) const
+            {
+                const mock_uniform_variable* u = uniform(handle);
+                *base_type = u != nullptr ? u->base_type : format::unknown;
+                if (rows != nullptr) *rows = u != nullptr ? u->rows : 0;
+                if (columns != nullptr) *columns = u != nullptr ? u->columns : 0;
+                if (array_length != nullptr) *array_length = u != nullptr ? u->array_length : 0;
+            }
+
+            void set_uniform_value_float(effect_uniform_variable handle, const float* values, size_t count, size_t array_index = 0) { set_uniform_value(handle, values, count, array_index); }
+            void set_uniform_value_int(effect_uniform_variable handle, const int32_t* values, size_t count, size_t array_index = 0) { set_uniform_value(handle, values, count, array_index); }
+            void set_uniform_value_uint(effect_uniform_variable handle, const uint32_t* values, size_t count, size_t array_index = 0) { set_uniform_value(handle, values, count, array_index); }
+
+            void render_technique(effect_technique handle, command_list*, resource_view, resource_view = { 0 })
+            {
+                calls["render_technique"]++;
+                rendered_techniques += technique(handle) != nullptr ? 1 : 0;
+            }
+
+            void render_effects(command_list*, resource_view, resource_view = { 0 }) { calls["render_effects"]++; }
+            void update_texture_bindings(const char*, resource_view, resource_view = { 0 }) { calls["update_texture_bindings"]++; }
+
+            command_queue* queue;
+            bool effects_enabled = true;
+            std::vector<mock_technique> techniques;
+            std::vector<mock_uniform_variable> uniforms;
+            uint64_t rendered_techniques = 0;
+            // Keyed by the name of the call, which are literals
+            std::map<std::string_view, uint32_t> calls;
+
+        private:
+            template<typename T>
+            void set_uniform_value(effect_uniform_variable handle, const T* values, size_t count, size_t array_index)
+            {
+                calls["set_uniform_value"]++;
+
+                mock_uniform_variable* u = uniform(handle);
+                const size_t offset = array_index * static_cast<size_t>(u != nullptr ? u->rows * u->columns : 0) * sizeof(T);
+                if (u != nullptr && offset < u->value.size())
+                {
+                    std::memcpy(u->value.data() + offset, values, std::min(count * sizeof(T), u->value.size() - offset));
+                }
+            }
+
+            /// <summary>
+            /// Copies like ReShade does: as much as fits including the terminator, the size is set to the length of the string plus one.
+            /// </summary>
+            static void copy_string(std::string_view source, char* dest, size_t* dest_size)
+            {
+                if (dest != nullptr && *dest_size > 0)
+                {
+                    const size_t length = std::min(source.size(), *dest_size - 1);
+                    std::memcpy(dest, source.data(), length);
+                    dest[length] = '\0';
+                }
+                *dest_size = source.size() + 1;
+            }
+        };
+    }
+}
@@ -0,0 +1,338 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Devices, command lists and queues of the mock ReShade API. Objects keep their private data in a map keyed by type. Devices translate
+// descriptor tables to heap offsets with a fixed encoding (see device::get_descriptor_heap_offset) and keep the resources and views created
+// through them, with host memory backing buffers so copies and maps move real data. Command lists count the calls made on them, and an
+// observer set on a device sees every resource operation of the device and its command lists in order. None of it is thread safe.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+#include "reshade_api_format.hpp"
+#include "reshade_api_resource.hpp"
+#include "reshade_api_pipeline.hpp"
+
+#ifndef _MSC_VER
+#define __declspec(x)
+#endif
+
+// Calling conventions only matter on Win32; an empty attribute keeps 'void(__fastcall)(...)' a function type.
+#if !defined(_MSC_VER) && !defined(__fastcall)
+#define __fastcall __attribute__(())
+#endif
+
+namespace reshade
+{
+    namespace api
+    {
+        enum class device_api { d3d9 = 0x9000, d3d10 = 0xa000, d3d11 = 0xb000, d3d12 = 0xc000, opengl = 0x10000, vulkan = 0x20000 };
+
+        struct api_object
+        {
+            virtual ~api_object() = default;
+
+            template<typename T>
+            T& create_private_data()
+            {
+                auto& data = private_data[typeid(T)];
+                data = std::shared_ptr<void>(new T(), [](void* object) { delete static_cast<T*>(object); });
+                return *static_cast<T*>(data.get());
+            }
+
+            template<typename T>
+            T& get_private_data() const
+            {
+                return *static_cast<T*>(private_data.at(typeid(T)).get());
+            }
+
+            template<typename T>
+            void destroy_private_data()
+            {
+                private_data.erase(typeid(T));
+            }
+
+            uint64_t get_native() const { return 0; }
+
+        private:
+            std::unordered_map<std::type_index, std::shared_ptr<void>> private_data;
+        };
+
+        struct device : api_object
+        {
+            explicit device(device_api api = device_api::d3d12) : api(api) {}
+
+            device_api get_api() const { return api; }
+
+            /// <summary>
+            /// Tables are encoded as heap << 32 | base offset, bindings are laid out back to back.
+            /// </summary>
+            void get_descriptor_heap_offset(descriptor_table table, uint32_t binding, uint32_t array_offset, descriptor_heap* heap, uint32_t* offset) const
+            {
+                translations++;
+                *heap = { table.handle >> 32 };
+                *offset = static_cast<uint32_t>(table.handle) + binding + array_offset;
+            }
+
+            bool create_resource(const resource_desc& desc, const subresource_data* initial_data, resource_usage, resource* out_resource, void** = nullptr)
+            {
+                if (fail_resource_creation)
+                {
+                    *out_resource = { 0 };
+                    return false;
+                }
+
+                *out_resource = { next_handle += HANDLE_STRIDE };
+                auto& created = resources[out_resource->handle];
+                created.desc = desc;
+                if (desc.type == resource_type::buffer)
+                {
+                    created.contents.assign(static_cast<size_t>(desc.buffer.size), 0);
+                    if (initial_data != nullptr && initial_data->data != nullptr)
+                    {
+                        std::memcpy(created.contents.data(), initial_data->data, created.contents.size());
+                    }
+                }
+                observe("create_resource", out_resource->handle);
+                return true;
+            }
+
+            void destroy_resource(resource res)
+            {
+                resources.erase(res.handle);
+                observe("destroy_resource", res.handle);
+            }
+
+            resource_desc get_resource_desc(resource res) const
+            {
+                const auto it = resources.find(res.handle);
+                return it != resources.end() ? it->second.desc : resource_desc{};
+            }
+
+            /// <summary>
+            /// Buffers map to their host memory, which stays valid until the buffer is destroyed.
+            /// </summary>
+            bool map_buffer_region(resource res, uint64_t offset, uint64_t, map_access, void** out_data)
+            {
+                observe("map_buffer_region", res.handle);
+
+                const auto it = resources.find(res.handle);
+                if (it == resources.end() || it->second.desc.type != resource_type::buffer || offset >= it->second.contents.size())
+                {
+                    *out_data = nullptr;
+                    return false;
+                }
+
+                *out_data = it->second.contents.data() + offset;
+                return true;
+            }
+
+            void unmap_buffer_region(resource res)
+            {
+                observe("unmap_buffer_region", res.handle);
+            }
+
+            bool create_resource_view(resource res, resource_usage, const resource_view_desc& desc, resource_view* out_view)
+            {
+                if (fail_resource_creation || resources.find(res.handle) == resources.end())
+                {
+                    *out_view = { 0 };
+                    return false;
+                }
+
+                *out_view = { next_handle += HANDLE_STRIDE };
+                views[out_view->handle] = { res, desc };
+                observe("create_resource_view", out_view->handle);
+                return true;
+            }
+
+            void destroy_resource_view(resource_view view)
+            {
+                views.erase(view.handle);
+                observe("destroy_resource_view", view.handle);
+            }
+
+            /// <summary>
+            /// Views not created through the device are their own resource, tests binding made up views rely on that.
+            /// </summary>
+            resource get_resource_from_view(resource_view view) const
+            {
+                const auto it = views.find(view.handle);
+                return it != views.end() ? it->second.first : resource{ view.handle };
+            }
+
+            resource_view_desc get_resource_view_desc(resource_view view) const
+            {
+                const auto it = views.find(view.handle);
+                return it != views.end() ? it->second.second : resource_view_desc{};
+            }
+
+            bool create_pipeline_layout(uint32_t, const pipeline_layout_param*, pipeline_layout* out_layout)
+            {
+                *out_layout = { next_handle += HANDLE_STRIDE };
+                observe("create_pipeline_layout", out_layout->handle);
+                return true;
+            }
+
+            void destroy_pipeline_layout(pipeline_layout layout) { observe("destroy_pipeline_layout", layout.handle); }
+
+            bool create_pipeline(pipeline_layout, uint32_t, const pipeline_subobject*, pipeline* out_pipeline)
+            {
+                *out_pipeline = { next_handle += HANDLE_STRIDE };
+                observe("create_pipeline", out_pipeline->handle);
+                return true;
+            }
+
+            void destroy_pipeline(pipeline pipeline) { observe("destroy_pipeline", pipeline.handle); }
+
+            bool create_sampler(const sampler_desc&, sampler* out_sampler)
+            {
+                *out_sampler = { next_handle += HANDLE_STRIDE };
+                observe("create_sampler", out_sampler->handle);
+                return true;
+            }
+
+            void destroy_sampler(sampler sampler) { observe("destroy_sampler", sampler.handle); }
+
+            /// <summary>
+            /// Host memory of a buffer, empty for textures and unknown resources.
+            /// </summary>
+            std::vector<uint8_t>& contents(resource res)
+            {
+                static std::vector<uint8_t> none;
+                const auto it = resources.find(res.handle);
+                return it != resources.end() ? it->second.contents : none;
+            }
+
+            void observe(std::string_view call, uint64_t handle)
+            {
+                if (observer)
+                {
+                    observer(call, handle);
+                }
+            }
+
+            struct mock_resource
+            {
+                resource_desc desc;
+                std::vector<uint8_t> contents;
+            };
+
+            // Handles look like pointers, so code hashing them by their upper bits sees a realistic spread
+            static constexpr uint64_t HANDLE_STRIDE = 0x40;
+
+            device_api api;
+            mutable uint64_t translations = 0;
+            bool fail_resource_creation = false;
+            uint64_t next_handle = 0x10000000;
+            std::unordered_map<uint64_t, mock_resource> resources;
+            std::unordered_map<uint64_t, std::pair<resource, resource_view_desc>> views;
+            std::function<void(std::string_view call, uint64_t handle)> observer;
+        };
+
+        struct command_list : api_object
+        {
+            explicit command_list(device* parent) : parent(parent) {}
+
+            device* get_device() const { return parent; }
+
+            void bind_render_targets_and_depth_stencil(uint32_t, const resource_view*, resource_view = { 0 }) { calls["bind_render_targets_and_depth_stencil"]++; }
+            void bind_pipeline(pipeline_stage, pipeline) { calls["bind_pipeline"]++; }
+            void bind_pipeline_state(dynamic_state, uint32_t) { calls["bind_pipeline_state"]++; }
+            void bind_viewports(uint32_t, uint32_t, const viewport*) { calls["bind_viewports"]++; }
+            void bind_scissor_rects(uint32_t, uint32_t, const rect*) { calls["bind_scissor_rects"]++; }
+            void bind_descriptor_tables(shader_stage, pipeline_layout, uint32_t, uint32_t, const descriptor_table*) { calls["bind_descriptor_tables"]++; }
+            void push_constants(shader_stage, pipeline_layout, uint32_t, uint32_t, uint32_t, const void*) { calls["push_constants"]++; }
+            void push_descriptors(shader_stage, pipeline_layout, uint32_t, const descriptor_table_update&) { calls["push_descriptors"]++; }
+            void bind_vertex_buffer(uint32_t, resource, uint64_t, uint32_t) { calls["bind_vertex_buffer"]++; }
+            void draw(uint32_t, uint32_t, uint32_t, uint32_t) { calls["draw"]++; }
+            void barrier(resource, resource_usage, resource_usage) { calls["barrier"]++; }
+            void barrier(uint32_t, const resource*, const resource_usage*, const resource_usage*) { calls["barrier"]++; }
+            void clear_render_target_view(resource_view, const float[4], uint32_t = 0, const rect* = nullptr) { calls["clear_render_target_view"]++; }
+
+            /// <summary>
+            /// Only buffers carry contents, texture copies are counted but otherwise dropped.
+            /// </summary>
+            void copy_resource(resource source, resource dest)
+            {
+                calls["copy_resource"]++;
+
+                const std::vector<uint8_t>& from = parent->contents(source);
+                std::vector<uint8_t>& to = parent->contents(dest);
+                std::memcpy(to.data(), from.data(), std::min(from.size(), to.size()));
+                parent->observe("copy_resource", dest.handle);
+            }
+
+            /// <summary>
+            /// Copies right away, the mock has no GPU timeline.
+            /// </summary>
+            void copy_buffer_region(resource source, uint64_t source_offset, resource dest, uint64_t dest_offset, uint64_t size)
+            {
+                calls["copy_buffer_region"]++;
+
+                const std::vector<uint8_t>& from = parent->contents(source);
+                std::vector<uint8_t>& to = parent->contents(dest);
+                if (source_offset < from.size() && dest_offset < to.size())
+                {
+                    size = std::min({ size, from.size() - source_offset, to.size() - dest_offset });
+                    std::memcpy(to.data() + dest_offset, from.data() + source_offset, static_cast<size_t>(size));
+                }
+                parent->observe("copy_buffer_region", dest.handle);
+            }
+
+            device* parent;
+            // Keyed by the name of the call, which are literals
+            std::map<std::string_view, uint32_t> calls;
+        };
+
+        struct command_queue : api_object
+        {
+            explicit command_queue(command_list* immediate) : immediate(immediate) {}
+
+            device* get_device() const { return immediate->get_device(); }
+            command_list* get_immediate_command_list() const { return immediate; }
+            void wait_idle() const {}
+
+            command_list* immediate;
+        };
+    }
+}
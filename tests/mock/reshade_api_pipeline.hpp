@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Pipeline, layout and descriptor types of the mock ReShade API.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "reshade_api_resource.hpp"
+
+namespace reshade
+{
+    namespace api
+    {
+        RESHADE_MOCK_HANDLE(pipeline)
+        RESHADE_MOCK_HANDLE(pipeline_layout)
+        RESHADE_MOCK_HANDLE(descriptor_table)
+        RESHADE_MOCK_HANDLE(descriptor_heap)
+
+        struct viewport { float x, y, width, height, min_depth, max_depth; };
+
+        enum class pipeline_stage : uint32_t
+        {
+            vertex_shader = 0x8, hull_shader = 0x10, domain_shader = 0x20, geometry_shader = 0x40, pixel_shader = 0x80, compute_shader = 0x800,
+            input_assembler = 0x2, stream_output = 0x4, rasterizer = 0x100, depth_stencil = 0x200, output_merger = 0x400,
+            all = 0x7FFFFFFF, all_graphics = 0x7FF
+        };
+        RESHADE_MOCK_ENUM_FLAG_OPERATORS(pipeline_stage)
+
+        enum class shader_stage : uint32_t { vertex = 0x1, hull = 0x2, domain = 0x4, geometry = 0x8, pixel = 0x10, compute = 0x20, all = 0x7FFFFFFF, all_graphics = 0x1F };
+        RESHADE_MOCK_ENUM_FLAG_OPERATORS(shader_stage)
+
+        enum class dynamic_state : uint32_t { primitive_topology, blend_constant, sample_mask, front_stencil_reference_value, back_stencil_reference_value };
+        enum class primitive_topology : uint32_t { undefined = 0, point_list = 1, line_list = 2, line_strip = 3, triangle_list = 4, triangle_strip = 5 };
+        enum class descriptor_type : uint32_t { sampler = 0, sampler_with_resource_view = 1, shader_resource_view = 2, unordered_access_view = 3, constant_buffer = 6, shader_storage_buffer = 7 };
+
+        struct buffer_range { resource buffer; uint64_t offset; uint64_t size; };
+        struct sampler_with_resource_view { api::sampler sampler; resource_view view; };
+
+        struct descriptor_range
+        {
+            uint32_t binding;
+            uint32_t dx_register_index;
+            uint32_t dx_register_space;
+            uint32_t count;
+            shader_stage visibility;
+            uint32_t array_size;
+            descriptor_type type;
+        };
+
+        struct constant_range
+        {
+            uint32_t binding;
+            uint32_t dx_register_index;
+            uint32_t dx_register_space;
+            uint32_t count;
+            shader_stage visibility;
+        };
+
+        enum class pipeline_layout_param_type : uint32_t { descriptor_table = 0, push_constants = 1, push_descriptors = 2 };
+
+        struct pipeline_layout_param
+        {
+            pipeline_layout_param() : type(pipeline_layout_param_type::push_constants), push_constants() {}
+            pipeline_layout_param(const constant_range& range) : type(pipeline_layout_param_type::push_constants), push_constants(range) {}
+            pipeline_layout_param(const descriptor_range& range) : type(pipeline_layout_param_type::push_descriptors), push_descriptors(range) {}
+            pipeline_layout_param(uint32_t count, const descriptor_range* ranges) : type(pipeline_layout_param_type::descriptor_table), descriptor_table{ count, ranges } {}
+
+            pipeline_layout_param_type type;
+            union
+            {
+                constant_range push_constants;
+                descriptor_range push_descriptors;
+                struct { uint32_t count; const descriptor_range* ranges; } descriptor_table;
+            };
+        };
+
+        struct shader_desc { const void* code; size_t code_size; const char* entry_point = nullptr; };
+
+        struct input_element
+        {
+            uint32_t location;
+            const char* semantic;
+            uint32_t semantic_index;
+            api::format format;
+            uint32_t buffer_binding;
+            uint32_t offset;
+            uint32_t stride;
+            uint32_t instance_step_rate;
+        };
+
+        enum class blend_factor : uint32_t { zero, one, source_color, one_minus_source_color, dest_color, one_minus_dest_color, source_alpha, one_minus_source_alpha, dest_alpha, one_minus_dest_alpha };
+        enum class blend_op : uint32_t { add, subtract, reverse_subtract, min, max };
+        enum class cull_mode : uint32_t { none = 0, front = 1, back = 2, front_and_back = 3 };
+        enum class fill_mode : uint32_t { solid = 0, wireframe = 1, point = 2 };
+
+        struct blend_desc
+        {
+            bool alpha_to_coverage_enable = false;
+            bool blend_enable[8] = {};
+            blend_factor source_color_blend_factor[8] = { blend_factor::one, blend_factor::one, blend_factor::one, blend_factor::one, blend_factor::one, blend_factor::one, blend_factor::one, blend_factor::one };
+            blend_factor dest_color_blend_factor[8] = {};
+            blend_op color_blend_op[8] = {};
+            blend_factor source_alpha_blend_factor[8] = { blend_factor::one, blend_factor::one, blend_factor::one, blend_factor::one, blend_factor::one, blend_factor::one, blend_factor::one, blend_factor::one };
+            blend_factor dest_alpha_blend_factor[8] = {};
+            blend_op alpha_blend_op[8] = {};
+            uint8_t render_target_write_mask[8] = { 0xF, 0xF, 0xF, 0xF, 0xF, 0xF, 0xF, 0xF };
+        };
+
+        struct rasterizer_desc
+        {
+            api::fill_mode fill_mode = api::fill_mode::solid;
+            api::cull_mode cull_mode = api::cull_mode::back;
+            bool front_counter_clockwise = false;
+            bool depth_clip_enable = true;
+            bool scissor_enable = false;
+        };
+
+        enum class pipeline_subobject_type : uint32_t { unknown, vertex_shader, hull_shader, domain_shader, geometry_shader, pixel_shader, compute_shader, input_layout, stream_output_state, blend_state, rasterizer_state, depth_stencil_state };
+
+        struct pipeline_subobject { pipeline_subobject_type type; uint32_t count; void* data; };
+
+        struct descriptor_table_update { descriptor_table table; uint32_t binding; uint32_t array_offset; uint32_t count; descriptor_type type; const void* descriptors; };
+        struct descriptor_table_copy { descriptor_table source_table; uint32_t source_binding; uint32_t source_array_offset; descriptor_table dest_table; uint32_t dest_binding; uint32_t dest_array_offset; uint32_t count; };
+    }
+}
@@ -0,0 +1,194 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Resource, view and sampler descriptions of the mock ReShade API, laid out like the ones of ReShade 5.8.
+
+#pragma once
+
+#include <cstdint>
+#include "reshade_api_format.hpp"
+
+#define RESHADE_MOCK_HANDLE(name) \
+    struct name \
+    { \
+        uint64_t handle; \
+        constexpr bool operator==(const name& other) const { return handle == other.handle; } \
+        constexpr bool operator==(uint64_t other) const { return handle == other; } \
+    };
+
+#define RESHADE_MOCK_ENUM_FLAG_OPERATORS(type) \
+    constexpr type operator~(type a) { return static_cast<type>(~static_cast<uint32_t>(a)); } \
+    constexpr type operator&(type a, type b) { return static_cast<type>(static_cast<uint32_t>(a) & static_cast<uint32_t>(b)); } \
+    constexpr type operator|(type a, type b) { return static_cast<type>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b)); } \
+    constexpr type operator^(type a, type b) { return static_cast<type>(static_cast<uint32_t>(a) ^ static_cast<uint32_t>(b)); } \
+    constexpr type& operator&=(type& a, type b) { return a = a & b; } \
+    constexpr type& operator|=(type& a, type b) { return a = a | b; } \
+    constexpr type& operator^=(type& a, type b) { return a = a ^ b; }
+
+namespace reshade
+{
+    namespace api
+    {
+        RESHADE_MOCK_HANDLE(resource)
+        RESHADE_MOCK_HANDLE(resource_view)
+        RESHADE_MOCK_HANDLE(sampler)
+
+        enum class resource_type : uint32_t { unknown, buffer, texture_1d, texture_2d, texture_3d, surface };
+        enum class resource_view_type : uint32_t
+        {
+            unknown, buffer, texture_1d, texture_1d_array, texture_2d, texture_2d_array, texture_2d_multisample, texture_2d_multisample_array, texture_3d, texture_cube, texture_cube_array
+        };
+        enum class memory_heap : uint32_t { unknown, gpu_only, cpu_to_gpu, gpu_to_cpu, cpu_only, custom };
+        enum class map_access { read_only, write_only, read_write, write_discard };
+
+        enum class resource_usage : uint32_t
+        {
+            undefined = 0x0,
+            index_buffer = 0x2,
+            vertex_buffer = 0x1,
+            constant_buffer = 0x8000,
+            stream_output = 0x100,
+            indirect_argument = 0x200,
+            depth_stencil = 0x30,
+            depth_stencil_read = 0x20,
+            depth_stencil_write = 0x10,
+            render_target = 0x4,
+            shader_resource = 0xC0,
+            shader_resource_pixel = 0x80,
+            shader_resource_non_pixel = 0x40,
+            unordered_access = 0x8,
+            copy_dest = 0x400,
+            copy_source = 0x800,
+            resolve_dest = 0x1000,
+            resolve_source = 0x2000,
+            general = 0x80000000,
+            present = 0x80000000 | render_target | copy_source,
+            cpu_access = vertex_buffer | index_buffer | shader_resource | indirect_argument | copy_source
+        };
+        RESHADE_MOCK_ENUM_FLAG_OPERATORS(resource_usage)
+
+        enum class resource_flags : uint32_t { none = 0, dynamic = 0x8, cube_compatible = 0x4, generate_mipmaps = 0x1, shared = 0x2, sparse_binding = 0x10 };
+        RESHADE_MOCK_ENUM_FLAG_OPERATORS(resource_flags)
+
+        struct resource_desc
+        {
+            constexpr resource_desc() : texture() {}
+            constexpr resource_desc(uint64_t size, memory_heap heap, resource_usage usage, resource_flags flags = resource_flags::none) :
+                type(resource_type::buffer), buffer({ size, 0 }), heap(heap), usage(usage), flags(flags) {}
+            constexpr resource_desc(uint32_t width, uint32_t height, uint16_t layers, uint16_t levels, api::format format, uint16_t samples, memory_heap heap, resource_usage usage, resource_flags flags = resource_flags::none) :
+                type(resource_type::texture_2d), texture({ width, height, layers, levels, format, samples }), heap(heap), usage(usage), flags(flags) {}
+
+            resource_type type = resource_type::unknown;
+            union
+            {
+                struct
+                {
+                    uint64_t size;
+                    uint32_t stride;
+                } buffer;
+                struct
+                {
+                    uint32_t width;
+                    uint32_t height;
+                    uint16_t depth_or_layers;
+                    uint16_t levels;
+                    api::format format;
+                    uint16_t samples;
+                } texture;
+            };
+            memory_heap heap = memory_heap::unknown;
+            resource_usage usage = resource_usage::undefined;
+            resource_flags flags = resource_flags::none;
+        };
+
+        struct resource_view_desc
+        {
+            constexpr resource_view_desc() : texture() {}
+            constexpr resource_view_desc(api::format format, uint64_t offset, uint64_t size) : type(resource_view_type::buffer), format(format), buffer({ offset, size }) {}
+            constexpr resource_view_desc(resource_view_type type, api::format format, uint32_t first_level, uint32_t levels, uint32_t first_layer, uint32_t layers) :
+                type(type), format(format), texture({ first_level, levels, first_layer, layers }) {}
+            constexpr explicit resource_view_desc(api::format format) : type(resource_view_type::texture_2d), format(format), texture({ 0, 1, 0, 1 }) {}
+
+            resource_view_type type = resource_view_type::unknown;
+            api::format format = api::format::unknown;
+            union
+            {
+                struct
+                {
+                    uint64_t offset;
+                    uint64_t size;
+                } buffer;
+                struct
+                {
+                    uint32_t first_level;
+                    uint32_t level_count;
+                    uint32_t first_layer;
+                    uint32_t layer_count;
+                } texture;
+            };
+        };
+
+        struct subresource_data
+        {
+            void* data = nullptr;
+            uint32_t row_pitch = 0;
+            uint32_t slice_pitch = 0;
+        };
+
+        struct subresource_box
+        {
+            int32_t left, top, front;
+            int32_t right, bottom, back;
+        };
+
+        struct rect { int32_t left, top, right, bottom; };
+
+        enum class filter_mode : uint32_t { min_mag_mip_point = 0, min_mag_mip_linear = 0x15, anisotropic = 0x55 };
+        enum class texture_address_mode : uint32_t { wrap = 1, mirror = 2, clamp = 3, border = 4, mirror_once = 5 };
+        enum class compare_op : uint32_t { never, less, equal, less_equal, greater, not_equal, greater_equal, always };
+
+        struct sampler_desc
+        {
+            filter_mode filter = filter_mode::min_mag_mip_linear;
+            texture_address_mode address_u = texture_address_mode::clamp;
+            texture_address_mode address_v = texture_address_mode::clamp;
+            texture_address_mode address_w = texture_address_mode::clamp;
+            float mip_lod_bias = 0.0f;
+            float max_anisotropy = 1.0f;
+            api::compare_op compare_op = api::compare_op::always;
+            float border_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            float min_lod = -3.402823466e+38f;
+            float max_lod = +3.402823466e+38f;
+        };
+    }
+}
@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////
+//
+// Part of ShaderToggler, a shader toggler add on for Reshade 5+ which allows you
+// to define groups of shaders to toggle them on/off with one key press
+// 
+// (c) Frans 'Otis_Inf' Bouma.
+//
+// All rights reserved.
+// https://github.com/FransBouma/ShaderToggler
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met :
+//
+//  * Redistributions of source code must retain the above copyright notice, this
+//	  list of conditions and the following disclaimer.
+//
+//  * Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and / or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////
+
+
+// Stand-in for the parts of the Windows headers and the MSVC runtime that the addon sources built by the tests use, through stdafx.h.
+
+#pragma once
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <strings.h>
+
+typedef unsigned long DWORD;
+typedef unsigned short WORD;
+typedef unsigned char BYTE;
+typedef int BOOL;
+typedef wchar_t WCHAR;
+typedef const char* LPCSTR;
+typedef const wchar_t* LPCWSTR;
+typedef const char* LPCTSTR;
+typedef void* HMODULE;
+typedef void* HRSRC;
+typedef void* HGLOBAL;
+
+#if !defined(_MSC_VER) && !defined(__fastcall)
+#define __fastcall __attribute__(())
+#endif
+
+#define MAX_PATH 260
+#define _TRUNCATE (static_cast<size_t>(-1))
+#define ARRAYSIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define VK_SHIFT 0x10
+#define VK_CONTROL 0x11
+#define VK_MENU 0x12
+#define VK_CAPITAL 0x14
+#define VK_XBUTTON2 0x06
+#define VK_NUMPAD1 0x61
+#define VK_NUMPAD2 0x62
+#define VK_NUMPAD3 0x63
+#define VK_NUMPAD4 0x64
+#define VK_NUMPAD5 0x65
+#define VK_NUMPAD6 0x66
+#define VK_NUMPAD7 0x67
+#define VK_NUMPAD8 0x68
+#define VK_ADD 0x6B
+#define VK_SUBTRACT 0x6D
+
+#define GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS 0x4
+#define MAKEINTRESOURCE(id) (reinterpret_cast<LPCTSTR>(static_cast<uintptr_t>(id)))
+#define RT_RCDATA MAKEINTRESOURCE(10)
+
+/// <summary>
+/// There's no module to take the name of, game hooks don't get installed.
+/// </summary>
+inline DWORD GetModuleFileNameA(HMODULE, char*, DWORD) { return 0; }
+inline DWORD GetModuleFileNameW(HMODULE, WCHAR*, DWORD) { return 0; }
+inline BOOL GetModuleHandleEx(DWORD, LPCTSTR, HMODULE* module) { *module = nullptr; return 1; }
+
+/// <summary>
+/// Every embedded resource (the addon's shaders) is the same few bytes, enough for the mock device to create pipelines from.
+/// </summary>
+inline HRSRC FindResource(HMODULE, LPCTSTR, LPCTSTR)
+{
+    static const char data[16] = { 'D', 'X', 'B', 'C' };
+    return const_cast<char*>(data);
+}
+inline DWORD SizeofResource(HMODULE, HRSRC) { return 16; }
+inline HGLOBAL LoadResource(HMODULE, HRSRC resource) { return resource; }
+inline void* LockResource(HGLOBAL data) { return data; }
+
+template<size_t size>
+inline int _snprintf_s(char (&buffer)[size], size_t count, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const int length = std::vsnprintf(buffer, count < size ? count + 1 : size, format, args);
+    va_end(args);
+    return length;
+}
+
+inline int _vsnprintf_s(char* buffer, size_t size, const char* format, va_list args)
+{
+    return std::vsnprintf(buffer, size, format, args);
+}
+
+inline char* strtok_s(char* str, const char* delimiters, char** context)
+{
+    return strtok_r(str, delimiters, context);
+}
+
+inline int _stricmp(const char* lhs, const char* rhs)
+{
+    return strcasecmp(lhs, rhs);
+}